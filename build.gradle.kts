@@ -3,4 +3,6 @@ plugins {
     id("com.android.application") version "8.1.3" apply false
     id("org.jetbrains.kotlin.android") version "1.9.20" apply false
     id("com.android.library") version "8.1.3" apply false
+    id("org.jetbrains.kotlin.jvm") version "1.9.20" apply false
+    id("androidx.benchmark") version "1.2.4" apply false
 }
\ No newline at end of file
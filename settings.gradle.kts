@@ -16,3 +16,5 @@ dependencyResolutionManagement {
 rootProject.name = "SQLiteCloud Sample App"
 include(":app")
 include(":sqlitecloud")
+include(":sqlitecloud-ksp")
+include(":sqlitecloud-benchmark")
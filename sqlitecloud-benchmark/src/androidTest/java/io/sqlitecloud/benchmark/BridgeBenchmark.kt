@@ -0,0 +1,181 @@
+package io.sqlitecloud.benchmark
+
+import android.os.Debug
+import android.util.Log
+import androidx.benchmark.junit4.BenchmarkRule
+import androidx.benchmark.junit4.measureRepeated
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import io.sqlitecloud.SQLiteCloud
+import io.sqlitecloud.SQLiteCloudColumnarRowset
+import io.sqlitecloud.SQLiteCloudCommand
+import io.sqlitecloud.SQLiteCloudConfig
+import io.sqlitecloud.SQLiteCloudResult
+import io.sqlitecloud.SQLiteCloudValue
+import kotlinx.coroutines.runBlocking
+import org.junit.Rule
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+
+/**
+ * Benchmarks of the JNI bridge on the device: the per-cell path of [SQLiteCloud.execute], the
+ * array path of a command with parameters, and the bulk paths of [SQLiteCloud.executeRowset] and
+ * [SQLiteCloud.executeColumnar].
+ *
+ * The replies are replayed from a recording (see [WireRecording]) instead of a server, so the
+ * numbers are those of the bridge and of the parser. Besides the time and allocations per command
+ * reported by the benchmark library, every benchmark logs its ns/cell, allocations/row and GC count
+ * over a pass of [REPLIES] commands:
+ *
+ * ```
+ * ./gradlew :sqlitecloud-benchmark:connectedReleaseAndroidTest
+ * adb logcat -s SQLiteCloudBenchmark
+ * ```
+ */
+@RunWith(AndroidJUnit4::class)
+class BridgeBenchmark {
+    @get:Rule
+    val benchmarkRule = BenchmarkRule()
+
+    private val context = InstrumentationRegistry.getInstrumentation().targetContext
+
+    @Test
+    fun executePerCell() {
+        val recording = WireRecording.rowset(File(context.cacheDir, "rowset.wire"), ROWS, REPLIES)
+        measure("execute", recording, ROWS) { sqliteCloud ->
+            val rowset = (sqliteCloud.execute(SQLiteCloudCommand(QUERY)) as SQLiteCloudResult.Rowset).value
+            var sink = 0L
+            for (row in rowset.rows) for (value in row) sink += cell(value)
+            sink
+        }
+    }
+
+    @Test
+    fun executeWithParameters() {
+        val recording = WireRecording.ok(File(context.cacheDir, "ok.wire"), REPLIES)
+        val parameters = listOf(
+            SQLiteCloudValue.Integer(42),
+            SQLiteCloudValue.String("player 42"),
+            SQLiteCloudValue.Double(52.5),
+            SQLiteCloudValue.String("player42@sqlitecloud.io"),
+            SQLiteCloudValue.Integer(1_700_000_042L),
+            SQLiteCloudValue.String("note of the row 42, long enough to cross the inline buffers"),
+            SQLiteCloudValue.Integer(42),
+            SQLiteCloudValue.Null,
+        )
+        val command = SQLiteCloudCommand(
+            "INSERT INTO players (${WireRecording.columns.joinToString()}) VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+            parameters,
+        )
+        // one row of parameters per command
+        measure("execute with parameters", recording, 1) { sqliteCloud ->
+            if (sqliteCloud.execute(command) is SQLiteCloudResult.Success) 1L else 0L
+        }
+    }
+
+    @Test
+    fun executeRowset() {
+        val recording = WireRecording.rowset(File(context.cacheDir, "rowset.wire"), ROWS, REPLIES)
+        measure("executeRowset", recording, ROWS) { sqliteCloud ->
+            sqliteCloud.executeRowset(SQLiteCloudCommand(QUERY)).use { rowset ->
+                var sink = 0L
+                for (row in 0 until rowset.rowCount) {
+                    for (column in rowset.columns.indices) sink += cell(rowset.value(row, column))
+                }
+                sink
+            }
+        }
+    }
+
+    @Test
+    fun executeColumnar() {
+        val recording = WireRecording.rowset(File(context.cacheDir, "rowset.wire"), ROWS, REPLIES)
+        measure("executeColumnar", recording, ROWS) { sqliteCloud ->
+            val rowset = sqliteCloud.executeColumnar(SQLiteCloudCommand(QUERY))
+            var sink = 0L
+            for (row in 0 until rowset.rowCount) sink += columnarRow(rowset, row)
+            sink
+        }
+    }
+
+    private fun cell(value: SQLiteCloudValue): Long = when (value) {
+        is SQLiteCloudValue.Integer -> value.value
+        is SQLiteCloudValue.Double -> value.value.toLong()
+        is SQLiteCloudValue.String -> value.value.length.toLong()
+        is SQLiteCloudValue.Blob -> value.value.remaining().toLong()
+        is SQLiteCloudValue.BlobFile -> value.value.length()
+        is SQLiteCloudValue.Null -> 0L
+    }
+
+    // the typed getters of the columns written by WireRecording
+    private fun columnarRow(rowset: SQLiteCloudColumnarRowset, row: Int): Long =
+        rowset.getLong(row, 0) + (rowset.getString(row, 1)?.length ?: 0) +
+            rowset.getDouble(row, 2).toLong() + (rowset.getString(row, 3)?.length ?: 0) +
+            rowset.getLong(row, 4) + (rowset.getString(row, 5)?.length ?: 0) +
+            rowset.getLong(row, 6) + (if (rowset.isNull(row, 7)) 0 else 1)
+
+    private fun connect(recording: File) = SQLiteCloud(
+        appContext = context,
+        config = SQLiteCloudConfig(
+            hostname = "replay",
+            username = "bench",
+            password = "bench",
+            wireReplayPath = recording.path,
+        ),
+        logger = null,
+    ).also { runBlocking { it.connect() } }
+
+    // A connection replays REPLIES commands before its recording runs out, it is then replaced
+    // outside of the measure.
+    private fun measure(name: String, recording: File, rows: Int, block: suspend (SQLiteCloud) -> Long) {
+        var sqliteCloud = connect(recording)
+        var left = REPLIES
+        var sink = 0L
+        benchmarkRule.measureRepeated {
+            if (left == 0) {
+                runWithTimingDisabled {
+                    runBlocking { sqliteCloud.disconnect() }
+                    sqliteCloud = connect(recording)
+                    left = REPLIES
+                }
+            }
+            sink += runBlocking { block(sqliteCloud) }
+            left--
+        }
+        runBlocking { sqliteCloud.disconnect() }
+
+        sqliteCloud = connect(recording)
+        report(name, rows, sqliteCloud, block)
+        runBlocking { sqliteCloud.disconnect() }
+        // the cells read by the block are used, so that reading them is not optimized away
+        Log.v(TAG, "$name: $sink")
+    }
+
+    @Suppress("DEPRECATION")
+    private fun report(name: String, rows: Int, sqliteCloud: SQLiteCloud, block: suspend (SQLiteCloud) -> Long) {
+        val gcCount = Debug.getRuntimeStat("art.gc.gc-count").toLong()
+        Debug.resetGlobalAllocCount()
+        Debug.startAllocCounting()
+        val start = System.nanoTime()
+        runBlocking { repeat(REPLIES) { block(sqliteCloud) } }
+        val elapsed = System.nanoTime() - start
+        Debug.stopAllocCounting()
+        val allocations = Debug.getGlobalAllocCount()
+        val gcs = Debug.getRuntimeStat("art.gc.gc-count").toLong() - gcCount
+
+        val cells = REPLIES.toLong() * rows * WireRecording.columns.size
+        Log.i(
+            TAG, "%s: %.1f ns/cell, %.2f allocations/row, %d GCs over %d rows".format(
+                name, elapsed.toDouble() / cells, allocations.toDouble() / (REPLIES * rows), gcs, REPLIES * rows,
+            )
+        )
+    }
+
+    companion object {
+        private const val TAG = "SQLiteCloudBenchmark"
+        private const val QUERY = "SELECT * FROM players"
+        private const val ROWS = 100
+        private const val REPLIES = 200
+    }
+}
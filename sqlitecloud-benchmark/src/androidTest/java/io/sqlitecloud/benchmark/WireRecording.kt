@@ -0,0 +1,61 @@
+package io.sqlitecloud.benchmark
+
+import java.io.ByteArrayOutputStream
+import java.io.File
+
+/**
+ * Writes the recordings replayed by the benchmarks through [io.sqlitecloud.SQLiteCloudConfig.wireReplayPath],
+ * so that a command of the benchmarks costs what the bridge and the parser spend on it and no network.
+ *
+ * A recording holds the reply to the authentication sent by the connect, then [replies] times the
+ * reply of every command. Only the received frames matter to the replay, the sent ones are skipped.
+ */
+internal object WireRecording {
+    private const val FRAME_IN = '<'.code
+
+    /** The columns of the rowsets: integers, floats and texts of a few sizes, and a null. */
+    val columns = listOf("id", "name", "score", "email", "created", "note", "rank", "deleted")
+
+    fun rowset(file: File, rows: Int, replies: Int): File = write(file, replies, rowsetReply(rows))
+
+    fun ok(file: File, replies: Int): File = write(file, replies, "+2 OK".toByteArray())
+
+    private fun write(file: File, replies: Int, reply: ByteArray): File {
+        file.outputStream().buffered().use { out ->
+            frame(out, "+2 OK".toByteArray())
+            repeat(replies) { frame(out, reply) }
+        }
+        return file
+    }
+
+    private fun frame(out: java.io.OutputStream, bytes: ByteArray) {
+        out.write(FRAME_IN)
+        for (shift in 0 until 32 step 8) out.write(bytes.size ushr shift)
+        out.write(bytes)
+    }
+
+    // *LEN 0:1 ROWS COLS, the column names and the values row by row
+    private fun rowsetReply(rows: Int): ByteArray {
+        val body = ByteArrayOutputStream()
+        fun text(value: String) {
+            val bytes = value.toByteArray()
+            body.write("+${bytes.size} ".toByteArray())
+            body.write(bytes)
+        }
+        columns.forEach { text(it) }
+        for (row in 0 until rows) {
+            body.write(":$row ".toByteArray())
+            text("player $row")
+            body.write(",${row * 1.25} ".toByteArray())
+            text("player$row@sqlitecloud.io")
+            body.write(":${1_700_000_000L + row} ".toByteArray())
+            text("note of the row $row, long enough to cross the inline buffers")
+            body.write(":${row % 100} ".toByteArray())
+            body.write("_ ".toByteArray())
+        }
+
+        val prefix = "0:1 $rows ${columns.size} "
+        val header = "*${prefix.length + body.size()} $prefix"
+        return header.toByteArray() + body.toByteArray()
+    }
+}
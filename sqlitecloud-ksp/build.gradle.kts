@@ -0,0 +1,7 @@
+plugins {
+    id("org.jetbrains.kotlin.jvm")
+}
+
+dependencies {
+    implementation("com.google.devtools.ksp:symbol-processing-api:1.9.20-1.0.14")
+}
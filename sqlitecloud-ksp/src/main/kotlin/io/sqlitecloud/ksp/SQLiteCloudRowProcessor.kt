@@ -0,0 +1,130 @@
+package io.sqlitecloud.ksp
+
+import com.google.devtools.ksp.processing.CodeGenerator
+import com.google.devtools.ksp.processing.Dependencies
+import com.google.devtools.ksp.processing.KSPLogger
+import com.google.devtools.ksp.processing.Resolver
+import com.google.devtools.ksp.processing.SymbolProcessor
+import com.google.devtools.ksp.processing.SymbolProcessorEnvironment
+import com.google.devtools.ksp.processing.SymbolProcessorProvider
+import com.google.devtools.ksp.symbol.KSAnnotated
+import com.google.devtools.ksp.symbol.KSClassDeclaration
+import com.google.devtools.ksp.symbol.KSValueParameter
+import com.google.devtools.ksp.validate
+
+private const val rowAnnotation = "io.sqlitecloud.SQLiteCloudRow"
+private const val columnAnnotation = "io.sqlitecloud.SQLiteCloudColumn"
+
+class SQLiteCloudRowProcessorProvider : SymbolProcessorProvider {
+    override fun create(environment: SymbolProcessorEnvironment): SymbolProcessor =
+        SQLiteCloudRowProcessor(environment.codeGenerator, environment.logger)
+}
+
+/**
+ * Generates a `<ClassName>RowMapper` object implementing `SQLiteCloudRowMapper` for every class
+ * annotated with `@SQLiteCloudRow`.
+ *
+ * The generated decoder resolves the column indices once per rowset and reads every cell through
+ * the typed getters of `SQLiteCloudColumnarRowset`, so no `SQLiteCloudValue` is allocated.
+ */
+class SQLiteCloudRowProcessor(
+    private val codeGenerator: CodeGenerator,
+    private val logger: KSPLogger,
+) : SymbolProcessor {
+    override fun process(resolver: Resolver): List<KSAnnotated> {
+        val symbols = resolver.getSymbolsWithAnnotation(rowAnnotation)
+        val deferred = symbols.filterNot { it.validate() }.toList()
+
+        symbols.filter { it.validate() }.forEach { symbol ->
+            if (symbol !is KSClassDeclaration) {
+                logger.error("@SQLiteCloudRow can only be applied to classes", symbol)
+            } else {
+                generateMapper(symbol)
+            }
+        }
+        return deferred
+    }
+
+    private fun generateMapper(declaration: KSClassDeclaration) {
+        val constructor = declaration.primaryConstructor
+        if (constructor == null) {
+            logger.error("@SQLiteCloudRow classes need a primary constructor", declaration)
+            return
+        }
+
+        val packageName = declaration.packageName.asString()
+        val className = declaration.qualifiedName?.asString() ?: return
+        val mapperName = "${declaration.simpleName.asString()}RowMapper"
+
+        val columns = constructor.parameters.map { parameter -> columnName(parameter) }
+        val arguments = constructor.parameters.mapIndexed { index, parameter ->
+            val name = parameter.name?.asString() ?: return
+            val value = readValue(parameter, columns[index], "c$index") ?: return
+            "                $name = $value,"
+        }
+
+        val source = buildString {
+            if (packageName.isNotEmpty()) appendLine("package $packageName").appendLine()
+            appendLine("import io.sqlitecloud.SQLiteCloudColumnarRowset")
+            appendLine("import io.sqlitecloud.SQLiteCloudError")
+            appendLine("import io.sqlitecloud.SQLiteCloudRowMapper")
+            appendLine()
+            appendLine("object $mapperName : SQLiteCloudRowMapper<$className> {")
+            appendLine("    override fun decode(rowset: SQLiteCloudColumnarRowset): List<$className> {")
+            columns.forEachIndexed { index, column ->
+                appendLine("        val c$index = rowset.columnIndex(\"${escape(column)}\")")
+            }
+            appendLine("        return List(rowset.rowCount) { row ->")
+            appendLine("            $className(")
+            arguments.forEach { appendLine(it) }
+            appendLine("            )")
+            appendLine("        }")
+            appendLine("    }")
+            appendLine("}")
+        }
+
+        val file = codeGenerator.createNewFile(
+            Dependencies(aggregating = false, declaration.containingFile ?: return),
+            packageName,
+            mapperName,
+        )
+        file.bufferedWriter().use { it.write(source) }
+    }
+
+    private fun columnName(parameter: KSValueParameter): String {
+        val annotation = parameter.annotations.firstOrNull {
+            it.annotationType.resolve().declaration.qualifiedName?.asString() == columnAnnotation
+        }
+        return annotation?.arguments?.firstOrNull()?.value as? String
+            ?: parameter.name?.asString().orEmpty()
+    }
+
+    private fun readValue(parameter: KSValueParameter, column: String, index: String): String? {
+        val type = parameter.type.resolve()
+        val read = when (type.declaration.qualifiedName?.asString()) {
+            "kotlin.Long" -> "rowset.getLong(row, $index)"
+            "kotlin.Int" -> "rowset.getLong(row, $index).toInt()"
+            "kotlin.Short" -> "rowset.getLong(row, $index).toShort()"
+            "kotlin.Byte" -> "rowset.getLong(row, $index).toByte()"
+            "kotlin.Boolean" -> "(rowset.getLong(row, $index) != 0L)"
+            "kotlin.Double" -> "rowset.getDouble(row, $index)"
+            "kotlin.Float" -> "rowset.getDouble(row, $index).toFloat()"
+            "kotlin.String" -> "rowset.getString(row, $index)!!"
+            "kotlin.ByteArray" -> "rowset.getBytes(row, $index)!!"
+            "java.nio.ByteBuffer" -> "rowset.getBlob(row, $index)!!"
+            else -> {
+                logger.error("Unsupported type $type for a @SQLiteCloudRow property", parameter)
+                return null
+            }
+        }
+
+        // The getters return null for NULL cells only, numeric getters would return 0 instead.
+        return if (type.isMarkedNullable) {
+            "if (rowset.isNull(row, $index)) null else $read"
+        } else {
+            "if (rowset.isNull(row, $index)) throw SQLiteCloudError.Execution.nullColumnValue(\"${escape(column)}\") else $read"
+        }
+    }
+
+    private fun escape(value: String) = value.replace("\\", "\\\\").replace("\"", "\\\"").replace("$", "\\$")
+}
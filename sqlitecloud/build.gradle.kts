@@ -4,6 +4,15 @@ plugins {
     kotlin("plugin.serialization") version "1.9.20"
 }
 
+// -Psqlitecloud.pgo=generate for a library instrumented to collect profiles, or the path of a
+// merged .profdata, in place of the checked-in profiles of the release build (see CMakeLists.txt)
+val pgo = project.findProperty("sqlitecloud.pgo") as String?
+
+// The release build asks for the checked-in profiles only if there are any, CMake then skips
+// the ABIs that have none (see src/main/cpp/pgo/README.md)
+val pgoProfiles = file("src/main/cpp/pgo").listFiles { file -> file.extension == "profdata" }.orEmpty().isNotEmpty()
+val releasePgo = pgo ?: "use".takeIf { pgoProfiles }
+
 android {
     namespace = "com.sqlitecloud"
     compileSdk = 34
@@ -16,6 +25,7 @@ android {
         externalNativeBuild {
             cmake {
                 cppFlags("")
+                pgo?.let { arguments += "-DSQLITECLOUD_PGO=$it" }
             }
         }
     }
@@ -23,6 +33,12 @@ android {
     buildTypes {
         release {
             isMinifyEnabled = false
+            externalNativeBuild {
+                cmake {
+                    arguments += "-DSQLITECLOUD_LTO=ON"
+                    releasePgo?.let { arguments += "-DSQLITECLOUD_PGO=$it" }
+                }
+            }
             proguardFiles(
                 getDefaultProguardFile("proguard-android-optimize.txt"),
                 "proguard-rules.pro"
@@ -49,6 +65,7 @@ dependencies {
     implementation("androidx.appcompat:appcompat:1.6.1")
     implementation("com.google.android.material:material:1.10.0")
     implementation("org.jetbrains.kotlinx:kotlinx-serialization-json:1.6.1")
+    api("androidx.paging:paging-common-ktx:3.2.1")
     testImplementation("junit:junit:4.13.2")
     androidTestImplementation("androidx.test.ext:junit:1.1.5")
     androidTestImplementation("androidx.test.espresso:espresso-core:3.5.1")
@@ -1,10 +1,13 @@
 package io.sqlitecloud
 
 import androidx.test.ext.junit.runners.AndroidJUnit4
+import kotlinx.coroutines.delay
 import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeoutOrNull
 import org.junit.Assert.*
 import org.junit.Test
 import org.junit.runner.RunWith
+import java.util.concurrent.CopyOnWriteArrayList
 
 /**
  * Instrumented test, which will execute on an Android device.
@@ -17,6 +20,18 @@ class ConnectionTest {
         private val sql: SQLiteCloud = TestContext.sqliteCloud()
     }
 
+    // Keeps the messages logged by the client, whatever their level.
+    private class RecordingLogger : SQLiteCloudLogger {
+        override var isEnabled = true
+        val messages = CopyOnWriteArrayList<String>()
+
+        override fun logInfo(tag: String?, category: String?, message: String) { messages.add(message) }
+        override fun logError(tag: String?, category: String?, message: String) { messages.add(message) }
+        override fun logDebug(tag: String?, category: String?, message: String) { messages.add(message) }
+        override fun logWarning(tag: String?, category: String?, message: String) { messages.add(message) }
+        override fun logVerbose(tag: String?, category: String?, message: String) { messages.add(message) }
+    }
+
     @Test
     fun connectWithValidCredentialsSucceeds() = runBlocking {
         sql.connect()
@@ -46,4 +61,67 @@ class ConnectionTest {
             }
         }
     }
+
+    @Test
+    fun pooledConnectionsAreReusedAcrossCheckouts() = runBlocking {
+        val pool = SQLiteCloudPool(appContext = TestContext.context, config = sql.config, size = 1)
+        val first = pool.use { it.execute(SQLiteCloudCommand.getUser) }
+        val second = pool.use { it.execute(SQLiteCloudCommand.getUser) }
+        pool.close()
+
+        assertEquals(sql.config.username, first.stringValue)
+        assertEquals(sql.config.username, second.stringValue)
+    }
+
+    @Test
+    fun lazyConnectOpensTheConnectionWithTheFirstCommand() = runBlocking {
+        val lazySql = SQLiteCloud(
+            appContext = TestContext.context,
+            config = sql.config.copy(lazyConnect = true),
+        )
+        lazySql.connect()
+        val connectedBeforeCommand = lazySql.isConnected
+        val result = lazySql.execute(SQLiteCloudCommand.getUser)
+        val connectedAfterCommand = lazySql.isConnected
+        lazySql.disconnect()
+
+        assertFalse(connectedBeforeCommand)
+        assertEquals(sql.config.username, result.stringValue)
+        assertTrue(connectedAfterCommand)
+    }
+
+    @Test
+    fun lazyConnectWithInvalidCredentialsThrowsOnTheFirstCommand() {
+        val invalidSql = SQLiteCloud(
+            appContext = TestContext.context,
+            config = sql.config.copy(password = "INVALID PASSWORD", lazyConnect = true),
+        )
+        runBlocking { invalidSql.connect() }
+        assertThrows(SQLiteCloudError::class.java) {
+            runBlocking {
+                invalidSql.execute(SQLiteCloudCommand.getUser)
+            }
+        }
+    }
+
+    @Test
+    fun cancelledCommandIsFollowedByTheStandbyConnection() = runBlocking {
+        val logger = RecordingLogger()
+        val standbySql = SQLiteCloud(
+            appContext = TestContext.context,
+            config = sql.config.copy(standbyRefreshMs = 60_000),
+            logger = logger,
+        )
+        standbySql.connect()
+        // the standby is dialed in the background right after the connect
+        delay(3000)
+        val slow = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 100000000) SELECT COUNT(*) FROM n"
+        val timedOut = withTimeoutOrNull(200) { standbySql.execute(query = slow) }
+        val result = standbySql.execute(SQLiteCloudCommand.getUser)
+        standbySql.disconnect()
+
+        assertNull(timedOut)
+        assertEquals(sql.config.username, result.stringValue)
+        assertTrue(logger.messages.any { it.contains("switching to the standby connection") })
+    }
 }
@@ -1,7 +1,14 @@
 package io.sqlitecloud
 
+import androidx.paging.PagingSource
 import androidx.test.ext.junit.runners.AndroidJUnit4
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.async
+import kotlinx.coroutines.awaitAll
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.flow.first
 import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeoutOrNull
 import org.junit.Assert.*
 import org.junit.Test
 import org.junit.runner.RunWith
@@ -43,4 +50,417 @@ class ExecuteCommandTest {
 
         assertTrue(result is SQLiteCloudResult.Array)
     }
+
+    @Test
+    fun executeAllReturnsOneResultPerCommandInOrder() = runBlocking {
+        sql.connect()
+        val results = sql.executeAll(listOf(SQLiteCloudCommand.getUser, SQLiteCloudCommand.testArray))
+        sql.disconnect()
+
+        assertEquals(2, results.size)
+        assertEquals(sql.config.username, results[0].stringValue)
+        assertTrue(results[1] is SQLiteCloudResult.Array)
+    }
+
+    @Test
+    fun executeNonBlockingAnswersQueuedCommandsInOrder() = runBlocking {
+        sql.connect()
+        val results = listOf(SQLiteCloudCommand.getUser, SQLiteCloudCommand.testArray).map {
+            async { sql.executeNonBlocking(it) }
+        }.awaitAll()
+        val blocking = sql.execute(SQLiteCloudCommand.getUser)
+        sql.disconnect()
+
+        assertEquals(sql.config.username, results[0].stringValue)
+        assertTrue(results[1] is SQLiteCloudResult.Array)
+        assertEquals(sql.config.username, blocking.stringValue)
+    }
+
+    @Test
+    fun executeManyInsertsEveryRowAtomically() = runBlocking {
+        sql.connect()
+        sql.useDatabase("testDatabase")
+        sql.execute(query = "CREATE TABLE IF NOT EXISTS Batch1 (id INTEGER PRIMARY KEY, name TEXT)")
+        sql.execute(query = "DELETE FROM Batch1")
+
+        val rows = (1..500L).map {
+            val name = if (it % 2 == 0L) SQLiteCloudValue.Null else SQLiteCloudValue.String("row$it")
+            listOf(SQLiteCloudValue.Integer(it), name)
+        }
+        val result = sql.executeMany("INSERT INTO Batch1 (id, name) VALUES (?, ?)", rows)
+
+        // The duplicated id makes the second batch fail, none of its rows must be kept.
+        assertThrows(SQLiteCloudError::class.java) {
+            runBlocking {
+                sql.executeMany("INSERT INTO Batch1 (id, name) VALUES (?, ?)", listOf(listOf(SQLiteCloudValue.Integer(1000), SQLiteCloudValue.Null), rows[1]))
+            }
+        }
+        val count = sql.execute(query = "SELECT COUNT(*) FROM Batch1")
+        sql.disconnect()
+
+        assertEquals(500L, result.changes)
+        assertEquals(500L, result.lastRowId)
+        assertEquals("500", (count as SQLiteCloudResult.Rowset).value.rows[0][0].stringValue)
+    }
+
+    @Test
+    fun compileQueryReusesCachedVirtualMachines() = runBlocking {
+        sql.connect()
+        sql.useDatabase("testDatabase")
+        sql.execute(query = "CREATE TABLE IF NOT EXISTS Cache1 (id INTEGER PRIMARY KEY, name TEXT)")
+        sql.execute(query = "DELETE FROM Cache1")
+
+        for (id in 1..10) {
+            val vm = sql.compileQuery(" INSERT INTO Cache1 (id, name) VALUES (?1, ?2) ")
+            vm.bindValue(SQLiteCloudVMValue.Integer(id), 1)
+            vm.bindValue(SQLiteCloudVMValue.String("row$id"), 2)
+            vm.step()
+            vm.close()
+        }
+        val count = sql.execute(query = "SELECT COUNT(*) FROM Cache1")
+        val hits = sql.statementCacheHits
+        val misses = sql.statementCacheMisses
+        sql.disconnect()
+
+        assertEquals("10", (count as SQLiteCloudResult.Rowset).value.rows[0][0].stringValue)
+        assertEquals(1, misses)
+        assertEquals(9, hits)
+    }
+
+    @Test
+    fun resetReusesTheSameVirtualMachine() = runBlocking {
+        sql.connect()
+        sql.useDatabase("testDatabase")
+        sql.execute(query = "CREATE TABLE IF NOT EXISTS Reset1 (id INTEGER PRIMARY KEY, name TEXT)")
+        sql.execute(query = "DELETE FROM Reset1")
+
+        val vm = sql.compileQuery("INSERT INTO Reset1 (id, name) VALUES (?1, ?2)")
+        for (id in 1..5) {
+            vm.bindValue(SQLiteCloudVMValue.Integer(id), 1)
+            vm.bindValue(SQLiteCloudVMValue.String("row$id"), 2)
+            vm.step()
+            vm.reset()
+        }
+        vm.reset(clearBindings = true)
+        vm.bindValue(SQLiteCloudVMValue.Integer(6), 1)
+        vm.step()
+        vm.close()
+        val nulls = sql.execute(query = "SELECT COUNT(*) FROM Reset1 WHERE name IS NULL")
+        val count = sql.execute(query = "SELECT COUNT(*) FROM Reset1")
+        sql.disconnect()
+
+        assertEquals("6", (count as SQLiteCloudResult.Rowset).value.rows[0][0].stringValue)
+        assertEquals("1", (nulls as SQLiteCloudResult.Rowset).value.rows[0][0].stringValue)
+    }
+
+    @Test
+    fun resultPoolKeepsResultsCorrectAcrossTrimMemory() = runBlocking {
+        val pooled = SQLiteCloud(appContext = TestContext.context, config = sql.config.copy(resultPoolSize = 1 shl 20))
+        pooled.connect()
+        pooled.useDatabase("testDatabase")
+
+        val rows = (1..20).map {
+            if (it == 10) pooled.trimMemory()
+            val result = pooled.execute(query = "SELECT $it, 'row$it'")
+            (result as SQLiteCloudResult.Rowset).value.rows[0].map { value -> value.stringValue }
+        }
+        pooled.disconnect()
+
+        assertEquals((1..20).map { listOf("$it", "row$it") }, rows)
+    }
+
+    @Test
+    fun numericCellsRoundTripExactly() = runBlocking {
+        sql.connect()
+        val result = sql.execute(query = "SELECT 0.1, 3.14, 1e22, 1e23, -2.5e-7, 2.2250738585072014e-308, 1.7976931348623157e308, 9223372036854775807, -42")
+        sql.disconnect()
+
+        val doubles = listOf(0.1, 3.14, 1e22, 1e23, -2.5e-7, 2.2250738585072014e-308, 1.7976931348623157e308)
+        val row = (result as SQLiteCloudResult.Rowset).value.rows[0]
+        assertEquals(doubles.map { SQLiteCloudValue.Double(it) }, row.take(doubles.size))
+        assertEquals(listOf(SQLiteCloudValue.Integer(Long.MAX_VALUE), SQLiteCloudValue.Integer(-42)), row.drop(doubles.size))
+    }
+
+    @Test
+    fun numericParametersAreBoundWithTheirType() = runBlocking {
+        sql.connect()
+        val command = SQLiteCloudCommand(
+            "SELECT ?, ?, typeof(?), ?",
+            SQLiteCloudValue.Integer(Long.MIN_VALUE),
+            SQLiteCloudValue.Double(0.1),
+            SQLiteCloudValue.Double(2.0),
+            SQLiteCloudValue.String("text"),
+        )
+        val result = sql.execute(command)
+        sql.disconnect()
+
+        val row = (result as SQLiteCloudResult.Rowset).value.rows[0]
+        assertEquals(SQLiteCloudValue.Integer(Long.MIN_VALUE), row[0])
+        assertEquals(SQLiteCloudValue.Double(0.1), row[1])
+        assertEquals("real", row[2].stringValue)
+        assertEquals("text", row[3].stringValue)
+    }
+
+    @Test
+    fun cachedCommandEncodingIsReusedAcrossExecutions() = runBlocking {
+        sql.connect()
+        // Supplementary characters differ between modified and standard UTF-8.
+        val command = SQLiteCloudCommand("SELECT ?, length(?)", SQLiteCloudValue.String("héllo 😀"), SQLiteCloudValue.String("😀"))
+        val first = sql.execute(command)
+        val second = sql.execute(command)
+        sql.disconnect()
+
+        val expected = listOf("héllo 😀", "1")
+        assertEquals(expected, (first as SQLiteCloudResult.Rowset).value.rows[0].map { it.stringValue })
+        assertEquals(expected, (second as SQLiteCloudResult.Rowset).value.rows[0].map { it.stringValue })
+    }
+
+    @Test
+    fun nativeRowsetReadsCellsUntilClosed() = runBlocking {
+        sql.connect()
+        val rowset = sql.executeRowset(SQLiteCloudCommand(query = "SELECT 42 AS id, 'text' AS name, x'00ff10' AS data"))
+        val copy = rowset.use {
+            assertEquals(listOf("id", "name", "data"), it.columns)
+            assertEquals(1, it.rowCount)
+            assertEquals(SQLiteCloudValue.Integer(42), it.value(0, 0))
+            assertEquals("text", it.value(0, 1).stringValue)
+            val blob = (it.value(0, 2) as SQLiteCloudValue.Blob).value
+            assertEquals(listOf<Byte>(0, -1, 16), (0..<blob.remaining()).map { index -> blob.get(index) })
+            it.toRowset()
+        }
+        sql.disconnect()
+
+        assertTrue(rowset.isClosed)
+        assertThrows(SQLiteCloudError::class.java) { rowset.value(0, 0) }
+        val blob = (copy.rows[0][2] as SQLiteCloudValue.Blob).value
+        assertEquals(3, blob.remaining())
+        assertEquals(16.toByte(), blob.get(2))
+    }
+
+    @Test
+    fun columnarRowsetExposesTypedColumns() = runBlocking {
+        sql.connect()
+        val rowset = sql.executeColumnar(SQLiteCloudCommand(query = "SELECT 7, 2.5, 'héllo', x'0102', NULL UNION ALL SELECT -1, NULL, '', x'', 3"))
+        sql.disconnect()
+
+        assertEquals(2, rowset.rowCount)
+        assertEquals(5, rowset.columnCount)
+        assertEquals(listOf(7L, -1L), (0..1).map { rowset.getLong(it, 0) })
+        assertEquals(2.5, rowset.getDouble(0, 1), 0.0)
+        assertTrue(rowset.isNull(1, 1))
+        assertEquals(listOf("héllo", ""), (0..1).map { rowset.getString(it, 2) })
+        assertEquals(2, rowset.getBlob(0, 3)?.remaining())
+        assertEquals(SQLiteCloudValue.Type.Null, rowset.type(0, 4))
+        assertEquals(SQLiteCloudValue.Integer(3), rowset.toRowset().rows[1][4])
+    }
+
+    @Test
+    fun pagingSourceAppendsPagesFromTheChunkedStream() = runBlocking {
+        sql.connect()
+        val command = SQLiteCloudCommand(query = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 25) SELECT i FROM n")
+        val source = SQLiteCloudPagingSource(sql, command) { rowset -> List(rowset.rowCount) { rowset.getLong(it, 0) } }
+
+        val pages = mutableListOf<List<Long>>()
+        var key: Int? = null
+        do {
+            val params = if (key == null) {
+                PagingSource.LoadParams.Refresh(key = null, loadSize = 10, placeholdersEnabled = false)
+            } else {
+                PagingSource.LoadParams.Append(key = key, loadSize = 10, placeholdersEnabled = false)
+            }
+            val page = source.load(params) as PagingSource.LoadResult.Page
+            pages.add(page.data)
+            key = page.nextKey
+        } while (key != null)
+        sql.disconnect()
+
+        assertEquals(listOf(10, 10, 5), pages.map { it.size })
+        assertEquals((1..25L).toList(), pages.flatten())
+    }
+
+    @Test
+    fun concurrentExecutionsAreSerializedOnTheConnection() = runBlocking {
+        sql.connect()
+        val results = (1..50).map { id ->
+            async(Dispatchers.IO) { sql.execute(SQLiteCloudCommand("SELECT ?", SQLiteCloudValue.Integer(id.toLong()))) }
+        }.awaitAll()
+        val failed = runCatching { sql.execute(query = "SELECT * FROM MissingTable") }
+        val inFlight = sql.inFlightCommands
+        sql.disconnect()
+
+        assertEquals((1..50).map { "$it" }, results.map { (it as SQLiteCloudResult.Rowset).value.rows[0][0].stringValue })
+        assertTrue(failed.exceptionOrNull() is SQLiteCloudError)
+        assertEquals(0, inFlight)
+    }
+
+    @Test
+    fun cancellingACommandAbortsTheNativeCallAndReconnects() = runBlocking {
+        sql.connect()
+        val slow = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 100000000) SELECT COUNT(*) FROM n"
+        val start = System.nanoTime()
+        val timedOut = withTimeoutOrNull(200) { sql.execute(query = slow) }
+        val elapsed = (System.nanoTime() - start) / 1_000_000
+        val result = sql.execute(SQLiteCloudCommand.getUser)
+        sql.disconnect()
+
+        assertNull(timedOut)
+        assertTrue("cancellation took $elapsed ms", elapsed < 1000)
+        assertEquals(sql.config.username, result.stringValue)
+    }
+
+    @Test
+    fun commandDeadlineFailsFastAndKeepsTheConnectionUsable() = runBlocking {
+        sql.connect()
+        val slow = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 3000000) SELECT COUNT(*) FROM n"
+        val start = System.nanoTime()
+        val overrun = runCatching { sql.execute(SQLiteCloudCommand(query = slow, deadlineMs = 150)) }
+        val elapsed = (System.nanoTime() - start) / 1_000_000
+        val result = sql.execute(SQLiteCloudCommand.getUser)
+        sql.disconnect()
+
+        val error = overrun.exceptionOrNull() as SQLiteCloudError.Connection
+        assertEquals(SQLiteCloudError.Connection.deadlineExceededCode, error.code)
+        assertTrue("deadline took $elapsed ms", elapsed < 1000)
+        assertEquals(sql.config.username, result.stringValue)
+    }
+
+    @Test
+    fun abandonedStreamIsDrainedAndTheConnectionReused() = runBlocking {
+        sql.connect()
+        val command = SQLiteCloudCommand(query = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 10000) SELECT i FROM n")
+        val first = sql.streamColumnar(command).first()
+        val result = sql.execute(SQLiteCloudCommand.getUser)
+        sql.disconnect()
+
+        assertEquals(1L, first.getLong(0, 0))
+        assertEquals(sql.config.username, result.stringValue)
+    }
+
+    @Test
+    fun largeCompressedRowsetIsDecompressed() = runBlocking {
+        val compressed = SQLiteCloud(TestContext.context, sql.config.copy(compression = true))
+        compressed.connect()
+        val command = SQLiteCloudCommand(query = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 20000) SELECT i, 'row ' || i FROM n")
+        val result = compressed.execute(command)
+        val compressedBytes = compressed.compressedBytes
+        compressed.disconnect()
+
+        val rowset = result as SQLiteCloudResult.Rowset
+        assertEquals(20000, rowset.value.rows.size)
+        assertTrue(compressedBytes > 0)
+    }
+
+    // Fires five inserts at once through executeBatched, the fourth one with a duplicated id, and
+    // returns the result of each and the rows left in the table.
+    private suspend fun executeWriteBatch(table: String, failure: SQLiteCloudConfig.WriteBatchFailure): Pair<List<Result<SQLiteCloudResult>>, String> = coroutineScope {
+        val batched = SQLiteCloud(TestContext.context, sql.config.copy(writeBatchWindowMs = 200, writeBatchFailure = failure))
+        batched.connect()
+        batched.useDatabase("testDatabase")
+        batched.execute(query = "CREATE TABLE IF NOT EXISTS $table (id INTEGER PRIMARY KEY, name TEXT)")
+        batched.execute(query = "DELETE FROM $table")
+
+        val results = listOf(1L, 2L, 3L, 1L, 4L).map { id ->
+            async {
+                runCatching {
+                    batched.executeBatched(SQLiteCloudCommand("INSERT INTO $table (id, name) VALUES (?, ?)", SQLiteCloudValue.Integer(id), SQLiteCloudValue.String("row$id")))
+                }
+            }
+        }.awaitAll()
+        val count = batched.execute(query = "SELECT COUNT(*) FROM $table")
+        batched.disconnect()
+
+        results to (count as SQLiteCloudResult.Rowset).value.rows[0][0].stringValue
+    }
+
+    @Test
+    fun isolatedWriteBatchKeepsTheWritesThatSucceeded() = runBlocking {
+        val (results, count) = executeWriteBatch("WriteBatch1", SQLiteCloudConfig.WriteBatchFailure.Isolated)
+
+        assertEquals(listOf(true, true, true, false, true), results.map { it.isSuccess })
+        assertTrue(results[3].exceptionOrNull() is SQLiteCloudError)
+        assertEquals("4", count)
+    }
+
+    @Test
+    fun atomicWriteBatchRollsBackEveryWriteOnFailure() = runBlocking {
+        val (results, count) = executeWriteBatch("WriteBatch2", SQLiteCloudConfig.WriteBatchFailure.Atomic)
+
+        // The failed write keeps its own error, the others fail because of it.
+        assertTrue(results.all { it.isFailure })
+        assertNotEquals(SQLiteCloudError.Execution.writeBatchRolledBack, results[3].exceptionOrNull())
+        results.filterIndexed { index, _ -> index != 3 }.forEach {
+            assertEquals(SQLiteCloudError.Execution.writeBatchRolledBack, it.exceptionOrNull())
+        }
+        assertEquals("0", count)
+    }
+
+    // Sends five copies of a slow read at once, and returns their results and the number of
+    // commands that went out for them.
+    private suspend fun executeIdenticalReads(dedupReads: Boolean): Pair<List<SQLiteCloudResult>, Long> = coroutineScope {
+        val client = SQLiteCloud(TestContext.context, sql.config.copy(dedupReads = dedupReads))
+        client.connect()
+        val slow = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 300000) SELECT COUNT(*) FROM n"
+        val before = client.connectionStats.commands
+        val results = (1..5).map { async(Dispatchers.IO) { client.execute(query = slow) } }.awaitAll()
+        val commands = client.connectionStats.commands - before
+        client.disconnect()
+
+        results to commands
+    }
+
+    @Test
+    fun identicalReadsInFlightShareOneReply() = runBlocking {
+        val (results, commands) = executeIdenticalReads(dedupReads = true)
+
+        assertEquals(1L, commands)
+        assertTrue(results.all { it === results[0] })
+        assertEquals("300000", (results[0] as SQLiteCloudResult.Rowset).value.rows[0][0].stringValue)
+    }
+
+    @Test
+    fun identicalReadsAreSentEachWithoutDedup() = runBlocking {
+        val (results, commands) = executeIdenticalReads(dedupReads = false)
+
+        assertEquals(5L, commands)
+        assertEquals(5, results.map { System.identityHashCode(it) }.toSet().size)
+    }
+
+    // Runs a small and a large query on a new client with the given thresholds, and returns their
+    // results and the stats of the client.
+    private suspend fun executeMaterialized(cells: Int, bytes: Int): Triple<SQLiteCloudResult, SQLiteCloudResult, SQLiteCloudMaterializationStats> {
+        val client = SQLiteCloud(TestContext.context, sql.config.copy(lazyRowsetCells = cells, lazyRowsetBytes = bytes))
+        client.connect()
+        val small = client.execute(query = "SELECT 1, 'one'")
+        val large = client.execute(query = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 3000) SELECT i, 'row ' || i, i / 2.0 FROM n")
+        val stats = client.materializationStats
+        client.disconnect()
+
+        return Triple(small, large, stats)
+    }
+
+    @Test
+    fun largeRowsetIsMaterializedLazilyWithTheSameRows() = runBlocking {
+        val (small, large, stats) = executeMaterialized(4096, 262_144)
+        val (_, eager, eagerStats) = executeMaterialized(0, 0)
+
+        assertEquals(SQLiteCloudResult.Materialization.Eager, small.materialization)
+        assertEquals(SQLiteCloudResult.Materialization.Lazy, large.materialization)
+        assertEquals(SQLiteCloudMaterializationStats(eagerRowsets = 1, lazyRowsets = 1, lazyRowsetCells = 4096, lazyRowsetBytes = 262_144), stats)
+
+        // both thresholds at 0 box every rowset when it is parsed
+        assertEquals(SQLiteCloudResult.Materialization.Eager, eager.materialization)
+        assertEquals(2L, eagerStats.eagerRowsets)
+        assertEquals(0L, eagerStats.lazyRowsets)
+        assertEquals((eager as SQLiteCloudResult.Rowset).value, (large as SQLiteCloudResult.Rowset).value)
+        assertEquals("row 3000", large.value.rows[2999][1].stringValue)
+    }
+
+    @Test
+    fun rowsetOverTheByteThresholdIsLazy() = runBlocking {
+        val (small, large, stats) = executeMaterialized(0, 1024)
+
+        assertEquals(SQLiteCloudResult.Materialization.Eager, small.materialization)
+        assertEquals(SQLiteCloudResult.Materialization.Lazy, large.materialization)
+        assertEquals(1L, stats.lazyRowsets)
+    }
 }
@@ -0,0 +1,367 @@
+//
+//  sqcloud_bench.c
+//
+//  Microbenchmarks of the reply parsing and of the rowset accessors of sqcloud.c: synthetic replies (and captured ones
+//  given with -c) are parsed from memory, without a socket, so that a change to the parser can be measured before and
+//  after on the same device.
+//
+//  Built by the sqcloud_bench target of CMakeLists.txt with -DSQLITECLOUD_BENCHMARKS=ON (an Android executable to run
+//  with adb shell), or on the host with:
+//  cc -O2 -I.. sqcloud_bench.c ../lz4.c -ltls -lpthread -lm -o sqcloud_bench
+//
+//  usage: sqcloud_bench [-t seconds] [-c capture]... [-k features] [filter]
+//  -t: minimum time of each sample (0.2 by default), 5 samples are run and their median is reported
+//  -c: file holding a single raw reply (as read from the socket, header included), parsed as a captured_<name> benchmark
+//  -k: comma separated CPU features the kernels are selected from (sse2, sse42, avx2, avx512, neon, dotprod, sve),
+//      "scalar" for none, all the detected ones by default
+//  filter: only the benchmarks whose name contains it are run
+//
+
+#include "sqcloud.c"
+
+#define BENCH_SAMPLES                       5
+#define BENCH_ROWS                          16384       // rows of the synthetic rowsets
+#define BENCH_CHUNK_ROWS                    1024        // rows of each chunk of the chunked ones
+#define BENCH_MAX_CAPTURES                  16
+
+// MARK: - HARNESS -
+
+typedef struct {
+    SQCloudConnection   *connection;        // fd 0: chunks are parsed without reading the next one
+    char                **buffers;          // replies parsed in order by each iteration (the chunks and the end chunk)
+    uint32_t            *blens;
+    uint32_t            count;
+    size_t              bytes;              // wire bytes of an iteration
+    SQCloudResult       *rowset;            // parsed once, for the accessor benchmarks
+    uint32_t            nrows;
+    uint32_t            ncols;
+} bench_input;
+
+typedef void (*bench_fn) (bench_input *input);
+
+static double bench_min_time = 0.2;
+static const char *bench_filter = NULL;
+
+static const struct {
+    const char          *name;
+    uint32_t            feature;
+} bench_features[] = {
+    {"sse2", CPU_FEATURE_SSE2}, {"sse42", CPU_FEATURE_SSE42}, {"avx2", CPU_FEATURE_AVX2}, {"avx512", CPU_FEATURE_AVX512},
+    {"neon", CPU_FEATURE_NEON}, {"dotprod", CPU_FEATURE_DOTPROD}, {"sve", CPU_FEATURE_SVE}
+};
+static volatile uint64_t bench_sink = 0;    // keeps the accessor results alive
+
+static double bench_now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int bench_compare (const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_run (const char *name, bench_fn fn, bench_input *input, uint64_t cells) {
+    if (bench_filter && !strstr(name, bench_filter)) return;
+    
+    // the iterations of a sample are doubled until it lasts bench_min_time
+    fn(input);
+    uint64_t iterations = 1;
+    while (1) {
+        double start = bench_now();
+        for (uint64_t i=0; i<iterations; ++i) fn(input);
+        if (bench_now() - start >= bench_min_time) break;
+        iterations *= 2;
+    }
+    
+    double samples[BENCH_SAMPLES];
+    for (int s=0; s<BENCH_SAMPLES; ++s) {
+        double start = bench_now();
+        for (uint64_t i=0; i<iterations; ++i) fn(input);
+        samples[s] = (bench_now() - start) / (double)iterations;
+    }
+    qsort(samples, BENCH_SAMPLES, sizeof(double), bench_compare);
+    double op = samples[BENCH_SAMPLES / 2];
+    
+    printf("%-40s %12.0f ns/op %10.1f MB/s %10.1f Mcells/s\n", name, op * 1e9, (double)input->bytes / op / 1e6, (double)cells / op / 1e6);
+}
+
+// MARK: - SYNTHETIC REPLIES -
+
+typedef struct {
+    char                *data;
+    size_t              len;
+    size_t              size;
+} bench_buffer;
+
+static void bench_append (bench_buffer *b, const char *data, size_t len) {
+    if (b->len + len > b->size) {
+        b->size = (b->len + len) * 2;
+        b->data = realloc(b->data, b->size);
+        if (!b->data) {fprintf(stderr, "Out of memory.\n"); exit(1);}
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void bench_appendf (bench_buffer *b, const char *format, ...) {
+    char tmp[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(tmp, sizeof(tmp), format, args);
+    va_end(args);
+    bench_append(b, tmp, (size_t)n);
+}
+
+static void bench_values (bench_buffer *body, uint32_t first, uint32_t nrows, uint32_t ncols, bool text) {
+    for (uint32_t row=first; row<first+nrows; ++row) {
+        for (uint32_t col=0; col<ncols; ++col) {
+            if (!text) bench_appendf(body, ":%u ", row * 31 + col * 7919);
+            else {
+                char value[64];
+                int n = snprintf(value, sizeof(value), "user-%u %s", row + col, (col & 1) ? "example.com" : "lorem ipsum");
+                bench_appendf(body, "+%d %s", n, value);
+            }
+        }
+    }
+}
+
+static char *bench_reply (char type, uint32_t idx, uint32_t nrows, uint32_t ncols, const bench_buffer *body, bool compressed, uint32_t *blen) {
+    // *LEN 0:1 ROWS COLS DATA or /LEN IDX:1 ROWS COLS DATA, compressed as %TLEN CLEN ULEN followed by the raw header
+    // (*LEN 0:1 ROWS COLS) and the LZ4 block of DATA
+    char prefix[64];
+    int plen = snprintf(prefix, sizeof(prefix), "%u:1 %u %u ", idx, nrows, ncols);
+    char header[96];
+    int hlen = snprintf(header, sizeof(header), "%c%zu %s", type, (size_t)plen + body->len, prefix);
+    
+    bench_buffer reply = {0};
+    if (!compressed) {
+        bench_append(&reply, header, (size_t)hlen);
+        bench_append(&reply, body->data, body->len);
+    } else {
+        int bound = LZ4_compressBound((int)body->len);
+        char *zdata = malloc((size_t)bound);
+        int clen = LZ4_compress_default(body->data, zdata, (int)body->len, bound);
+        char sizes[64];
+        int slen = snprintf(sizes, sizeof(sizes), "%d %zu ", clen, body->len);
+        bench_appendf(&reply, "%c%zu %s", CMD_COMPRESSED, (size_t)slen + (size_t)hlen + (size_t)clen, sizes);
+        bench_append(&reply, header, (size_t)hlen);
+        bench_append(&reply, zdata, (size_t)clen);
+        free(zdata);
+    }
+    
+    *blen = (uint32_t)reply.len;
+    return reply.data;
+}
+
+static void bench_input_add (bench_input *input, char *buffer, uint32_t blen) {
+    input->buffers = realloc(input->buffers, (input->count + 1) * sizeof(char *));
+    input->blens = realloc(input->blens, (input->count + 1) * sizeof(uint32_t));
+    input->buffers[input->count] = buffer;
+    input->blens[input->count] = blen;
+    input->bytes += blen;
+    ++input->count;
+}
+
+static SQCloudConnection *bench_connection (void) {
+    SQCloudConnection *connection = mem_zeroalloc(sizeof(SQCloudConnection));
+    connection->mempool = internal_mempool_create();
+    pthread_mutex_init(&connection->cancel_mutex, NULL);
+    return connection;
+}
+
+static void bench_input_rowset (bench_input *input, uint32_t ncols, bool text, bool compressed, bool chunked) {
+    memset(input, 0, sizeof(bench_input));
+    input->connection = bench_connection();
+    input->nrows = BENCH_ROWS;
+    input->ncols = ncols;
+    
+    uint32_t step = (chunked) ? BENCH_CHUNK_ROWS : BENCH_ROWS;
+    for (uint32_t first=0, idx=1; first<BENCH_ROWS; first+=step, ++idx) {
+        bench_buffer body = {0};
+        for (uint32_t col=0; first == 0 && col<ncols; ++col) {
+            char cname[32];
+            int n = snprintf(cname, sizeof(cname), "column%u", col);
+            bench_appendf(&body, "+%d %s", n, cname);
+        }
+        bench_values(&body, first, step, ncols, text);
+        
+        uint32_t blen = 0;
+        char *reply = bench_reply((chunked) ? CMD_ROWSET_CHUNK : CMD_ROWSET, (chunked) ? idx : 0, step, ncols, &body, compressed, &blen);
+        bench_input_add(input, reply, blen);
+        free(body.data);
+    }
+    if (chunked) {
+        static const char end[] = "/8 0:1 0 0 ";
+        char *reply = strdup(end);
+        bench_input_add(input, reply, (uint32_t)strlen(end));
+    }
+}
+
+// MARK: - BENCHMARKS -
+
+static SQCloudResult *bench_parse_input (bench_input *input) {
+    // every buffer is parsed as a static one, so it is copied (or decompressed) into a pool buffer as a received reply
+    SQCloudResult *result = NULL;
+    for (uint32_t i=0; i<input->count; ++i) {
+        char *buffer = input->buffers[i];
+        uint32_t cstart = 0;
+        internal_parse_number(&buffer[1], input->blens[i] - 1, &cstart);
+        result = internal_parse_buffer(input->connection, buffer, input->blens[i], cstart, true, false);
+        if (!result) {
+            fprintf(stderr, "Parse failed: %s.\n", input->connection->errmsg);
+            exit(1);
+        }
+    }
+    return result;
+}
+
+static void bench_parse (bench_input *input) {
+    SQCloudResultFree(bench_parse_input(input));
+}
+
+static void bench_decompress (bench_input *input) {
+    for (uint32_t i=0; i<input->count; ++i) {
+        if (input->buffers[i][0] != CMD_COMPRESSED) continue;
+        int rc = 0;
+        uint32_t clonelen = 0;
+        char *clone = internal_uncompress_buffer(input->connection->mempool, NULL, input->buffers[i], input->blens[i], &clonelen, &rc);
+        if (!clone) {
+            fprintf(stderr, "Decompression failed: %d.\n", rc);
+            exit(1);
+        }
+        internal_mempool_free(clone);
+    }
+}
+
+static void bench_value (bench_input *input) {
+    uint64_t sum = 0;
+    for (uint32_t row=0; row<input->nrows; ++row) {
+        for (uint32_t col=0; col<input->ncols; ++col) {
+            uint32_t len = 0;
+            char *value = SQCloudRowsetValue(input->rowset, row, col, &len);
+            sum += len + (value != NULL);
+        }
+    }
+    bench_sink += sum;
+}
+
+static void bench_value_type (bench_input *input) {
+    uint64_t sum = 0;
+    for (uint32_t row=0; row<input->nrows; ++row) {
+        for (uint32_t col=0; col<input->ncols; ++col) sum += SQCloudRowsetValueType(input->rowset, row, col);
+    }
+    bench_sink += sum;
+}
+
+static void bench_int64 (bench_input *input) {
+    uint64_t sum = 0;
+    for (uint32_t row=0; row<input->nrows; ++row) {
+        for (uint32_t col=0; col<input->ncols; ++col) sum += (uint64_t)SQCloudRowsetInt64Value(input->rowset, row, col);
+    }
+    bench_sink += sum;
+}
+
+static void bench_shape (const char *shape, uint32_t ncols, bool text) {
+    static const char *variants[] = {"plain", "lz4", "chunked", "chunked_lz4"};
+    for (int v=0; v<4; ++v) {
+        bool compressed = (v & 1), chunked = (v & 2);
+        bench_input input;
+        bench_input_rowset(&input, ncols, text, compressed, chunked);
+        uint64_t cells = (uint64_t)input.nrows * input.ncols;
+        
+        char name[128];
+        snprintf(name, sizeof(name), "parse_%s_%s", shape, variants[v]);
+        bench_run(name, bench_parse, &input, cells);
+        
+        if (compressed) {
+            snprintf(name, sizeof(name), "decompress_%s_%s", shape, variants[v]);
+            bench_run(name, bench_decompress, &input, cells);
+        }
+        
+        if (!compressed) {
+            input.rowset = bench_parse_input(&input);
+            snprintf(name, sizeof(name), "value_%s_%s", shape, variants[v]);
+            bench_run(name, bench_value, &input, cells);
+            snprintf(name, sizeof(name), "value_type_%s_%s", shape, variants[v]);
+            bench_run(name, bench_value_type, &input, cells);
+            if (!text) {
+                snprintf(name, sizeof(name), "int64_%s_%s", shape, variants[v]);
+                bench_run(name, bench_int64, &input, cells);
+            }
+            SQCloudResultFree(input.rowset);
+        }
+        
+        for (uint32_t i=0; i<input.count; ++i) free(input.buffers[i]);
+        free(input.buffers);
+        free(input.blens);
+        SQCloudDisconnect(input.connection);
+    }
+}
+
+static void bench_capture (const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Unable to open %s: %s.\n", path, strerror(errno));
+        exit(1);
+    }
+    bench_buffer data = {0};
+    char tmp[65536];
+    size_t n;
+    while ((n = fread(tmp, 1, sizeof(tmp), file)) > 0) bench_append(&data, tmp, n);
+    fclose(file);
+    
+    bench_input input;
+    memset(&input, 0, sizeof(bench_input));
+    input.connection = bench_connection();
+    bench_input_add(&input, data.data, (uint32_t)data.len);
+    
+    const char *base = strrchr(path, '/');
+    char name[128];
+    snprintf(name, sizeof(name), "captured_%s", (base) ? base + 1 : path);
+    bench_run(name, bench_parse, &input, 0);
+    
+    free(data.data);
+    free(input.buffers);
+    free(input.blens);
+    SQCloudDisconnect(input.connection);
+}
+
+static uint32_t bench_parse_features (const char *list) {
+    uint32_t features = 0;
+    for (size_t i=0; i<sizeof(bench_features)/sizeof(bench_features[0]); ++i) {
+        const char *found = strstr(list, bench_features[i].name);
+        size_t len = strlen(bench_features[i].name);
+        // whole names only (sse2 is not sse42)
+        if (found && (found == list || found[-1] == ',') && (found[len] == 0 || found[len] == ',')) features |= bench_features[i].feature;
+    }
+    return features;
+}
+
+int main (int argc, char *argv[]) {
+    const char *captures[BENCH_MAX_CAPTURES];
+    int ncaptures = 0;
+    const char *features = NULL;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) bench_min_time = atof(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc && ncaptures < BENCH_MAX_CAPTURES) captures[ncaptures++] = argv[++i];
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) features = argv[++i];
+        else bench_filter = argv[i];
+    }
+    
+    uint32_t selected = (features) ? SQCloudForceCPUFeatures(bench_parse_features(features)) : SQCloudCPUFeatures();
+    printf("kernels:");
+    for (size_t i=0; i<sizeof(bench_features)/sizeof(bench_features[0]); ++i) {
+        if (selected & bench_features[i].feature) printf(" %s", bench_features[i].name);
+    }
+    printf("%s\n", (selected) ? "" : " scalar");
+    
+    bench_shape("narrow_numeric", 4, false);
+    bench_shape("narrow_text", 4, true);
+    bench_shape("wide_numeric", 64, false);
+    bench_shape("wide_text", 64, true);
+    for (int i=0; i<ncaptures; ++i) bench_capture(captures[i]);
+    
+    return 0;
+}
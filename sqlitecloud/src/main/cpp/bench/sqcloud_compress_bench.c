@@ -0,0 +1,214 @@
+//
+//  sqcloud_compress_bench.c
+//
+//  Whether compressed replies pay off on this device, and from which size. SQCloudCompressionCalibrate times
+//  LZ4_decompress_safe on synthetic rowsets (-c runs, their median is the calibration); then, for each emulated
+//  bandwidth of the mock server of sqcloud_mockserver.h, a connection with the calibration measures the link rate
+//  (SQCloudStats.link_rate) from a large reply, SQCloudCompressionThreshold reports the reply size and the ratio the
+//  compression policy would decide with, and rowsets of growing size are timed with COMPRESSION on and off, so that
+//  the predicted winner of each size can be checked against the measured one.
+//
+//  Everything is printed on stdout as a JSON object on a line of its own, so that the reports of two devices (or two
+//  builds) can be compared by a script:
+//  {"run":"calibration","median":true,"decompress_rate":2411230051,"decompress_call_ns":312,"ratio":281}
+//  {"run":"threshold","bandwidth_kbps":10000,"link_rate":1249612,"min_size":512,"ratio_max":999,"calibrated":true}
+//  {"run":"reply","bandwidth_kbps":10000,"rows":1024,"bytes":104503,"plain_us":84211,"compressed_us":31187,"wins":"compressed","predicted":"compressed"}
+//
+//  Built by the sqcloud_compress_bench target of CMakeLists.txt with -DSQLITECLOUD_BENCHMARKS=ON (an Android
+//  executable to run with adb shell), or on the host with:
+//  cc -O2 -I.. sqcloud_compress_bench.c sqcloud_mockserver.c ../sqcloud.c ../lz4.c -ltls -lpthread -lm -o sqcloud_compress_bench
+//
+//  usage: sqcloud_compress_bench [-n samples] [-c calibrations] [-t budget_ms] [-b kbps,...] [-r rtt_ms]
+//  -n: samples of each reply measure (5 by default), their median is reported
+//  -c, -t: calibration runs (5 by default) and the time given to each one (0 is the default of SQCloudCompressionCalibrate)
+//  -b: bandwidths of the mock server (1000,10000,100000,1000000 by default, 0 is unlimited)
+//  -r: round trip time of the mock server (10 by default)
+//
+
+#include "sqcloud_mockserver.h"
+#include "sqcloud.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define COMPRESS_MAX_SAMPLES                64
+#define COMPRESS_MAX_BANDWIDTHS             8
+#define COMPRESS_LINK_ROWS                  16384       // rows of the reply that measures the link rate (about 1.6 MB)
+
+static const uint32_t compress_rows[] = {4, 16, 64, 256, 1024, 4096, 16384};
+
+static const char compress_script[] =
+    "# rowsets of 4 text columns (about 100 bytes a row), the longest names first since the patterns are substrings\n"
+    "r16384 => ROWSET 16384 4 TEXT\n"
+    "r4096 => ROWSET 4096 4 TEXT\n"
+    "r1024 => ROWSET 1024 4 TEXT\n"
+    "r256 => ROWSET 256 4 TEXT\n"
+    "r64 => ROWSET 64 4 TEXT\n"
+    "r16 => ROWSET 16 4 TEXT\n"
+    "r4 => ROWSET 4 4 TEXT\n";
+
+static int compress_samples = 5;
+
+static int64_t compress_now_us (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + (int64_t)ts.tv_nsec / 1000;
+}
+
+static int compress_compare (const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t compress_median (int64_t *samples, int count) {
+    qsort(samples, (size_t)count, sizeof(int64_t), compress_compare);
+    return samples[count / 2];
+}
+
+static void compress_calibration_print (const SQCloudCompressionCalibration *calibration, const char *extra) {
+    printf("{\"run\":\"calibration\",%s,\"decompress_rate\":%llu,\"decompress_call_ns\":%u,\"ratio\":%u}\n", extra,
+           (unsigned long long)calibration->decompress_rate, calibration->decompress_call_ns, calibration->ratio);
+    fflush(stdout);
+}
+
+static SQCloudCompressionCalibration compress_calibrate (int runs, uint32_t budget_ms) {
+    // the median of each field over the runs, which keeps a run disturbed by the scheduler out of the calibration
+    int64_t rates[COMPRESS_MAX_SAMPLES], calls[COMPRESS_MAX_SAMPLES], ratios[COMPRESS_MAX_SAMPLES];
+    for (int i=0; i<runs; ++i) {
+        SQCloudCompressionCalibration calibration;
+        if (!SQCloudCompressionCalibrate(&calibration, budget_ms)) {
+            fprintf(stderr, "Calibration failed.\n");
+            exit(1);
+        }
+        char extra[32];
+        snprintf(extra, sizeof(extra), "\"sample\":%d", i);
+        compress_calibration_print(&calibration, extra);
+        rates[i] = (int64_t)calibration.decompress_rate;
+        calls[i] = calibration.decompress_call_ns;
+        ratios[i] = calibration.ratio;
+    }
+    
+    SQCloudCompressionCalibration median = {(uint64_t)compress_median(rates, runs), (uint32_t)compress_median(calls, runs), (uint32_t)compress_median(ratios, runs)};
+    compress_calibration_print(&median, "\"median\":true");
+    return median;
+}
+
+static void compress_exec (SQCloudConnection *connection, const char *command, int type) {
+    SQCloudResult *result = SQCloudExec(connection, command);
+    if (SQCloudResultType(result) != type) {
+        fprintf(stderr, "%s failed: %s.\n", command, SQCloudErrorMsg(connection));
+        exit(1);
+    }
+    SQCloudResultFree(result);
+}
+
+static void compress_set (SQCloudConnection *connection, bool compression) {
+    compress_exec(connection, (compression) ? "SET CLIENT KEY COMPRESSION TO 1;" : "SET CLIENT KEY COMPRESSION TO 0;", RESULT_OK);
+}
+
+static int64_t compress_time (SQCloudConnection *connection, const char *command, uint64_t *bytes) {
+    SQCloudStats before, after;
+    SQCloudConnectionStats(connection, &before);
+    int64_t start = compress_now_us();
+    compress_exec(connection, command, RESULT_ROWSET);
+    int64_t elapsed = compress_now_us() - start;
+    SQCloudConnectionStats(connection, &after);
+    if (bytes) *bytes = after.bytes_in - before.bytes_in;
+    return elapsed;
+}
+
+static void compress_bandwidth (const mock_network *network) {
+    mock_server *server = mock_server_start(0, compress_script, network);
+    if (!server) {
+        fprintf(stderr, "%s\n", mock_server_error());
+        exit(1);
+    }
+    
+    SQCloudConfig config = {0};
+    config.timeout = 60;
+    config.insecure = true;
+    SQCloudConnection *connection = SQCloudConnect("127.0.0.1", mock_server_port(server), &config);
+    if (SQCloudIsError(connection)) {
+        fprintf(stderr, "Connect failed: %s.\n", SQCloudErrorMsg(connection));
+        exit(1);
+    }
+    
+    // a few compressed replies of the largest size settle the link rate and the ratio estimate of the policy
+    char command[64];
+    snprintf(command, sizeof(command), "SELECT * FROM r%u;", COMPRESS_LINK_ROWS);
+    compress_set(connection, true);
+    for (int i=0; i<3; ++i) compress_time(connection, command, NULL);
+    
+    SQCloudStats stats;
+    SQCloudConnectionStats(connection, &stats);
+    uint32_t min_size = 0, ratio_max = 0;
+    bool calibrated = SQCloudCompressionThreshold(connection, &min_size, &ratio_max);
+    printf("{\"run\":\"threshold\",\"bandwidth_kbps\":%u,\"link_rate\":%llu,\"min_size\":%u,\"ratio_max\":%u,\"calibrated\":%s}\n", network->bandwidth_kbps,
+           (unsigned long long)stats.link_rate, min_size, ratio_max, (calibrated) ? "true" : "false");
+    fflush(stdout);
+    
+    for (size_t n=0; n<sizeof(compress_rows)/sizeof(compress_rows[0]); ++n) {
+        snprintf(command, sizeof(command), "SELECT * FROM r%u;", compress_rows[n]);
+        int64_t plain[COMPRESS_MAX_SAMPLES], compressed[COMPRESS_MAX_SAMPLES];
+        uint64_t bytes = 0;
+        
+        // the two settings alternate, so that a drift of the device affects both alike
+        for (int s=0; s<compress_samples; ++s) {
+            compress_set(connection, false);
+            plain[s] = compress_time(connection, command, &bytes);
+            compress_set(connection, true);
+            compressed[s] = compress_time(connection, command, NULL);
+        }
+        
+        int64_t plain_us = compress_median(plain, compress_samples), compressed_us = compress_median(compressed, compress_samples);
+        SQCloudCompressionThreshold(connection, &min_size, &ratio_max);
+        bool predicted = (bytes >= min_size && ratio_max > 0);
+        printf("{\"run\":\"reply\",\"bandwidth_kbps\":%u,\"rows\":%u,\"bytes\":%llu,\"plain_us\":%lld,\"compressed_us\":%lld,\"wins\":\"%s\",\"predicted\":\"%s\"}\n",
+               network->bandwidth_kbps, compress_rows[n], (unsigned long long)bytes, (long long)plain_us, (long long)compressed_us,
+               (compressed_us < plain_us) ? "compressed" : "plain", (predicted) ? "compressed" : "plain");
+        fflush(stdout);
+    }
+    
+    SQCloudDisconnect(connection);
+    mock_server_stop(server);
+}
+
+int main (int argc, char *argv[]) {
+    uint32_t bandwidths[COMPRESS_MAX_BANDWIDTHS] = {1000, 10000, 100000, 1000000};
+    int nbandwidths = 4;
+    int calibrations = 5;
+    uint32_t budget_ms = 0;
+    mock_network network = {0};
+    network.rtt_ms = 10;
+    
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) compress_samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) calibrations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) budget_ms = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) network.rtt_ms = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            nbandwidths = 0;
+            for (char *s = argv[++i]; *s && nbandwidths < COMPRESS_MAX_BANDWIDTHS; ++s) {
+                bandwidths[nbandwidths++] = (uint32_t)strtoul(s, &s, 10);
+                if (*s != ',') break;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [-n samples] [-c calibrations] [-t budget_ms] [-b kbps,...] [-r rtt_ms]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (compress_samples < 1 || compress_samples > COMPRESS_MAX_SAMPLES) compress_samples = 5;
+    if (calibrations < 1 || calibrations > COMPRESS_MAX_SAMPLES) calibrations = 5;
+    
+    SQCloudCompressionCalibration calibration = compress_calibrate(calibrations, budget_ms);
+    SQCloudSetCompressionCalibration(&calibration);
+    
+    for (int b=0; b<nbandwidths; ++b) {
+        network.bandwidth_kbps = bandwidths[b];
+        compress_bandwidth(&network);
+    }
+    
+    return 0;
+}
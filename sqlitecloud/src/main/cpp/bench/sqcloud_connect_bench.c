@@ -0,0 +1,286 @@
+//
+//  sqcloud_connect_bench.c
+//
+//  Cold start and connect path of the client, phase by phase, from the spans of the trace callback: the process-wide
+//  init (from the call of SQCloudConnect to the begin of its TRACE_CONNECT span), TRACE_TLS_SETUP (tls_init and the
+//  root certificates), TRACE_RESOLVE, TRACE_TCP_CONNECT, TRACE_TLS_HANDSHAKE, TRACE_CONNECT_CONFIG and the first command.
+//  A cold run is the first connect of a forked child that never touched the library, so its TLS, DNS and session
+//  caches are empty (the executable itself is already loaded, System.loadLibrary is measured by ConnectBenchmark of
+//  sqlitecloud-benchmark); a warm run is a later connect of a process that already connected once.
+//
+//  The endpoint is the loopback mock server of sqcloud_mockserver.h, run in a process of its own so that its libtls
+//  does not warm up the client, or a real one given with -h. Each run is printed on stdout as a JSON object on a line
+//  of its own, followed by the median of each phase of the cold and of the warm runs, so that the reports of two
+//  builds (or of two settings, such as -D) can be compared by a script:
+//  {"endpoint":"mock","tls":false,"defer_config":false,"run":"cold","sample":0,"init_us":41,...,"total_us":612}
+//
+//  Built by the sqcloud_connect_bench target of CMakeLists.txt with -DSQLITECLOUD_BENCHMARKS=ON (an Android executable
+//  to run with adb shell), or on the host with:
+//  cc -O2 -I.. sqcloud_connect_bench.c sqcloud_mockserver.c ../sqcloud.c ../lz4.c -ltls -lpthread -lm -o sqcloud_connect_bench
+//
+//  usage: sqcloud_connect_bench [-n samples] [-r rtt_ms] [-k certificate key] [-D] [-h host [-p port] [-u user -s password] [-d database] [-i]]
+//  -n: cold and warm runs (10 by default)
+//  -r, -k: round trip time and PEM certificate and key of the mock server (no delay and plain TCP by default)
+//  -D: defer_config, the configuration commands are sent with the first command
+//  -h, -p, -u, -s, -d: the real endpoint and its credentials, -i connects to it without TLS
+//
+
+#include "sqcloud_mockserver.h"
+#include "sqcloud.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CONNECT_MAX_SAMPLES                 256
+
+// the phases of a run, in the order of the connect path
+typedef enum {
+    PHASE_INIT,
+    PHASE_TLS_SETUP,
+    PHASE_RESOLVE,
+    PHASE_TCP_CONNECT,
+    PHASE_TLS_HANDSHAKE,
+    PHASE_CONNECT_CONFIG,
+    PHASE_FIRST_EXEC,
+    PHASE_TOTAL,
+    PHASES
+} connect_phase;
+
+static const char *connect_phase_names[PHASES] = {
+    "init_us", "tls_setup_us", "resolve_us", "tcp_connect_us", "tls_handshake_us", "connect_config_us", "first_exec_us", "total_us"
+};
+
+typedef struct {
+    int64_t         us[PHASES];             // -1 for a phase that did not happen (no TLS handshake over plain TCP)
+    int64_t         begin[PHASES];          // begin of the span being measured
+    int64_t         connect_begin;          // begin of the TRACE_CONNECT span
+    bool            failed;
+} connect_run;
+
+static struct {
+    const char      *host;
+    int             port;
+    SQCloudConfig   config;
+    bool            mock;
+    bool            tls;
+} endpoint;
+
+static int connect_samples = 10;
+
+static int64_t connect_now_us (void) {
+    // the clock of SQCloudTraceEvent.time_us
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + (int64_t)ts.tv_nsec / 1000;
+}
+
+static connect_phase connect_span_phase (SQCLOUD_TRACE_SPAN span) {
+    switch (span) {
+        case TRACE_TLS_SETUP: return PHASE_TLS_SETUP;
+        case TRACE_RESOLVE: return PHASE_RESOLVE;
+        case TRACE_TCP_CONNECT: return PHASE_TCP_CONNECT;
+        case TRACE_TLS_HANDSHAKE: return PHASE_TLS_HANDSHAKE;
+        case TRACE_CONNECT_CONFIG: return PHASE_CONNECT_CONFIG;
+        default: return PHASES;
+    }
+}
+
+static void connect_trace (SQCloudConnection *connection, const SQCloudTraceEvent *event, void *data) {
+    connect_run *run = (connect_run *)data;
+    if (event->span == TRACE_CONNECT) {
+        if (!event->end && !run->connect_begin) run->connect_begin = event->time_us;
+        return;
+    }
+
+    // only the first span of each phase, the one of the main socket
+    connect_phase phase = connect_span_phase(event->span);
+    if (phase == PHASES || run->us[phase] >= 0) return;
+    if (!event->end) run->begin[phase] = event->time_us;
+    else run->us[phase] = event->time_us - run->begin[phase];
+}
+
+static connect_run connect_once (void) {
+    connect_run run;
+    memset(&run, 0, sizeof(run));
+    for (int i=0; i<PHASES; ++i) run.us[i] = -1;
+
+    SQCloudConfig config = endpoint.config;
+    config.trace = connect_trace;
+    config.trace_data = &run;
+
+    int64_t start = connect_now_us();
+    SQCloudConnection *connection = SQCloudConnect(endpoint.host, endpoint.port, &config);
+    if (!connection || SQCloudIsError(connection)) {
+        fprintf(stderr, "Connect failed: %s.\n", (connection) ? SQCloudErrorMsg(connection) : "out of memory");
+        run.failed = true;
+        if (connection) SQCloudDisconnect(connection);
+        return run;
+    }
+    run.us[PHASE_INIT] = (run.connect_begin) ? run.connect_begin - start : -1;
+
+    // with defer_config the configuration commands are sent here
+    int64_t exec = connect_now_us();
+    SQCloudResult *result = SQCloudExec(connection, "SELECT 1;");
+    int64_t end = connect_now_us();
+    run.failed = (SQCloudResultType(result) == RESULT_ERROR);
+    if (run.failed) fprintf(stderr, "SELECT 1 failed: %s.\n", SQCloudErrorMsg(connection));
+    SQCloudResultFree(result);
+    run.us[PHASE_FIRST_EXEC] = end - exec;
+    run.us[PHASE_TOTAL] = end - start;
+
+    SQCloudDisconnect(connection);
+    return run;
+}
+
+static connect_run connect_cold (void) {
+    // the child has never called the library, the run comes back through a pipe
+    connect_run run;
+    memset(&run, 0, sizeof(run));
+    run.failed = true;
+
+    int fds[2];
+    if (pipe(fds) != 0) return run;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        connect_run child = connect_once();
+        ssize_t written = write(fds[1], &child, sizeof(child));
+        _exit((written == (ssize_t)sizeof(child)) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid > 0) {
+        if (read(fds[0], &run, sizeof(run)) != (ssize_t)sizeof(run)) run.failed = true;
+        waitpid(pid, NULL, 0);
+    }
+    close(fds[0]);
+    return run;
+}
+
+static void connect_print (const char *kind, int sample, const connect_run *run) {
+    printf("{\"endpoint\":\"%s\",\"tls\":%s,\"defer_config\":%s,\"run\":\"%s\"", (endpoint.mock) ? "mock" : endpoint.host,
+           (endpoint.tls) ? "true" : "false", (endpoint.config.defer_config) ? "true" : "false", kind);
+    if (sample >= 0) printf(",\"sample\":%d", sample);
+    else printf(",\"median\":true");
+    for (int i=0; i<PHASES; ++i) {
+        if (run->us[i] >= 0) printf(",\"%s\":%lld", connect_phase_names[i], (long long)run->us[i]);
+        else printf(",\"%s\":null", connect_phase_names[i]);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+static int connect_compare (const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void connect_summary (const char *kind, const connect_run *runs, int count) {
+    connect_run median;
+    memset(&median, 0, sizeof(median));
+    for (int i=0; i<PHASES; ++i) {
+        int64_t values[CONNECT_MAX_SAMPLES];
+        int n = 0;
+        for (int s=0; s<count; ++s) {
+            if (!runs[s].failed && runs[s].us[i] >= 0) values[n++] = runs[s].us[i];
+        }
+        qsort(values, (size_t)n, sizeof(int64_t), connect_compare);
+        median.us[i] = (n) ? values[n / 2] : -1;
+    }
+    connect_print(kind, -1, &median);
+}
+
+static pid_t connect_mock_start (const mock_network *network, int *port) {
+    // the server runs in a process of its own until it is killed, its port comes back through a pipe
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        static const char script[] = "SELECT 1 => INT 1\n";
+        mock_server *server = mock_server_start(0, script, network);
+        int value = (server) ? mock_server_port(server) : -1;
+        if (!server) fprintf(stderr, "%s\n", mock_server_error());
+        ssize_t written = write(fds[1], &value, sizeof(value));
+        close(fds[1]);
+        if (!server || written != (ssize_t)sizeof(value)) _exit(1);
+        for (;;) pause();
+    }
+    close(fds[1]);
+    if (pid > 0 && (read(fds[0], port, sizeof(*port)) != (ssize_t)sizeof(*port) || *port < 0)) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        pid = -1;
+    }
+    close(fds[0]);
+    return pid;
+}
+
+int main (int argc, char *argv[]) {
+    mock_network network = {0};
+    endpoint.mock = true;
+    endpoint.host = "127.0.0.1";
+    endpoint.port = 8860;
+    endpoint.config.timeout = 30;
+    endpoint.config.username = "bench";
+    endpoint.config.password = "bench";
+    bool insecure = false;
+
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) connect_samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) network.rtt_ms = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 2 < argc) {network.tls_certificate = argv[++i]; network.tls_certificate_key = argv[++i];}
+        else if (strcmp(argv[i], "-D") == 0) endpoint.config.defer_config = true;
+        else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {endpoint.host = argv[++i]; endpoint.mock = false;}
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) endpoint.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) endpoint.config.username = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) endpoint.config.password = argv[++i];
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) endpoint.config.database = argv[++i];
+        else if (strcmp(argv[i], "-i") == 0) insecure = true;
+        else {
+            fprintf(stderr, "usage: %s [-n samples] [-r rtt_ms] [-k certificate key] [-D] [-h host [-p port] [-u user -s password] [-d database] [-i]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (connect_samples < 1 || connect_samples > CONNECT_MAX_SAMPLES) connect_samples = 10;
+
+    pid_t server = -1;
+    if (endpoint.mock) {
+        server = connect_mock_start(&network, &endpoint.port);
+        if (server < 0) return 1;
+        endpoint.tls = (network.tls_certificate != NULL);
+        endpoint.config.tls_root_certificate = network.tls_certificate;
+        endpoint.config.no_verify_certificate = true;
+    } else {
+        endpoint.tls = !insecure;
+    }
+    endpoint.config.insecure = !endpoint.tls;
+
+    // the cold runs first, while this process has still never called the library
+    static connect_run cold[CONNECT_MAX_SAMPLES], warm[CONNECT_MAX_SAMPLES];
+    for (int s=0; s<connect_samples; ++s) {
+        cold[s] = connect_cold();
+        if (!cold[s].failed) connect_print("cold", s, &cold[s]);
+    }
+
+    // the first connect of this process fills the caches and is not reported
+    connect_once();
+    for (int s=0; s<connect_samples; ++s) {
+        warm[s] = connect_once();
+        if (!warm[s].failed) connect_print("warm", s, &warm[s]);
+    }
+
+    connect_summary("cold", cold, connect_samples);
+    connect_summary("warm", warm, connect_samples);
+
+    if (server > 0) {
+        kill(server, SIGKILL);
+        waitpid(server, NULL, 0);
+    }
+    return 0;
+}
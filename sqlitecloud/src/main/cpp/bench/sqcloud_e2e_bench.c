@@ -0,0 +1,176 @@
+//
+//  sqcloud_e2e_bench.c
+//
+//  End-to-end latency matrix of the client against the mock server of sqcloud_mockserver.h: round trip time x reply
+//  size x compression x TLS, with the time of the connect, of a command, of a pipeline of commands and of a command
+//  whose rowset is split into chunks (MAXROWS). The numbers are reproducible on a single device and show what the
+//  client side latency features gain on each network.
+//
+//  Built by the sqcloud_e2e_bench target of CMakeLists.txt with -DSQLITECLOUD_BENCHMARKS=ON (an Android executable to
+//  run with adb shell), or on the host with:
+//  cc -O2 -I.. sqcloud_e2e_bench.c sqcloud_mockserver.c ../sqcloud.c ../lz4.c -ltls -lpthread -lm -o sqcloud_e2e_bench
+//
+//  usage: sqcloud_e2e_bench [-n samples] [-r rtt_ms,...] [-b kbps] [-l loss_permille] [-k certificate key]
+//  -n: samples of each measure (5 by default), their median is reported
+//  -r: round trip times of the matrix (0,20,80 by default)
+//  -b, -l: bandwidth and loss of every network of the matrix (unlimited and none by default)
+//  -k: PEM certificate and key of the server, the TLS rows of the matrix are skipped without them
+//
+
+#include "sqcloud_mockserver.h"
+#include "sqcloud.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define E2E_MAX_RTTS                        8
+#define E2E_PIPELINE                        8           // commands of the pipeline measure
+#define E2E_CHUNK_ROWS                      256         // MAXROWS of the chunked measure
+
+static const uint32_t e2e_rows[] = {16, 1024, 16384};
+
+static const char e2e_script[] =
+    "# rowsets of 4 text columns (about 100 bytes a row), the longest names first since the patterns are substrings\n"
+    "r16384 => ROWSET 16384 4 TEXT\n"
+    "r1024 => ROWSET 1024 4 TEXT\n"
+    "r16 => ROWSET 16 4 TEXT\n";
+
+static int e2e_samples = 5;
+
+static double e2e_now_ms (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+}
+
+static int e2e_compare (const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double e2e_median (double *samples) {
+    qsort(samples, (size_t)e2e_samples, sizeof(double), e2e_compare);
+    return samples[e2e_samples / 2];
+}
+
+static SQCloudConnection *e2e_connect (int port, const mock_network *network, bool compression, int max_rows) {
+    SQCloudConfig config = {0};
+    config.compression = compression;
+    config.max_rows = max_rows;
+    config.timeout = 30;
+    config.insecure = (network->tls_certificate == NULL);
+    config.tls_root_certificate = network->tls_certificate;
+    config.no_verify_certificate = true;
+    
+    SQCloudConnection *connection = SQCloudConnect("127.0.0.1", port, &config);
+    if (SQCloudIsError(connection)) {
+        fprintf(stderr, "Connect failed: %s.\n", SQCloudErrorMsg(connection));
+        exit(1);
+    }
+    return connection;
+}
+
+static void e2e_exec (SQCloudConnection *connection, const char *command) {
+    SQCloudResult *result = SQCloudExec(connection, command);
+    if (SQCloudResultType(result) != RESULT_ROWSET) {
+        fprintf(stderr, "%s failed: %s.\n", command, SQCloudErrorMsg(connection));
+        exit(1);
+    }
+    SQCloudResultFree(result);
+}
+
+static void e2e_cell (int port, const mock_network *network, uint32_t rows, bool compression) {
+    char command[64];
+    snprintf(command, sizeof(command), "SELECT * FROM r%u;", rows);
+    double connect[64], exec[64], pipeline[64], chunked[64];
+    uint64_t bytes = 0;
+    
+    for (int s=0; s<e2e_samples; ++s) {
+        double start = e2e_now_ms();
+        SQCloudConnection *connection = e2e_connect(port, network, compression, 0);
+        connect[s] = e2e_now_ms() - start;
+        
+        SQCloudStats before, after;
+        SQCloudConnectionStats(connection, &before);
+        start = e2e_now_ms();
+        e2e_exec(connection, command);
+        exec[s] = e2e_now_ms() - start;
+        SQCloudConnectionStats(connection, &after);
+        bytes = after.bytes_in - before.bytes_in;
+        
+        start = e2e_now_ms();
+        SQCloudPipeline *p = SQCloudPipelineBegin(connection);
+        for (int i=0; i<E2E_PIPELINE; ++i) SQCloudPipelineAppend(p, command);
+        uint32_t count = 0;
+        SQCloudResult **results = SQCloudPipelineFlush(p, &count);
+        pipeline[s] = e2e_now_ms() - start;
+        if (!results || count != E2E_PIPELINE) {
+            fprintf(stderr, "Pipeline failed: %s.\n", SQCloudErrorMsg(connection));
+            exit(1);
+        }
+        SQCloudPipelineResultsFree(results, count);
+        SQCloudDisconnect(connection);
+        
+        connection = e2e_connect(port, network, compression, E2E_CHUNK_ROWS);
+        start = e2e_now_ms();
+        e2e_exec(connection, command);
+        chunked[s] = e2e_now_ms() - start;
+        SQCloudDisconnect(connection);
+    }
+    
+    printf("%6u %-4s %6u %-3s %10llu %10.2f %10.2f %10.2f %10.2f\n", network->rtt_ms, (network->tls_certificate) ? "tls" : "tcp", rows,
+           (compression) ? "lz4" : "-", (unsigned long long)bytes, e2e_median(connect), e2e_median(exec), e2e_median(pipeline) / E2E_PIPELINE, e2e_median(chunked));
+    fflush(stdout);
+}
+
+int main (int argc, char *argv[]) {
+    uint32_t rtts[E2E_MAX_RTTS] = {0, 20, 80};
+    int nrtts = 3;
+    mock_network network = {0};
+    const char *certificate = NULL, *key = NULL;
+    
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) e2e_samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) network.bandwidth_kbps = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) network.loss_permille = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 2 < argc) {certificate = argv[++i]; key = argv[++i];}
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            nrtts = 0;
+            for (char *s = argv[++i]; *s && nrtts < E2E_MAX_RTTS; ++s) {
+                rtts[nrtts++] = (uint32_t)strtoul(s, &s, 10);
+                if (*s != ',') break;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [-n samples] [-r rtt_ms,...] [-b kbps] [-l loss_permille] [-k certificate key]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (e2e_samples < 1 || e2e_samples > 64) e2e_samples = 5;
+    if (!certificate) fprintf(stderr, "No -k certificate key: the TLS rows are skipped.\n");
+    
+    printf("%6s %-4s %6s %-3s %10s %10s %10s %10s %10s\n", "rtt_ms", "net", "rows", "lz4", "bytes_in", "connect", "exec", "pipelined", "chunked");
+    for (int r=0; r<nrtts; ++r) {
+        for (int tls=0; tls<2; ++tls) {
+            if (tls && !certificate) continue;
+            network.rtt_ms = rtts[r];
+            network.tls_certificate = (tls) ? certificate : NULL;
+            network.tls_certificate_key = (tls) ? key : NULL;
+            
+            mock_server *server = mock_server_start(0, e2e_script, &network);
+            if (!server) {
+                fprintf(stderr, "%s\n", mock_server_error());
+                return 1;
+            }
+            int port = mock_server_port(server);
+            for (size_t n=0; n<sizeof(e2e_rows)/sizeof(e2e_rows[0]); ++n) {
+                e2e_cell(port, &network, e2e_rows[n], false);
+                e2e_cell(port, &network, e2e_rows[n], true);
+            }
+            mock_server_stop(server);
+        }
+    }
+    
+    return 0;
+}
@@ -0,0 +1,1224 @@
+//
+//  sqcloud_mockserver.c
+//
+//  See sqcloud_mockserver.h. The network is emulated on the server side only: each connection thread keeps the
+//  commands it received in a delay line until half the round trip has elapsed, and sends its replies as segments
+//  paced by the bandwidth that become due half a round trip after leaving the link. A lost segment is due a
+//  retransmission timeout later, together with every segment behind it (TCP delivers in order).
+//
+
+#define _GNU_SOURCE                         // memmem, strndup
+#include "sqcloud_mockserver.h"
+#include "sqcloud.h"
+#include "lz4.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <tls.h>
+
+#define MOCK_SEGMENT_SIZE                   1448        // payload of a TCP segment on a 1500 bytes MTU
+#define MOCK_RTO_MIN_MS                     200         // minimum retransmission timeout of Linux
+#define MOCK_COMPRESS_MIN                   1024        // rowsets from this size are compressed when the session asks for it
+#define MOCK_READ_SIZE                      65536
+#define MOCK_BACKLOG                        1024        // pending connections of a ramp of hundreds of clients
+
+typedef enum {
+    MOCK_REPLY_OK,
+    MOCK_REPLY_NULL,
+    MOCK_REPLY_INT,
+    MOCK_REPLY_FLOAT,
+    MOCK_REPLY_STRING,
+    MOCK_REPLY_ERROR,
+    MOCK_REPLY_ROWSET,
+    MOCK_REPLY_STEPS,
+    MOCK_REPLY_DATABASE
+} mock_reply_type;
+
+typedef struct {
+    char                *pattern;
+    mock_reply_type     type;
+    char                *text;              // STRING text, ERROR message, INT and FLOAT values as written
+    int                 code;               // ERROR code
+    uint32_t            rows;               // ROWSET shape
+    uint32_t            cols;
+    bool                textvalues;
+    uint32_t            fail_chunk;         // ROWSET chunk replaced by an error reply, which ends the rowset (0 for none)
+    uint64_t            db_size;            // DATABASE size and bytes of each DOWNLOAD STEP
+    uint32_t            db_step;
+    uint32_t            delay_ms;           // server time before the reply
+} mock_rule;
+
+typedef struct {
+    char                *data;
+    size_t              len;
+    size_t              size;
+} mock_buffer;
+
+typedef struct {
+    int64_t             due;                // time the command reaches the server
+    size_t              end;                // end of its bytes in mock_connection.requests
+} mock_request;
+
+typedef struct {
+    int64_t             due;                // time the segment reaches the client
+    size_t              end;                // end of its bytes in mock_connection.output
+} mock_segment;
+
+typedef struct {
+    uint32_t            session;            // the main connection of the listening client
+    char                *channel;
+} mock_subscription;
+
+typedef struct {
+    bool                used;
+    bool                select;             // a step replies its bindings as a row, like SELECT ?1, ?2
+    uint32_t            nparams;
+    char                **values;           // bound values as text, NULL for the unbound ones
+} mock_vm;
+
+struct mock_server {
+    int                 fd;
+    mock_network        network;
+    mock_rule           *rules;
+    uint32_t            nrules;
+    struct tls_config   *tls_config;
+    struct tls          *tls;               // server context the connections are accepted from
+    pthread_t           thread;
+    pthread_mutex_t     mutex;
+    int                 *clients;           // sockets of the connections being served (to shut them down on stop)
+    uint32_t            nclients;
+    uint32_t            aclients;
+    bool                stopping;
+    
+    // pub/sub state, guarded by mutex
+    uint32_t            sessions;           // last session number given to a connection
+    mock_subscription   *subscriptions;
+    uint32_t            nsubscriptions;
+    uint32_t            asubscriptions;
+    struct mock_connection **subscribers;   // the pub/sub sockets, each one receives the notifications of its session
+    uint32_t            nsubscribers;
+    uint32_t            asubscribers;
+};
+
+typedef struct mock_connection {
+    mock_server         *server;
+    int                 fd;
+    struct tls          *tls;
+    uint64_t            seed;               // loss generator
+
+    mock_buffer         input;              // bytes received and not yet framed
+    mock_buffer         requests;           // commands in the delay line
+    mock_request        *queue;
+    uint32_t            qhead;
+    uint32_t            qcount;
+    uint32_t            qalloc;
+
+    mock_buffer         output;             // replies not yet sent
+    size_t              sent;
+    mock_segment        *segments;
+    uint32_t            shead;
+    uint32_t            scount;
+    uint32_t            salloc;
+    int64_t             link_free;          // time the link finishes sending the last queued segment
+    int64_t             last_due;
+    int64_t             server_free;        // time the last DELAY reply is ready
+
+    bool                compression;        // session state set by SET CLIENT KEY
+    uint32_t            maxrows;
+    bool                binary;             // BINARYROWSET
+    char                *dict;              // dictionary set by SET COMPRESSION DICTIONARY, and its ID
+    size_t              dict_len;
+    uint32_t            dict_id;
+    uint32_t            header_slots;       // ROWSET_HEADERS set by the session
+    bool                header_sent[256];   // headers of the slots the client holds
+    
+    mock_vm             *vms;               // VM COMPILE index n is vms[n-1]
+    uint32_t            nvms;
+    uint32_t            avms;
+    mock_buffer         steps;              // rowset values of the bindings of the steps, the STEPS reply
+    uint32_t            nsteps;
+    uint32_t            steps_cols;
+    
+    uint64_t            db_size;            // database being downloaded (see DATABASE), 0 for none
+    uint32_t            db_step;
+    uint64_t            db_offset;          // offset of the next DOWNLOAD STEP
+    bool                db_compression;     // COMPRESSION_DOWNLOAD set by the session
+    
+    uint32_t            session;
+    uint32_t            subscribed;         // session of a pub/sub socket, 0 for a main connection
+    mock_buffer         notifications;      // notifications not yet queued on the pub/sub socket, guarded by the server mutex
+    int                 wake[2];            // pipe written when notifications are added, created by PAUTH
+} mock_connection;
+
+static char mock_error[256];
+
+// MARK: - UTILS -
+
+static int64_t mock_time_us (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool mock_set_error (const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(mock_error, sizeof(mock_error), format, args);
+    va_end(args);
+    return false;
+}
+
+static void mock_append (mock_buffer *b, const char *data, size_t len) {
+    // nothing to copy, data and b->data can both be NULL
+    if (len == 0) return;
+    if (b->len + len > b->size) {
+        b->size = (b->len + len) * 2;
+        b->data = realloc(b->data, b->size);
+        if (!b->data) {fprintf(stderr, "Out of memory.\n"); exit(1);}
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void mock_appendf (mock_buffer *b, const char *format, ...) {
+    char tmp[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(tmp, sizeof(tmp), format, args);
+    va_end(args);
+    mock_append(b, tmp, (size_t)n);
+}
+
+static void *mock_grow (void *array, uint32_t *alloc, uint32_t count, size_t item) {
+    if (count < *alloc) return array;
+    *alloc = (*alloc) ? *alloc * 2 : 16;
+    array = realloc(array, *alloc * item);
+    if (!array) {fprintf(stderr, "Out of memory.\n"); exit(1);}
+    return array;
+}
+
+static bool mock_lost (mock_connection *c) {
+    // xorshift64, seeded per connection so that a run is reproducible
+    if (c->server->network.loss_permille == 0) return false;
+    c->seed ^= c->seed << 13;
+    c->seed ^= c->seed >> 7;
+    c->seed ^= c->seed << 17;
+    return (c->seed % 1000) < c->server->network.loss_permille;
+}
+
+static int64_t mock_rto_us (mock_connection *c) {
+    uint32_t rto = c->server->network.rtt_ms * 2;
+    return (int64_t)((rto > MOCK_RTO_MIN_MS) ? rto : MOCK_RTO_MIN_MS) * 1000;
+}
+
+static const char *mock_array_item (const char *command, size_t len, const char *p, size_t *vlen) {
+    // the item of an array after the one p points into, !LEN TEXT or $LEN BLOB (the items before it are ended by their NUL,
+    // like the command that is the first item)
+    const char *end = command + len;
+    p = memchr(p, 0, (size_t)(end - p));
+    if (!p || ++p >= end) return NULL;
+    
+    char *space = NULL;
+    size_t n = strtoull(p + 1, &space, 10);
+    if (*space != ' ' || space + 1 + n > end) return NULL;
+    *vlen = (*p == CMD_ZEROSTRING && n) ? n - 1 : n;
+    return space + 1;
+}
+
+// MARK: - SCRIPT -
+
+static bool mock_parse_reply (mock_rule *rule, const char *reply) {
+    while (*reply == ' ') ++reply;
+    
+    if (strncmp(reply, "DELAY ", 6) == 0) {
+        char *next = NULL;
+        rule->delay_ms += (uint32_t)strtoul(reply + 6, &next, 10);
+        return mock_parse_reply(rule, next);
+    }
+    
+    if (strcmp(reply, "OK") == 0) rule->type = MOCK_REPLY_OK;
+    else if (strcmp(reply, "NULL") == 0) rule->type = MOCK_REPLY_NULL;
+    else if (strncmp(reply, "INT ", 4) == 0) {rule->type = MOCK_REPLY_INT; rule->text = strdup(reply + 4);}
+    else if (strncmp(reply, "FLOAT ", 6) == 0) {rule->type = MOCK_REPLY_FLOAT; rule->text = strdup(reply + 6);}
+    else if (strncmp(reply, "STRING ", 7) == 0) {rule->type = MOCK_REPLY_STRING; rule->text = strdup(reply + 7);}
+    else if (strncmp(reply, "ERROR ", 6) == 0) {
+        char *next = NULL;
+        rule->type = MOCK_REPLY_ERROR;
+        rule->code = (int)strtol(reply + 6, &next, 10);
+        while (*next == ' ') ++next;
+        rule->text = strdup(next);
+    } else if (strcmp(reply, "STEPS") == 0) {
+        rule->type = MOCK_REPLY_STEPS;
+    } else if (strncmp(reply, "DATABASE ", 9) == 0) {
+        unsigned long long size = 0;
+        rule->type = MOCK_REPLY_DATABASE;
+        if (sscanf(reply + 9, "%llu %u", &size, &rule->db_step) < 2 || rule->db_step == 0) return false;
+        rule->db_size = size;
+    } else if (strncmp(reply, "ROWSET ", 7) == 0) {
+        rule->type = MOCK_REPLY_ROWSET;
+        if (sscanf(reply + 7, "%u %u", &rule->rows, &rule->cols) < 2 || rule->cols == 0) return false;
+        rule->textvalues = (strstr(reply + 7, " TEXT") != NULL);
+        const char *fail = strstr(reply + 7, " FAIL ");
+        if (fail) rule->fail_chunk = (uint32_t)strtoul(fail + 6, NULL, 10);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool mock_parse_script (mock_server *server, const char *script) {
+    char *copy = strdup((script) ? script : "");
+    char *next = NULL;
+    uint32_t alloc = 0;
+    uint32_t line = 0;
+    
+    for (char *s = copy; s; s = next) {
+        next = strchr(s, '\n');
+        if (next) *next++ = 0;
+        ++line;
+        size_t len = strlen(s);
+        while (len && (s[len-1] == '\r' || s[len-1] == ' ')) s[--len] = 0;
+        while (*s == ' ') ++s;
+        if (*s == 0 || *s == '#') continue;
+        
+        char *arrow = strstr(s, "=>");
+        if (!arrow) {free(copy); return mock_set_error("Line %u of the script has no =>.", line);}
+        char *end = arrow;
+        while (end > s && end[-1] == ' ') --end;
+        
+        server->rules = mock_grow(server->rules, &alloc, server->nrules, sizeof(mock_rule));
+        mock_rule *rule = &server->rules[server->nrules++];
+        memset(rule, 0, sizeof(mock_rule));
+        rule->pattern = strndup(s, (size_t)(end - s));
+        if (!mock_parse_reply(rule, arrow + 2)) {free(copy); return mock_set_error("Line %u of the script has an unknown reply.", line);}
+    }
+    
+    free(copy);
+    return true;
+}
+
+static const mock_rule *mock_match (mock_server *server, const char *command, size_t len) {
+    for (uint32_t i=0; i<server->nrules; ++i) {
+        const char *pattern = server->rules[i].pattern;
+        if (memmem(command, len, pattern, strlen(pattern))) return &server->rules[i];
+    }
+    return NULL;
+}
+
+// MARK: - REPLIES -
+
+static void mock_varint (mock_buffer *body, uint32_t value) {
+    // LEB128, the lengths of the binary rowsets
+    do {
+        char byte = (char)(value & 0x7F);
+        value >>= 7;
+        if (value) byte |= (char)0x80;
+        mock_append(body, &byte, 1);
+    } while (value);
+}
+
+static void mock_rowset_values (mock_buffer *body, uint32_t first, uint32_t nrows, uint32_t ncols, bool text, bool binary) {
+    // the binary encoding (ROWSET_TYPE_BINARY) starts each row with the bitmap of its NULL columns (none here),
+    // then sends numbers as 8 bytes little-endian and strings with a varint length
+    char nulls[32] = {0};
+    for (uint32_t row=first; row<first+nrows; ++row) {
+        if (binary) mock_append(body, nulls, (ncols + 7) / 8);
+        for (uint32_t col=0; col<ncols; ++col) {
+            char value[64];
+            int n = (text) ? snprintf(value, sizeof(value), "user-%u %s", row + col, (col & 1) ? "example.com" : "lorem ipsum") : 0;
+            int64_t number = (int64_t)row * 31 + col * 7919;
+            
+            if (!binary && !text) mock_appendf(body, ":%lld ", (long long)number);
+            else if (!binary) mock_appendf(body, "+%d %s", n, value);
+            else if (text) {
+                mock_append(body, "+", 1);
+                mock_varint(body, (uint32_t)n);
+                mock_append(body, value, (size_t)n);
+            } else {
+                char le[9] = {CMD_INT};
+                for (int i=0; i<8; ++i) le[1+i] = (char)((uint64_t)number >> (8 * i));
+                mock_append(body, le, sizeof(le));
+            }
+        }
+    }
+}
+
+static void mock_rowset_reply (mock_buffer *reply, char type, uint32_t idx, uint32_t version, uint32_t hid, uint32_t nrows, uint32_t ncols, const mock_buffer *body, const mock_connection *c) {
+    // *LEN 0:VERSION[:HID] ROWS COLS DATA or /LEN IDX:VERSION[:HID] ROWS COLS DATA, compressed as %TLEN CLEN ULEN followed
+    // by the raw header and the LZ4 block of DATA; with a dictionary every rowset is compressed against it, as %TLEN CLEN ULEN ~ID
+    char prefix[64];
+    int plen = (hid) ? snprintf(prefix, sizeof(prefix), "%u:%u:%u %u %u ", idx, version, hid, nrows, ncols) :
+                       snprintf(prefix, sizeof(prefix), "%u:%u %u %u ", idx, version, nrows, ncols);
+    char header[96];
+    int hlen = snprintf(header, sizeof(header), "%c%zu %s", type, (size_t)plen + body->len, prefix);
+    
+    if (!c->compression || (body->len < MOCK_COMPRESS_MIN && !c->dict)) {
+        mock_append(reply, header, (size_t)hlen);
+        mock_append(reply, body->data, body->len);
+        return;
+    }
+    
+    int bound = LZ4_compressBound((int)body->len);
+    char *zdata = malloc((size_t)bound);
+    int clen = 0;
+    char sizes[64];
+    int slen = 0;
+    if (c->dict) {
+        LZ4_stream_t *stream = LZ4_createStream();
+        LZ4_loadDict(stream, c->dict, (int)c->dict_len);
+        clen = LZ4_compress_fast_continue(stream, body->data, zdata, (int)body->len, bound, 1);
+        LZ4_freeStream(stream);
+        slen = snprintf(sizes, sizeof(sizes), "%d %zu %c%u ", clen, body->len, CMD_CODEC, c->dict_id);
+    } else {
+        clen = LZ4_compress_default(body->data, zdata, (int)body->len, bound);
+        slen = snprintf(sizes, sizeof(sizes), "%d %zu ", clen, body->len);
+    }
+    mock_appendf(reply, "%c%zu %s", CMD_COMPRESSED, (size_t)slen + (size_t)hlen + (size_t)clen, sizes);
+    mock_append(reply, header, (size_t)hlen);
+    mock_append(reply, zdata, (size_t)clen);
+    free(zdata);
+}
+
+static void mock_error_reply (mock_buffer *reply, int code, const char *text) {
+    // -LEN CODE MESSAGE
+    char message[384];
+    int n = snprintf(message, sizeof(message), "%d %s", code, text);
+    mock_appendf(reply, "%c%d %s", CMD_ERROR, n, message);
+}
+
+static void mock_rowset (mock_connection *c, mock_buffer *reply, const mock_rule *rule) {
+    // split into chunks of MAXROWS rows (the column names go with the first one) followed by the end chunk; with
+    // ROWSET_HEADERS the rule takes the header slot of its index, whose header is sent once and then referenced
+    bool chunked = (c->maxrows > 0 && rule->rows > c->maxrows);
+    uint32_t step = (chunked) ? c->maxrows : rule->rows;
+    uint32_t idx = 1;
+    uint32_t slot = (uint32_t)(rule - c->server->rules);
+    uint32_t hid = (slot < c->header_slots) ? slot + 1 : 0;
+    bool cached = (hid && c->header_sent[slot]);
+    if (hid) c->header_sent[slot] = true;
+    
+    for (uint32_t first=0; first<rule->rows || first == 0; first+=step, ++idx) {
+        if (chunked && idx == rule->fail_chunk) {
+            // like a server that fails while it is stepping the statement, after the chunks already sent
+            mock_error_reply(reply, 10001, "Rowset interrupted.");
+            return;
+        }
+        uint32_t nrows = (rule->rows - first < step) ? rule->rows - first : step;
+        mock_buffer body = {0};
+        for (uint32_t col=0; first == 0 && !cached && col<rule->cols; ++col) {
+            char cname[32];
+            int n = snprintf(cname, sizeof(cname), "column%u", col);
+            mock_appendf(&body, "+%d %s", n, cname);
+        }
+        mock_rowset_values(&body, first, nrows, rule->cols, rule->textvalues, c->binary);
+        uint32_t version = ((first == 0 && cached) ? ROWSET_TYPE_DATA_ONLY : ROWSET_TYPE_BASIC) | ((c->binary) ? ROWSET_TYPE_BINARY : 0);
+        mock_rowset_reply(reply, (chunked) ? CMD_ROWSET_CHUNK : CMD_ROWSET, (chunked) ? idx : 0, version, (first == 0) ? hid : 0, nrows, rule->cols, &body, c);
+        free(body.data);
+        if (rule->rows == 0) break;
+    }
+    
+    if (chunked) mock_appendf(reply, "%c8 0:1 0 0 ", CMD_ROWSET_CHUNK);
+}
+
+static void mock_session (mock_connection *c, const char *command, size_t len) {
+    // the part of the session state that changes the replies
+    char *text = strndup(command, len);
+    const char *p;
+    if ((p = strstr(text, "SET CLIENT KEY COMPRESSION TO "))) c->compression = (atoi(p + 30) != 0);
+    if ((p = strstr(text, "SET CLIENT KEY MAXROWS TO "))) c->maxrows = (uint32_t)atoi(p + 26);
+    if ((p = strstr(text, "SET CLIENT KEY BINARYROWSET TO "))) c->binary = (atoi(p + 31) != 0);
+    if ((p = strstr(text, "SET CLIENT KEY COMPRESSION_DOWNLOAD TO "))) c->db_compression = (atoi(p + 39) != 0);
+    if ((p = strstr(text, "SET CLIENT KEY ROWSET_HEADERS TO "))) {
+        c->header_slots = (uint32_t)atoi(p + 33);
+        if (c->header_slots > 256) c->header_slots = 256;
+        memset(c->header_sent, 0, sizeof(c->header_sent));
+    }
+    free(text);
+}
+
+static bool mock_dictionary (mock_connection *c, const char *command, size_t len, mock_buffer *reply) {
+    // SET COMPRESSION DICTIONARY ? TO ? with the ID (:ID) and the dictionary ($LEN DATA) as its array items,
+    // an ID of 0 stops dictionary compression
+    static const char verb[] = "SET COMPRESSION DICTIONARY";
+    const char *p = memmem(command, len, verb, sizeof(verb) - 1);
+    if (!p) return false;
+    
+    const char *end = command + len;
+    char *next = NULL;
+    p = memchr(p, 0, (size_t)(end - p));
+    unsigned long id = (p && p + 2 < end && p[1] == CMD_INT) ? strtoul(p + 2, &next, 10) : 0;
+    size_t dlen = (next && next + 2 < end && next[1] == CMD_BLOB) ? strtoull(next + 2, &next, 10) : 0;
+    if (!next || next + 1 + dlen > end) {
+        mock_error_reply(reply, 1, "Invalid dictionary.");
+        return true;
+    }
+    
+    free(c->dict);
+    c->dict = (id && dlen) ? malloc(dlen) : NULL;
+    c->dict_len = (c->dict) ? dlen : 0;
+    c->dict_id = (c->dict) ? (uint32_t)id : 0;
+    if (c->dict) memcpy(c->dict, next + 1, dlen);
+    mock_append(reply, "+2 OK", 5);
+    return true;
+}
+
+static void mock_reply (mock_connection *c, const mock_rule *rule, mock_buffer *reply) {
+    switch ((rule) ? rule->type : MOCK_REPLY_OK) {
+        case MOCK_REPLY_OK: mock_append(reply, "+2 OK", 5); break;
+        case MOCK_REPLY_NULL: mock_append(reply, "_ ", 2); break;
+        case MOCK_REPLY_INT: mock_appendf(reply, "%c%s ", CMD_INT, rule->text); break;
+        case MOCK_REPLY_FLOAT: mock_appendf(reply, "%c%s ", CMD_FLOAT, rule->text); break;
+        case MOCK_REPLY_STRING: mock_appendf(reply, "%c%zu %s", CMD_STRING, strlen(rule->text), rule->text); break;
+        case MOCK_REPLY_ERROR: mock_error_reply(reply, rule->code, rule->text); break;
+        case MOCK_REPLY_ROWSET: mock_rowset(c, reply, rule); break;
+        case MOCK_REPLY_STEPS: {
+            mock_buffer body = {0};
+            for (uint32_t col=0; col<c->steps_cols; ++col) {
+                char cname[32];
+                int n = snprintf(cname, sizeof(cname), "?%u", col + 1);
+                mock_appendf(&body, "+%d %s", n, cname);
+            }
+            if (c->steps.len) mock_append(&body, c->steps.data, c->steps.len);
+            mock_rowset_reply(reply, CMD_ROWSET, 0, ROWSET_TYPE_BASIC, 0, (c->steps_cols) ? c->nsteps : 0, c->steps_cols, &body, c);
+            free(body.data);
+            break;
+        }
+        case MOCK_REPLY_DATABASE: {
+            // database size, number of pages and raft index, the bytes are sent by DOWNLOAD STEP
+            c->db_size = rule->db_size;
+            c->db_step = rule->db_step;
+            c->db_offset = 0;
+            mock_buffer body = {0};
+            mock_appendf(&body, "3 %c%llu %c%llu %c1 ", CMD_INT, (unsigned long long)rule->db_size, CMD_INT, (unsigned long long)((rule->db_size + 4095) / 4096), CMD_INT);
+            mock_appendf(reply, "%c%zu ", CMD_ARRAY, body.len);
+            mock_append(reply, body.data, body.len);
+            free(body.data);
+            break;
+        }
+    }
+}
+
+// MARK: - DOWNLOAD -
+
+static bool mock_download (mock_connection *c, const char *command, size_t len, mock_buffer *reply) {
+    // DOWNLOAD STEP [OFFSET n] replies the next bytes of the database of the last DATABASE reply (byte i is i % 251), an empty
+    // blob once they have all been sent (compressed while the session has COMPRESSION_DOWNLOAD set), and DOWNLOAD ABORT ends
+    // the download; false for the other commands
+    if (!c->db_size || len < 13 || strncmp(command, "DOWNLOAD ", 9) != 0) return false;
+    
+    if (strncmp(command, "DOWNLOAD ABORT", 14) == 0) {
+        c->db_size = 0;
+        mock_append(reply, "+2 OK", 5);
+        return true;
+    }
+    if (strncmp(command, "DOWNLOAD STEP", 13) != 0) return false;
+    
+    const char *offset = memmem(command, len, "OFFSET ", 7);
+    if (offset) c->db_offset = strtoull(offset + 7, NULL, 10);
+    uint64_t n = (c->db_offset < c->db_size) ? c->db_size - c->db_offset : 0;
+    if (n > c->db_step) n = c->db_step;
+    
+    mock_buffer body = {0};
+    for (uint64_t i=0; i<n; ++i) {
+        char byte = (char)((c->db_offset + i) % 251);
+        mock_append(&body, &byte, 1);
+    }
+    c->db_offset += n;
+    
+    // with COMPRESSION_DOWNLOAD the step is %TLEN CLEN ULEN followed by the raw $LEN header and the LZ4 block of its bytes
+    char header[32];
+    int hlen = snprintf(header, sizeof(header), "%c%llu ", CMD_BLOB, (unsigned long long)n);
+    if (!c->db_compression || n == 0) {
+        mock_append(reply, header, (size_t)hlen);
+        mock_append(reply, body.data, body.len);
+        free(body.data);
+        return true;
+    }
+    
+    int bound = LZ4_compressBound((int)body.len);
+    char *zdata = malloc((size_t)bound);
+    int clen = LZ4_compress_default(body.data, zdata, (int)body.len, bound);
+    char sizes[64];
+    int slen = snprintf(sizes, sizeof(sizes), "%d %zu ", clen, body.len);
+    mock_appendf(reply, "%c%zu %s", CMD_COMPRESSED, (size_t)slen + (size_t)hlen + (size_t)clen, sizes);
+    mock_append(reply, header, (size_t)hlen);
+    mock_append(reply, zdata, (size_t)clen);
+    free(zdata);
+    free(body.data);
+    return true;
+}
+
+// MARK: - PUB/SUB -
+
+static char *mock_pubsub_argument (char **text) {
+    // the next word of text, or the text between single quotes
+    char *s = *text;
+    while (*s == ' ') ++s;
+    if (*s == '\'') {
+        char *end = strrchr(s + 1, '\'');
+        if (end) {*end = 0; *text = end + 1; return s + 1;}
+    }
+    char *end = s;
+    while (*end && *end != ' ') ++end;
+    if (*end) *end++ = 0;
+    *text = end;
+    return s;
+}
+
+static void mock_pubsub_notify (mock_server *server, const char *channel, const char *payload) {
+    // called with the server mutex locked, the message is added once to each session listening to channel
+    // the publish time is in milliseconds since the epoch, like the one of a server
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long long timestamp = (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    
+    mock_buffer json = {0};
+    mock_appendf(&json, "{\"channel\":\"%s\",\"type\":\"MESSAGE\",\"sender\":\"mock\",\"timestamp\":%lld,\"payload\":\"", channel, timestamp);
+    for (const char *p = payload; *p; ++p) {
+        if (*p == '"' || *p == '\\') mock_append(&json, "\\", 1);
+        mock_append(&json, p, 1);
+    }
+    mock_append(&json, "\"}", 2);
+    
+    char header[32];
+    int hlen = snprintf(header, sizeof(header), "%c%zu ", CMD_JSON, json.len);
+    for (uint32_t i=0; i<server->nsubscribers; ++i) {
+        mock_connection *subscriber = server->subscribers[i];
+        for (uint32_t j=0; j<server->nsubscriptions; ++j) {
+            const mock_subscription *subscription = &server->subscriptions[j];
+            if (subscription->session != subscriber->subscribed) continue;
+            if (strcasecmp(subscription->channel, channel) != 0 && strcmp(subscription->channel, "*") != 0) continue;
+            
+            mock_append(&subscriber->notifications, header, (size_t)hlen);
+            mock_append(&subscriber->notifications, json.data, json.len);
+            char c = 0;
+            if (write(subscriber->wake[1], &c, 1) < 0) {/* a full pipe already wakes the thread */}
+            break;
+        }
+    }
+    free(json.data);
+}
+
+static bool mock_pubsub_notify_array (mock_server *server, const char *command, size_t len) {
+    // NOTIFY ? ? with the channel and the payload as the items of an array command (see SQCloudNotifyBatch)
+    const char *p = memmem(command, len, "NOTIFY ? ?", 10);
+    if (!p) return false;
+    
+    size_t clen = 0, plen = 0;
+    const char *citem = mock_array_item(command, len, p, &clen);
+    const char *pitem = (citem) ? mock_array_item(command, len, citem, &plen) : NULL;
+    if (!pitem) return false;
+    
+    char *channel = strndup(citem, clen), *payload = strndup(pitem, plen);
+    pthread_mutex_lock(&server->mutex);
+    mock_pubsub_notify(server, channel, payload);
+    pthread_mutex_unlock(&server->mutex);
+    free(channel);
+    free(payload);
+    return true;
+}
+
+static bool mock_pubsub (mock_connection *c, const char *command, size_t len, mock_buffer *reply) {
+    // LISTEN [TABLE] channel, UNLISTEN [TABLE] channel, PAUTH session and NOTIFY channel 'payload',
+    // false for the other commands, which are replied by the script
+    mock_server *server = c->server;
+    if (mock_pubsub_notify_array(server, command, len)) {
+        mock_append(reply, "+2 OK", 5);
+        return true;
+    }
+    
+    char *text = strndup(command, len);
+    len = strlen(text);                     // the first item of an array command ends with its NUL
+    while (len && (text[len-1] == ';' || text[len-1] == ' ')) text[--len] = 0;
+    char *next = text;
+    char *verb = mock_pubsub_argument(&next);
+    bool listen = (strcasecmp(verb, "LISTEN") == 0);
+    bool unlisten = (strcasecmp(verb, "UNLISTEN") == 0);
+    bool notify = (strcasecmp(verb, "NOTIFY") == 0);
+    bool pauth = (strcasecmp(verb, "PAUTH") == 0);
+    if (!listen && !unlisten && !notify && !pauth) {free(text); return false;}
+    
+    char *channel = mock_pubsub_argument(&next);
+    if ((listen || unlisten) && strcasecmp(channel, "TABLE") == 0) channel = mock_pubsub_argument(&next);
+    
+    pthread_mutex_lock(&server->mutex);
+    if (listen) {
+        uint32_t i = 0;
+        while (i < server->nsubscriptions && (server->subscriptions[i].session != c->session || strcasecmp(server->subscriptions[i].channel, channel) != 0)) ++i;
+        if (i == server->nsubscriptions) {
+            server->subscriptions = mock_grow(server->subscriptions, &server->asubscriptions, server->nsubscriptions, sizeof(mock_subscription));
+            server->subscriptions[server->nsubscriptions++] = (mock_subscription){c->session, strdup(channel)};
+        }
+    } else if (unlisten) {
+        for (uint32_t i=0; i<server->nsubscriptions; ++i) {
+            mock_subscription *subscription = &server->subscriptions[i];
+            if (subscription->session != c->session || strcasecmp(subscription->channel, channel) != 0) continue;
+            free(subscription->channel);
+            *subscription = server->subscriptions[--server->nsubscriptions];
+            break;
+        }
+    } else if (pauth && !c->subscribed && pipe(c->wake) == 0) {
+        fcntl(c->wake[0], F_SETFL, fcntl(c->wake[0], F_GETFL) | O_NONBLOCK);
+        fcntl(c->wake[1], F_SETFL, fcntl(c->wake[1], F_GETFL) | O_NONBLOCK);
+        c->subscribed = (uint32_t)strtoul(channel, NULL, 10);
+        server->subscribers = mock_grow(server->subscribers, &server->asubscribers, server->nsubscribers, sizeof(mock_connection *));
+        server->subscribers[server->nsubscribers++] = c;
+    } else if (notify) {
+        mock_pubsub_notify(server, channel, mock_pubsub_argument(&next));
+    }
+    pthread_mutex_unlock(&server->mutex);
+    
+    // the client opens its pub/sub socket and authenticates it with the command of the reply
+    if (listen) {
+        char pauth_command[32];
+        int n = snprintf(pauth_command, sizeof(pauth_command), "PAUTH %u", c->session);
+        mock_appendf(reply, "%c%d %s", CMD_PUBSUB, n, pauth_command);
+    } else {
+        mock_append(reply, "+2 OK", 5);
+    }
+    free(text);
+    return true;
+}
+
+static void mock_pubsub_remove (mock_connection *c) {
+    // a closed main connection stops listening, a closed pub/sub socket stops receiving
+    mock_server *server = c->server;
+    pthread_mutex_lock(&server->mutex);
+    for (uint32_t i=0; i<server->nsubscribers; ++i) {
+        if (server->subscribers[i] == c) {server->subscribers[i] = server->subscribers[--server->nsubscribers]; break;}
+    }
+    for (uint32_t i=0; !c->subscribed && i<server->nsubscriptions;) {
+        mock_subscription *subscription = &server->subscriptions[i];
+        if (subscription->session != c->session) {++i; continue;}
+        free(subscription->channel);
+        *subscription = server->subscriptions[--server->nsubscriptions];
+    }
+    pthread_mutex_unlock(&server->mutex);
+    
+    if (c->wake[0] >= 0) close(c->wake[0]);
+    if (c->wake[1] >= 0) close(c->wake[1]);
+    free(c->notifications.data);
+}
+
+// MARK: - VM -
+
+static void mock_vm_error (mock_buffer *reply, const char *message) {
+    char error[256];
+    int n = snprintf(error, sizeof(error), "1 %s", message);
+    mock_appendf(reply, "%c%d %s", CMD_ERROR, n, error);
+}
+
+static void mock_vm_array (mock_buffer *reply, const int64_t *values, uint32_t n) {
+    mock_buffer body = {0};
+    mock_appendf(&body, "%u ", n);
+    for (uint32_t i=0; i<n; ++i) mock_appendf(&body, "%c%lld ", CMD_INT, (long long)values[i]);
+    mock_appendf(reply, "%c%zu ", CMD_ARRAY, body.len);
+    mock_append(reply, body.data, body.len);
+    free(body.data);
+}
+
+static void mock_vm_values (mock_buffer *body, const mock_vm *vm) {
+    for (uint32_t i=0; i<vm->nparams; ++i) {
+        if (vm->values[i]) mock_appendf(body, "%c%zu %s", CMD_STRING, strlen(vm->values[i]), vm->values[i]);
+        else mock_append(body, "_ ", 2);
+    }
+}
+
+static void mock_vm_compile (mock_connection *c, const char *sql, size_t len, mock_buffer *reply) {
+    // ?NNN counts as NNN parameters, a bare ? as the next one
+    uint32_t nparams = 0;
+    for (size_t i=0; i<len; ++i) {
+        if (sql[i] != '?') continue;
+        uint32_t n = 0;
+        while (i + 1 < len && sql[i+1] >= '0' && sql[i+1] <= '9') n = n * 10 + (uint32_t)(sql[++i] - '0');
+        nparams = (n) ? ((n > nparams) ? n : nparams) : nparams + 1;
+    }
+    size_t start = 0;
+    while (start < len && sql[start] == ' ') ++start;
+    
+    uint32_t index = 0;
+    while (index < c->nvms && c->vms[index].used) ++index;
+    if (index == c->nvms) {
+        c->vms = mock_grow(c->vms, &c->avms, c->nvms, sizeof(mock_vm));
+        ++c->nvms;
+    }
+    mock_vm *vm = &c->vms[index];
+    vm->used = true;
+    vm->select = (len - start >= 6 && strncasecmp(sql + start, "SELECT", 6) == 0);
+    vm->nparams = nparams;
+    vm->values = calloc((nparams) ? nparams : 1, sizeof(char *));
+    
+    // TYPE, INDEX, NPARAMS, READONLY, NCOLUMNS, EXPLAIN, TAIL, FINALIZED (a tail of 0 is the whole statement)
+    int64_t values[8] = {ARRAY_TYPE_VM_COMPILE, index + 1, nparams, vm->select, (vm->select) ? nparams : 0, 0, 0, 0};
+    mock_vm_array(reply, values, 8);
+}
+
+static void mock_vm_free (mock_vm *vm) {
+    for (uint32_t i=0; i<vm->nparams; ++i) free(vm->values[i]);
+    free(vm->values);
+    memset(vm, 0, sizeof(mock_vm));
+}
+
+static bool mock_vm_command (mock_connection *c, const char *command, size_t len, mock_buffer *reply) {
+    // VM COMPILE, BIND, STEP, RESET and FINALIZE of statements that are not run: a step of a SELECT replies its bindings
+    // as a row, the step of any other statement adds them to the rows of the STEPS reply; RESET keeps the bindings
+    // like sqlite3_reset, false for the other commands
+    const char *p = memmem(command, len, "VM ", 3);
+    if (!p || (p != command && p[-1] != ' ' && p[-1] != '\0')) return false;
+    char *text = strndup(p, len - (size_t)(p - command));
+    
+    char verb[16] = {0};
+    int index = 0, column = 0;
+    sscanf(text, "VM %15s %d", verb, &index);
+    mock_vm *vm = (index >= 1 && (uint32_t)index <= c->nvms && c->vms[index-1].used) ? &c->vms[index-1] : NULL;
+    bool handled = true;
+    
+    if (strcmp(verb, "COMPILE") == 0) {
+        size_t slen = 0;
+        const char *sql = mock_array_item(command, len, p, &slen);
+        if (sql) mock_vm_compile(c, sql, slen, reply);
+        else mock_vm_error(reply, "VM COMPILE expects the statement as an array item.");
+    } else if (strcmp(verb, "BIND") == 0) {
+        char type[16] = {0};
+        const char *value = strstr(text, " VALUE ");
+        if (!vm || sscanf(text, "VM BIND %d TYPE %15s COLUMN %d", &index, type, &column) != 3 || column < 1 || (uint32_t)column > vm->nparams || !value) {
+            mock_vm_error(reply, "Invalid VM BIND.");
+        } else {
+            free(vm->values[column-1]);
+            size_t vlen = 0;
+            const char *item = (strcmp(type, "TEXT") == 0 || strcmp(type, "BLOB") == 0) ? mock_array_item(command, len, p, &vlen) : NULL;
+            if (item) vm->values[column-1] = strndup(item, vlen);
+            else if (strcmp(type, "NULL") == 0) vm->values[column-1] = NULL;
+            else vm->values[column-1] = strndup(value + 7, strcspn(value + 7, ";"));
+            mock_append(reply, "+2 OK", 5);
+        }
+    } else if (strcmp(verb, "STEP") == 0) {
+        if (!vm) {
+            mock_vm_error(reply, "Invalid VM index.");
+        } else if (vm->select) {
+            mock_buffer body = {0};
+            for (uint32_t col=0; col<vm->nparams; ++col) {
+                char cname[32];
+                int n = snprintf(cname, sizeof(cname), "?%u", col + 1);
+                mock_appendf(&body, "+%d %s", n, cname);
+            }
+            mock_vm_values(&body, vm);
+            mock_rowset_reply(reply, CMD_ROWSET, 0, ROWSET_TYPE_BASIC, 0, 1, vm->nparams, &body, c);
+            free(body.data);
+            
+            // a VM that replied a rowset is finalized by the server
+            mock_vm_free(vm);
+        } else {
+            mock_vm_values(&c->steps, vm);
+            c->steps_cols = vm->nparams;
+            ++c->nsteps;
+            
+            // TYPE, INDEX, LASTROWID, CHANGES, TOTALCHANGES, FINALIZED
+            int64_t values[6] = {ARRAY_TYPE_VM_STEP, index, c->nsteps, 1, c->nsteps, 0};
+            mock_vm_array(reply, values, 6);
+        }
+    } else if (strcmp(verb, "RESET") == 0 || strcmp(verb, "FINALIZE") == 0) {
+        if (vm && verb[0] == 'F') mock_vm_free(vm);
+        if (vm) mock_append(reply, "+2 OK", 5);
+        else mock_vm_error(reply, "Invalid VM index.");
+    } else {
+        handled = false;
+    }
+    
+    free(text);
+    return handled;
+}
+
+// MARK: - DELAY LINES -
+
+static bool mock_inflate_field (const char **p, const char *end, unsigned long *value) {
+    // a decimal number followed by a space, both before end: *p is moved past the space
+    const char *s = *p;
+    unsigned long v = 0;
+    while (s < end && *s >= '0' && *s <= '9' && v <= INT_MAX) v = v * 10 + (unsigned long)(*s++ - '0');
+    if (s == *p || s >= end || *s != ' ' || v > INT_MAX) return false;
+    *value = v;
+    *p = s + 1;
+    return true;
+}
+
+static void mock_inflate_request (mock_buffer *requests, const char *payload, size_t plen) {
+    // CLEN ULEN RAWHEADER ZDATA of a compressed upload, RAWHEADER being the $LEN of a blob or the =LEN N of an array:
+    // the command is served as if it was sent uncompressed (a frame that does not inflate, or whose fields do not fit
+    // in it, is kept as is and matches no rule)
+    const char *end = payload + plen;
+    const char *p = payload;
+    unsigned long clen = 0, ulen = 0, value = 0;
+    bool valid = (mock_inflate_field(&p, end, &clen) && mock_inflate_field(&p, end, &ulen) && p < end);
+    if (valid) {
+        int nfields = (*p++ == CMD_ARRAY) ? 2 : 1;
+        for (int i=0; valid && i<nfields; ++i) valid = mock_inflate_field(&p, end, &value);
+    }
+    
+    char *data = (valid && clen <= (size_t)(end - p)) ? malloc(ulen ? ulen : 1) : NULL;
+    if (data && LZ4_decompress_safe(p, data, (int)clen, (int)ulen) == (int)ulen) mock_append(requests, data, ulen);
+    else mock_append(requests, payload, plen);
+    free(data);
+}
+
+static void mock_frame_requests (mock_connection *c, int64_t now) {
+    // the commands are TYPE LEN SPACE PAYLOAD (strings, arrays, blobs and compressed uploads alike)
+    const mock_network *network = &c->server->network;
+    size_t off = 0;
+    while (off < c->input.len) {
+        const char *frame = c->input.data + off;
+        const char *space = memchr(frame, ' ', c->input.len - off);
+        if (!space) break;
+        size_t plen = strtoull(frame + 1, NULL, 10);
+        size_t hlen = (size_t)(space - frame) + 1;
+        if (c->input.len - off < hlen + plen) break;
+        
+        int64_t due = now + (int64_t)network->rtt_ms * 500;
+        if (mock_lost(c)) due += mock_rto_us(c);
+        if (c->qcount && due < c->queue[c->qhead + c->qcount - 1].due) due = c->queue[c->qhead + c->qcount - 1].due;
+        
+        if (frame[0] == CMD_COMPRESSED) mock_inflate_request(&c->requests, frame + hlen, plen);
+        else mock_append(&c->requests, frame + hlen, plen);
+        c->queue = mock_grow(c->queue, &c->qalloc, c->qhead + c->qcount, sizeof(mock_request));
+        c->queue[c->qhead + c->qcount++] = (mock_request){due, c->requests.len};
+        off += hlen + plen;
+    }
+    
+    if (off == 0) return;
+    memmove(c->input.data, c->input.data + off, c->input.len - off);
+    c->input.len -= off;
+}
+
+static void mock_queue_reply (mock_connection *c, const mock_buffer *reply, int64_t ready) {
+    // segments leave the link one after the other at the emulated bandwidth and arrive half a round trip later
+    const mock_network *network = &c->server->network;
+    for (size_t off=0; off<reply->len; off+=MOCK_SEGMENT_SIZE) {
+        size_t len = (reply->len - off < MOCK_SEGMENT_SIZE) ? reply->len - off : MOCK_SEGMENT_SIZE;
+        int64_t start = (c->link_free > ready) ? c->link_free : ready;
+        c->link_free = start + ((network->bandwidth_kbps) ? (int64_t)(len * 8 * 1000 / network->bandwidth_kbps) : 0);
+        
+        int64_t due = c->link_free + (int64_t)network->rtt_ms * 500;
+        if (mock_lost(c)) due += mock_rto_us(c);
+        if (due < c->last_due) due = c->last_due;
+        c->last_due = due;
+        
+        mock_append(&c->output, reply->data + off, len);
+        c->segments = mock_grow(c->segments, &c->salloc, c->shead + c->scount, sizeof(mock_segment));
+        c->segments[c->shead + c->scount++] = (mock_segment){due, c->output.len};
+    }
+}
+
+static void mock_queue_notifications (mock_connection *c, int64_t now) {
+    // the notifications added by the other connections leave on the link of the pub/sub socket
+    char drain[64];
+    while (read(c->wake[0], drain, sizeof(drain)) > 0) {}
+    
+    pthread_mutex_lock(&c->server->mutex);
+    mock_buffer notifications = c->notifications;
+    c->notifications = (mock_buffer){0};
+    pthread_mutex_unlock(&c->server->mutex);
+    
+    if (notifications.len) mock_queue_reply(c, &notifications, now);
+    free(notifications.data);
+}
+
+static void mock_process_requests (mock_connection *c, int64_t now) {
+    size_t start = (c->qhead) ? c->queue[c->qhead - 1].end : 0;
+    while (c->qcount && c->queue[c->qhead].due <= now) {
+        mock_request *request = &c->queue[c->qhead];
+        const char *command = c->requests.data + start;
+        size_t len = request->end - start;
+        mock_session(c, command, len);
+        mock_buffer reply = {0};
+        const mock_rule *rule = (mock_pubsub(c, command, len, &reply) || mock_vm_command(c, command, len, &reply) || mock_dictionary(c, command, len, &reply) || mock_download(c, command, len, &reply)) ? NULL : mock_match(c->server, command, len);
+        
+        // a DELAY holds the replies behind it too, the commands of a connection are run one at a time
+        int64_t ready = (c->server_free > now) ? c->server_free : now;
+        if (rule) ready += (int64_t)rule->delay_ms * 1000;
+        c->server_free = ready;
+        
+        if (reply.len == 0) mock_reply(c, rule, &reply);
+        mock_queue_reply(c, &reply, ready);
+        free(reply.data);
+        
+        start = request->end;
+        ++c->qhead;
+        --c->qcount;
+    }
+    
+    if (c->qcount == 0) {
+        c->qhead = 0;
+        c->requests.len = 0;
+    }
+}
+
+static ssize_t mock_write (mock_connection *c, const char *buffer, size_t len) {
+    if (c->tls) {
+        ssize_t n = tls_write(c->tls, buffer, len);
+        if (n == TLS_WANT_POLLIN || n == TLS_WANT_POLLOUT) {errno = EAGAIN; return -1;}
+        return n;
+    }
+    return send(c->fd, buffer, len, MSG_NOSIGNAL);
+}
+
+static ssize_t mock_read (mock_connection *c, char *buffer, size_t len) {
+    if (c->tls) {
+        ssize_t n = tls_read(c->tls, buffer, len);
+        if (n == TLS_WANT_POLLIN || n == TLS_WANT_POLLOUT) {errno = EAGAIN; return -1;}
+        return n;
+    }
+    return recv(c->fd, buffer, len, 0);
+}
+
+static bool mock_send_segments (mock_connection *c, int64_t now, bool *blocked) {
+    *blocked = false;
+    while (c->scount && c->segments[c->shead].due <= now) {
+        size_t end = c->segments[c->shead].end;
+        ssize_t n = mock_write(c, c->output.data + c->sent, end - c->sent);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {*blocked = true; return true;}
+        if (n <= 0) return false;
+        
+        c->sent += (size_t)n;
+        if (c->sent == end) {++c->shead; --c->scount;}
+    }
+    
+    if (c->scount == 0) {
+        c->shead = 0;
+        c->output.len = c->sent = 0;
+    }
+    return true;
+}
+
+// MARK: - SERVER -
+
+static void mock_client_remove (mock_server *server, int fd) {
+    pthread_mutex_lock(&server->mutex);
+    for (uint32_t i=0; i<server->nclients; ++i) {
+        if (server->clients[i] == fd) {server->clients[i] = server->clients[--server->nclients]; break;}
+    }
+    pthread_mutex_unlock(&server->mutex);
+}
+
+static void *mock_connection_thread (void *arg) {
+    mock_connection *c = (mock_connection *)arg;
+    char *buffer = malloc(MOCK_READ_SIZE);
+    pthread_mutex_lock(&c->server->mutex);
+    c->session = ++c->server->sessions;
+    pthread_mutex_unlock(&c->server->mutex);
+    
+    // the flights of a TLS handshake take a round trip (the TCP one is completed by the kernel and is not delayed)
+    if (c->tls) {
+        usleep(c->server->network.rtt_ms * 1000);
+        if (tls_handshake(c->tls) != 0) goto abort_connection;
+    }
+    fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+    
+    while (1) {
+        int64_t now = mock_time_us();
+        mock_process_requests(c, now);
+        bool blocked = false;
+        if (!mock_send_segments(c, now, &blocked)) break;
+        
+        // sleep until the socket is readable or the next command or segment is due
+        int64_t next = -1;
+        if (c->qcount) next = c->queue[c->qhead].due;
+        if (c->scount && !blocked && (next < 0 || c->segments[c->shead].due < next)) next = c->segments[c->shead].due;
+        int timeout = (next < 0) ? -1 : (int)((next - now + 999) / 1000);
+        if (timeout < 0 && next >= 0) timeout = 0;
+        
+        struct pollfd pfd[2] = {{c->fd, (short)(POLLIN | ((blocked) ? POLLOUT : 0)), 0}, {c->wake[0], POLLIN, 0}};
+        if (poll(pfd, (c->wake[0] >= 0) ? 2 : 1, timeout) < 0 && errno != EINTR) break;
+        if (c->wake[0] >= 0 && (pfd[1].revents & POLLIN)) mock_queue_notifications(c, mock_time_us());
+        if (!(pfd[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+        
+        // TLS may hold decrypted bytes the socket no longer signals, so reads go on until they would block
+        bool closed = false;
+        while (1) {
+            ssize_t n = mock_read(c, buffer, MOCK_READ_SIZE);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) break;
+            if (n <= 0) {closed = true; break;}
+            mock_append(&c->input, buffer, (size_t)n);
+        }
+        mock_frame_requests(c, mock_time_us());
+        if (closed) break;
+    }
+    
+abort_connection:
+    mock_pubsub_remove(c);
+    mock_client_remove(c->server, c->fd);
+    if (c->tls) {
+        tls_close(c->tls);
+        tls_free(c->tls);
+    }
+    close(c->fd);
+    free(buffer);
+    free(c->input.data);
+    free(c->requests.data);
+    free(c->queue);
+    free(c->output.data);
+    free(c->segments);
+    for (uint32_t i=0; i<c->nvms; ++i) mock_vm_free(&c->vms[i]);
+    free(c->vms);
+    free(c->steps.data);
+    free(c->dict);
+    free(c);
+    return NULL;
+}
+
+static void *mock_accept_thread (void *arg) {
+    mock_server *server = (mock_server *)arg;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    
+    while (1) {
+        int fd = accept(server->fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        
+        pthread_mutex_lock(&server->mutex);
+        bool stopping = server->stopping;
+        if (!stopping) {
+            server->clients = mock_grow(server->clients, &server->aclients, server->nclients, sizeof(int));
+            server->clients[server->nclients++] = fd;
+        }
+        pthread_mutex_unlock(&server->mutex);
+        if (stopping) {close(fd); break;}
+        
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        
+        mock_connection *c = calloc(1, sizeof(mock_connection));
+        c->server = server;
+        c->fd = fd;
+        c->seed = (seed += 0x9E3779B97F4A7C15ULL);
+        c->wake[0] = c->wake[1] = -1;
+        pthread_t thread;
+        if ((server->tls && tls_accept_socket(server->tls, &c->tls, fd) != 0) || pthread_create(&thread, NULL, mock_connection_thread, c) != 0) {
+            if (c->tls) tls_free(c->tls);
+            mock_client_remove(server, fd);
+            close(fd);
+            free(c);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static bool mock_setup_tls (mock_server *server) {
+    const mock_network *network = &server->network;
+    if (!network->tls_certificate) return true;
+    
+    if (tls_init() != 0) return mock_set_error("Unable to initialize TLS.");
+    server->tls_config = tls_config_new();
+    server->tls = tls_server();
+    if (!server->tls_config || !server->tls) return mock_set_error("Unable to create the TLS server.");
+    
+    // the suite is the first one of the client offer that the server supports (libtls prefers its own order by default)
+    tls_config_prefer_ciphers_client(server->tls_config);
+    if (tls_config_set_cert_file(server->tls_config, network->tls_certificate) != 0 ||
+        tls_config_set_key_file(server->tls_config, (network->tls_certificate_key) ? network->tls_certificate_key : network->tls_certificate) != 0 ||
+        tls_configure(server->tls, server->tls_config) != 0) {
+        return mock_set_error("Unable to configure TLS: %s.", tls_config_error(server->tls_config) ? tls_config_error(server->tls_config) : tls_error(server->tls));
+    }
+    return true;
+}
+
+static void mock_server_free (mock_server *server) {
+    if (server->fd >= 0) close(server->fd);
+    if (server->tls) tls_free(server->tls);
+    if (server->tls_config) tls_config_free(server->tls_config);
+    for (uint32_t i=0; i<server->nrules; ++i) {
+        free(server->rules[i].pattern);
+        free(server->rules[i].text);
+    }
+    free(server->rules);
+    free(server->clients);
+    for (uint32_t i=0; i<server->nsubscriptions; ++i) free(server->subscriptions[i].channel);
+    free(server->subscriptions);
+    free(server->subscribers);
+    pthread_mutex_destroy(&server->mutex);
+    free(server);
+}
+
+mock_server *mock_server_start (int port, const char *script, const mock_network *network) {
+    mock_server *server = calloc(1, sizeof(mock_server));
+    if (!server) return NULL;
+    server->fd = -1;
+    if (network) server->network = *network;
+    pthread_mutex_init(&server->mutex, NULL);
+    
+    if (!mock_parse_script(server, script) || !mock_setup_tls(server)) goto abort_start;
+    
+    server->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->fd < 0) {mock_set_error("Unable to create the socket: %s.", strerror(errno)); goto abort_start;}
+    int one = 1;
+    setsockopt(server->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server->fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server->fd, MOCK_BACKLOG) != 0) {
+        mock_set_error("Unable to listen on port %d: %s.", port, strerror(errno));
+        goto abort_start;
+    }
+    
+    if (pthread_create(&server->thread, NULL, mock_accept_thread, server) != 0) {
+        mock_set_error("Unable to start the server thread.");
+        goto abort_start;
+    }
+    return server;
+    
+abort_start:
+    mock_server_free(server);
+    return NULL;
+}
+
+int mock_server_port (mock_server *server) {
+    struct sockaddr_in address;
+    socklen_t len = sizeof(address);
+    if (getsockname(server->fd, (struct sockaddr *)&address, &len) != 0) return -1;
+    return ntohs(address.sin_port);
+}
+
+const char *mock_server_error (void) {
+    return mock_error;
+}
+
+void mock_server_stop (mock_server *server) {
+    if (!server) return;
+    
+    // the connections still open are shut down, their threads close them and remove them from clients
+    pthread_mutex_lock(&server->mutex);
+    server->stopping = true;
+    for (uint32_t i=0; i<server->nclients; ++i) shutdown(server->clients[i], SHUT_RDWR);
+    pthread_mutex_unlock(&server->mutex);
+    shutdown(server->fd, SHUT_RDWR);
+    pthread_join(server->thread, NULL);
+    
+    while (1) {
+        pthread_mutex_lock(&server->mutex);
+        uint32_t nclients = server->nclients;
+        pthread_mutex_unlock(&server->mutex);
+        if (nclients == 0) break;
+        usleep(1000);
+    }
+    mock_server_free(server);
+}
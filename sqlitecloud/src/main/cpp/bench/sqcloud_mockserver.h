@@ -0,0 +1,65 @@
+//
+//  sqcloud_mockserver.h
+//
+//  A loopback server speaking the subset of the SQLite Cloud protocol used by sqcloud.c, with scripted replies and an
+//  in-process emulation of the network (latency, bandwidth and loss), so that the end-to-end effects of the client
+//  features (connect, pipelining, chunking, compression, TLS) can be measured without a cluster.
+//
+//  A script is a list of lines "pattern => reply", the reply of the first line whose pattern is found in a command is
+//  sent (OK when none matches), empty lines and lines starting with # are ignored. Replies:
+//  OK, NULL, INT n, FLOAT x, STRING text, ERROR code message
+//  ROWSET rows cols [TEXT] [FAIL n]: a synthetic rowset (numbers, or TEXT values of about 25 bytes), split into chunks
+//  of the MAXROWS set by the session and compressed with LZ4 while the session has COMPRESSION set, FAIL replaces its
+//  chunk n (and the ones after it) with an error reply; with ROWSET_HEADERS set the rule of index i holds header slot
+//  i+1, and its rowsets after the first one are data-only rowsets that reference it; with BINARYROWSET set its values
+//  use the binary encoding
+//  DATABASE size step: the reply to DOWNLOAD DATABASE, after which DOWNLOAD STEP [OFFSET n] replies the next step bytes of a
+//  database of size bytes (byte i is i % 251) and an empty blob at its end, until DOWNLOAD ABORT; the steps are compressed
+//  with LZ4 while the session has COMPRESSION_DOWNLOAD set
+//  DELAY ms reply: reply after ms milliseconds of server time
+//  STEPS: a rowset of the bindings of each VM STEP of the session on a statement other than SELECT (one row per step,
+//  NULL for a parameter never bound), to check what the client bound
+//  VM COMPILE, BIND, STEP, RESET and FINALIZE are served before the script too: no statement is run, a step of a SELECT
+//  replies its bindings as a single row (like SELECT ?1, ?2) and a step of any other statement adds them to STEPS
+//  LISTEN, UNLISTEN and NOTIFY are served before the script: a LISTEN opens the pub/sub socket of the session (PAUTH) if
+//  it has none, and NOTIFY channel 'payload' sends {"channel":...,"timestamp":...,"payload":...} to every session listening to the channel
+//  (or to *), through the emulated network of its pub/sub socket; NOTIFY ? ? takes them from the items of an array command
+//  SET COMPRESSION DICTIONARY is served before the script too: while COMPRESSION is set, every rowset that follows is
+//  compressed against the dictionary (small ones included) and carries its ~ID codec token
+//  Compressed uploads (see SQCloudSetUploadCompression) are inflated before they are matched, SET CLIENT KEY
+//  COMPRESSION_UPLOAD is accepted like any other command unless the script says otherwise
+//  With a certificate the TLS suite is the first one of the client offer, like a server that honours the client preference.
+//  The TCP handshake is completed by the kernel before the server sees the connection, so it takes no emulated time.
+//
+
+#ifndef __SQCLOUD_MOCKSERVER__
+#define __SQCLOUD_MOCKSERVER__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t        rtt_ms;                 // round trip time, each direction is delayed by half of it
+    uint32_t        bandwidth_kbps;         // rate of the replies in kilobits per second (0 means unlimited)
+    uint32_t        loss_permille;          // segments delayed by a retransmission timeout (and the ones behind them)
+    const char      *tls_certificate;       // PEM files of the server certificate and key, NULL serves plain TCP
+    const char      *tls_certificate_key;
+} mock_network;
+
+typedef struct mock_server mock_server;
+
+// starts a server on 127.0.0.1 (port 0 picks a free one), each connection is served by a thread of its own
+mock_server *mock_server_start (int port, const char *script, const mock_network *network);
+int mock_server_port (mock_server *server);
+const char *mock_server_error (void);       // reason of the last failed mock_server_start
+void mock_server_stop (mock_server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
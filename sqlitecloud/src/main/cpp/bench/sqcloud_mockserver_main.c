@@ -0,0 +1,70 @@
+//
+//  sqcloud_mockserver_main.c
+//
+//  The mock server of sqcloud_mockserver.h as a standalone executable, to point an app (or the Kotlin tests) at a
+//  scripted server through adb reverse or on the host. Built by the sqcloud_mockserver target of CMakeLists.txt with
+//  -DSQLITECLOUD_BENCHMARKS=ON.
+//
+//  usage: sqcloud_mockserver [-p port] [-r rtt_ms] [-b kbps] [-l loss_permille] [-k certificate key] script
+//  the script file is described in sqcloud_mockserver.h, the server runs until it is interrupted
+//
+
+#include "sqcloud_mockserver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char *mock_read_file (const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    size_t len = 0, size = 4096;
+    char *data = malloc(size);
+    size_t n;
+    while (data && (n = fread(data + len, 1, size - len - 1, file)) > 0) {
+        len += n;
+        if (size - len == 1) data = realloc(data, size *= 2);
+    }
+    fclose(file);
+    if (data) data[len] = 0;
+    return data;
+}
+
+int main (int argc, char *argv[]) {
+    mock_network network = {0};
+    int port = 8860;
+    const char *path = NULL;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) network.rtt_ms = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) network.bandwidth_kbps = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) network.loss_permille = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 2 < argc) {network.tls_certificate = argv[++i]; network.tls_certificate_key = argv[++i];}
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [-p port] [-r rtt_ms] [-b kbps] [-l loss_permille] [-k certificate key] script\n", argv[0]);
+        return 1;
+    }
+    
+    char *script = mock_read_file(path);
+    if (!script) {
+        fprintf(stderr, "Unable to read %s.\n", path);
+        return 1;
+    }
+    
+    mock_server *server = mock_server_start(port, script, &network);
+    free(script);
+    if (!server) {
+        fprintf(stderr, "%s\n", mock_server_error());
+        return 1;
+    }
+    
+    printf("Listening on 127.0.0.1:%d (%s, rtt %u ms, %u kbps, loss %u/1000)\n", mock_server_port(server),
+           (network.tls_certificate) ? "TLS" : "plain", network.rtt_ms, network.bandwidth_kbps, network.loss_permille);
+    fflush(stdout);
+    while (1) pause();
+    return 0;
+}
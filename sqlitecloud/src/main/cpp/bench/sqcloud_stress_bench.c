@@ -0,0 +1,613 @@
+//
+//  sqcloud_stress_bench.c
+//
+//  Concurrency scaling of the client: a ramp of N connections x M commands in flight x K pub/sub channels, run with each
+//  of the concurrency models of the library, with the throughput, the median and 99th percentile latency, and the threads,
+//  file descriptors and resident memory of the process, in total and per connection. Models:
+//  blocking: SQCloudPool of N connections shared by N x M threads, each one running SQCloudExec in a loop (the latency
+//  includes the wait in SQCloudPoolCheckout)
+//  async: a single thread keeping M commands in flight on each of N connections with SQCloudExecAsync and SQCloudEvents
+//  pubsub: N connections each listening to one of K channels on a pub/sub socket of its own, all read by the reactor thread,
+//  and a publisher connection sending NOTIFY round robin on the channels; the latency is the one of a delivery
+//  pubsub_shared: the same with the connections grouped on the pub/sub socket of a host (SQCloudSetPubSubHost and the
+//  channel filter), so that a reactor thread reads N / 17 sockets
+//
+//  Each point of the ramp runs in a forked process of its own, so that its threads, descriptors and memory are measured
+//  against the ones of a process that never connected. The endpoint is the loopback mock server of sqcloud_mockserver.h,
+//  run in a process of its own, or a real one given with -h (where the channels bench0, bench1... must exist). Each point
+//  is printed on stdout as a JSON object on a line of its own:
+//  {"model":"async","connections":100,"inflight":4,"channels":0,"ops_per_s":81234,"p50_us":4210,"p99_us":9120,...}
+//
+//  Built by the sqcloud_stress_bench target of CMakeLists.txt with -DSQLITECLOUD_BENCHMARKS=ON (an Android executable to
+//  run with adb shell), or on the host with:
+//  cc -O2 -I.. sqcloud_stress_bench.c sqcloud_mockserver.c ../sqcloud.c ../lz4.c -ltls -lpthread -lm -o sqcloud_stress_bench
+//
+//  usage: sqcloud_stress_bench [-m model,...] [-c connections,...] [-i inflight,...] [-k channels] [-t seconds] [-n notify_per_s]
+//                              [-r rtt_ms] [-w server_ms] [-h host [-p port] [-u user -s password] [-d database]]
+//  -m: models of the ramp (blocking,async,pubsub,pubsub_shared by default)
+//  -c, -i: connections and commands in flight per connection of the ramp (1,10,50,100 and 1,4 by default)
+//  -k: pub/sub channels (4 by default)
+//  -t: seconds each point is measured (2 by default)
+//  -n: notifications sent per second by the publisher (1000 by default, 0 sends them back to back)
+//  -r, -w: round trip time and server time of a command of the mock server (none by default)
+//  -h, -p, -u, -s, -d: the real endpoint and its credentials
+//
+
+#define _GNU_SOURCE                         // memmem
+#include "sqcloud_mockserver.h"
+#include "sqcloud.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STRESS_MAX_RAMP                     16
+#define STRESS_MAX_SAMPLES                  (1 << 22)   // latencies kept for the percentiles, the ones beyond are only counted
+#define STRESS_THREAD_STACK                 (256 * 1024)
+#define STRESS_SHARED_GROUP                 17          // a host and the 16 guests of its pub/sub socket (PUBSUB_SHARED_MAX)
+#define STRESS_COMMAND                      "SELECT 1;"
+
+typedef enum {
+    MODEL_BLOCKING,
+    MODEL_ASYNC,
+    MODEL_PUBSUB,
+    MODEL_PUBSUB_SHARED,
+    MODELS
+} stress_model;
+
+static const char *stress_model_names[MODELS] = {"blocking", "async", "pubsub", "pubsub_shared"};
+
+typedef struct {
+    int64_t         threads;
+    int64_t         fds;
+    int64_t         rss_kb;
+} stress_process;
+
+typedef struct {
+    stress_model    model;
+    int             connections;
+    int             inflight;
+    int             channels;
+} stress_point;
+
+typedef struct {
+    uint64_t        ops;                    // commands completed (or notifications delivered) while measuring
+    uint64_t        errors;
+    double          seconds;
+    int64_t         p50_us;
+    int64_t         p99_us;
+    stress_process  idle;                   // the process before it connects
+    stress_process  loaded;                 // the process while measuring
+} stress_result;
+
+static struct {
+    const char      *host;
+    int             port;
+    SQCloudConfig   config;
+    bool            mock;
+} endpoint;
+
+static int stress_seconds = 2;
+static int stress_notify_rate = 1000;
+
+// latencies of the point being measured, recorded by every thread
+static struct {
+    int64_t         *samples;
+    uint32_t        count;                  // atomic, may exceed STRESS_MAX_SAMPLES
+    uint64_t        errors;                 // atomic
+    bool            measuring;              // atomic
+    bool            stopping;               // atomic
+} stress_latency;
+
+// MARK: - UTILS -
+
+static int64_t stress_now_us (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + (int64_t)ts.tv_nsec / 1000;
+}
+
+static bool stress_measuring (void) {
+    return __atomic_load_n(&stress_latency.measuring, __ATOMIC_ACQUIRE);
+}
+
+static bool stress_stopping (void) {
+    return __atomic_load_n(&stress_latency.stopping, __ATOMIC_ACQUIRE);
+}
+
+static void stress_record (int64_t us, bool failed) {
+    if (!stress_measuring()) return;
+    if (failed) {
+        __atomic_fetch_add(&stress_latency.errors, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    uint32_t index = __atomic_fetch_add(&stress_latency.count, 1, __ATOMIC_RELAXED);
+    if (index < STRESS_MAX_SAMPLES) stress_latency.samples[index] = us;
+}
+
+static int stress_compare (const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static stress_process stress_process_stats (void) {
+    // /proc of Linux and Android: the Threads and VmRSS lines of status and the entries of fd
+    stress_process stats = {0, 0, 0};
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f) {
+        char line[256];
+        while (fgets(line, sizeof(line), f)) {
+            if (strncmp(line, "Threads:", 8) == 0) stats.threads = atoll(line + 8);
+            else if (strncmp(line, "VmRSS:", 6) == 0) stats.rss_kb = atoll(line + 6);
+        }
+        fclose(f);
+    }
+
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir))) {
+            if (entry->d_name[0] != '.') ++stats.fds;
+        }
+        closedir(dir);
+        --stats.fds;                        // the descriptor of dir itself
+    }
+    return stats;
+}
+
+static SQCloudConnection *stress_connect (void) {
+    SQCloudConnection *connection = SQCloudConnect(endpoint.host, endpoint.port, &endpoint.config);
+    if (connection && !SQCloudIsError(connection)) return connection;
+    fprintf(stderr, "Connect failed: %s.\n", (connection) ? SQCloudErrorMsg(connection) : "out of memory");
+    if (connection) SQCloudDisconnect(connection);
+    return NULL;
+}
+
+static void stress_measure (stress_result *result) {
+    // the load is already running: the latencies of stress_seconds are kept, then the load is stopped
+    __atomic_store_n(&stress_latency.count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stress_latency.errors, 0, __ATOMIC_RELAXED);
+    int64_t start = stress_now_us();
+    __atomic_store_n(&stress_latency.measuring, true, __ATOMIC_RELEASE);
+
+    usleep((useconds_t)stress_seconds * 500000);
+    result->loaded = stress_process_stats();
+    usleep((useconds_t)stress_seconds * 500000);
+
+    __atomic_store_n(&stress_latency.measuring, false, __ATOMIC_RELEASE);
+    result->seconds = (double)(stress_now_us() - start) / 1000000.0;
+    __atomic_store_n(&stress_latency.stopping, true, __ATOMIC_RELEASE);
+}
+
+static void *stress_measure_thread (void *arg) {
+    stress_measure((stress_result *)arg);
+    return NULL;
+}
+
+static void stress_collect (stress_result *result) {
+    // once the load has stopped, the percentiles of the kept latencies
+    uint32_t count = __atomic_load_n(&stress_latency.count, __ATOMIC_RELAXED);
+    uint32_t n = (count < STRESS_MAX_SAMPLES) ? count : STRESS_MAX_SAMPLES;
+    qsort(stress_latency.samples, n, sizeof(int64_t), stress_compare);
+    result->ops = count;
+    result->errors = __atomic_load_n(&stress_latency.errors, __ATOMIC_RELAXED);
+    result->p50_us = (n) ? stress_latency.samples[n / 2] : -1;
+    result->p99_us = (n) ? stress_latency.samples[(uint32_t)((uint64_t)n * 99 / 100)] : -1;
+}
+
+// MARK: - BLOCKING -
+
+static void *stress_blocking_thread (void *arg) {
+    SQCloudPool *pool = (SQCloudPool *)arg;
+    while (!stress_stopping()) {
+        int64_t start = stress_now_us();
+        SQCloudConnection *connection = SQCloudPoolCheckout(pool, 30);
+        if (!connection) {stress_record(0, true); continue;}
+        SQCloudResult *result = SQCloudExec(connection, STRESS_COMMAND);
+        bool failed = (SQCloudResultType(result) == RESULT_ERROR || SQCloudIsError(connection));
+        SQCloudResultFree(result);
+        SQCloudPoolCheckin(pool, connection);
+        stress_record(stress_now_us() - start, failed);
+    }
+    return NULL;
+}
+
+static bool stress_blocking (const stress_point *point, stress_result *result) {
+    SQCloudPool *pool = SQCloudPoolCreate(endpoint.host, endpoint.port, &endpoint.config, (uint32_t)point->connections);
+    if (!pool) return false;
+
+    // the pool connects lazily, so every connection is opened before the load starts
+    SQCloudConnection **connections = calloc((size_t)point->connections, sizeof(SQCloudConnection *));
+    bool connected = true;
+    for (int i=0; i<point->connections; ++i) {
+        connections[i] = SQCloudPoolCheckout(pool, 30);
+        connected &= (connections[i] && !SQCloudIsError(connections[i]));
+    }
+    for (int i=0; i<point->connections; ++i) {
+        if (connections[i]) SQCloudPoolCheckin(pool, connections[i]);
+    }
+    free(connections);
+    if (!connected) {SQCloudPoolFree(pool); return false;}
+
+    int nthreads = point->connections * point->inflight;
+    pthread_t *threads = calloc((size_t)nthreads, sizeof(pthread_t));
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, STRESS_THREAD_STACK);
+    int started = 0;
+    while (started < nthreads && pthread_create(&threads[started], &attr, stress_blocking_thread, pool) == 0) ++started;
+    pthread_attr_destroy(&attr);
+
+    if (started == nthreads) stress_measure(result);
+    __atomic_store_n(&stress_latency.stopping, true, __ATOMIC_RELEASE);
+    for (int i=0; i<started; ++i) pthread_join(threads[i], NULL);
+    free(threads);
+    SQCloudPoolFree(pool);
+    stress_collect(result);
+    return (started == nthreads);
+}
+
+// MARK: - ASYNC -
+
+typedef struct stress_async_connection stress_async_connection;
+
+typedef struct {
+    stress_async_connection *owner;
+    int64_t                 start;
+} stress_async_request;
+
+struct stress_async_connection {
+    SQCloudConnection       *connection;
+    stress_async_request    *requests;
+    stress_async_request    **completed;    // the requests to send again once SQCloudProcessEvents returns
+    int                     ncompleted;
+    int                     pending;
+    bool                    runnable;       // completed requests to send with no event to wait for
+};
+
+static void stress_async_callback (SQCloudConnection *connection, SQCloudResult *result, void *data) {
+    stress_async_request *request = (stress_async_request *)data;
+    stress_async_connection *owner = request->owner;
+    stress_record(stress_now_us() - request->start, (!result || SQCloudResultType(result) == RESULT_ERROR));
+    SQCloudResultFree(result);
+    owner->completed[owner->ncompleted++] = request;
+    --owner->pending;
+}
+
+static bool stress_async_send (stress_async_connection *c, stress_async_request *request) {
+    request->start = stress_now_us();
+    if (!SQCloudExecAsync(c->connection, STRESS_COMMAND, stress_async_callback, request)) return false;
+    ++c->pending;
+    return true;
+}
+
+static void stress_async_process (SQCloudEvents *events, stress_async_connection *c) {
+    // the callbacks run within SQCloudProcessEvents and their requests are sent again after it; a reply can already be
+    // there once they are written, then the connection is runnable and takes its turn after the other ready ones
+    for (int i=0; i<c->ncompleted && !stress_stopping(); ++i) stress_async_send(c, c->completed[i]);
+    c->ncompleted = 0;
+    
+    int mask = SQCloudProcessEvents(c->connection);
+    if (mask < 0) stress_record(0, true);
+    c->runnable = (mask >= 0 && c->ncompleted && !stress_stopping());
+    SQCloudEventsWatch(events, c->connection, mask);
+}
+
+static void *stress_async_thread (void *arg) {
+    // the single thread of the model: it waits for the ready connections, the main thread only measures
+    const stress_point *point = ((void **)arg)[0];
+    stress_async_connection *connections = ((void **)arg)[1];
+    SQCloudEvents *events = SQCloudEventsCreate();
+    if (!events) return NULL;
+
+    for (int i=0; i<point->connections; ++i) {
+        stress_async_connection *c = &connections[i];
+        for (int j=0; j<point->inflight; ++j) stress_async_send(c, &c->requests[j]);
+        stress_async_process(events, c);
+    }
+
+    SQCloudConnection *ready[256];
+    bool draining = false;
+    int64_t deadline = 0;
+    while (1) {
+        if (stress_stopping() && !draining) {
+            draining = true;
+            deadline = stress_now_us() + 30 * 1000000LL;
+        }
+        if (draining) {
+            int pending = 0;
+            for (int i=0; i<point->connections; ++i) pending += connections[i].pending;
+            if (pending == 0 || stress_now_us() > deadline) break;
+        }
+
+        bool runnable = false;
+        for (int i=0; i<point->connections && !runnable; ++i) runnable = connections[i].runnable;
+        int n = SQCloudEventsWait(events, ready, 256, (runnable) ? 0 : 100);
+        for (int i=0; i<n; ++i) {
+            // the ready connection is found by address, the set holds a few hundreds of them at most
+            int index = 0;
+            while (index < point->connections && connections[index].connection != ready[i]) ++index;
+            if (index < point->connections) stress_async_process(events, &connections[index]);
+        }
+        for (int i=0; i<point->connections && runnable; ++i) {
+            if (connections[i].runnable) stress_async_process(events, &connections[i]);
+        }
+    }
+
+    SQCloudEventsFree(events);
+    return NULL;
+}
+
+static bool stress_async (const stress_point *point, stress_result *result) {
+    stress_async_connection *connections = calloc((size_t)point->connections, sizeof(stress_async_connection));
+    bool connected = true;
+    for (int i=0; i<point->connections && connected; ++i) {
+        stress_async_connection *c = &connections[i];
+        c->connection = stress_connect();
+        c->requests = calloc((size_t)point->inflight, sizeof(stress_async_request));
+        c->completed = calloc((size_t)point->inflight, sizeof(stress_async_request *));
+        for (int j=0; j<point->inflight; ++j) c->requests[j].owner = c;
+        connected = (c->connection != NULL);
+    }
+
+    pthread_t thread;
+    void *args[2] = {(void *)point, connections};
+    bool started = (connected && pthread_create(&thread, NULL, stress_async_thread, args) == 0);
+    if (started) {
+        stress_measure(result);
+        pthread_join(thread, NULL);
+        stress_collect(result);
+    }
+
+    for (int i=0; i<point->connections; ++i) {
+        if (connections[i].connection) SQCloudDisconnect(connections[i].connection);
+        free(connections[i].requests);
+        free(connections[i].completed);
+    }
+    free(connections);
+    return started;
+}
+
+// MARK: - PUB/SUB -
+
+static void stress_pubsub_callback (SQCloudConnection *connection, SQCloudResult *result, void *data) {
+    // the payload is the time the notification was sent
+    static const char key[] = "\"payload\":\"";
+    if (!result) {stress_record(0, true); return;}
+    const char *json = SQCloudResultBuffer(result);
+    uint32_t len = SQCloudResultLen(result);
+    const char *payload = (json) ? memmem(json, len, key, sizeof(key) - 1) : NULL;
+    if (payload) stress_record(stress_now_us() - atoll(payload + sizeof(key) - 1), false);
+    else stress_record(0, true);
+    SQCloudResultFree(result);
+}
+
+static bool stress_listen (SQCloudConnection *connection, int channel) {
+    char command[64];
+    snprintf(command, sizeof(command), "LISTEN bench%d;", channel);
+    SQCloudResult *result = SQCloudExec(connection, command);
+    bool listening = SQCloudResultIsOK(result);
+    if (!listening) fprintf(stderr, "LISTEN failed: %s.\n", SQCloudErrorMsg(connection));
+    SQCloudResultFree(result);
+    return listening;
+}
+
+static bool stress_pubsub (const stress_point *point, bool shared, stress_result *result) {
+    // connection i listens to channel i % K, with shared the first connection of each group is the host of the others
+    SQCloudConnection **connections = calloc((size_t)point->connections, sizeof(SQCloudConnection *));
+    SQCloudConnection *publisher = stress_connect();
+    bool ready = (publisher != NULL);
+    for (int i=0; i<point->connections && ready; ++i) {
+        connections[i] = stress_connect();
+        if (!connections[i]) {ready = false; break;}
+        SQCloudSetPubSubCallback(connections[i], stress_pubsub_callback, NULL);
+
+        // a host listens to the channels of its guests too, its filter keeps only its own one
+        int channel = i % point->channels;
+        char name[32];
+        snprintf(name, sizeof(name), "bench%d", channel);
+        SQCloudConnection *host = (shared) ? connections[i - i % STRESS_SHARED_GROUP] : connections[i];
+        if (shared) {
+            SQCloudSetPubSubFilter(connections[i], true);
+            ready = SQCloudPubSubFilterAdd(connections[i], name);
+        }
+        if (ready && host != connections[i]) ready = SQCloudSetPubSubHost(connections[i], host);
+        if (ready) ready = stress_listen(host, channel);
+    }
+
+    // the publisher runs on this thread and the measure on another one
+    pthread_t thread;
+    bool started = (ready && pthread_create(&thread, NULL, stress_measure_thread, result) == 0);
+    int64_t interval = (stress_notify_rate > 0) ? 1000000 / stress_notify_rate : 0;
+    int64_t next = stress_now_us();
+    for (uint64_t sent = 0; started && !stress_stopping(); ++sent) {
+        char command[96];
+        snprintf(command, sizeof(command), "NOTIFY bench%d '%lld';", (int)(sent % (uint64_t)point->channels), (long long)stress_now_us());
+        SQCloudResult *reply = SQCloudExec(publisher, command);
+        if (!SQCloudResultIsOK(reply)) stress_record(0, true);
+        SQCloudResultFree(reply);
+
+        next += interval;
+        int64_t wait = next - stress_now_us();
+        if (wait > 0) usleep((useconds_t)wait);
+    }
+    if (started) pthread_join(thread, NULL);
+
+    // the guests are disconnected before their hosts
+    for (int i=point->connections-1; i>=0; --i) {
+        if (connections[i]) SQCloudDisconnect(connections[i]);
+    }
+    if (publisher) SQCloudDisconnect(publisher);
+    free(connections);
+    if (started) stress_collect(result);
+    return started;
+}
+
+// MARK: - RAMP -
+
+static void stress_print (const stress_point *point, const stress_result *result) {
+    int n = point->connections;
+    printf("{\"endpoint\":\"%s\",\"model\":\"%s\",\"connections\":%d,\"inflight\":%d,\"channels\":%d,\"seconds\":%.2f,"
+           "\"ops\":%llu,\"ops_per_s\":%.0f,\"errors\":%llu,\"p50_us\":%lld,\"p99_us\":%lld,"
+           "\"threads\":%lld,\"fds\":%lld,\"rss_kb\":%lld,"
+           "\"threads_per_connection\":%.2f,\"fds_per_connection\":%.2f,\"rss_kb_per_connection\":%.1f}\n",
+           (endpoint.mock) ? "mock" : endpoint.host, stress_model_names[point->model], n, point->inflight, point->channels,
+           result->seconds, (unsigned long long)result->ops, (result->seconds > 0) ? (double)result->ops / result->seconds : 0,
+           (unsigned long long)result->errors, (long long)result->p50_us, (long long)result->p99_us,
+           (long long)result->loaded.threads, (long long)result->loaded.fds, (long long)result->loaded.rss_kb,
+           (double)(result->loaded.threads - result->idle.threads) / n, (double)(result->loaded.fds - result->idle.fds) / n,
+           (double)(result->loaded.rss_kb - result->idle.rss_kb) / n);
+    fflush(stdout);
+}
+
+static void stress_run (const stress_point *point) {
+    // each point runs in a child process, which has never connected when its idle state is measured
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return;
+    if (pid > 0) {
+        waitpid(pid, NULL, 0);
+        return;
+    }
+
+    stress_latency.samples = malloc(STRESS_MAX_SAMPLES * sizeof(int64_t));
+    stress_result result;
+    memset(&result, 0, sizeof(result));
+    result.idle = stress_process_stats();
+
+    bool done = false;
+    switch (point->model) {
+        case MODEL_BLOCKING: done = stress_blocking(point, &result); break;
+        case MODEL_ASYNC: done = stress_async(point, &result); break;
+        case MODEL_PUBSUB: done = stress_pubsub(point, false, &result); break;
+        case MODEL_PUBSUB_SHARED: done = stress_pubsub(point, true, &result); break;
+        default: break;
+    }
+    if (done) stress_print(point, &result);
+    else fprintf(stderr, "The %s point of %d connections could not run.\n", stress_model_names[point->model], point->connections);
+    _exit(done ? 0 : 1);
+}
+
+static int stress_list (const char *text, int *values, int max) {
+    int n = 0;
+    for (const char *s = text; s && *s && n < max; s = strchr(s, ',')) {
+        if (*s == ',') ++s;
+        values[n++] = atoi(s);
+    }
+    return n;
+}
+
+static pid_t stress_mock_start (const mock_network *network, int server_ms, int *port) {
+    // the server runs in a process of its own until it is killed, its port comes back through a pipe
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        char script[64];
+        if (server_ms > 0) snprintf(script, sizeof(script), "SELECT 1 => DELAY %d INT 1\n", server_ms);
+        else snprintf(script, sizeof(script), "SELECT 1 => INT 1\n");
+        mock_server *server = mock_server_start(0, script, network);
+        int value = (server) ? mock_server_port(server) : -1;
+        if (!server) fprintf(stderr, "%s\n", mock_server_error());
+        ssize_t written = write(fds[1], &value, sizeof(value));
+        close(fds[1]);
+        if (!server || written != (ssize_t)sizeof(value)) _exit(1);
+        for (;;) pause();
+    }
+    close(fds[1]);
+    if (pid > 0 && (read(fds[0], port, sizeof(*port)) != (ssize_t)sizeof(*port) || *port < 0)) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        pid = -1;
+    }
+    close(fds[0]);
+    return pid;
+}
+
+int main (int argc, char *argv[]) {
+    int connections[STRESS_MAX_RAMP] = {1, 10, 50, 100};
+    int nconnections = 4;
+    int inflights[STRESS_MAX_RAMP] = {1, 4};
+    int ninflights = 2;
+    bool models[MODELS] = {true, true, true, true};
+    int channels = 4;
+    int server_ms = 0;
+    mock_network network = {0};
+
+    endpoint.mock = true;
+    endpoint.host = "127.0.0.1";
+    endpoint.port = 8860;
+    endpoint.config.timeout = 30;
+    endpoint.config.username = "bench";
+    endpoint.config.password = "bench";
+
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            const char *list = argv[++i];
+            for (int m=0; m<MODELS; ++m) {
+                const char *found = strstr(list, stress_model_names[m]);
+                size_t len = strlen(stress_model_names[m]);
+                models[m] = (found && (found[len] == 0 || found[len] == ','));
+            }
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) nconnections = stress_list(argv[++i], connections, STRESS_MAX_RAMP);
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) ninflights = stress_list(argv[++i], inflights, STRESS_MAX_RAMP);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) channels = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) stress_seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) stress_notify_rate = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) network.rtt_ms = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) server_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {endpoint.host = argv[++i]; endpoint.mock = false;}
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) endpoint.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) endpoint.config.username = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) endpoint.config.password = argv[++i];
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) endpoint.config.database = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [-m model,...] [-c connections,...] [-i inflight,...] [-k channels] [-t seconds] [-n notify_per_s] "
+                    "[-r rtt_ms] [-w server_ms] [-h host [-p port] [-u user -s password] [-d database]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (channels < 1) channels = 1;
+    if (stress_seconds < 1) stress_seconds = 1;
+
+    // each connection takes a descriptor, its pub/sub socket another one
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    pid_t server = -1;
+    if (endpoint.mock) {
+        server = stress_mock_start(&network, server_ms, &endpoint.port);
+        if (server < 0) return 1;
+        endpoint.config.insecure = true;
+    }
+
+    for (int m=0; m<MODELS; ++m) {
+        if (!models[m]) continue;
+        bool pubsub = (m == MODEL_PUBSUB || m == MODEL_PUBSUB_SHARED);
+        for (int c=0; c<nconnections; ++c) {
+            for (int f=0; f<((pubsub) ? 1 : ninflights); ++f) {
+                stress_point point = {(stress_model)m, connections[c], (pubsub) ? 0 : inflights[f], (pubsub) ? channels : 0};
+                if (point.connections < 1 || (!pubsub && point.inflight < 1)) continue;
+                stress_run(&point);
+            }
+        }
+    }
+
+    if (server > 0) {
+        kill(server, SIGKILL);
+        waitpid(server, NULL, 0);
+    }
+    return 0;
+}
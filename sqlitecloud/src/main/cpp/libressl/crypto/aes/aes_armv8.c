@@ -0,0 +1,146 @@
+/*
+ * AES with the ARMv8 Cryptography Extensions.
+ *
+ * The functions of this file execute AESE/AESMC/AESD/AESIMC and must only be
+ * called once OPENSSL_cpuid_setup has found ARMV8_AES in OPENSSL_armcap_P.
+ * The key schedules are the ones of AES_set_{en,de}crypt_key, with the round
+ * keys stored as bytes instead of host order words, so that an AES_KEY set up
+ * here can only be used with the aes_v8 functions.
+ */
+
+#include <arm_neon.h>
+#include <endian.h>
+#include <string.h>
+
+#include <openssl/aes.h>
+
+int aes_v8_set_encrypt_key(const unsigned char *userKey, int bits,
+    AES_KEY *key);
+int aes_v8_set_decrypt_key(const unsigned char *userKey, int bits,
+    AES_KEY *key);
+void aes_v8_encrypt(const unsigned char *in, unsigned char *out,
+    const AES_KEY *key);
+void aes_v8_decrypt(const unsigned char *in, unsigned char *out,
+    const AES_KEY *key);
+void aes_v8_ctr32_encrypt_blocks(const unsigned char *in, unsigned char *out,
+    size_t blocks, const AES_KEY *key, const unsigned char ivec[16]);
+
+static void
+aes_v8_swap_key(AES_KEY *key)
+{
+	uint8_t *rk = (uint8_t *)key->rd_key;
+	int i;
+
+	for (i = 0; i <= key->rounds; i++, rk += 16)
+		vst1q_u8(rk, vrev32q_u8(vld1q_u8(rk)));
+}
+
+int
+aes_v8_set_encrypt_key(const unsigned char *userKey, int bits, AES_KEY *key)
+{
+	int ret;
+
+	if ((ret = AES_set_encrypt_key(userKey, bits, key)) == 0)
+		aes_v8_swap_key(key);
+	return ret;
+}
+
+int
+aes_v8_set_decrypt_key(const unsigned char *userKey, int bits, AES_KEY *key)
+{
+	int ret;
+
+	if ((ret = AES_set_decrypt_key(userKey, bits, key)) == 0)
+		aes_v8_swap_key(key);
+	return ret;
+}
+
+static inline uint8x16_t
+aes_v8_encrypt_block(uint8x16_t block, const uint8_t *rk, int rounds)
+{
+	int i;
+
+	for (i = 0; i < rounds - 1; i++, rk += 16)
+		block = vaesmcq_u8(vaeseq_u8(block, vld1q_u8(rk)));
+	block = vaeseq_u8(block, vld1q_u8(rk));
+	return veorq_u8(block, vld1q_u8(rk + 16));
+}
+
+void
+aes_v8_encrypt(const unsigned char *in, unsigned char *out,
+    const AES_KEY *key)
+{
+	vst1q_u8(out, aes_v8_encrypt_block(vld1q_u8(in),
+	    (const uint8_t *)key->rd_key, key->rounds));
+}
+
+void
+aes_v8_decrypt(const unsigned char *in, unsigned char *out,
+    const AES_KEY *key)
+{
+	const uint8_t *rk = (const uint8_t *)key->rd_key;
+	uint8x16_t block = vld1q_u8(in);
+	int i;
+
+	for (i = 0; i < key->rounds - 1; i++, rk += 16)
+		block = vaesimcq_u8(vaesdq_u8(block, vld1q_u8(rk)));
+	block = vaesdq_u8(block, vld1q_u8(rk));
+	vst1q_u8(out, veorq_u8(block, vld1q_u8(rk + 16)));
+}
+
+/*
+ * Encrypts four counter blocks at a time so that the AES pipelines of the
+ * core are kept busy. Only the last 32 bits of the counter are incremented.
+ */
+void
+aes_v8_ctr32_encrypt_blocks(const unsigned char *in, unsigned char *out,
+    size_t blocks, const AES_KEY *key, const unsigned char ivec[16])
+{
+	const uint8_t *rk;
+	uint8x16_t iv, k, b0, b1, b2, b3;
+	uint32_t ctr;
+	int i;
+
+	iv = vld1q_u8(ivec);
+	memcpy(&ctr, ivec + 12, sizeof(ctr));
+	ctr = be32toh(ctr);
+
+#define AES_V8_COUNTER(n) \
+	vreinterpretq_u8_u32(vsetq_lane_u32(htobe32(ctr + (n)), \
+	    vreinterpretq_u32_u8(iv), 3))
+
+	for (; blocks >= 4; blocks -= 4, in += 64, out += 64, ctr += 4) {
+		b0 = AES_V8_COUNTER(0);
+		b1 = AES_V8_COUNTER(1);
+		b2 = AES_V8_COUNTER(2);
+		b3 = AES_V8_COUNTER(3);
+
+		rk = (const uint8_t *)key->rd_key;
+		for (i = 0; i < key->rounds - 1; i++, rk += 16) {
+			k = vld1q_u8(rk);
+			b0 = vaesmcq_u8(vaeseq_u8(b0, k));
+			b1 = vaesmcq_u8(vaeseq_u8(b1, k));
+			b2 = vaesmcq_u8(vaeseq_u8(b2, k));
+			b3 = vaesmcq_u8(vaeseq_u8(b3, k));
+		}
+		k = vld1q_u8(rk);
+		b0 = vaeseq_u8(b0, k);
+		b1 = vaeseq_u8(b1, k);
+		b2 = vaeseq_u8(b2, k);
+		b3 = vaeseq_u8(b3, k);
+		k = vld1q_u8(rk + 16);
+
+		vst1q_u8(out, veorq_u8(vld1q_u8(in), veorq_u8(b0, k)));
+		vst1q_u8(out + 16, veorq_u8(vld1q_u8(in + 16), veorq_u8(b1, k)));
+		vst1q_u8(out + 32, veorq_u8(vld1q_u8(in + 32), veorq_u8(b2, k)));
+		vst1q_u8(out + 48, veorq_u8(vld1q_u8(in + 48), veorq_u8(b3, k)));
+	}
+
+	for (; blocks > 0; blocks--, in += 16, out += 16, ctr++) {
+		b0 = aes_v8_encrypt_block(AES_V8_COUNTER(0),
+		    (const uint8_t *)key->rd_key, key->rounds);
+		vst1q_u8(out, veorq_u8(vld1q_u8(in), b0));
+	}
+
+#undef AES_V8_COUNTER
+}
@@ -8,9 +8,20 @@
 
 #include "arm_arch.h"
 
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+
+/* Linux arm64 AT_HWCAP bits */
+#define ARM64_HWCAP_ASIMD	(1 << 1)
+#define ARM64_HWCAP_AES		(1 << 3)
+#define ARM64_HWCAP_PMULL	(1 << 4)
+#define ARM64_HWCAP_SHA1	(1 << 5)
+#define ARM64_HWCAP_SHA2	(1 << 6)
+#endif
+
 unsigned int OPENSSL_armcap_P;
 
-#if __ARM_ARCH__ >= 7
+#if __ARM_ARCH__ >= 7 && !defined(__aarch64__)
 static sigset_t all_masked;
 
 static sigjmp_buf ill_jmp;
@@ -31,7 +42,9 @@ void _armv8_pmull_probe(void);
 void
 OPENSSL_cpuid_setup(void)
 {
-#if __ARM_ARCH__ >= 7
+#if defined(__aarch64__) && defined(__linux__)
+	unsigned long		hwcap;
+#elif __ARM_ARCH__ >= 7
 	struct sigaction	ill_oact, ill_act;
 	sigset_t		oset;
 #endif
@@ -43,7 +56,20 @@ OPENSSL_cpuid_setup(void)
 
 	OPENSSL_armcap_P = 0;
 
-#if __ARM_ARCH__ >= 7
+#if defined(__aarch64__) && defined(__linux__)
+	/* the kernel reports the instructions, there is nothing to probe */
+	hwcap = getauxval(AT_HWCAP);
+	if (hwcap & ARM64_HWCAP_ASIMD)
+		OPENSSL_armcap_P |= ARMV7_NEON;
+	if (hwcap & ARM64_HWCAP_AES)
+		OPENSSL_armcap_P |= ARMV8_AES;
+	if (hwcap & ARM64_HWCAP_PMULL)
+		OPENSSL_armcap_P |= ARMV8_PMULL;
+	if (hwcap & ARM64_HWCAP_SHA1)
+		OPENSSL_armcap_P |= ARMV8_SHA1;
+	if (hwcap & ARM64_HWCAP_SHA2)
+		OPENSSL_armcap_P |= ARMV8_SHA256;
+#elif __ARM_ARCH__ >= 7
 	sigfillset(&all_masked);
 	sigdelset(&all_masked, SIGILL);
 	sigdelset(&all_masked, SIGTRAP);
@@ -115,6 +115,81 @@ chacha_ivsetup(chacha_ctx *x, const u8 *iv, const u8 *counter)
 	x->input[15] = U8TO32_LITTLE(iv + 4);
 }
 
+#ifdef CHACHA_NEON
+#include <arm_neon.h>
+
+#include "arm_arch.h"
+
+#define ROTATE_NEON(v,c) (vsriq_n_u32(vshlq_n_u32((v), (c)), (v), 32 - (c)))
+
+#define QUARTERROUND_NEON(a,b,c,d) \
+  a = vaddq_u32(a,b); d = ROTATE_NEON(veorq_u32(d,a),16); \
+  c = vaddq_u32(c,d); b = ROTATE_NEON(veorq_u32(b,c),12); \
+  a = vaddq_u32(a,b); d = ROTATE_NEON(veorq_u32(d,a), 8); \
+  c = vaddq_u32(c,d); b = ROTATE_NEON(veorq_u32(b,c), 7);
+
+/*
+ * Encrypts four blocks at a time, lane i of each vector holding a word of the
+ * i-th block. Stops before the low counter word would wrap within four blocks
+ * and returns the number of blocks encrypted.
+ */
+static inline u32
+chacha_encrypt_blocks_neon(chacha_ctx *x, const u8 *m, u8 *c, u32 blocks)
+{
+	static const u32 lanes[4] = { 0, 1, 2, 3 };
+	uint32x4_t v[16], j[16], t0, t1, t2, t3;
+	uint64x2_t w0, w1, w2, w3, b[4];
+	u32 done, i, k;
+
+	for (i = 0; i < 16; i++)
+		j[i] = vdupq_n_u32(x->input[i]);
+
+	for (done = 0; blocks - done >= 4 && x->input[12] <= 0xfffffffc;
+	    done += 4, m += 256, c += 256) {
+		j[12] = vaddq_u32(vdupq_n_u32(x->input[12]), vld1q_u32(lanes));
+		j[13] = vdupq_n_u32(x->input[13]);
+		for (i = 0; i < 16; i++)
+			v[i] = j[i];
+		for (i = 20; i > 0; i -= 2) {
+			QUARTERROUND_NEON(v[0], v[4], v[8], v[12])
+			QUARTERROUND_NEON(v[1], v[5], v[9], v[13])
+			QUARTERROUND_NEON(v[2], v[6], v[10], v[14])
+			QUARTERROUND_NEON(v[3], v[7], v[11], v[15])
+			QUARTERROUND_NEON(v[0], v[5], v[10], v[15])
+			QUARTERROUND_NEON(v[1], v[6], v[11], v[12])
+			QUARTERROUND_NEON(v[2], v[7], v[8], v[13])
+			QUARTERROUND_NEON(v[3], v[4], v[9], v[14])
+		}
+
+		/* transpose four words of the four blocks at a time */
+		for (i = 0; i < 16; i += 4) {
+			t0 = vaddq_u32(v[i], j[i]);
+			t1 = vaddq_u32(v[i + 1], j[i + 1]);
+			t2 = vaddq_u32(v[i + 2], j[i + 2]);
+			t3 = vaddq_u32(v[i + 3], j[i + 3]);
+			w0 = vreinterpretq_u64_u32(vzip1q_u32(t0, t1));
+			w1 = vreinterpretq_u64_u32(vzip2q_u32(t0, t1));
+			w2 = vreinterpretq_u64_u32(vzip1q_u32(t2, t3));
+			w3 = vreinterpretq_u64_u32(vzip2q_u32(t2, t3));
+			b[0] = vzip1q_u64(w0, w2);
+			b[1] = vzip2q_u64(w0, w2);
+			b[2] = vzip1q_u64(w1, w3);
+			b[3] = vzip2q_u64(w1, w3);
+			for (k = 0; k < 4; k++)
+				vst1q_u8(c + 64 * k + 4 * i, veorq_u8(
+				    vld1q_u8(m + 64 * k + 4 * i),
+				    vreinterpretq_u8_u64(b[k])));
+		}
+
+		x->input[12] += 4;
+		if (!x->input[12])
+			x->input[13] = PLUSONE(x->input[13]);
+	}
+
+	return done;
+}
+#endif
+
 static inline void
 chacha_encrypt_bytes(chacha_ctx *x, const u8 *m, u8 *c, u32 bytes)
 {
@@ -129,6 +204,19 @@ chacha_encrypt_bytes(chacha_ctx *x, const u8 *m, u8 *c, u32 bytes)
 	if (!bytes)
 		return;
 
+#ifdef CHACHA_NEON
+	if (bytes >= 256 && (OPENSSL_armcap_P & ARMV7_NEON)) {
+		i = chacha_encrypt_blocks_neon(x, m, c, bytes / 64) * 64;
+		m += i;
+		c += i;
+		bytes -= i;
+		if (!bytes) {
+			x->unused = 0;
+			return;
+		}
+	}
+#endif
+
 	j0 = x->input[0];
 	j1 = x->input[1];
 	j2 = x->input[2];
@@ -132,6 +132,24 @@ void bsaes_xts_decrypt(const unsigned char *inp, unsigned char *out,
     size_t len, const AES_KEY *key1, const AES_KEY *key2,
     const unsigned char iv[16]);
 #endif
+#ifdef AES_ARMV8
+#include "arm_arch.h"
+
+#define AES_ARMV8_CAPABLE	(OPENSSL_armcap_P & ARMV8_AES)
+
+int aes_v8_set_encrypt_key(const unsigned char *userKey, int bits,
+    AES_KEY *key);
+int aes_v8_set_decrypt_key(const unsigned char *userKey, int bits,
+    AES_KEY *key);
+
+void aes_v8_encrypt(const unsigned char *in, unsigned char *out,
+    const AES_KEY *key);
+void aes_v8_decrypt(const unsigned char *in, unsigned char *out,
+    const AES_KEY *key);
+
+void aes_v8_ctr32_encrypt_blocks(const unsigned char *in, unsigned char *out,
+    size_t blocks, const AES_KEY *key, const unsigned char ivec[16]);
+#endif
 #ifdef AES_CTR_ASM
 void AES_ctr32_encrypt(const unsigned char *in, unsigned char *out,
     size_t blocks, const AES_KEY *key,
@@ -365,6 +383,14 @@ aes_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
 	mode = ctx->cipher->flags & EVP_CIPH_MODE;
 	if ((mode == EVP_CIPH_ECB_MODE || mode == EVP_CIPH_CBC_MODE) &&
 	    !enc)
+#ifdef AES_ARMV8_CAPABLE
+		if (AES_ARMV8_CAPABLE) {
+			ret = aes_v8_set_decrypt_key(key, ctx->key_len * 8,
+			    &dat->ks);
+			dat->block = (block128_f)aes_v8_decrypt;
+			dat->stream.cbc = NULL;
+		} else
+#endif
 #ifdef BSAES_CAPABLE
 		if (BSAES_CAPABLE && mode == EVP_CIPH_CBC_MODE) {
 			ret = AES_set_decrypt_key(key, ctx->key_len * 8,
@@ -389,6 +415,15 @@ aes_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
 			dat->stream.cbc = mode == EVP_CIPH_CBC_MODE ?
 			    (cbc128_f)AES_cbc_encrypt : NULL;
 		} else
+#ifdef AES_ARMV8_CAPABLE
+		if (AES_ARMV8_CAPABLE) {
+			ret = aes_v8_set_encrypt_key(key, ctx->key_len * 8,
+			    &dat->ks);
+			dat->block = (block128_f)aes_v8_encrypt;
+			dat->stream.ctr = mode == EVP_CIPH_CTR_MODE ?
+			    (ctr128_f)aes_v8_ctr32_encrypt_blocks : NULL;
+		} else
+#endif
 #ifdef BSAES_CAPABLE
 		if (BSAES_CAPABLE && mode == EVP_CIPH_CTR_MODE) {
 			ret = AES_set_encrypt_key(key, ctx->key_len * 8,
@@ -1432,6 +1467,13 @@ static ctr128_f
 aes_gcm_set_key(AES_KEY *aes_key, GCM128_CONTEXT *gcm_ctx,
     const unsigned char *key, size_t key_len)
 {
+#ifdef AES_ARMV8_CAPABLE
+	if (AES_ARMV8_CAPABLE) {
+		aes_v8_set_encrypt_key(key, key_len * 8, aes_key);
+		CRYPTO_gcm128_init(gcm_ctx, aes_key, (block128_f)aes_v8_encrypt);
+		return (ctr128_f)aes_v8_ctr32_encrypt_blocks;
+	} else
+#endif
 #ifdef BSAES_CAPABLE
 	if (BSAES_CAPABLE) {
 		AES_set_encrypt_key(key, key_len * 8, aes_key);
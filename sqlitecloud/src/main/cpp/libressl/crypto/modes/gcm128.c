@@ -632,6 +632,17 @@ void gcm_ghash_neon(u64 Xi[2], const u128 Htable[16], const u8 *inp,
 # endif
 #endif
 
+#if	TABLE_BITS==4 && defined(GHASH_ARMV8) && defined(__aarch64__) && \
+	!defined(OPENSSL_SMALL_FOOTPRINT)
+# include "arm_arch.h"
+# define GHASH_ASM_ARMV8
+# define GCM_FUNCREF_4BIT
+void gcm_init_v8(u128 Htable[16], const u64 H[2]);
+void gcm_gmult_v8(u64 Xi[2], const u128 Htable[16]);
+void gcm_ghash_v8(u64 Xi[2], const u128 Htable[16], const u8 *inp,
+    size_t len);
+#endif
+
 #ifdef GCM_FUNCREF_4BIT
 # undef  GCM_MUL
 # define GCM_MUL(ctx,Xi)	(*gcm_gmult_p)(ctx->Xi.u,ctx->Htable)
@@ -685,6 +696,16 @@ CRYPTO_gcm128_init(GCM128_CONTEXT *ctx, void *key, block128_f block)
 	ctx->gmult = gcm_gmult_4bit;
 	ctx->ghash = gcm_ghash_4bit;
 #  endif
+# elif	defined(GHASH_ASM_ARMV8)
+	if (OPENSSL_armcap_P & ARMV8_PMULL) {
+		gcm_init_v8(ctx->Htable, ctx->H.u);
+		ctx->gmult = gcm_gmult_v8;
+		ctx->ghash = gcm_ghash_v8;
+	} else {
+		gcm_init_4bit(ctx->Htable, ctx->H.u);
+		ctx->gmult = gcm_gmult_4bit;
+		ctx->ghash = gcm_ghash_4bit;
+	}
 # elif	defined(GHASH_ASM_ARM)
 	if (OPENSSL_armcap_P & ARMV7_NEON) {
 		ctx->gmult = gcm_gmult_neon;
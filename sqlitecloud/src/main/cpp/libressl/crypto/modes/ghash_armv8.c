@@ -0,0 +1,128 @@
+/*
+ * GHASH with the ARMv8 PMULL instruction.
+ *
+ * The functions of this file must only be called once OPENSSL_cpuid_setup has
+ * found ARMV8_PMULL in OPENSSL_armcap_P. The field elements are the GCM blocks
+ * read as big endian 128 bit integers, which reverses the order of their bits:
+ * the carry-less product of two of them is one bit short and is shifted before
+ * being reduced, as in the Intel carry-less multiplication white paper.
+ *
+ * Htable holds H, H^2, H^3 and H^4 in host byte order, so that gcm_ghash_v8
+ * multiplies four blocks before reducing their sum once.
+ */
+
+#include <arm_neon.h>
+#include <endian.h>
+
+#include "crypto_internal.h"
+#include "modes_local.h"
+
+void gcm_init_v8(u128 Htable[16], const u64 H[2]);
+void gcm_gmult_v8(u64 Xi[2], const u128 Htable[16]);
+void gcm_ghash_v8(u64 Xi[2], const u128 Htable[16], const u8 *inp,
+    size_t len);
+
+/* The 256 bit carry-less product of two field elements, before reduction. */
+typedef struct {
+	uint64x2_t lo, mid, hi;
+} ghash_v8_product;
+
+static inline uint64x2_t
+ghash_v8_clmul(u64 a, u64 b)
+{
+	return vreinterpretq_u64_p128(vmull_p64((poly64_t)a, (poly64_t)b));
+}
+
+static inline void
+ghash_v8_mul(ghash_v8_product *z, u64 ahi, u64 alo, const u128 *b)
+{
+	z->lo = veorq_u64(z->lo, ghash_v8_clmul(alo, b->lo));
+	z->hi = veorq_u64(z->hi, ghash_v8_clmul(ahi, b->hi));
+	z->mid = veorq_u64(z->mid, ghash_v8_clmul(alo, b->hi));
+	z->mid = veorq_u64(z->mid, ghash_v8_clmul(ahi, b->lo));
+}
+
+static inline u128
+ghash_v8_reduce(const ghash_v8_product *z)
+{
+	u64 x0, x1, x2, x3, d;
+	u128 r;
+
+	x0 = vgetq_lane_u64(z->lo, 0);
+	x1 = vgetq_lane_u64(z->lo, 1) ^ vgetq_lane_u64(z->mid, 0);
+	x2 = vgetq_lane_u64(z->hi, 0) ^ vgetq_lane_u64(z->mid, 1);
+	x3 = vgetq_lane_u64(z->hi, 1);
+
+	x3 = x3 << 1 | x2 >> 63;
+	x2 = x2 << 1 | x1 >> 63;
+	x1 = x1 << 1 | x0 >> 63;
+	x0 <<= 1;
+
+	/* modulo x^128 + x^7 + x^2 + x + 1 */
+	d = x1 ^ x0 << 63 ^ x0 << 62 ^ x0 << 57;
+	r.hi = x3 ^ d ^ d >> 1 ^ d >> 2 ^ d >> 7;
+	r.lo = x2 ^ x0 ^ (x0 >> 1 | d << 63) ^ (x0 >> 2 | d << 62) ^
+	    (x0 >> 7 | d << 57);
+	return r;
+}
+
+static inline u128
+ghash_v8_mul_reduce(u64 ahi, u64 alo, const u128 *b)
+{
+	ghash_v8_product z = { vdupq_n_u64(0), vdupq_n_u64(0), vdupq_n_u64(0) };
+
+	ghash_v8_mul(&z, ahi, alo, b);
+	return ghash_v8_reduce(&z);
+}
+
+void
+gcm_init_v8(u128 Htable[16], const u64 H[2])
+{
+	int i;
+
+	Htable[0].hi = H[0];
+	Htable[0].lo = H[1];
+	for (i = 1; i < 4; i++)
+		Htable[i] = ghash_v8_mul_reduce(Htable[i - 1].hi,
+		    Htable[i - 1].lo, &Htable[0]);
+}
+
+void
+gcm_gmult_v8(u64 Xi[2], const u128 Htable[16])
+{
+	u128 r;
+
+	r = ghash_v8_mul_reduce(be64toh(Xi[0]), be64toh(Xi[1]), &Htable[0]);
+	Xi[0] = htobe64(r.hi);
+	Xi[1] = htobe64(r.lo);
+}
+
+void
+gcm_ghash_v8(u64 Xi[2], const u128 Htable[16], const u8 *inp, size_t len)
+{
+	ghash_v8_product z;
+	u128 x;
+	int i;
+
+	x.hi = be64toh(Xi[0]);
+	x.lo = be64toh(Xi[1]);
+
+	/* Xi = (Xi + C0)H^4 + C1H^3 + C2H^2 + C3H */
+	for (; len >= 64; len -= 64, inp += 64) {
+		z.lo = z.mid = z.hi = vdupq_n_u64(0);
+		ghash_v8_mul(&z, x.hi ^ crypto_load_be64toh(inp),
+		    x.lo ^ crypto_load_be64toh(inp + 8), &Htable[3]);
+		for (i = 1; i < 4; i++)
+			ghash_v8_mul(&z, crypto_load_be64toh(inp + 16 * i),
+			    crypto_load_be64toh(inp + 16 * i + 8),
+			    &Htable[3 - i]);
+		x = ghash_v8_reduce(&z);
+	}
+
+	for (; len >= 16; len -= 16, inp += 16)
+		x = ghash_v8_mul_reduce(x.hi ^ crypto_load_be64toh(inp),
+		    x.lo ^ crypto_load_be64toh(inp + 8), &Htable[0]);
+
+	Xi[0] = htobe64(x.hi);
+	Xi[1] = htobe64(x.lo);
+}
@@ -72,6 +72,12 @@ CTASSERT(sizeof(SHA_LONG) == sizeof(uint32_t));
 void sha256_block_data_order(SHA256_CTX *ctx, const void *_in, size_t num);
 #endif
 
+#ifdef SHA256_ARMV8
+#include "arm_arch.h"
+
+void sha256_block_armv8(SHA256_CTX *ctx, const void *_in, size_t num);
+#endif
+
 #ifndef SHA256_ASM
 static const SHA_LONG K256[64] = {
 	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
@@ -158,7 +164,7 @@ sha256_round(SHA_LONG *a, SHA_LONG *b, SHA_LONG *c, SHA_LONG *d,
 }
 
 static void
-sha256_block_data_order(SHA256_CTX *ctx, const void *_in, size_t num)
+sha256_block_generic(SHA256_CTX *ctx, const void *_in, size_t num)
 {
 	const uint8_t *in = _in;
 	const SHA_LONG *in32;
@@ -279,6 +285,18 @@ sha256_block_data_order(SHA256_CTX *ctx, const void *_in, size_t num)
 		ctx->h[7] += h;
 	}
 }
+
+static void
+sha256_block_data_order(SHA256_CTX *ctx, const void *_in, size_t num)
+{
+#ifdef SHA256_ARMV8
+	if (OPENSSL_armcap_P & ARMV8_SHA256) {
+		sha256_block_armv8(ctx, _in, num);
+		return;
+	}
+#endif
+	sha256_block_generic(ctx, _in, num);
+}
 #endif /* SHA256_ASM */
 
 int
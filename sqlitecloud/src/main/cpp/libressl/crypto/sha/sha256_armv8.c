@@ -0,0 +1,69 @@
+/*
+ * SHA-256 with the ARMv8 Cryptography Extensions.
+ *
+ * sha256_block_armv8 executes SHA256H/SHA256H2/SHA256SU0/SHA256SU1 and must
+ * only be called once OPENSSL_cpuid_setup has found ARMV8_SHA256 in
+ * OPENSSL_armcap_P.
+ */
+
+#include <arm_neon.h>
+
+#include <openssl/sha.h>
+
+void sha256_block_armv8(SHA256_CTX *ctx, const void *_in, size_t num);
+
+static const uint32_t K256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+void
+sha256_block_armv8(SHA256_CTX *ctx, const void *_in, size_t num)
+{
+	const uint8_t *in = _in;
+	uint32x4_t abcd, efgh, abcd0, efgh0, abcd1, wk, w[4];
+	int i;
+
+	abcd = vld1q_u32(&ctx->h[0]);
+	efgh = vld1q_u32(&ctx->h[4]);
+
+	while (num--) {
+		abcd0 = abcd;
+		efgh0 = efgh;
+
+		for (i = 0; i < 4; i++, in += 16)
+			w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(in)));
+
+		/* four rounds at a time, w holds the next 16 message words */
+		for (i = 0; i < 16; i++) {
+			wk = vaddq_u32(w[i & 3], vld1q_u32(&K256[i * 4]));
+			if (i < 12)
+				w[i & 3] = vsha256su1q_u32(
+				    vsha256su0q_u32(w[i & 3], w[(i + 1) & 3]),
+				    w[(i + 2) & 3], w[(i + 3) & 3]);
+			abcd1 = abcd;
+			abcd = vsha256hq_u32(abcd, efgh, wk);
+			efgh = vsha256h2q_u32(efgh, abcd1, wk);
+		}
+
+		abcd = vaddq_u32(abcd, abcd0);
+		efgh = vaddq_u32(efgh, efgh0);
+	}
+
+	vst1q_u32(&ctx->h[0], abcd);
+	vst1q_u32(&ctx->h[4], efgh);
+}
@@ -25,6 +25,14 @@ extern "C" {
 #define SQCLOUD_IPv6                1
 #define SQCLOUD_IPANY               2
 
+#define SQCLOUD_EVENT_READ          1           // SQCloudProcessEvents must be called again once the socket is readable
+#define SQCLOUD_EVENT_WRITE         2           // SQCloudProcessEvents must be called again once the socket is writable
+
+#define SQCLOUD_PUBSUB_LATENCY_BUCKETS  32      // counters of a latency histogram, counter n counts the latencies below 2^n microseconds (see SQCloudPubSubLatency)
+#define SQCLOUD_STATS_ERRCODES      12          // client side error codes counted by SQCloudConnectionStats (from INTERNAL_ERRCODE_GENERIC)
+#define SQCLOUD_LATENCY_BUCKETS     256         // counters of a command latency histogram, bucket n counts the latencies below SQCloudLatencyBucketLimit(n)
+#define SQCLOUD_DICTIONARY_NULL     UINT32_MAX  // code of a NULL cell in SQCloudRowsetColumnDictionary
+
 #ifndef BITCHECK
 #define BITCHECK(byte,nbit)         ((byte) &   (1<<(nbit)))
 #endif
@@ -49,12 +57,14 @@ extern "C" {
 #define CMD_ARRAY                   '='
 #define CMD_ASYNC_STRING            '>'
 #define CMD_ASYNC_ARRAY             '<'
+#define CMD_CODEC                   '~'
 
 typedef enum {
     ROWSET_TYPE_BASIC               = 1,
     ROWSET_TYPE_METADATA_v1         = 2,
     ROWSET_TYPE_HEADER_ONLY         = 3,
-    ROWSET_TYPE_DATA_ONLY           = 4
+    ROWSET_TYPE_DATA_ONLY           = 4,
+    ROWSET_TYPE_BINARY              = 0x10      // combined with the types above: values use the binary encoding
 } SQCLOUD_ROWSET_TYPE;
 
 // MARK: -
@@ -64,10 +74,31 @@ typedef struct SQCloudConnection            SQCloudConnection;
 typedef struct SQCloudResult                SQCloudResult;
 typedef struct SQCloudVM                    SQCloudVM;
 typedef struct SQCloudBlob                  SQCloudBlob;
+typedef struct SQCloudBlobStream            SQCloudBlobStream;
 typedef struct SQCloudBackup                SQCloudBackup;
+typedef struct SQCloudPipeline              SQCloudPipeline;
+typedef struct SQCloudRowsetCursor          SQCloudRowsetCursor;
+typedef struct SQCloudRowsetIndex           SQCloudRowsetIndex;
+typedef struct SQCloudPool                  SQCloudPool;
+typedef struct SQCloudEvents                SQCloudEvents;
+typedef struct SQCloudTraceEvent            SQCloudTraceEvent;
 typedef void (*SQCloudPubSubCB)             (SQCloudConnection *connection, SQCloudResult *result, void *data);
+typedef void (*SQCloudPubSubReadyCB)        (SQCloudConnection *connection, void *data);
+typedef void (*SQCloudExecCB)               (SQCloudConnection *connection, SQCloudResult *result, void *data);
+typedef int (*SQCloudProgressCB)            (void *data, int64_t ntot, int64_t nprogress);
+typedef int (*SQCloudBlobRowsCB)            (void *data, uint32_t row, int errcode, int64_t ntot, int64_t nprogress);
 typedef int (*config_cb)                    (char *buffer, int len, void *data);
 typedef int64_t (*SQCloudBackupOnDataCB)    (SQCloudBackup *backup, const char *data, uint32_t len, int page_size, int page_counter);
+typedef void (*SQCloudTraceCB)              (SQCloudConnection *connection, const SQCloudTraceEvent *event, void *data);
+
+// allocator hooks to be passed to SQCloudSetAllocator (NULL function pointers fall back to libc)
+typedef struct {
+    void            *(*xMalloc)(size_t size);
+    void            *(*xRealloc)(void *ptr, size_t size);
+    void            (*xFree)(void *ptr);
+    size_t          (*xSize)(void *ptr);    // usable size of an allocated block (required to track a custom allocator)
+    bool            track;                  // keep a running counter of the live bytes (see SQCloudMemoryStats)
+} SQCloudAllocator;
 
 // configuration struct to be passed to the connect function
 typedef struct SQCloudConfigStruct {
@@ -87,13 +118,29 @@ typedef struct SQCloudConfigStruct {
     int             max_data;               // value to tell the server to not send columns with more than max_data bytes
     int             max_rows;               // value to control rowset chunks based on the number of rows
     int             max_rowset;             // value to control the maximum allowed size for a rowset
+    bool            columnar_rowset;        // flag to decode rowset values into typed per-column arrays at parse time
+    bool            lean_rowset;            // flag to skip the display-only column widths at parse time (computed on first use)
+    bool            compact_index;          // flag to index chunked rowsets with 32-bit offsets inside their chunks instead of pointers
+    bool            binary_rowset;          // flag to ask the server for rowsets with binary numbers (ROWSET_TYPE_BINARY)
+    bool            defer_config;           // flag to send the AUTH/USE DATABASE/SET CLIENT KEY batch with the first command instead of waiting for its reply in SQCloudConnect
+    int             keepalive_idle;         // seconds of idle before the first TCP keepalive probe (0 keeps the system default)
+    int             keepalive_interval;     // seconds between two keepalive probes (0 keeps the system default)
+    int             keepalive_count;        // unanswered keepalive probes after which the socket is dropped (0 keeps the system default)
+    int             user_timeout;           // milliseconds written data may stay unacknowledged before the socket is dropped (TCP_USER_TIMEOUT, 0 keeps the system default)
+    int             ping_timeout;           // milliseconds budget of the PING that SQCloudPoolCheckout sends to a connection idle for a while (0 means no ping)
     #ifndef SQLITECLOUD_DISABLE_TLS
-    const char      *tls_root_certificate;
+    const char      *tls_root_certificate;  // path to a PEM file, or the PEM data itself (a string starting with "-----BEGIN")
     const char      *tls_certificate;
     const char      *tls_certificate_key;
+    const char      *tls_ciphers;           // libtls cipher list, NULL prefers AES-GCM with hardware AES and ChaCha20-Poly1305 without
     bool            insecure;               // flag to disable TLS
     bool            no_verify_certificate;  // flag to accept invalid TLS certificates
     #endif
+    SQCloudTraceCB  trace;                  // optional callback receiving the begin and end events of the spans of the connection (see SQCloudTraceEvent)
+    void            *trace_data;            // trace callback data parameter
+    bool            trace_hash_only;        // flag to pass the trace callback the hash of the commands instead of their text
+    const char      *wire_record;           // optional path of a file receiving the plaintext traffic of the main socket
+    const char      *wire_replay;           // optional path of a file recorded with wire_record, replayed instead of connecting to hostname
     config_cb       callback;               // reserved callback for internal usage
     void            *data;                  // reserved callback data parameter
 } SQCloudConfig;
@@ -122,9 +169,155 @@ typedef enum {
     VALUE_FLOAT = 2,
     VALUE_TEXT = 3,
     VALUE_BLOB = 4,
-    VALUE_NULL = 5
+    VALUE_NULL = 5,
+    VALUE_BLOB_FILE = 6                     // SQCloudExecArrayTyped parameter only: a BLOB streamed from a file
 } SQCLOUD_VALUE_TYPE;
 
+// comparison applied by SQCloudRowsetColumnFilter between a numeric cell and a constant
+typedef enum {
+    COMPARE_EQ = 1,
+    COMPARE_NE = 2,
+    COMPARE_LT = 3,
+    COMPARE_LE = 4,
+    COMPARE_GT = 5,
+    COMPARE_GE = 6
+} SQCLOUD_COMPARE_OP;
+
+// text format written by SQCloudRowsetExport and read by SQCloudImportFile
+typedef enum {
+    EXPORT_CSV = 1,                         // RFC 4180 with a header line, BLOB cells in base64
+    EXPORT_NDJSON = 2                       // a JSON object per line, BLOB cells as base64 strings
+} SQCLOUD_EXPORT_FORMAT;
+
+// typed array item used by SQCloudExecArrayTyped (len is used only by VALUE_TEXT, VALUE_BLOB and VALUE_BLOB_FILE)
+// a VALUE_BLOB_FILE item sends the len bytes of the file descriptor fd from foffset, read while they are written
+typedef struct {
+    SQCLOUD_VALUE_TYPE  type;
+    uint32_t            len;
+    union {
+        int64_t         i64;
+        double          f64;
+        const char      *value;
+        struct {
+            int         fd;
+            int64_t     foffset;
+        };
+    };
+} SQCloudValue;
+
+// row written by SQCloudBlobWriteRows: len bytes of buffer, or of the file descriptor fd from foffset if buffer is NULL
+typedef struct {
+    int64_t             rowid;
+    const void          *buffer;
+    int                 fd;
+    int64_t             foffset;
+    uint32_t            len;
+} SQCloudBlobWriteRow;
+
+// client keys of a single command, used by SQCloudExecEx (a field left to 0 keeps the setting of the connection)
+typedef struct {
+    int8_t              no_blob;            // 1 replaces BLOB cells with NULL, -1 sends them
+    int8_t              zero_text;          // 1 NUL terminates TEXT cells, -1 does not
+    int8_t              non_linearizable;   // 1 allows a read from a node that may be behind, -1 asks for a linearizable one
+    int8_t              compression;        // 1 compresses the reply, -1 does not
+    int32_t             max_data;           // > 0 caps the size of a cell, -1 removes the cap
+    int32_t             max_rows;           // > 0 splits the rowset in chunks of max_rows rows, -1 sends it whole
+    int32_t             max_rowset;         // > 0 caps the size of the rowset, -1 removes the cap
+} SQCloudCommandOptions;
+
+// group built by SQCloudRowsetGroupBy (the key is the value of the key column at row)
+typedef struct {
+    uint32_t            row;                // first row of the group
+    uint32_t            count;              // rows in the group
+    uint32_t            numbers;            // INTEGER/FLOAT cells of the aggregated column in the group
+    double              sum;                // sum, min and max of those cells (0.0 if numbers is 0)
+    double              min;
+    double              max;
+} SQCloudRowsetGroup;
+
+// latency breakdown of the command that returned a result (see SQCloudResultTimings)
+// timestamps are monotonic microseconds, comparable only with each other, and 0 if the stage did not happen
+typedef struct {
+    int64_t             write_start;        // command about to be written
+    int64_t             write_end;          // command fully written
+    int64_t             first_byte;         // first byte of the reply received
+    int64_t             last_byte;          // last byte of the reply received (of its last chunk for a chunked rowset)
+    int64_t             decompress;         // microseconds spent decompressing the reply
+    int64_t             parse;              // microseconds spent parsing the reply
+} SQCloudTimings;
+
+// heap allocations made by the thread of a blocking command for its reply (see SQCloudSetAllocationCounters)
+// the calls are the ones of the allocator, the bytes are the ones requested whether they came from the heap or from a pool
+typedef struct {
+    uint32_t            allocs;             // mem_alloc and mem_zeroalloc calls
+    uint32_t            reallocs;           // mem_realloc calls
+    uint32_t            frees;              // mem_free calls
+    uint32_t            pool_reuses;        // reply buffers and results served by the memory pool without an allocation
+    uint64_t            bytes;              // bytes requested by the allocs and reallocs
+    uint64_t            receive;            // buffers receiving the reply
+    uint64_t            decompress;         // buffers holding an uncompressed reply
+    uint64_t            rowset;             // results and the arenas of their index arrays
+    uint64_t            chunk_growth;       // index arrays of a chunked rowset grown to hold a new chunk
+    uint64_t            metadata;           // column names, widths and metadata arrays
+} SQCloudAllocations;
+
+// span reported to the trace callback (see SQCloudConfig.trace and SQCloudSetTrace)
+typedef enum {
+    TRACE_CONNECT = 0,                      // SQCloudConnect and SQCloudReconnect, TLS handshakes and configuration commands included
+    TRACE_TLS_HANDSHAKE = 1,                // a TLS handshake of the main or of the pub/sub socket
+    TRACE_EXEC = 2,                         // a blocking command, with or without bound values, from its write to its reply
+    TRACE_CHUNK = 3,                        // the parse of a chunk of a rowset reply (its read with chunk workers, which parse it)
+    TRACE_PUBSUB = 4,                       // the pub/sub callback of a message, called on the reactor thread
+    TRACE_TLS_SETUP = 5,                    // tls_init and the TLS configuration of a connect, root certificates loaded on a cache miss
+    TRACE_RESOLVE = 6,                      // the addresses of the host of a socket, from the DNS cache or from getaddrinfo
+    TRACE_TCP_CONNECT = 7,                  // the TCP connection of a socket, every address raced (RFC 8305) until one completes
+    TRACE_CONNECT_CONFIG = 8                // the configuration commands sent by SQCloudConnect once connected, with their round trip
+} SQCLOUD_TRACE_SPAN;
+
+// begin or end event of a span, spans of the same thread are nested (a TRACE_CHUNK within a TRACE_EXEC)
+struct SQCloudTraceEvent {
+    SQCLOUD_TRACE_SPAN  span;
+    bool                end;                // false for the begin event
+    const char          *command;           // TRACE_EXEC: the command (not NULL terminated), TRACE_PUBSUB: the channel; NULL with trace_hash_only
+    uint32_t            command_len;
+    uint64_t            command_hash;       // FNV-1a of the command or channel, 0 without one
+    uint64_t            bytes_out;          // end event: bytes written on the main socket by the span
+    uint64_t            bytes_in;           // end event: bytes read on the main socket by the span, the chunk or the message
+    SQCLOUD_RESULT_TYPE result_type;        // end event: type of the reply (RESULT_OK for a TRACE_CONNECT or TRACE_TLS_HANDSHAKE that succeeded)
+    int                 errcode;            // end event: error code of the connection, 0 on success
+    int64_t             time_us;            // monotonic microseconds, comparable with SQCloudTimings
+};
+
+// counters of the main socket of a connection since it was created, reconnects included (see SQCloudConnectionStats)
+// with TLS the bytes are the plaintext ones and the calls are tls_read/tls_write calls
+typedef struct {
+    uint64_t            commands;           // commands sent (each command of a pipeline or of a deferred batch counts)
+    uint64_t            replies;            // replies received (a chunked rowset counts once, error replies are in errors_server)
+    uint64_t            round_trips;        // reads that followed a write, each one waits for the server at least once
+    uint64_t            bytes_out;          // bytes written
+    uint64_t            bytes_out_raw;      // bytes that would have been written without upload compression
+    uint64_t            bytes_in;           // bytes read
+    uint64_t            bytes_in_raw;       // bytes that would have been read without reply compression
+    uint64_t            read_calls;         // read calls
+    uint64_t            write_calls;        // write, writev and sendfile calls
+    uint64_t            tls_records_out;    // TLS records written (computed from the size of each write)
+    uint64_t            chunked_rowsets;    // rowsets received in chunks
+    uint64_t            chunks;             // chunks of those rowsets
+    uint64_t            reconnects;         // successful SQCloudReconnect calls
+    uint64_t            errors_server;      // error replies
+    uint64_t            link_rate;          // smoothed bytes per second of the large replies, decompression excluded (0 before the first one)
+    SQCloudAllocations  allocations;        // totals of the commands run with SQCloudSetAllocationCounters
+    uint64_t            errors[SQCLOUD_STATS_ERRCODES];    // client side errors, errors[n] counts INTERNAL_ERRCODE_GENERIC + n
+} SQCloudStats;
+
+// error of a command run by SQCloudExecShared, which leaves the error of the connection alone
+typedef struct {
+    int                 code;               // 0 on success
+    int                 extcode;
+    int                 offset;             // -1 if the error does not refer to a token of the command
+    char                msg[1024];          // as large as the message of the connection, never truncated
+} SQCloudCommandError;
+
 typedef enum {
     ARRAY_TYPE_SQLITE_EXEC = 10,            // used in SQLITE_MODE only when a write statement is executed (instead of the OK reply)
     ARRAY_TYPE_DB_STATUS = 11,
@@ -155,6 +348,9 @@ typedef enum {
     INTERNAL_ERRCODE_FORMAT = 100006,
     INTERNAL_ERRCODE_INDEX = 100007,
     INTERNAL_ERRCODE_SOCKCLOSED = 100008,
+    INTERNAL_ERRCODE_CANCELLED = 100009,
+    INTERNAL_ERRCODE_DEADLINE = 100010,
+    INTERNAL_ERRCODE_DEADLINE_RESET = 100011,
 } SQCLOUD_INTERNAL_ERRCODE;
 
 // from SQLiteCloud
@@ -168,17 +364,145 @@ typedef enum {
     CLOUD_ERRCODE_RAFT = 10006
 } SQCLOUD_CLOUD_ERRCODE;
 
+// network hint of SQCloudSetCompressionPolicy
+typedef enum {
+    NETWORK_CLASS_UNKNOWN = 0,
+    NETWORK_CLASS_WIFI = 1,
+    NETWORK_CLASS_CELLULAR = 2,
+    NETWORK_CLASS_METERED = 3
+} SQCLOUD_NETWORK_CLASS;
+
+// LZ4 decompression speed of the device (see SQCloudCompressionCalibrate and SQCloudSetCompressionCalibration)
+typedef struct {
+    uint64_t            decompress_rate;    // uncompressed bytes per second produced by LZ4_decompress_safe on large rowset buffers
+    uint32_t            decompress_call_ns; // fixed cost of a decompression call, whatever its size
+    uint32_t            ratio;              // permille compressed/uncompressed ratio of the synthetic rowsets (for reference only)
+} SQCloudCompressionCalibration;
+
+// type of a node of a JSON result (see SQCloudJSONType)
+typedef enum {
+    JSON_TYPE_INVALID = 0,
+    JSON_TYPE_NULL = 1,
+    JSON_TYPE_FALSE = 2,
+    JSON_TYPE_TRUE = 3,
+    JSON_TYPE_NUMBER = 4,
+    JSON_TYPE_STRING = 5,
+    JSON_TYPE_ARRAY = 6,
+    JSON_TYPE_OBJECT = 7
+} SQCLOUD_JSON_TYPE;
+
+// overflow policy of SQCloudSetPubSubQueue
+typedef enum {
+    PUBSUB_OVERFLOW_DROP_OLDEST = 0,
+    PUBSUB_OVERFLOW_COALESCE = 1,           // drops the oldest message of the same channel
+    PUBSUB_OVERFLOW_SUSPEND = 2             // stops reading the socket until the queue is drained
+} SQCLOUD_PUBSUB_OVERFLOW;
+
+// stage of the delivery of a pub/sub message measured by SQCloudSetPubSubLatency
+typedef enum {
+    PUBSUB_LATENCY_NETWORK = 0,             // publish timestamp of the message to socket readable (messages with a "timestamp" only)
+    PUBSUB_LATENCY_PARSE = 1,               // socket readable to message parsed
+    PUBSUB_LATENCY_DISPATCH = 2,            // message parsed to callback entry, or to SQCloudPubSubDrain with a queue
+    PUBSUB_LATENCY_CALLBACK = 3,            // callback entry to callback exit
+    PUBSUB_LATENCY_STAGES = 4
+} SQCLOUD_PUBSUB_LATENCY_STAGE;
+
+// class of the operations timed by SQCloudSetLatencyHistograms
+typedef enum {
+    LATENCY_QUERY = 0,                      // SQCloudExec, SQCloudExecBuffer, SQCloudExecWithDeadline and SQCloudExecEx
+    LATENCY_EXEC_ARRAY = 1,                 // SQCloudExecArray, SQCloudExecArrayTyped, SQCloudExecArrayTypedWithDeadline and SQCloudExecEx
+    LATENCY_VM_STEP = 2,                    // SQCloudVMStep and SQCloudVMFetchRows (a step within a rowset already received included)
+    LATENCY_BLOB = 3,                       // SQCloudBlobRead, SQCloudBlobWrite and SQCloudBlobWritev
+    LATENCY_DOWNLOAD_STEP = 4,              // wait for the reply of each DOWNLOAD STEP of a database download
+    LATENCY_BACKUP_STEP = 5,                // SQCloudBackupStep, without its on_data callback
+    LATENCY_PUBSUB = 6,                     // pub/sub socket readable to callback exit (messages queued or routed to a guest excluded)
+    LATENCY_CLASSES = 7
+} SQCLOUD_LATENCY_CLASS;
+
+// how much memory SQCloudMemoryPressure releases, from the mildest (see ComponentCallbacks2.onTrimMemory on Android)
+typedef enum {
+    MEMORY_PRESSURE_NONE = 0,               // the pressure is over: the spill budget lowered by the other levels is restored
+    MEMORY_PRESSURE_LOW = 1,                // the buffers and results kept only to speed up the next replies are released
+    MEMORY_PRESSURE_MODERATE = 2,           // the least recently used half of the statement cache too, and rowsets spill from 4 MB
+    MEMORY_PRESSURE_CRITICAL = 3            // the whole statement cache too, and rowsets spill from 1 MB
+} SQCLOUD_MEMORY_PRESSURE;
+
+// SIMD extensions the vectorized kernels are selected from (see SQCloudCPUFeatures)
+typedef enum {
+    CPU_FEATURE_SSE2 = 1 << 0,
+    CPU_FEATURE_SSE42 = 1 << 1,
+    CPU_FEATURE_AVX2 = 1 << 2,
+    CPU_FEATURE_AVX512 = 1 << 3,            // AVX-512 F and BW
+    CPU_FEATURE_NEON = 1 << 4,
+    CPU_FEATURE_DOTPROD = 1 << 5,
+    CPU_FEATURE_SVE = 1 << 6,
+    CPU_FEATURE_CRC32 = 1 << 7              // ARMv8 CRC32 (SSE4.2 has the x86 ones)
+} SQCLOUD_CPU_FEATURE;
+
 // MARK: - General -
+bool SQCloudInitialize (const char *hostname, int port, SQCloudConfig *config);
+bool SQCloudSetResolvedAddresses (const char *hostname, int port, const char *addresses);
+void SQCloudSetNetwork (uint64_t handle);
 SQCloudConnection *SQCloudConnect (const char *hostname, int port, SQCloudConfig *config);
 SQCloudConnection *SQCloudConnectWithString (const char *s, SQCloudConfig *config);
 SQCloudResult *SQCloudExec (SQCloudConnection *connection, const char *command);
+SQCloudResult *SQCloudExecBuffer (SQCloudConnection *connection, const char *command, size_t len);
 SQCloudConfig *SQCloudGetConfig (SQCloudConnection *connection);
+void SQCloudTLSStats (SQCloudConnection *connection, uint32_t *handshakes, uint32_t *resumed);
+const char *SQCloudTLSCipher (SQCloudConnection *connection);
+void SQCloudSetMemoryPool (SQCloudConnection *connection, size_t maxbytes);
+void SQCloudSetAdaptiveChunks (SQCloudConnection *connection, uint32_t min_rows, uint32_t max_rows, uint32_t target_ms);
+void SQCloudSetChunkWorkers (SQCloudConnection *connection, uint32_t nworkers);
+void SQCloudSetParallelParse (SQCloudConnection *connection, uint32_t min_bytes);
+void SQCloudSetCompressionPolicy (SQCloudConnection *connection, uint32_t min_size, SQCLOUD_NETWORK_CLASS network);
+bool SQCloudCompressionCalibrate (SQCloudCompressionCalibration *calibration, uint32_t budget_ms);
+void SQCloudSetCompressionCalibration (const SQCloudCompressionCalibration *calibration);
+bool SQCloudCompressionThreshold (SQCloudConnection *connection, uint32_t *min_size, uint32_t *ratio_max);
+void SQCloudSetUploadCompression (SQCloudConnection *connection, uint32_t min_size);
+void SQCloudSetDownloadWindow (SQCloudConnection *connection, uint32_t window);
+void SQCloudSetDownloadCompression (SQCloudConnection *connection, bool enabled);
+uint32_t SQCloudTransferChecksum (SQCloudConnection *connection);
+bool SQCloudSetCompressionDictionary (SQCloudConnection *connection, const void *data, uint32_t len);
+void SQCloudPrimeCompressionDictionary (SQCloudConnection *connection, uint32_t size);
+void SQCloudSetHeaderCache (SQCloudConnection *connection, uint32_t nslots);
+void SQCloudSetSpill (SQCloudConnection *connection, const char *dir, uint64_t budget);
+void SQCloudCompressionStats (SQCloudConnection *connection, uint64_t *compressed, int64_t *saved);
+void SQCloudConnectionStats (SQCloudConnection *connection, SQCloudStats *stats);
+void SQCloudSetLatencyHistograms (SQCloudConnection *connection, bool enabled);
+void SQCloudSetAllocationCounters (SQCloudConnection *connection, bool enabled);
+void SQCloudSetTrace (SQCloudConnection *connection, SQCloudTraceCB trace, void *data, bool hash_only);
+bool SQCloudLatencySnapshot (SQCloudConnection *connection, SQCLOUD_LATENCY_CLASS cls, uint32_t *counters);
+void SQCloudLatencyMerge (uint32_t *counters, const uint32_t *from);
+uint64_t SQCloudLatencyBucketLimit (uint32_t index);
+uint64_t SQCloudLatencyPercentile (const uint32_t *counters, double fraction);
+void SQCloudConnectionTrimMemory (SQCloudConnection *connection);
+void SQCloudMemoryPressure (SQCloudConnection *connection, SQCLOUD_MEMORY_PRESSURE level);
+bool SQCloudSetAllocator (const SQCloudAllocator *allocator);
+void SQCloudMemoryStats (int64_t *used, int64_t *highwater);
+uint32_t SQCloudCPUFeatures (void);
+uint32_t SQCloudForceCPUFeatures (uint32_t features);
+void SQCloudSetMemoryBudget (SQCloudConnection *connection, uint64_t soft, uint64_t hard);
+void SQCloudSetProcessMemoryBudget (uint64_t soft, uint64_t hard);
+void SQCloudMemoryUsage (SQCloudConnection *connection, int64_t *connection_bytes, int64_t *process_bytes);
 const char *SQCloudUUID (SQCloudConnection *connection);
 void SQCloudDisconnect (SQCloudConnection *connection);
+bool SQCloudIsAlive (SQCloudConnection *connection);
+bool SQCloudPing (SQCloudConnection *connection, int timeout_ms);
+bool SQCloudReconnect (SQCloudConnection *connection);
+bool SQCloudSessionTransfer (SQCloudConnection *connection, SQCloudConnection *from);
 
 // MARK: - Pub/Sub -
 void SQCloudSetPubSubCallback (SQCloudConnection *connection, SQCloudPubSubCB callback, void *data);
+void SQCloudSetPubSubQueue (SQCloudConnection *connection, uint32_t capacity, SQCLOUD_PUBSUB_OVERFLOW overflow, SQCloudPubSubReadyCB ready, void *data);
+uint32_t SQCloudPubSubDrain (SQCloudConnection *connection, SQCloudResult **results, uint32_t max, uint32_t *dropped);
+void SQCloudSetPubSubFilter (SQCloudConnection *connection, bool enabled);
+bool SQCloudPubSubFilterAdd (SQCloudConnection *connection, const char *channel);
+void SQCloudPubSubFilterRemove (SQCloudConnection *connection, const char *channel);
+bool SQCloudSetPubSubHost (SQCloudConnection *connection, SQCloudConnection *host);
+void SQCloudSetPubSubLatency (SQCloudConnection *connection, bool enabled);
+uint32_t SQCloudPubSubLatency (SQCloudConnection *connection, uint32_t index, char *channel, uint32_t size, uint32_t *counters);
 SQCloudResult *SQCloudSetPubSubOnly (SQCloudConnection *connection);
+int SQCloudPubSubError (SQCloudConnection *connection, char *msg, size_t size);
 
 // MARK: - Error -
 bool SQCloudIsError (SQCloudConnection *connection);
@@ -194,6 +518,7 @@ void SQCloudErrorSetMsg (SQCloudConnection *connection, const char *format, ...)
 // MARK: - Result -
 SQCLOUD_RESULT_TYPE SQCloudResultType (SQCloudResult *result);
 uint32_t SQCloudResultLen (SQCloudResult *result);
+bool SQCloudResultIsChunked (SQCloudResult *result);
 char *SQCloudResultBuffer (SQCloudResult *result);
 int32_t SQCloudResultInt32 (SQCloudResult *result);
 int64_t SQCloudResultInt64 (SQCloudResult *result);
@@ -202,8 +527,21 @@ float SQCloudResultFloat (SQCloudResult *result);
 void SQCloudResultFree (SQCloudResult *result);
 bool SQCloudResultIsOK (SQCloudResult *result);
 bool SQCloudResultIsError (SQCloudResult *result);
+bool SQCloudResultTimings (SQCloudResult *result, SQCloudTimings *timings);
+bool SQCloudResultAllocations (SQCloudResult *result, SQCloudAllocations *allocations);
 void SQCloudResultDump (SQCloudConnection *connection, SQCloudResult *result);
 
+// rowset files (native-endian, to be loaded on the device that saved them), a loaded rowset needs no connection
+bool SQCloudResultSave (SQCloudResult *result, const char *path);
+SQCloudResult *SQCloudResultLoadMapped (const char *path);
+
+// copy of a finished rowset in a single block with an exact-size index (for results kept around, e.g. in a cache)
+SQCloudResult *SQCloudResultCompact (SQCloudResult *result);
+
+// rowsets handed to another process of the device through an anonymous shared memory region (layout of the rowset files)
+int SQCloudResultExportShared (SQCloudResult *result, size_t *size);
+SQCloudResult *SQCloudResultLoadShared (int fd);
+
 // MARK: - Rowset -
 SQCLOUD_VALUE_TYPE SQCloudRowsetValueType (SQCloudResult *result, uint32_t row, uint32_t col);
 uint32_t SQCloudRowsetRowsMaxColumnLength (SQCloudResult *result, uint32_t col);
@@ -226,10 +564,87 @@ float SQCloudRowsetFloatValue (SQCloudResult *result, uint32_t row, uint32_t col
 double SQCloudRowsetDoubleValue (SQCloudResult *result, uint32_t row, uint32_t col);
 void SQCloudRowsetDump (SQCloudResult *result, uint32_t maxline, bool quiet);
 bool SQCloudRowsetCompare (SQCloudResult *result1, SQCloudResult *result2);
+uint64_t SQCloudRowsetHash (SQCloudResult *result);
+uint64_t SQCloudRowsetRowHash (SQCloudResult *result, uint32_t row);
 bool SQCloudRowsetCanWrite (SQCloudResult *result);
+bool SQCloudRowsetDecodeColumns (SQCloudResult *result);
+bool SQCloudRowsetDecodeColumn (SQCloudResult *result, uint32_t col);
+const int64_t *SQCloudRowsetColumnInt64Array (SQCloudResult *result, uint32_t col, uint32_t *count);
+const double *SQCloudRowsetColumnDoubleArray (SQCloudResult *result, uint32_t col, uint32_t *count);
+const char * const *SQCloudRowsetColumnValueArray (SQCloudResult *result, uint32_t col, const uint32_t **len, uint32_t *count);
+const uint8_t *SQCloudRowsetColumnNullBitmap (SQCloudResult *result, uint32_t col, uint32_t *count);
+
+// aggregates over the INTEGER/FLOAT cells of a column (the rowset is decoded on first use)
+// sel is an optional selection vector of nsel row indexes, as returned by SQCloudRowsetColumnFilter
+uint32_t SQCloudRowsetColumnCount (SQCloudResult *result, uint32_t col, const uint32_t *sel, uint32_t nsel);
+bool SQCloudRowsetColumnSum (SQCloudResult *result, uint32_t col, const uint32_t *sel, uint32_t nsel, double *sum);
+bool SQCloudRowsetColumnMin (SQCloudResult *result, uint32_t col, const uint32_t *sel, uint32_t nsel, double *min);
+bool SQCloudRowsetColumnMax (SQCloudResult *result, uint32_t col, const uint32_t *sel, uint32_t nsel, double *max);
+int64_t SQCloudRowsetColumnFilter (SQCloudResult *result, uint32_t col, SQCLOUD_COMPARE_OP op, double value, const uint32_t *sel, uint32_t nsel, uint32_t *out);
+SQCloudRowsetGroup *SQCloudRowsetGroupBy (SQCloudResult *result, uint32_t keycol, uint32_t col, const uint32_t *sel, uint32_t nsel, uint32_t *ngroups);
+void SQCloudRowsetGroupFree (SQCloudRowsetGroup *groups);
+
+// in-memory lookups and orderings over a decoded rowset, which must outlive them
+SQCloudRowsetIndex *SQCloudRowsetBuildIndex (SQCloudResult *result, uint32_t col);
+int64_t SQCloudRowsetIndexLookup (SQCloudRowsetIndex *index, const SQCloudValue *key);
+int64_t SQCloudRowsetIndexNext (SQCloudRowsetIndex *index, uint32_t row);
+void SQCloudRowsetIndexFree (SQCloudRowsetIndex *index);
+int64_t SQCloudRowsetColumnDictionary (SQCloudResult *result, uint32_t col, uint32_t first, uint32_t nrows, uint32_t maxcodes, uint32_t *codes, uint32_t *rows);
+uint32_t *SQCloudRowsetSortedView (SQCloudResult *result, const uint32_t *cols, const bool *descending, uint32_t ncols);
+void SQCloudRowsetSortedViewFree (uint32_t *rows);
+
+// Apache Arrow C Data Interface (https://arrow.apache.org/docs/format/CDataInterface.html)
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED       1
+#define ARROW_FLAG_NULLABLE                 2
+#define ARROW_FLAG_MAP_KEYS_SORTED          4
+
+struct ArrowSchema {
+    const char          *format;
+    const char          *name;
+    const char          *metadata;
+    int64_t             flags;
+    int64_t             n_children;
+    struct ArrowSchema  **children;
+    struct ArrowSchema  *dictionary;
+    void                (*release)(struct ArrowSchema *);
+    void                *private_data;
+};
+
+struct ArrowArray {
+    int64_t             length;
+    int64_t             null_count;
+    int64_t             offset;
+    int64_t             n_buffers;
+    int64_t             n_children;
+    const void          **buffers;
+    struct ArrowArray   **children;
+    struct ArrowArray   *dictionary;
+    void                (*release)(struct ArrowArray *);
+    void                *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+bool SQCloudRowsetExportArrow (SQCloudResult *result, struct ArrowSchema *schema, struct ArrowArray *array);
+
+// MARK: - Rowset Cursor -
+SQCloudRowsetCursor *SQCloudRowsetCursorOpen (SQCloudConnection *connection, const char *command, const char **values, uint32_t len[], SQCLOUD_VALUE_TYPE types[], uint32_t n);
+bool SQCloudRowsetCursorNextChunk (SQCloudRowsetCursor *cursor);
+SQCloudResult *SQCloudRowsetCursorChunk (SQCloudRowsetCursor *cursor);
+uint32_t SQCloudRowsetCursorRows (SQCloudRowsetCursor *cursor);
+uint32_t SQCloudRowsetCursorCols (SQCloudRowsetCursor *cursor);
+char *SQCloudRowsetCursorColumnName (SQCloudRowsetCursor *cursor, uint32_t col, uint32_t *len);
+char *SQCloudRowsetCursorValue (SQCloudRowsetCursor *cursor, uint32_t row, uint32_t col, uint32_t *len);
+bool SQCloudRowsetCursorClose (SQCloudRowsetCursor *cursor);
+int64_t SQCloudRowsetExport (SQCloudConnection *connection, const char *command, const char **values, uint32_t len[], SQCLOUD_VALUE_TYPE types[], uint32_t n, SQCLOUD_EXPORT_FORMAT format, int fd);
+bool SQCloudImportFile (SQCloudConnection *connection, const char *command, int fd, SQCLOUD_EXPORT_FORMAT format, uint32_t batch_rows, int64_t *rows, int64_t *changes);
 
 // MARK: - Array -
 SQCloudResult *SQCloudExecArray (SQCloudConnection *connection, const char *command, const char **values, uint32_t len[], SQCLOUD_VALUE_TYPE types[], uint32_t n);
+SQCloudResult *SQCloudExecArrayTyped (SQCloudConnection *connection, const char *command, const SQCloudValue values[], uint32_t n);
 SQCLOUD_VALUE_TYPE SQCloudArrayValueType (SQCloudResult *result, uint32_t index);
 uint32_t SQCloudArrayCount (SQCloudResult *result);
 char *SQCloudArrayValue (SQCloudResult *result, uint32_t index, uint32_t *len);
@@ -237,18 +652,77 @@ int32_t SQCloudArrayInt32Value (SQCloudResult *result, uint32_t index);
 int64_t SQCloudArrayInt64Value (SQCloudResult *result, uint32_t index);
 float SQCloudArrayFloatValue (SQCloudResult *result, uint32_t index);
 double SQCloudArrayDoubleValue (SQCloudResult *result, uint32_t index);
+uint32_t SQCloudArrayDecode (SQCloudResult *result, SQCLOUD_VALUE_TYPE *types, int64_t *i64, double *f64, uint32_t *lens);
 void SQCloudArrayDump (SQCloudResult *result);
 
+// MARK: - JSON -
+SQCLOUD_JSON_TYPE SQCloudJSONType (SQCloudResult *result, int32_t node);
+uint32_t SQCloudJSONCount (SQCloudResult *result, int32_t node);
+int32_t SQCloudJSONMember (SQCloudResult *result, int32_t node, const char *name);
+int32_t SQCloudJSONElement (SQCloudResult *result, int32_t node, uint32_t index);
+const char *SQCloudJSONValue (SQCloudResult *result, int32_t node, uint32_t *len);
+
+// MARK: - Pipeline -
+SQCloudPipeline *SQCloudPipelineBegin (SQCloudConnection *connection);
+bool SQCloudPipelineAppend (SQCloudPipeline *pipeline, const char *command);
+bool SQCloudPipelineAppendArray (SQCloudPipeline *pipeline, const char *command, const char **values, uint32_t len[], SQCLOUD_VALUE_TYPE types[], uint32_t n);
+SQCloudResult **SQCloudPipelineFlush (SQCloudPipeline *pipeline, uint32_t *count);
+void SQCloudPipelineResultsFree (SQCloudResult **results, uint32_t count);
+bool SQCloudExecMulti (SQCloudConnection *connection, const char *sql, SQCloudResult ***results, uint32_t *count);
+SQCloudResult *SQCloudExecShared (SQCloudConnection *connection, const char *command, size_t len, SQCloudCommandError *error);
+bool SQCloudExecArrayBatch (SQCloudConnection *connection, const char *command, uint32_t rows, uint32_t cols, const char **values, uint32_t len[], SQCLOUD_VALUE_TYPE types[], int64_t *changes, int64_t *lastrowid);
+bool SQCloudNotifyBatch (SQCloudConnection *connection, const char *channel, const char **payloads, uint32_t len[], uint32_t n);
+
+// MARK: - Async -
+bool SQCloudExecAsync (SQCloudConnection *connection, const char *command, SQCloudExecCB callback, void *data);
+bool SQCloudExecArrayAsync (SQCloudConnection *connection, const char *command, const char **values, uint32_t len[], SQCLOUD_VALUE_TYPE types[], uint32_t n, SQCloudExecCB callback, void *data);
+int SQCloudConnectionFD (SQCloudConnection *connection);
+int SQCloudProcessEvents (SQCloudConnection *connection);
+SQCloudEvents *SQCloudEventsCreate (void);
+bool SQCloudEventsWatch (SQCloudEvents *events, SQCloudConnection *connection, int mask);
+int SQCloudEventsWait (SQCloudEvents *events, SQCloudConnection **ready, int max, int timeout_ms);
+void SQCloudEventsFree (SQCloudEvents *events);
+
+// MARK: - Cancel -
+uint64_t SQCloudCancelArm (SQCloudConnection *connection);
+bool SQCloudCancelDisarm (SQCloudConnection *connection, uint64_t handle);
+bool SQCloudCancel (SQCloudConnection *connection, uint64_t handle);
+
+// MARK: - Deadline -
+SQCloudResult *SQCloudExecWithDeadline (SQCloudConnection *connection, const char *command, int deadline_ms);
+SQCloudResult *SQCloudExecArrayTypedWithDeadline (SQCloudConnection *connection, const char *command, const SQCloudValue values[], uint32_t n, int deadline_ms);
+SQCloudResult *SQCloudExecEx (SQCloudConnection *connection, const char *command, const SQCloudValue values[], uint32_t n, int deadline_ms, const SQCloudCommandOptions *options);
+
+// MARK: - Pool -
+SQCloudPool *SQCloudPoolCreate (const char *hostname, int port, SQCloudConfig *config, uint32_t size);
+SQCloudConnection *SQCloudPoolCheckout (SQCloudPool *pool, int timeout);
+void SQCloudPoolCheckin (SQCloudPool *pool, SQCloudConnection *connection);
+void SQCloudPoolFree (SQCloudPool *pool);
+
 // MARK: - Upload/Download -
 bool SQCloudDownloadDatabase (SQCloudConnection *connection, const char *dbname, void *xdata,
                               int (*xCallback)(void *xdata, const void *buffer, uint32_t blen, int64_t ntot, int64_t nprogress));
 bool SQCloudUploadDatabase (SQCloudConnection *connection, const char *dbname, const char *key, void *xdata, int64_t dbsize, int (*xCallback)(void *xdata, void *buffer, uint32_t *blen, int64_t ntot, int64_t nprogress));
+bool SQCloudDownloadDatabaseFile (SQCloudConnection *connection, const char *dbname, int fd, SQCloudProgressCB progress, void *data);
+bool SQCloudDownloadDatabaseResumable (SQCloudConnection *connection, const char *dbname, int fd, int checkpoint_fd, SQCloudProgressCB progress, void *data);
+void SQCloudSetTransferMode (SQCloudConnection *connection, bool enabled);
+bool SQCloudSyncDatabase (SQCloudConnection *connection, const char *dbname, const char *local_path, uint64_t last_raft_index, uint64_t *raft_index);
+bool SQCloudUploadDatabaseFile (SQCloudConnection *connection, const char *dbname, const char *key, int fd, uint32_t chunk, SQCloudProgressCB progress, void *data);
 
 // MARK: - VM -
+void SQCloudSetVMCache (SQCloudConnection *connection, uint32_t count, uint32_t bytes);
+void SQCloudVMCacheStats (SQCloudConnection *connection, uint32_t *hits, uint32_t *misses);
+void SQCloudSetAutoParameterize (SQCloudConnection *connection, uint32_t count);
+SQCloudResult *SQCloudExecAutoParameterize (SQCloudConnection *connection, const char *command, size_t len);
 SQCloudVM *SQCloudVMCompile (SQCloudConnection *connection, const char *sql, int32_t len, const char **tail);
+bool SQCloudVMCompileMany (SQCloudConnection *connection, const char **sqls, int32_t len[], uint32_t n, SQCloudVM **vms);
 SQCLOUD_RESULT_TYPE SQCloudVMStep (SQCloudVM *vm);
+int SQCloudVMFetchRows (SQCloudVM *vm, uint32_t maxrows, uint32_t *first);
+void SQCloudVMSetFetchRows (SQCloudVM *vm, int rows);
 SQCloudResult *SQCloudVMResult (SQCloudVM *vm);
 bool SQCloudVMClose (SQCloudVM *vm);
+bool SQCloudVMReset (SQCloudVM *vm);
+bool SQCloudVMClearBindings (SQCloudVM *vm);
 const char *SQCloudVMErrorMsg (SQCloudVM *vm);
 int SQCloudVMErrorCode (SQCloudVM *vm);
 int SQCloudVMIndex (SQCloudVM *vm);
@@ -280,17 +754,29 @@ int64_t SQCloudVMTotalChanges (SQCloudVM *vm);
 // MARK: - BLOB -
 SQCloudBlob *SQCloudBlobOpen (SQCloudConnection *connection, const char *dbname, const char *tablename, const char *colname, int64_t rowid, bool wrflag);
 bool SQCloudBlobReOpen (SQCloudBlob *blob, int64_t rowid);
+int SQCloudBlobReOpenRead (SQCloudBlob *blob, int64_t rowid, void *buffer, int n, int offset);
+bool SQCloudBlobSizes (SQCloudConnection *connection, const char *dbname, const char *tablename, const char *colname, const int64_t rowids[], uint32_t n, int64_t sizes[]);
 bool SQCloudBlobClose (SQCloudBlob *blob);
 int SQCloudBlobBytes (SQCloudBlob *blob);
 int SQCloudBlobRead (SQCloudBlob *blob, void *buffer, int blen, int offset);
 int SQCloudBlobWrite (SQCloudBlob *blob, const void *buffer, int blen, int offset);
+int SQCloudBlobWritev (SQCloudBlob *blob, const void *buffers[], const uint32_t lens[], int count, int offset);
+int SQCloudBlobWriteFromFD (SQCloudBlob *blob, int fd, int64_t foffset, uint32_t len, int offset);
+bool SQCloudBlobWriteRows (SQCloudConnection *connection, const char *dbname, const char *tablename, const char *colname, const SQCloudBlobWriteRow rows[], uint32_t n, uint32_t chunk, uint32_t window, SQCloudBlobRowsCB callback, void *data);
+SQCloudBlobStream *SQCloudBlobStreamOpen (SQCloudBlob *blob, int chunk, uint32_t window);
+int SQCloudBlobStreamRead (SQCloudBlobStream *stream, void *buffer, int n);
+bool SQCloudBlobStreamClose (SQCloudBlobStream *stream);
 
 // MARK: - Backup -
 SQCloudBackup *SQCloudBackupInit (SQCloudConnection *connection, const char *dest_name, const char *source_name);
 int SQCloudBackupStep (SQCloudBackup *backup, int n, SQCloudBackupOnDataCB on_data);
+int SQCloudBackupRun (SQCloudBackup *backup, int n, uint32_t window, SQCloudBackupOnDataCB on_data);
+int SQCloudBackupRunFile (SQCloudBackup *backup, int n, uint32_t window, int fd);
+int SQCloudBackupRunIncremental (SQCloudBackup *backup, int n, uint32_t window, int fd, int manifest_fd, int64_t *pages_written);
 bool SQCloudBackupFinish (SQCloudBackup *backup);
 int SQCloudBackupPageRemaining (SQCloudBackup *backup);
 int SQCloudBackupPageCount (SQCloudBackup *backup);
+uint32_t SQCloudBackupChecksum (SQCloudBackup *backup);
 void *SQCloudBackupSetData (SQCloudBackup *backup, void *data);
 void *SQCloudBackupData (SQCloudBackup *backup);
 SQCloudConnection *SQCloudBackupConnection (SQCloudBackup *backup);
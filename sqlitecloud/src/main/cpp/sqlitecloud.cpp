@@ -1,13 +1,123 @@
 #include <jni.h>
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(SQLITECLOUD_ATRACE) && defined(__ANDROID__)
+#include <android/trace.h>
+#endif
+
+#if defined(SQLITECLOUD_PGO_GENERATE)
+extern "C" int __llvm_profile_write_file(void);
+#endif
 
 #include "sqcloud.h"
 
+// Class, field and method IDs stay valid as long as the classes are loaded, so they are looked up
+// once in JNI_OnLoad instead of on every call.
+static struct {
+    jfieldID connection;
+    jfieldID pubSubData;
+    jmethodID pubSubCallback;
+    jmethodID pubSubReady;
+    jmethodID traceEvent;
+    jmethodID onResult;
+    jmethodID onProgress;
+    jmethodID onBlobRow;
+    jmethodID windowSetNumColumns;
+    jmethodID windowAllocRow;
+    jmethodID windowFreeLastRow;
+    jmethodID windowPutLong;
+    jmethodID windowPutDouble;
+    jmethodID windowPutString;
+    jmethodID windowPutBlob;
+    jmethodID windowPutNull;
+    jclass integerClass;
+    jmethodID integerInit;
+    jclass stringClass;
+    jclass objectClass;
+} ids;
+
+jint registerAccessors(JNIEnv *env);
+
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    auto bridgeClass = env->FindClass("io/sqlitecloud/SQLiteCloudBridge");
+    auto callbackClass = env->FindClass("io/sqlitecloud/SQLiteCloudResultCallback");
+    auto progressClass = env->FindClass("io/sqlitecloud/SQLiteCloudProgressCallback");
+    auto blobRowsClass = env->FindClass("io/sqlitecloud/SQLiteCloudBlobRowsCallback");
+    auto windowClass = env->FindClass("android/database/CursorWindow");
+    auto integerClass = env->FindClass("java/lang/Integer");
+    auto stringClass = env->FindClass("java/lang/String");
+    auto objectClass = env->FindClass("java/lang/Object");
+    if (!bridgeClass || !callbackClass || !progressClass || !blobRowsClass || !windowClass || !integerClass ||
+        !stringClass || !objectClass) {
+        return JNI_ERR;
+    }
+
+    ids.connection = env->GetFieldID(bridgeClass, "connection", "J");
+    ids.pubSubData = env->GetFieldID(bridgeClass, "pubSubData", "J");
+    ids.pubSubCallback = env->GetMethodID(bridgeClass, "pubSubCallback", "(J)V");
+    ids.pubSubReady = env->GetMethodID(bridgeClass, "pubSubReady", "()V");
+    ids.traceEvent = env->GetMethodID(bridgeClass, "traceEvent", "(IZLjava/lang/String;JJJIIJ)V");
+    ids.onResult = env->GetMethodID(callbackClass, "onResult", "(J)V");
+    ids.onProgress = env->GetMethodID(progressClass, "onProgress", "(JJ)V");
+    ids.onBlobRow = env->GetMethodID(blobRowsClass, "onRow", "(IILjava/lang/String;JJ)V");
+    ids.windowSetNumColumns = env->GetMethodID(windowClass, "setNumColumns", "(I)Z");
+    ids.windowAllocRow = env->GetMethodID(windowClass, "allocRow", "()Z");
+    ids.windowFreeLastRow = env->GetMethodID(windowClass, "freeLastRow", "()V");
+    ids.windowPutLong = env->GetMethodID(windowClass, "putLong", "(JII)Z");
+    ids.windowPutDouble = env->GetMethodID(windowClass, "putDouble", "(DII)Z");
+    ids.windowPutString = env->GetMethodID(windowClass, "putString", "(Ljava/lang/String;II)Z");
+    ids.windowPutBlob = env->GetMethodID(windowClass, "putBlob", "([BII)Z");
+    ids.windowPutNull = env->GetMethodID(windowClass, "putNull", "(II)Z");
+    ids.integerClass = static_cast<jclass>(env->NewGlobalRef(integerClass));
+    ids.integerInit = env->GetMethodID(integerClass, "<init>", "(I)V");
+    ids.stringClass = static_cast<jclass>(env->NewGlobalRef(stringClass));
+    ids.objectClass = static_cast<jclass>(env->NewGlobalRef(objectClass));
+    if (!ids.connection || !ids.pubSubData || !ids.pubSubCallback || !ids.pubSubReady || !ids.traceEvent ||
+        !ids.onResult || !ids.onProgress || !ids.onBlobRow || !ids.windowSetNumColumns || !ids.windowAllocRow ||
+        !ids.windowFreeLastRow || !ids.windowPutLong || !ids.windowPutDouble || !ids.windowPutString ||
+        !ids.windowPutBlob || !ids.windowPutNull || !ids.integerInit) {
+        return JNI_ERR;
+    }
+
+    env->DeleteLocalRef(bridgeClass);
+    env->DeleteLocalRef(callbackClass);
+    env->DeleteLocalRef(progressClass);
+    env->DeleteLocalRef(blobRowsClass);
+    env->DeleteLocalRef(windowClass);
+    env->DeleteLocalRef(integerClass);
+    env->DeleteLocalRef(stringClass);
+    env->DeleteLocalRef(objectClass);
+
+    if (registerAccessors(env) != JNI_OK) {
+        return JNI_ERR;
+    }
+    return JNI_VERSION_1_6;
+}
+
 SQCloudConnection *getConnection(JNIEnv *env, jobject thiz) {
-    auto thisClass = env->GetObjectClass(thiz);
-    auto connectionFieldID = env->GetFieldID(thisClass, "connection", "Ljava/nio/ByteBuffer;");
-    auto connectionBuffer = env->GetObjectField(thiz, connectionFieldID);
-    return static_cast<SQCloudConnection *>(env->GetDirectBufferAddress(connectionBuffer));
+    return reinterpret_cast<SQCloudConnection *>(env->GetLongField(thiz, ids.connection));
+}
+
+jobject newInteger(JNIEnv *env, jint value) {
+    return env->NewObject(ids.integerClass, ids.integerInit, value);
 }
 
 const char *cString(JNIEnv *env, jstring string) {
@@ -17,47 +127,320 @@ const char *cString(JNIEnv *env, jstring string) {
     return env->GetStringUTFChars(string, nullptr);
 }
 
-jobject wrapPointer(JNIEnv *env, void *pointer) {
-    if (!pointer) {
+// Decodes length bytes of UTF-8 into chars (which must have room for length units, a UTF-8 sequence
+// never produces more UTF-16 units than bytes) and returns the number of units written. Invalid bytes
+// become U+FFFD. Runs of ASCII, by far the most common case in text cells, are widened 16 bytes at a time.
+static size_t utf8ToUtf16(const uint8_t *bytes, size_t length, jchar *chars) {
+    // the SIMD path follows the CPU features of sqcloud.c, so that SQCloudForceCPUFeatures can turn it off
+    const bool simd = (SQCloudCPUFeatures() & (CPU_FEATURE_SSE2 | CPU_FEATURE_NEON)) != 0;
+    size_t i = 0, n = 0;
+    while (i < length) {
+#if defined(__SSE2__)
+        while (simd && i + 16 <= length) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+            if (_mm_movemask_epi8(block)) {
+                break;
+            }
+            auto zero = _mm_setzero_si128();
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(chars + n), _mm_unpacklo_epi8(block, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(chars + n + 8), _mm_unpackhi_epi8(block, zero));
+            i += 16;
+            n += 16;
+        }
+#elif defined(__ARM_NEON)
+        while (simd && i + 16 <= length) {
+            auto block = vld1q_u8(bytes + i);
+            auto high = vreinterpretq_u64_u8(vandq_u8(block, vdupq_n_u8(0x80)));
+            if (vgetq_lane_u64(high, 0) | vgetq_lane_u64(high, 1)) {
+                break;
+            }
+            vst1q_u16(reinterpret_cast<uint16_t *>(chars + n), vmovl_u8(vget_low_u8(block)));
+            vst1q_u16(reinterpret_cast<uint16_t *>(chars + n + 8), vmovl_u8(vget_high_u8(block)));
+            i += 16;
+            n += 16;
+        }
+#endif
+        // scalar path, up to the next non ASCII sequence (or the tail)
+        while (i < length && bytes[i] < 0x80) {
+            chars[n++] = bytes[i++];
+        }
+        if (i >= length) {
+            break;
+        }
+
+        uint32_t c = bytes[i];
+        size_t size = 0;
+        uint32_t min = 0x80, max = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            size = 2;
+            c &= 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            size = 3;
+            if (c == 0xE0) min = 0xA0;
+            if (c == 0xED) max = 0x9F;
+            c &= 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            size = 4;
+            if (c == 0xF0) min = 0x90;
+            if (c == 0xF4) max = 0x8F;
+            c &= 0x07;
+        }
+
+        bool valid = size > 0 && i + size <= length && bytes[i + 1] >= min && bytes[i + 1] <= max;
+        for (size_t k = 2; valid && k < size; k++) {
+            valid = (bytes[i + k] & 0xC0) == 0x80;
+        }
+        if (!valid) {
+            chars[n++] = 0xFFFD;
+            i++;
+            continue;
+        }
+
+        for (size_t k = 1; k < size; k++) {
+            c = (c << 6) | (bytes[i + k] & 0x3F);
+        }
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            chars[n++] = static_cast<jchar>(0xD800 + (c >> 10));
+            chars[n++] = static_cast<jchar>(0xDC00 + (c & 0x3FF));
+        } else {
+            chars[n++] = static_cast<jchar>(c);
+        }
+        i += size;
+    }
+    return n;
+}
+
+// Builds a Java string from a (not necessarily NUL terminated) UTF-8 value, unlike NewStringUTF it
+// neither needs a terminator nor goes through modified UTF-8 validation.
+jstring newString(JNIEnv *env, const char *value, uint32_t length) {
+    if (!value) {
+        return nullptr;
+    }
+
+    jchar stackChars[256];
+    auto chars = (length <= 256) ? stackChars : static_cast<jchar *>(malloc(length * sizeof(jchar)));
+    if (!chars) {
         return nullptr;
     }
-    return env->NewDirectByteBuffer(pointer, sizeof(void *));
+
+    auto count = utf8ToUtf16(reinterpret_cast<const uint8_t *>(value), length, chars);
+    auto string = env->NewString(chars, static_cast<jsize>(count));
+    if (chars != stackChars) {
+        free(chars);
+    }
+    return string;
 }
 
-void *unwrapPointer(JNIEnv *env, jobject wrappedPointer) {
-    return env->GetDirectBufferAddress(wrappedPointer);
+// Native handles are passed to Kotlin as plain jlong values (0 is null).
+jlong wrapPointer(void *pointer) {
+    return reinterpret_cast<jlong>(pointer);
 }
 
-SQCloudResult *unwrapResult(JNIEnv *env, jobject wrappedResult) {
-    return static_cast<SQCloudResult *>(unwrapPointer(env, wrappedResult));
+SQCloudResult *unwrapResult(jlong handle) {
+    return reinterpret_cast<SQCloudResult *>(handle);
 }
 
-SQCloudBlob *unwrapBlob(JNIEnv *env, jobject wrappedBlob) {
-    return static_cast<SQCloudBlob *>(unwrapPointer(env, wrappedBlob));
+SQCloudBlob *unwrapBlob(jlong handle) {
+    return reinterpret_cast<SQCloudBlob *>(handle);
 }
 
-SQCloudVM *unwrapVM(JNIEnv *env, jobject wrappedVM) {
-    return static_cast<SQCloudVM *>(unwrapPointer(env, wrappedVM));
+SQCloudBlobStream *unwrapBlobStream(jlong handle) {
+    return reinterpret_cast<SQCloudBlobStream *>(handle);
 }
 
+SQCloudVM *unwrapVM(jlong handle) {
+    return reinterpret_cast<SQCloudVM *>(handle);
+}
+
+SQCloudRowsetCursor *unwrapCursor(jlong handle) {
+    return reinterpret_cast<SQCloudRowsetCursor *>(handle);
+}
+
+SQCloudPool *unwrapPool(jlong handle) {
+    return reinterpret_cast<SQCloudPool *>(handle);
+}
+
+SQCloudRowsetIndex *unwrapIndex(jlong handle) {
+    return reinterpret_cast<SQCloudRowsetIndex *>(handle);
+}
+
+// A section of the system trace around the bulk transfers, compiled in with SQLITECLOUD_ATRACE as
+// the ones of sqcloud.c.
+struct TraceSection {
+#if defined(SQLITECLOUD_ATRACE) && defined(__ANDROID__)
+    explicit TraceSection(const char *name) { ATrace_beginSection(name); }
+    ~TraceSection() { ATrace_endSection(); }
+#else
+    explicit TraceSection(const char *name) {}
+#endif
+};
+
+struct NativeParams {
+    uint32_t count;
+    const char **values;
+    uint32_t *lengths;
+    jobject *objects;
+    jint *types;
+};
+
+NativeParams getNativeParams(JNIEnv *env, jobjectArray params, jintArray param_types) {
+    NativeParams nativeParams;
+    nativeParams.count = env->GetArrayLength(params);
+    nativeParams.values = static_cast<const char **>(calloc(nativeParams.count, sizeof(char *)));
+    nativeParams.lengths = static_cast<uint32_t *>(calloc(nativeParams.count, sizeof(uint32_t)));
+    nativeParams.objects = static_cast<jobject *>(calloc(nativeParams.count, sizeof(jobject)));
+    nativeParams.types = env->GetIntArrayElements(param_types, nullptr);
+    for (int i = 0; i < nativeParams.count; i++) {
+        auto param = env->GetObjectArrayElement(params, i);
+        nativeParams.objects[i] = param;
+        if (nativeParams.types[i] == VALUE_BLOB) {
+            nativeParams.values[i] = static_cast<const char *>(env->GetDirectBufferAddress(param));
+            nativeParams.lengths[i] = env->GetDirectBufferCapacity(param);
+        } else {
+            // The length must be expressed in bytes, GetStringLength would return UTF-16 units.
+            nativeParams.values[i] = cString(env, static_cast<jstring>(param));
+            nativeParams.lengths[i] = strlen(nativeParams.values[i]);
+        }
+    }
+    return nativeParams;
+}
+
+void releaseNativeParams(JNIEnv *env, jintArray param_types, NativeParams &nativeParams) {
+    for (int i = 0; i < nativeParams.count; i++) {
+        if (nativeParams.types[i] != VALUE_BLOB) {
+            env->ReleaseStringUTFChars(static_cast<jstring>(nativeParams.objects[i]),
+                                       nativeParams.values[i]);
+        }
+        env->DeleteLocalRef(nativeParams.objects[i]);
+    }
+    env->ReleaseIntArrayElements(param_types, nativeParams.types, JNI_ABORT);
+    free(nativeParams.values);
+    free(nativeParams.lengths);
+    free(nativeParams.objects);
+}
+
+// Numbers are read straight from the long[]/double[] arrays and text parameters point into the
+// packed zero terminated text buffer (longs holds their length), see SQLiteCloudCommand.Encoded.
+// The file of a VALUE_BLOB_FILE parameter (its path in blobs) is opened here and closed by
+// releaseTypedParams; one that cannot be opened is refused by the exec with a -1 descriptor.
+SQCloudValue *getTypedParams(JNIEnv *env, jobject text, jobjectArray blobs, jintArray param_types,
+                             jlongArray longs, jdoubleArray doubles, uint32_t *count) {
+    *count = env->GetArrayLength(param_types);
+    auto values = static_cast<SQCloudValue *>(calloc(*count + 1, sizeof(SQCloudValue)));
+    auto types = env->GetIntArrayElements(param_types, nullptr);
+    auto nativeLongs = env->GetLongArrayElements(longs, nullptr);
+    auto nativeDoubles = env->GetDoubleArrayElements(doubles, nullptr);
+    auto nativeText = (text) ? static_cast<const char *>(env->GetDirectBufferAddress(text)) : nullptr;
+    for (int i = 0; i < *count; i++) {
+        auto value = &values[i];
+        value->type = static_cast<SQCLOUD_VALUE_TYPE>(types[i]);
+        switch (value->type) {
+            case VALUE_INTEGER:
+                value->i64 = nativeLongs[i];
+                break;
+            case VALUE_FLOAT:
+                value->f64 = nativeDoubles[i];
+                break;
+            case VALUE_TEXT:
+                value->value = nativeText;
+                value->len = static_cast<uint32_t>(nativeLongs[i]);
+                nativeText += value->len + 1;
+                break;
+            case VALUE_BLOB: {
+                auto blob = env->GetObjectArrayElement(blobs, i);
+                value->value = static_cast<const char *>(env->GetDirectBufferAddress(blob));
+                value->len = env->GetDirectBufferCapacity(blob);
+                env->DeleteLocalRef(blob);
+            } break;
+            case VALUE_BLOB_FILE: {
+                auto path = static_cast<jstring>(env->GetObjectArrayElement(blobs, i));
+                auto nativePath = env->GetStringUTFChars(path, nullptr);
+                value->fd = open(nativePath, O_RDONLY | O_CLOEXEC);
+                value->foffset = 0;
+                struct stat st;
+                if (value->fd >= 0 && fstat(value->fd, &st) == 0 && st.st_size <= UINT32_MAX) {
+                    value->len = static_cast<uint32_t>(st.st_size);
+                } else if (value->fd >= 0) {
+                    close(value->fd);
+                    value->fd = -1;
+                }
+                env->ReleaseStringUTFChars(path, nativePath);
+                env->DeleteLocalRef(path);
+            } break;
+            default:
+                break;
+        }
+    }
+    env->ReleaseDoubleArrayElements(doubles, nativeDoubles, JNI_ABORT);
+    env->ReleaseLongArrayElements(longs, nativeLongs, JNI_ABORT);
+    env->ReleaseIntArrayElements(param_types, types, JNI_ABORT);
+    return values;
+}
+
+void releaseTypedParams(SQCloudValue *values, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (values[i].type == VALUE_BLOB_FILE && values[i].fd >= 0) close(values[i].fd);
+    }
+    free(values);
+}
+
+// The int[] of SQLiteCloudCommand.Options.encoded, in the order of the fields of SQCloudCommandOptions.
+void getCommandOptions(JNIEnv *env, jintArray options, SQCloudCommandOptions *nativeOptions) {
+    jint keys[7];
+    env->GetIntArrayRegion(options, 0, 7, keys);
+    nativeOptions->no_blob = static_cast<int8_t>(keys[0]);
+    nativeOptions->zero_text = static_cast<int8_t>(keys[1]);
+    nativeOptions->non_linearizable = static_cast<int8_t>(keys[2]);
+    nativeOptions->compression = static_cast<int8_t>(keys[3]);
+    nativeOptions->max_data = keys[4];
+    nativeOptions->max_rows = keys[5];
+    nativeOptions->max_rowset = keys[6];
+}
+
+// Owned by the bridge (its pubSubData field) and released by doDisconnect, once the reactor can no
+// longer call back. The weak reference lets a bridge that was never disconnected be collected.
+// The trace callback shares it.
 struct PubSubData {
-    JNIEnv *env;
-    jobject thiz;
+    JavaVM *vm;
+    jweak bridge;
 };
 
-extern "C" JNIEXPORT jobject JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_doConnect(
+struct AsyncData {
+    JavaVM *vm;
+    jobject callback;
+};
+
+PubSubData *bridgeData(JNIEnv *env, jobject thiz) {
+    auto data = reinterpret_cast<PubSubData *>(env->GetLongField(thiz, ids.pubSubData));
+    if (!data) {
+        data = new PubSubData;
+        env->GetJavaVM(&data->vm);
+        data->bridge = env->NewWeakGlobalRef(thiz);
+        env->SetLongField(thiz, ids.pubSubData, wrapPointer(data));
+    }
+    return data;
+}
+
+void traceCallback(SQCloudConnection *connection, const SQCloudTraceEvent *event, void *data);
+
+void releasePubSubData(JNIEnv *env, jobject thiz) {
+    auto data = reinterpret_cast<PubSubData *>(env->GetLongField(thiz, ids.pubSubData));
+    if (data) {
+        env->DeleteWeakGlobalRef(data->bridge);
+        delete data;
+        env->SetLongField(thiz, ids.pubSubData, 0);
+    }
+}
+
+SQCloudConfig nativeConfig(
         JNIEnv *env,
-        jobject thiz,
-        jstring hostname,
-        jint port,
         jstring username,
         jstring password,
         jstring database,
         jint timeout,
         jint family,
         jboolean compression,
-        jboolean sqlite_mode,
         jboolean zero_text,
         jboolean password_hashed,
         jboolean nonlinearizable,
@@ -70,41 +453,239 @@ Java_io_sqlitecloud_SQLiteCloudBridge_doConnect(
         jstring tls_root_certificate,
         jstring tls_certificate,
         jstring tls_certificate_key,
-        jboolean insecure
-        // TODO: config_cb callback
+        jstring tls_ciphers,
+        jboolean insecure,
+        jboolean binary_rowset,
+        jboolean compact_index,
+        jboolean defer_config,
+        jint keepalive_idle,
+        jint keepalive_interval,
+        jint keepalive_count,
+        jint user_timeout,
+        jint ping_timeout
 ) {
-    SQCloudConfig config = {
+    return {
             .username = cString(env, username),
             .password = cString(env, password),
             .database = database ? cString(env, database) : nullptr,
             .timeout = timeout,
             .family = family,
             .compression = static_cast<bool>(compression),
-            .sqlite_mode = static_cast<bool>(sqlite_mode),
             .zero_text = static_cast<bool>(zero_text),
             .password_hashed = static_cast<bool>(password_hashed),
-            .nonlinearizable = static_cast<bool>(nonlinearizable),
+            .non_linearizable = static_cast<bool>(nonlinearizable),
             .db_memory = static_cast<bool>(db_memory),
             .no_blob = static_cast<bool>(no_blob),
             .db_create = static_cast<bool>(db_create),
             .max_data = max_data,
             .max_rows = max_rows,
             .max_rowset = max_rowset,
+            // the bridge never dumps rowsets, so column widths are not computed while parsing
+            .lean_rowset = true,
+            .compact_index = static_cast<bool>(compact_index),
+            .binary_rowset = static_cast<bool>(binary_rowset),
+            .defer_config = static_cast<bool>(defer_config),
+            .keepalive_idle = keepalive_idle,
+            .keepalive_interval = keepalive_interval,
+            .keepalive_count = keepalive_count,
+            .user_timeout = user_timeout,
+            .ping_timeout = ping_timeout,
             .tls_root_certificate = tls_root_certificate ? cString(env, tls_root_certificate)
                                                          : nullptr,
             .tls_certificate = tls_certificate ? cString(env, tls_certificate) : nullptr,
             .tls_certificate_key = tls_certificate_key ? cString(env, tls_certificate_key)
                                                        : nullptr,
+            .tls_ciphers = tls_ciphers ? cString(env, tls_ciphers) : nullptr,
             .insecure = static_cast<bool>(insecure),
     };
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_doConnect(
+        JNIEnv *env,
+        jobject thiz,
+        jstring hostname,
+        jint port,
+        jstring username,
+        jstring password,
+        jstring database,
+        jint timeout,
+        jint family,
+        jboolean compression,
+        jboolean sqlite_mode,
+        jboolean zero_text,
+        jboolean password_hashed,
+        jboolean nonlinearizable,
+        jboolean db_memory,
+        jboolean no_blob,
+        jboolean db_create,
+        jint max_data,
+        jint max_rows,
+        jint max_rowset,
+        jstring tls_root_certificate,
+        jstring tls_certificate,
+        jstring tls_certificate_key,
+        jstring tls_ciphers,
+        jboolean insecure,
+        jboolean binary_rowset,
+        jboolean compact_index,
+        jboolean defer_config,
+        jint keepalive_idle,
+        jint keepalive_interval,
+        jint keepalive_count,
+        jint user_timeout,
+        jboolean trace,
+        jboolean trace_hash_only,
+        jstring wire_record,
+        jstring wire_replay
+        // TODO: config_cb callback
+) {
+    // the connection keeps reading its config (parse flags, reconnection), so it lives until doDisconnect
+    auto config = new SQCloudConfig(nativeConfig(
+            env, username, password, database, timeout, family, compression, zero_text,
+            password_hashed, nonlinearizable, db_memory, no_blob, db_create, max_data, max_rows,
+            max_rowset, tls_root_certificate, tls_certificate, tls_certificate_key, tls_ciphers,
+            insecure, binary_rowset, compact_index, defer_config, keepalive_idle,
+            keepalive_interval, keepalive_count, user_timeout, 0
+    ));
+    if (trace) {
+        config->trace = traceCallback;
+        config->trace_data = bridgeData(env, thiz);
+        config->trace_hash_only = trace_hash_only;
+    }
+    config->wire_record = wire_record ? cString(env, wire_record) : nullptr;
+    config->wire_replay = wire_replay ? cString(env, wire_replay) : nullptr;
+
+    auto connection = SQCloudConnect(cString(env, hostname), port, config);
+    if (!connection) {
+        delete config;
+    }
+    return wrapPointer(connection);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_doCreatePool(
+        JNIEnv *env,
+        jobject thiz,
+        jstring hostname,
+        jint port,
+        jstring username,
+        jstring password,
+        jstring database,
+        jint timeout,
+        jint family,
+        jboolean compression,
+        jboolean sqlite_mode,
+        jboolean zero_text,
+        jboolean password_hashed,
+        jboolean nonlinearizable,
+        jboolean db_memory,
+        jboolean no_blob,
+        jboolean db_create,
+        jint max_data,
+        jint max_rows,
+        jint max_rowset,
+        jstring tls_root_certificate,
+        jstring tls_certificate,
+        jstring tls_certificate_key,
+        jstring tls_ciphers,
+        jboolean insecure,
+        jboolean binary_rowset,
+        jboolean compact_index,
+        jboolean defer_config,
+        jint keepalive_idle,
+        jint keepalive_interval,
+        jint keepalive_count,
+        jint user_timeout,
+        jint ping_timeout,
+        jint size
+) {
+    // the pool keeps its own copy of the config
+    SQCloudConfig config = nativeConfig(
+            env, username, password, database, timeout, family, compression, zero_text,
+            password_hashed, nonlinearizable, db_memory, no_blob, db_create, max_data, max_rows,
+            max_rowset, tls_root_certificate, tls_certificate, tls_certificate_key, tls_ciphers,
+            insecure, binary_rowset, compact_index, defer_config, keepalive_idle,
+            keepalive_interval, keepalive_count, user_timeout, ping_timeout
+    );
+
+    auto pool = SQCloudPoolCreate(cString(env, hostname), port, &config, size);
+    return wrapPointer(pool);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_poolCheckout(
+        JNIEnv *env,
+        jobject thiz,
+        jlong pool,
+        jint timeout
+) {
+    auto connection = SQCloudPoolCheckout(unwrapPool(pool), timeout);
+    return wrapPointer(connection);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_poolCheckin(
+        JNIEnv *env,
+        jobject thiz,
+        jlong pool,
+        jlong connection
+) {
+    // the next bridge to check the connection out sets its own trace callback
+    SQCloudSetTrace(reinterpret_cast<SQCloudConnection *>(connection), nullptr, nullptr, false);
+    SQCloudPoolCheckin(unwrapPool(pool), reinterpret_cast<SQCloudConnection *>(connection));
+}
 
-    auto connection = SQCloudConnect(cString(env, hostname), port, &config);
-    return wrapPointer(env, connection);
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_destroyPool(JNIEnv *env, jobject thiz, jlong pool) {
+    SQCloudPoolFree(unwrapPool(pool));
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_doDisconnect(JNIEnv *env, jobject thiz) {
-    SQCloudDisconnect(getConnection(env, thiz));
+    auto connection = getConnection(env, thiz);
+    auto config = connection ? SQCloudGetConfig(connection) : nullptr;
+    SQCloudDisconnect(connection);
+    delete config;
+    releasePubSubData(env, thiz);
+#if defined(SQLITECLOUD_PGO_GENERATE)
+    // the process of an app is killed rather than exited, so the profile is not written at exit
+    __llvm_profile_write_file();
+#endif
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_isAlive(JNIEnv *env, jobject thiz) {
+    return SQCloudIsAlive(getConnection(env, thiz));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_doReconnect(JNIEnv *env, jobject thiz) {
+    auto connection = getConnection(env, thiz);
+    return connection && SQCloudReconnect(connection);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_transferSession(JNIEnv *env, jobject thiz, jlong connection) {
+    auto standby = reinterpret_cast<SQCloudConnection *>(connection);
+    return SQCloudSessionTransfer(standby, getConnection(env, thiz));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_isStandbyReady(JNIEnv *env, jclass clazz, jlong connection) {
+    auto standby = reinterpret_cast<SQCloudConnection *>(connection);
+    return !SQCloudIsError(standby) && SQCloudIsAlive(standby);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_closeStandby(JNIEnv *env, jclass clazz, jlong connection) {
+    auto standby = reinterpret_cast<SQCloudConnection *>(connection);
+    if (!standby) return;
+
+    // same ownership as doDisconnect, a standby never had pub/sub data
+    auto config = SQCloudGetConfig(standby);
+    SQCloudDisconnect(standby);
+    delete config;
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
@@ -123,11 +704,7 @@ Java_io_sqlitecloud_SQLiteCloudBridge_errorCode(JNIEnv *env, jobject thiz) {
     if (!SQCloudIsError(connection)) {
         return nullptr;
     }
-    return env->NewObject(
-            env->FindClass("java/lang/Integer"),
-            env->GetMethodID(env->FindClass("java/lang/Integer"), "<init>", "(I)V"),
-            SQCloudErrorCode(connection)
-    );
+    return newInteger(env, SQCloudErrorCode(connection));
 }
 
 extern "C" JNIEXPORT jstring JNICALL
@@ -145,11 +722,7 @@ Java_io_sqlitecloud_SQLiteCloudBridge_extendedErrorCode(JNIEnv *env, jobject thi
     if (!SQCloudIsError(connection)) {
         return nullptr;
     }
-    return env->NewObject(
-            env->FindClass("java/lang/Integer"),
-            env->GetMethodID(env->FindClass("java/lang/Integer"), "<init>", "(I)V"),
-            SQCloudExtendedErrorCode(connection)
-    );
+    return newInteger(env, SQCloudExtendedErrorCode(connection));
 }
 
 extern "C" JNIEXPORT jobject JNICALL
@@ -158,58 +731,197 @@ Java_io_sqlitecloud_SQLiteCloudBridge_errorOffset(JNIEnv *env, jobject thiz) {
     if (!SQCloudIsError(connection)) {
         return nullptr;
     }
-    return env->NewObject(
-            env->FindClass("java/lang/Integer"),
-            env->GetMethodID(env->FindClass("java/lang/Integer"), "<init>", "(I)V"),
-            SQCloudErrorOffset(connection)
-    );
+    return newInteger(env, SQCloudErrorOffset(connection));
 }
 
 extern "C" JNIEXPORT jobject JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmErrorCode(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+Java_io_sqlitecloud_SQLiteCloudBridge_vmErrorCode(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     if (!vm) {
         return nullptr;
     }
-    return env->NewObject(
-            env->FindClass("java/lang/Integer"),
-            env->GetMethodID(env->FindClass("java/lang/Integer"), "<init>", "(I)V"),
-            SQCloudVMErrorCode(vm)
-    );
+    return newInteger(env, SQCloudVMErrorCode(vm));
 }
 
 extern "C" JNIEXPORT jstring JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_vmErrorMessage(JNIEnv *env, jobject thiz,
-                                                      jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+                                                      jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     if (!vm) {
         return nullptr;
     }
     return env->NewStringUTF(SQCloudVMErrorMsg(vm));
 }
 
+// The pub/sub reactor of the C core is a single native thread serving every connection: it is
+// attached once, as a daemon, and stays attached for the life of the process.
+JNIEnv *pubSubEnv(JavaVM *vm) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+        vm->AttachCurrentThreadAsDaemon(&env, nullptr);
+    }
+    return env;
+}
+
 void pubSubCallback(SQCloudConnection *connection, SQCloudResult *result, void *data) {
     auto pubSubData = static_cast<PubSubData *>(data);
-    auto env = pubSubData->env;
-    auto thiz = pubSubData->thiz;
-    auto wrappedResult = wrapPointer(env, result);
-    env->CallVoidMethod(thiz, env->GetMethodID(env->GetObjectClass(thiz), "pubSubCallback",
-                                               "(Ljava/nio/ByteBuffer;)V"), wrappedResult);
+    auto env = pubSubEnv(pubSubData->vm);
+    auto bridge = env->NewLocalRef(pubSubData->bridge);
+    if (!bridge) {
+        SQCloudResultFree(result);
+        return;
+    }
+    env->CallVoidMethod(bridge, ids.pubSubCallback, wrapPointer(result));
+    env->ExceptionClear();
+    env->DeleteLocalRef(bridge);
+}
+
+void pubSubReady(SQCloudConnection *connection, void *data) {
+    auto pubSubData = static_cast<PubSubData *>(data);
+    auto env = pubSubEnv(pubSubData->vm);
+    auto bridge = env->NewLocalRef(pubSubData->bridge);
+    if (!bridge) {
+        return;
+    }
+    env->CallVoidMethod(bridge, ids.pubSubReady);
+    env->ExceptionClear();
+    env->DeleteLocalRef(bridge);
+}
+
+// Called on the connection thread, already attached, and on the reactor thread for TRACE_PUBSUB.
+void traceCallback(SQCloudConnection *connection, const SQCloudTraceEvent *event, void *data) {
+    auto traceData = static_cast<PubSubData *>(data);
+    auto env = pubSubEnv(traceData->vm);
+    auto bridge = env->NewLocalRef(traceData->bridge);
+    if (!bridge) {
+        return;
+    }
+    auto command = (event->command) ? newString(env, event->command, event->command_len) : nullptr;
+    env->CallVoidMethod(bridge, ids.traceEvent, static_cast<jint>(event->span),
+                        static_cast<jboolean>(event->end), command,
+                        static_cast<jlong>(event->command_hash), static_cast<jlong>(event->bytes_out),
+                        static_cast<jlong>(event->bytes_in), static_cast<jint>(event->result_type),
+                        static_cast<jint>(event->errcode), static_cast<jlong>(event->time_us));
+    env->ExceptionClear();
+    if (command) {
+        env->DeleteLocalRef(command);
+    }
+    env->DeleteLocalRef(bridge);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setTrace(JNIEnv *env, jobject thiz, jboolean enabled,
+                                               jboolean hash_only) {
+    auto connection = getConnection(env, thiz);
+    if (enabled) {
+        SQCloudSetTrace(connection, traceCallback, bridgeData(env, thiz), hash_only);
+    } else {
+        SQCloudSetTrace(connection, nullptr, nullptr, false);
+    }
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_setPubSubCallback(JNIEnv *env, jobject thiz) {
-    auto data = new PubSubData;
-    data->env = env;
-    data->thiz = thiz;
+Java_io_sqlitecloud_SQLiteCloudBridge_setPubSubCallback(JNIEnv *env, jobject thiz, jint queue_size,
+                                                        jint overflow) {
+    auto connection = getConnection(env, thiz);
+    auto data = bridgeData(env, thiz);
+
+    SQCloudSetPubSubCallback(connection, pubSubCallback, data);
+    SQCloudSetPubSubQueue(connection, queue_size > 0 ? queue_size : 0,
+                          static_cast<SQCLOUD_PUBSUB_OVERFLOW>(overflow), pubSubReady, data);
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_pubSubDrain(JNIEnv *env, jobject thiz, jint max) {
+    // Element 0 is the number of notifications dropped since the previous drain, the drained
+    // results follow.
+    auto count = static_cast<uint32_t>(std::max(max, 1));
+    auto results = static_cast<SQCloudResult **>(malloc(count * sizeof(SQCloudResult *)));
+    auto values = static_cast<jlong *>(malloc((count + 1) * sizeof(jlong)));
+    uint32_t n = 0;
+    uint32_t dropped = 0;
+    if (results && values) {
+        n = SQCloudPubSubDrain(getConnection(env, thiz), results, count, &dropped);
+        for (uint32_t i = 0; i < n; ++i) {
+            values[i + 1] = wrapPointer(results[i]);
+        }
+    }
+
+    auto array = env->NewLongArray(static_cast<jsize>(n + 1));
+    if (values) {
+        values[0] = dropped;
+        env->SetLongArrayRegion(array, 0, static_cast<jsize>(n + 1), values);
+    }
+    free(results);
+    free(values);
+    return array;
+}
 
-    SQCloudSetPubSubCallback(getConnection(env, thiz),pubSubCallback, data);
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setPubSubFilter(JNIEnv *env, jobject thiz, jboolean enabled) {
+    SQCloudSetPubSubFilter(getConnection(env, thiz), enabled);
 }
 
-extern "C" JNIEXPORT jobject JNICALL
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_pubSubFilterAdd(JNIEnv *env, jobject thiz, jstring channel) {
+    auto nativeChannel = cString(env, channel);
+    auto added = SQCloudPubSubFilterAdd(getConnection(env, thiz), nativeChannel);
+    if (nativeChannel) {
+        env->ReleaseStringUTFChars(channel, nativeChannel);
+    }
+    return added;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_pubSubFilterRemove(JNIEnv *env, jobject thiz, jstring channel) {
+    auto nativeChannel = cString(env, channel);
+    SQCloudPubSubFilterRemove(getConnection(env, thiz), nativeChannel);
+    if (nativeChannel) {
+        env->ReleaseStringUTFChars(channel, nativeChannel);
+    }
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setPubSubHost(JNIEnv *env, jobject thiz, jobject host) {
+    auto hostConnection = (host) ? getConnection(env, host) : nullptr;
+    return SQCloudSetPubSubHost(getConnection(env, thiz), hostConnection);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setPubSubLatency(JNIEnv *env, jobject thiz, jboolean enabled) {
+    SQCloudSetPubSubLatency(getConnection(env, thiz), enabled);
+}
+
+// Channel names and histograms alternate: {String, int[STAGES * BUCKETS], String, int[], ...}.
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_pubSubLatency(JNIEnv *env, jobject thiz) {
+    auto connection = getConnection(env, thiz);
+    auto count = SQCloudPubSubLatency(connection, UINT32_MAX, nullptr, 0, nullptr);
+    auto histograms = env->NewObjectArray(count * 2, ids.objectClass, nullptr);
+    char channel[256];
+    jint counters[PUBSUB_LATENCY_STAGES * SQCLOUD_PUBSUB_LATENCY_BUCKETS];
+    for (uint32_t i = 0; i < count; i++) {
+        // A channel seen for the first time meanwhile is left for the next call, the trailing
+        // slots stay null if the histograms are reset meanwhile.
+        if (SQCloudPubSubLatency(connection, i, channel, sizeof(channel),
+                                 reinterpret_cast<uint32_t *>(counters)) <= i) {
+            break;
+        }
+        auto name = newString(env, channel, strlen(channel));
+        auto array = env->NewIntArray(PUBSUB_LATENCY_STAGES * SQCLOUD_PUBSUB_LATENCY_BUCKETS);
+        env->SetIntArrayRegion(array, 0, PUBSUB_LATENCY_STAGES * SQCLOUD_PUBSUB_LATENCY_BUCKETS, counters);
+        env->SetObjectArrayElement(histograms, i * 2, name);
+        env->SetObjectArrayElement(histograms, i * 2 + 1, array);
+        env->DeleteLocalRef(name);
+        env->DeleteLocalRef(array);
+    }
+    return histograms;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_setPubSubOnly(JNIEnv *env, jobject thiz) {
     auto result = SQCloudSetPubSubOnly(getConnection(env, thiz));
-    return wrapPointer(env, result);
+    return wrapPointer(result);
 }
 
 
@@ -222,213 +934,1236 @@ Java_io_sqlitecloud_SQLiteCloudBridge_getClientUUID(JNIEnv *env, jobject thiz) {
     return env->NewStringUTF(SQCloudUUID(connection));
 }
 
-extern "C" JNIEXPORT jobject JNICALL
+extern "C" JNIEXPORT jlong JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_executeCommand(
         JNIEnv *env,
         jobject thiz,
-        jstring query
+        jobject query,
+        jint deadline_ms,
+        jintArray options
+) {
+    // query is a zero terminated UTF-8 direct buffer, see SQLiteCloudCommand.Encoded
+    auto connection = getConnection(env, thiz);
+    auto command = static_cast<const char *>(env->GetDirectBufferAddress(query));
+
+    if (options) {
+        SQCloudCommandOptions nativeOptions;
+        getCommandOptions(env, options, &nativeOptions);
+        return wrapPointer(SQCloudExecEx(connection, command, nullptr, 0, deadline_ms, &nativeOptions));
+    }
+
+    auto result = (deadline_ms > 0)
+            ? SQCloudExecWithDeadline(connection, command, deadline_ms)
+            : SQCloudExecAutoParameterize(connection, command, env->GetDirectBufferCapacity(query) - 1);
+
+    return wrapPointer(result);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_executeTypedArrayCommand(
+        JNIEnv *env,
+        jobject thiz,
+        jobject query,
+        jobject text,
+        jobjectArray blobs,
+        jintArray param_types,
+        jlongArray longs,
+        jdoubleArray doubles,
+        jint deadline_ms,
+        jintArray options
 ) {
     auto connection = getConnection(env, thiz);
+    auto command = static_cast<const char *>(env->GetDirectBufferAddress(query));
+    uint32_t count;
+    auto values = getTypedParams(env, text, blobs, param_types, longs, doubles, &count);
+
+    SQCloudResult *result;
+    if (options) {
+        SQCloudCommandOptions nativeOptions;
+        getCommandOptions(env, options, &nativeOptions);
+        result = SQCloudExecEx(connection, command, values, count, deadline_ms, &nativeOptions);
+    } else {
+        result = SQCloudExecArrayTypedWithDeadline(connection, command, values, count, deadline_ms);
+    }
+
+    releaseTypedParams(values, count);
+    return wrapPointer(result);
+}
 
-    auto result = SQCloudExec(connection, cString(env, query));
+void asyncCallback(SQCloudConnection *connection, SQCloudResult *result, void *data) {
+    // Invoked by SQCloudProcessEvents, i.e. on the (attached) event loop thread.
+    auto asyncData = static_cast<AsyncData *>(data);
+    JNIEnv *env = nullptr;
+    asyncData->vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6);
 
-    return wrapPointer(env, result);
+    auto callback = asyncData->callback;
+    env->CallVoidMethod(callback, ids.onResult, wrapPointer(result));
+
+    env->DeleteGlobalRef(callback);
+    delete asyncData;
 }
 
-extern "C" JNIEXPORT jobject JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_executeArrayCommand(
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_executeAsync(
         JNIEnv *env,
         jobject thiz,
         jstring query,
         jobjectArray params,
-        jintArray param_types
+        jintArray param_types,
+        jobject callback
 ) {
     auto connection = getConnection(env, thiz);
     auto command = cString(env, query);
-    uint32_t paramCount = env->GetArrayLength(params);
-    const char **nativeParams = static_cast<const char **>(calloc(paramCount, sizeof(char *)));
-    uint32_t *paramLengths = static_cast<uint32_t *>(calloc(paramCount, sizeof(uint32_t)));
-    auto paramTypes = env->GetIntArrayElements(param_types, nullptr);
-    for (int i = 0; i < paramCount; i++) {
-        auto param = env->GetObjectArrayElement(params, i);
-        if (paramTypes[i] == VALUE_BLOB) {
-            nativeParams[i] = static_cast<const char *>(env->GetDirectBufferAddress(param));
-            paramLengths[i] = env->GetDirectBufferCapacity(param);
+    auto data = new AsyncData;
+    env->GetJavaVM(&data->vm);
+    data->callback = env->NewGlobalRef(callback);
+
+    // The command is serialized immediately, so every JNI reference can be released on return.
+    bool queued;
+    if (env->GetArrayLength(params) == 0) {
+        queued = SQCloudExecAsync(connection, command, asyncCallback, data);
+    } else {
+        auto nativeParams = getNativeParams(env, params, param_types);
+        queued = SQCloudExecArrayAsync(connection, command, nativeParams.values,
+                                       nativeParams.lengths,
+                                       reinterpret_cast<SQCLOUD_VALUE_TYPE *>(nativeParams.types),
+                                       nativeParams.count, asyncCallback, data);
+        releaseNativeParams(env, param_types, nativeParams);
+    }
+
+    if (!queued) {
+        env->DeleteGlobalRef(data->callback);
+        delete data;
+    }
+    env->ReleaseStringUTFChars(query, command);
+    return queued;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_connectionFD(JNIEnv *env, jobject thiz) {
+    return SQCloudConnectionFD(getConnection(env, thiz));
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_processEvents(JNIEnv *env, jobject thiz) {
+    return SQCloudProcessEvents(getConnection(env, thiz));
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_cancelArm(JNIEnv *env, jobject thiz) {
+    return (jlong) SQCloudCancelArm(getConnection(env, thiz));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_cancelDisarm(JNIEnv *env, jobject thiz, jlong handle) {
+    return SQCloudCancelDisarm(getConnection(env, thiz), (uint64_t) handle);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_cancel(JNIEnv *env, jobject thiz, jlong handle) {
+    return SQCloudCancel(getConnection(env, thiz), (uint64_t) handle);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_watchEvents(JNIEnv *env, jobject thiz, jlong events, jint mask) {
+    return SQCloudEventsWatch(reinterpret_cast<SQCloudEvents *>(events), getConnection(env, thiz), mask);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudEventLoop_newEvents(JNIEnv *env, jobject thiz) {
+    return reinterpret_cast<jlong>(SQCloudEventsCreate());
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_io_sqlitecloud_SQLiteCloudEventLoop_waitReady(
+        JNIEnv *env,
+        jobject thiz,
+        jlong events,
+        jintArray fds,
+        jint timeout
+) {
+    // The ready connections are reported by their socket, the loop knows the bridge of each one.
+    jsize max = env->GetArrayLength(fds);
+    auto ready = static_cast<SQCloudConnection **>(calloc(max, sizeof(SQCloudConnection *)));
+    int count = SQCloudEventsWait(reinterpret_cast<SQCloudEvents *>(events), ready, max, timeout);
+
+    auto nativeFds = env->GetIntArrayElements(fds, nullptr);
+    for (int i = 0; i < count; i++) {
+        nativeFds[i] = SQCloudConnectionFD(ready[i]);
+    }
+    env->ReleaseIntArrayElements(fds, nativeFds, 0);
+    free(ready);
+    return count;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_executePipeline(
+        JNIEnv *env,
+        jobject thiz,
+        jobjectArray queries,
+        jobjectArray params,
+        jobjectArray param_types
+) {
+    auto connection = getConnection(env, thiz);
+    auto pipeline = SQCloudPipelineBegin(connection);
+    if (pipeline == nullptr) {
+        return nullptr;
+    }
+
+    // Commands are copied into the pipeline buffer, so every JNI reference can be released
+    // as soon as the command has been appended.
+    jsize commandCount = env->GetArrayLength(queries);
+    for (int i = 0; i < commandCount; i++) {
+        auto query = static_cast<jstring>(env->GetObjectArrayElement(queries, i));
+        auto command = cString(env, query);
+        auto commandParams = static_cast<jobjectArray>(env->GetObjectArrayElement(params, i));
+        auto commandTypes = static_cast<jintArray>(env->GetObjectArrayElement(param_types, i));
+        uint32_t paramCount = env->GetArrayLength(commandParams);
+
+        if (paramCount == 0) {
+            SQCloudPipelineAppend(pipeline, command);
         } else {
-            auto stringParam = static_cast<jstring>(param);
-            nativeParams[i] = cString(env, stringParam);
-            paramLengths[i] = env->GetStringLength(stringParam);
+            auto nativeParams = getNativeParams(env, commandParams, commandTypes);
+            SQCloudPipelineAppendArray(pipeline, command, nativeParams.values, nativeParams.lengths,
+                                       reinterpret_cast<SQCLOUD_VALUE_TYPE *>(nativeParams.types),
+                                       nativeParams.count);
+            releaseNativeParams(env, commandTypes, nativeParams);
         }
+
+        env->ReleaseStringUTFChars(query, command);
+        env->DeleteLocalRef(query);
+        env->DeleteLocalRef(commandParams);
+        env->DeleteLocalRef(commandTypes);
+    }
+
+    uint32_t resultCount = 0;
+    auto results = SQCloudPipelineFlush(pipeline, &resultCount);
+    if (results == nullptr) {
+        return nullptr;
+    }
+
+    // Error slots are left 0, the connection error refers to the first failed command.
+    auto wrappedResults = env->NewLongArray((jsize) resultCount);
+    auto handles = static_cast<jlong *>(malloc((resultCount + 1) * sizeof(jlong)));
+    for (int i = 0; i < resultCount; i++) {
+        handles[i] = wrapPointer(results[i]);
+    }
+    env->SetLongArrayRegion(wrappedResults, 0, (jsize) resultCount, handles);
+    free(handles);
+
+    // Only the array is released here, each result is freed by the caller through freeResult.
+    SQCloudPipelineResultsFree(results, 0);
+    return wrappedResults;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_executeStatements(
+        JNIEnv *env,
+        jobject thiz,
+        jstring sql
+) {
+    auto connection = getConnection(env, thiz);
+    auto statements = cString(env, sql);
+
+    SQCloudResult **results = nullptr;
+    uint32_t resultCount = 0;
+    bool success = SQCloudExecMulti(connection, statements, &results, &resultCount);
+    env->ReleaseStringUTFChars(sql, statements);
+    if (!success && results == nullptr) {
+        return nullptr;
+    }
+
+    // Same layout as executePipeline: error slots are left 0.
+    auto wrappedResults = env->NewLongArray((jsize) resultCount);
+    auto handles = static_cast<jlong *>(malloc((resultCount + 1) * sizeof(jlong)));
+    for (int i = 0; i < resultCount; i++) {
+        handles[i] = wrapPointer(results[i]);
+    }
+    env->SetLongArrayRegion(wrappedResults, 0, (jsize) resultCount, handles);
+    free(handles);
+
+    SQCloudPipelineResultsFree(results, 0);
+    return wrappedResults;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_executeBatch(
+        JNIEnv *env,
+        jobject thiz,
+        jstring query,
+        jobjectArray params,
+        jintArray param_types,
+        jint rows,
+        jint cols
+) {
+    // params and param_types contain rows * cols values in row-major order.
+    TraceSection section("sqlitecloud jni batch");
+    auto connection = getConnection(env, thiz);
+    auto command = cString(env, query);
+    auto nativeParams = getNativeParams(env, params, param_types);
+
+    int64_t changes = 0, lastRowId = 0;
+    bool success = SQCloudExecArrayBatch(connection, command, rows, cols, nativeParams.values,
+                                         nativeParams.lengths,
+                                         reinterpret_cast<SQCLOUD_VALUE_TYPE *>(nativeParams.types),
+                                         &changes, &lastRowId);
+
+    releaseNativeParams(env, param_types, nativeParams);
+    env->ReleaseStringUTFChars(query, command);
+    if (!success) {
+        return nullptr;
+    }
+
+    jlong counters[2] = {changes, lastRowId};
+    auto result = env->NewLongArray(2);
+    env->SetLongArrayRegion(result, 0, 2, counters);
+    return result;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_notifyBatch(
+        JNIEnv *env,
+        jobject thiz,
+        jstring channel,
+        jobjectArray payloads
+) {
+    auto connection = getConnection(env, thiz);
+    auto nativeChannel = cString(env, channel);
+    auto count = env->GetArrayLength(payloads);
+    auto objects = static_cast<jstring *>(calloc(count, sizeof(jstring)));
+    auto values = static_cast<const char **>(calloc(count, sizeof(char *)));
+    auto lengths = static_cast<uint32_t *>(calloc(count, sizeof(uint32_t)));
+    for (int i = 0; i < count; i++) {
+        objects[i] = static_cast<jstring>(env->GetObjectArrayElement(payloads, i));
+        values[i] = cString(env, objects[i]);
+        lengths[i] = strlen(values[i]);
+    }
+
+    bool success = SQCloudNotifyBatch(connection, nativeChannel, values, lengths, count);
+
+    for (int i = 0; i < count; i++) {
+        env->ReleaseStringUTFChars(objects[i], values[i]);
+        env->DeleteLocalRef(objects[i]);
+    }
+    free(objects);
+    free(values);
+    free(lengths);
+    env->ReleaseStringUTFChars(channel, nativeChannel);
+    return success;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_openCursor(
+        JNIEnv *env,
+        jobject thiz,
+        jstring query,
+        jobjectArray params,
+        jintArray param_types
+) {
+    auto connection = getConnection(env, thiz);
+    auto command = cString(env, query);
+    auto nativeParams = getNativeParams(env, params, param_types);
+
+    auto cursor = SQCloudRowsetCursorOpen(connection, command, nativeParams.values,
+                                          nativeParams.lengths,
+                                          reinterpret_cast<SQCLOUD_VALUE_TYPE *>(nativeParams.types),
+                                          nativeParams.count);
+
+    releaseNativeParams(env, param_types, nativeParams);
+    env->ReleaseStringUTFChars(query, command);
+    return wrapPointer(cursor);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_cursorNextChunk(JNIEnv *env, jobject thiz,
+                                                       jlong wrappedCursor) {
+    // The returned rowset is owned by the cursor and stays valid until the next call.
+    auto cursor = unwrapCursor(wrappedCursor);
+    if (!SQCloudRowsetCursorNextChunk(cursor)) {
+        return 0;
     }
-    SQCLOUD_VALUE_TYPE *types = reinterpret_cast<SQCLOUD_VALUE_TYPE *>(env->GetIntArrayElements(
-            param_types, nullptr));
+    return wrapPointer(SQCloudRowsetCursorChunk(cursor));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_doCloseCursor(JNIEnv *env, jobject thiz,
+                                                     jlong wrappedCursor) {
+    auto cursor = unwrapCursor(wrappedCursor);
+    return SQCloudRowsetCursorClose(cursor);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_doExportRowset(
+        JNIEnv *env,
+        jobject thiz,
+        jstring query,
+        jobjectArray params,
+        jintArray param_types,
+        jint format,
+        jint fd
+) {
+    // The rows are formatted and written natively while the chunks arrive, none of them crosses
+    // into the JVM.
+    auto connection = getConnection(env, thiz);
+    auto command = cString(env, query);
+    auto nativeParams = getNativeParams(env, params, param_types);
+
+    auto rows = SQCloudRowsetExport(connection, command, nativeParams.values, nativeParams.lengths,
+                                    reinterpret_cast<SQCLOUD_VALUE_TYPE *>(nativeParams.types),
+                                    nativeParams.count, static_cast<SQCLOUD_EXPORT_FORMAT>(format),
+                                    fd);
+
+    releaseNativeParams(env, param_types, nativeParams);
+    env->ReleaseStringUTFChars(query, command);
+    return rows;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_doImportFile(
+        JNIEnv *env,
+        jobject thiz,
+        jstring query,
+        jint format,
+        jint fd,
+        jint batchRows
+) {
+    // The file is parsed natively, its records never cross into the JVM.
+    auto connection = getConnection(env, thiz);
+    auto command = cString(env, query);
+
+    int64_t rows = 0, changes = 0;
+    bool success = SQCloudImportFile(connection, command, fd, static_cast<SQCLOUD_EXPORT_FORMAT>(format),
+                                     static_cast<uint32_t>(batchRows), &rows, &changes);
 
-    auto result = SQCloudExecArray(connection, command, nativeParams, paramLengths, types,
-                                   paramCount);
+    env->ReleaseStringUTFChars(query, command);
+    if (!success) {
+        return nullptr;
+    }
 
-    return wrapPointer(env, result);
+    jlong counters[2] = {rows, changes};
+    auto result = env->NewLongArray(2);
+    env->SetLongArrayRegion(result, 0, 2, counters);
+    return result;
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_freeResult(JNIEnv *env, jobject thiz,
-                                                  jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                  jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
     SQCloudResultFree(result);
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_resultType(JNIEnv *env, jobject thiz,
-                                                  jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_resultTimings(JNIEnv *env, jobject thiz,
+                                                     jlong wrappedResult) {
+    SQCloudTimings timings;
+    if (!SQCloudResultTimings(unwrapResult(wrappedResult), &timings)) {
+        return nullptr;
+    }
+
+    jlong values[6] = {timings.write_start, timings.write_end, timings.first_byte,
+                       timings.last_byte, timings.decompress, timings.parse};
+    auto array = env->NewLongArray(6);
+    env->SetLongArrayRegion(array, 0, 6, values);
+    return array;
+}
+
+// The counters in the order of SQCloudAllocations.
+static void allocationValues(const SQCloudAllocations &allocations, jlong *values) {
+    values[0] = allocations.allocs;
+    values[1] = allocations.reallocs;
+    values[2] = allocations.frees;
+    values[3] = allocations.pool_reuses;
+    values[4] = static_cast<jlong>(allocations.bytes);
+    values[5] = static_cast<jlong>(allocations.receive);
+    values[6] = static_cast<jlong>(allocations.decompress);
+    values[7] = static_cast<jlong>(allocations.rowset);
+    values[8] = static_cast<jlong>(allocations.chunk_growth);
+    values[9] = static_cast<jlong>(allocations.metadata);
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_resultAllocations(JNIEnv *env, jobject thiz,
+                                                         jlong wrappedResult) {
+    SQCloudAllocations allocations;
+    if (!SQCloudResultAllocations(unwrapResult(wrappedResult), &allocations)) {
+        return nullptr;
+    }
+
+    jlong values[10];
+    allocationValues(allocations, values);
+    auto array = env->NewLongArray(10);
+    env->SetLongArrayRegion(array, 0, 10, values);
+    return array;
+}
+
+// The scalar accessors below are @CriticalNative methods of SQLiteCloudAccessors, see
+// registerAccessors: they must only read memory of the result or VM, never block or call back
+// into Java.
+static jint JNICALL
+accessorResultType(jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudResultType(result);
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_intResult(JNIEnv *env, jobject thiz, jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
+Java_io_sqlitecloud_SQLiteCloudBridge_intResult(JNIEnv *env, jobject thiz, jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudResultInt32(result);
 }
 
 extern "C" JNIEXPORT jlong JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_longResult(JNIEnv *env, jobject thiz,
-                                                  jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                  jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudResultInt64(result);
 }
 
 extern "C" JNIEXPORT jdouble JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_doubleResult(JNIEnv *env, jobject thiz,
-                                                    jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                    jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudResultDouble(result);
 }
 
 extern "C" JNIEXPORT jstring JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_stringResult(JNIEnv *env, jobject thiz,
-                                                    jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
-    auto bufferResult = SQCloudResultBuffer(result);
-    return env->NewStringUTF(bufferResult);
+                                                    jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
+    return newString(env, SQCloudResultBuffer(result), SQCloudResultLen(result));
+}
+
+jstring jsonString(JNIEnv *env, SQCloudResult *result, int32_t node) {
+    uint32_t length = 0;
+    auto value = SQCloudJSONValue(result, node, &length);
+    return value ? newString(env, value, length) : nullptr;
+}
+
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_notificationFields(JNIEnv *env, jobject thiz,
+                                                         jlong wrappedResult) {
+    // Sender, channel, message type, payload and primary key of a notification decoded natively in
+    // a single call, or null if the JSON object does not have exactly these members with the types
+    // of SQLiteCloudPayload (the caller then decodes it in Kotlin).
+    auto result = unwrapResult(wrappedResult);
+    if (SQCloudJSONType(result, 0) != JSON_TYPE_OBJECT || SQCloudJSONCount(result, 0) != 5) {
+        return nullptr;
+    }
+
+    static const char *names[] = {"sender", "channel", "messageType", "payload"};
+    int32_t nodes[4];
+    for (int i = 0; i < 4; ++i) {
+        nodes[i] = SQCloudJSONMember(result, 0, names[i]);
+        auto type = SQCloudJSONType(result, nodes[i]);
+        if (type != JSON_TYPE_STRING && !(i == 3 && type == JSON_TYPE_NULL)) {
+            return nullptr;
+        }
+    }
+    auto pk = SQCloudJSONMember(result, 0, "pk");
+    if (SQCloudJSONType(result, pk) != JSON_TYPE_ARRAY) {
+        return nullptr;
+    }
+    auto npk = SQCloudJSONCount(result, pk);
+    for (uint32_t i = 0; i < npk; ++i) {
+        if (SQCloudJSONType(result, SQCloudJSONElement(result, pk, i)) != JSON_TYPE_STRING) {
+            return nullptr;
+        }
+    }
+
+    auto fields = env->NewObjectArray(5, ids.objectClass, nullptr);
+    for (int i = 0; i < 4; ++i) {
+        if (SQCloudJSONType(result, nodes[i]) == JSON_TYPE_STRING) {
+            auto value = jsonString(env, result, nodes[i]);
+            env->SetObjectArrayElement(fields, i, value);
+            env->DeleteLocalRef(value);
+        }
+    }
+    auto keys = env->NewObjectArray(static_cast<jsize>(npk), ids.stringClass, nullptr);
+    for (uint32_t i = 0; i < npk; ++i) {
+        auto value = jsonString(env, result, SQCloudJSONElement(result, pk, i));
+        env->SetObjectArrayElement(keys, static_cast<jsize>(i), value);
+        env->DeleteLocalRef(value);
+    }
+    env->SetObjectArrayElement(fields, 4, keys);
+    env->DeleteLocalRef(keys);
+    return fields;
 }
 
 extern "C" JNIEXPORT jobject JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_bufferResult(JNIEnv *env, jobject thiz,
-                                                    jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                    jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
     auto bufferResult = SQCloudResultBuffer(result);
     return env->NewDirectByteBuffer(bufferResult, SQCloudResultLen(result));
 }
 
+static jint JNICALL
+accessorResultLength(jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
+    return (jint) SQCloudResultLen(result);
+}
+
+static jboolean JNICALL
+accessorResultIsChunked(jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudResultIsChunked(result);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_saveResult(JNIEnv *env, jobject thiz, jlong wrappedResult,
+                                                 jstring path) {
+    auto result = unwrapResult(wrappedResult);
+    auto nativePath = cString(env, path);
+    if (!nativePath) {
+        return false;
+    }
+    auto saved = SQCloudResultSave(result, nativePath);
+    env->ReleaseStringUTFChars(path, nativePath);
+    return saved;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_compactResult(JNIEnv *env, jobject thiz, jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
+    return wrapPointer(SQCloudResultCompact(result));
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_loadMappedResult(JNIEnv *env, jobject thiz, jstring path) {
+    auto nativePath = cString(env, path);
+    if (!nativePath) {
+        return 0;
+    }
+    auto result = SQCloudResultLoadMapped(nativePath);
+    env->ReleaseStringUTFChars(path, nativePath);
+    return wrapPointer(result);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_exportSharedResult(JNIEnv *env, jobject thiz, jlong wrappedResult) {
+    // The descriptor is adopted by a ParcelFileDescriptor on the Kotlin side, which closes it.
+    TraceSection section("sqlitecloud jni share");
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudResultExportShared(result, nullptr);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_loadSharedResult(JNIEnv *env, jobject thiz, jint fd) {
+    return wrapPointer(SQCloudResultLoadShared(fd));
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultSize(JNIEnv *env, jobject thiz,
-                                                       jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                       jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudArrayCount(result);
 }
 
 extern "C" JNIEXPORT jint JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultValueType(JNIEnv *env, jobject thiz,
-                                                            jobject wrappedResult, jint index) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                            jlong wrappedResult, jint index) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudArrayValueType(result, index);
 }
 
 extern "C" JNIEXPORT jlong JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultLongValue(JNIEnv *env, jobject thiz,
-                                                            jobject wrappedResult, jint index) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                            jlong wrappedResult, jint index) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudArrayInt64Value(result, index);
 }
 
 extern "C" JNIEXPORT jdouble JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultDoubleValue(JNIEnv *env, jobject thiz,
-                                                              jobject wrappedResult, jint index) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                              jlong wrappedResult, jint index) {
+    auto result = unwrapResult(wrappedResult);
     return SQCloudArrayDoubleValue(result, index);
 }
 
 extern "C" JNIEXPORT jstring JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultStringValue(JNIEnv *env, jobject thiz,
-                                                              jobject wrappedResult, jint index) {
-    auto result = unwrapResult(env, wrappedResult);
+                                                              jlong wrappedResult, jint index) {
+    auto result = unwrapResult(wrappedResult);
+    uint32_t valueSize;
+    auto value = SQCloudArrayValue(result, index, &valueSize);
+    return newString(env, value, valueSize);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultBufferValue(JNIEnv *env, jobject thiz,
+                                                              jlong wrappedResult, jint index) {
+    auto result = unwrapResult(wrappedResult);
     uint32_t valueSize;
-    return env->NewStringUTF(SQCloudArrayValue(result, index, &valueSize));
+    auto value = SQCloudArrayValue(result, index, &valueSize);
+    return env->NewDirectByteBuffer(value, valueSize);
+}
+
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultValues(JNIEnv *env, jobject thiz,
+                                                        jlong wrappedResult, jbyteArray types,
+                                                        jlongArray longs, jdoubleArray doubles,
+                                                        jintArray offsets) {
+    // As rowsetResultColumn for the items of an array: one JNI call for the whole array, the
+    // numbers come from the table decoded by the parse and TEXT/BLOB items are concatenated.
+    auto result = unwrapResult(wrappedResult);
+    uint32_t count = SQCloudArrayCount(result);
+
+    auto nativeTypes = static_cast<SQCLOUD_VALUE_TYPE *>(malloc((count + 1) * sizeof(SQCLOUD_VALUE_TYPE)));
+    auto nativeLongs = static_cast<int64_t *>(malloc((count + 1) * sizeof(int64_t)));
+    auto nativeDoubles = static_cast<double *>(malloc((count + 1) * sizeof(double)));
+    auto nativeLengths = static_cast<uint32_t *>(malloc((count + 1) * sizeof(uint32_t)));
+    auto nativeOffsets = static_cast<jint *>(malloc((count + 1) * sizeof(jint)));
+    auto byteTypes = static_cast<jbyte *>(malloc(count + 1));
+    SQCloudArrayDecode(result, nativeTypes, nativeLongs, nativeDoubles, nativeLengths);
+
+    jint totalLength = 0;
+    for (uint32_t index = 0; index < count; index++) {
+        byteTypes[index] = (jbyte) nativeTypes[index];
+        nativeOffsets[index] = totalLength;
+        totalLength += (jint) nativeLengths[index];
+    }
+    nativeOffsets[count] = totalLength;
+
+    auto bytes = env->NewByteArray(totalLength);
+    if (bytes) {
+        auto nativeBytes = static_cast<jbyte *>(env->GetPrimitiveArrayCritical(bytes, nullptr));
+        for (uint32_t index = 0; index < count; index++) {
+            if (nativeLengths[index] == 0) continue;
+            uint32_t valueSize;
+            auto value = SQCloudArrayValue(result, index, &valueSize);
+            memcpy(nativeBytes + nativeOffsets[index], value, nativeLengths[index]);
+        }
+        env->ReleasePrimitiveArrayCritical(bytes, nativeBytes, 0);
+
+        env->SetByteArrayRegion(types, 0, (jsize) count, byteTypes);
+        env->SetLongArrayRegion(longs, 0, (jsize) count, reinterpret_cast<const jlong *>(nativeLongs));
+        env->SetDoubleArrayRegion(doubles, 0, (jsize) count, nativeDoubles);
+        env->SetIntArrayRegion(offsets, 0, (jsize) count + 1, nativeOffsets);
+    }
+    free(nativeTypes);
+    free(nativeLongs);
+    free(nativeDoubles);
+    free(nativeLengths);
+    free(nativeOffsets);
+    free(byteTypes);
+
+    return bytes;
+}
+
+static jint JNICALL
+accessorRowsetResultRowCount(jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudRowsetRows(result);
+}
+
+static jint JNICALL
+accessorRowsetResultColumnCount(jlong wrappedResult) {
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudRowsetCols(result);
 }
 
-extern "C" JNIEXPORT jobject JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_arrayResultBufferValue(JNIEnv *env, jobject thiz,
-                                                              jobject wrappedResult, jint index) {
-    auto result = unwrapResult(env, wrappedResult);
-    uint32_t valueSize;
-    auto value = SQCloudArrayValue(result, index, &valueSize);
-    return env->NewDirectByteBuffer(value, valueSize);
+extern "C" JNIEXPORT jstring JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultColumnName(JNIEnv *env, jobject thiz,
+                                                              jlong wrappedResult, jint column) {
+    auto result = unwrapResult(wrappedResult);
+    uint32_t columnNameLength;
+    auto columnName = SQCloudRowsetColumnName(result, column, &columnNameLength);
+    return newString(env, columnName, columnNameLength);
+}
+
+static jint JNICALL
+accessorRowsetResultValueType(jlong wrappedResult, jint row, jint column) {
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudRowsetValueType(result, row, column);
+}
+
+static jlong JNICALL
+accessorRowsetResultLongValue(jlong wrappedResult, jint row, jint column) {
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudRowsetInt64Value(result, row, column);
+}
+
+
+static jdouble JNICALL
+accessorRowsetResultDoubleValue(jlong wrappedResult, jint row, jint column) {
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudRowsetDoubleValue(result, row, column);
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultStringValue(JNIEnv *env, jobject thiz,
+                                                               jlong wrappedResult, jint row,
+                                                               jint column) {
+    auto result = unwrapResult(wrappedResult);
+    uint32_t valueSize;
+    auto value = SQCloudRowsetValue(result, row, column, &valueSize);
+    return newString(env, value, valueSize);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultBufferValue(JNIEnv *env, jobject thiz,
+                                                               jlong wrappedResult, jint row,
+                                                               jint column) {
+    auto result = unwrapResult(wrappedResult);
+    uint32_t valueSize;
+    auto value = SQCloudRowsetValue(result, row, column, &valueSize);
+    return env->NewDirectByteBuffer(value, valueSize);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_exportArrow(JNIEnv *env, jobject thiz, jlong wrappedResult,
+                                                  jlong schemaAddress, jlong arrayAddress) {
+    // On success the result belongs to the exported array, its release callback frees it.
+    TraceSection section("sqlitecloud jni arrow");
+    auto result = unwrapResult(wrappedResult);
+    return SQCloudRowsetExportArrow(result, reinterpret_cast<ArrowSchema *>(schemaAddress),
+                                    reinterpret_cast<ArrowArray *>(arrayAddress));
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultColumn(JNIEnv *env, jobject thiz,
+                                                         jlong wrappedResult, jint column,
+                                                         jint first, jint rowCount,
+                                                         jbyteArray types, jlongArray longs,
+                                                         jdoubleArray doubles, jintArray offsets) {
+    // Fills the given arrays (at least rowCount long, offsets one more) for rowCount rows of a
+    // column from first and returns the length of their TEXT/BLOB cells concatenated, copied by
+    // rowsetResultColumnBytes into an array of the caller, so that a rowset can be transferred
+    // with two JNI calls per column instead of two per cell and into arrays reused from a pool.
+    // Only this column is decoded, the cells of the columns left out of a projection are never
+    // read. Returns -1 if the column could not be decoded.
+    TraceSection section("sqlitecloud jni column");
+    auto result = unwrapResult(wrappedResult);
+    if (!SQCloudRowsetDecodeColumn(result, column)) {
+        return -1;
+    }
+
+    if (first < 0 || rowCount < 0 || (uint32_t) first + (uint32_t) rowCount > SQCloudRowsetRows(result)) {
+        return -1;
+    }
+
+    uint32_t count;
+    auto int64Values = SQCloudRowsetColumnInt64Array(result, column, &count);
+    if (int64Values) {
+        env->SetLongArrayRegion(longs, 0, rowCount,
+                                reinterpret_cast<const jlong *>(int64Values + first));
+    }
+    auto doubleValues = SQCloudRowsetColumnDoubleArray(result, column, &count);
+    if (doubleValues) {
+        env->SetDoubleArrayRegion(doubles, 0, rowCount, doubleValues + first);
+    }
+
+    const uint32_t *valueLengths;
+    auto values = SQCloudRowsetColumnValueArray(result, column, &valueLengths, &count);
+
+    auto nativeTypes = static_cast<jbyte *>(malloc(rowCount + 1));
+    auto nativeOffsets = static_cast<jint *>(malloc((rowCount + 1) * sizeof(jint)));
+    jint totalLength = 0;
+    for (jint row = 0; row < rowCount; row++) {
+        nativeTypes[row] = (jbyte) SQCloudRowsetValueType(result, first + row, column);
+        nativeOffsets[row] = totalLength;
+        if (values && values[first + row]) {
+            totalLength += (jint) valueLengths[first + row];
+        }
+    }
+    nativeOffsets[rowCount] = totalLength;
+
+    env->SetByteArrayRegion(types, 0, (jsize) rowCount, nativeTypes);
+    env->SetIntArrayRegion(offsets, 0, (jsize) rowCount + 1, nativeOffsets);
+    free(nativeTypes);
+    free(nativeOffsets);
+
+    return totalLength;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultColumnBytes(JNIEnv *env, jobject thiz,
+                                                              jlong wrappedResult, jint column,
+                                                              jint first, jint rowCount,
+                                                              jbyteArray bytes) {
+    // The TEXT/BLOB cells of the rows transferred by rowsetResultColumn, one after the other from
+    // the start of bytes (which is at least as long as the length it returned).
+    auto result = unwrapResult(wrappedResult);
+    const uint32_t *valueLengths;
+    uint32_t count;
+    auto values = SQCloudRowsetColumnValueArray(result, column, &valueLengths, &count);
+    if (!values || (uint32_t) first + (uint32_t) rowCount > count) {
+        return;
+    }
+
+    auto nativeBytes = static_cast<jbyte *>(env->GetPrimitiveArrayCritical(bytes, nullptr));
+    if (!nativeBytes) {
+        return;
+    }
+    jint offset = 0;
+    for (uint32_t row = first; row < (uint32_t) (first + rowCount); row++) {
+        if (values[row]) {
+            memcpy(nativeBytes + offset, values[row], valueLengths[row]);
+            offset += (jint) valueLengths[row];
+        }
+    }
+    env->ReleasePrimitiveArrayCritical(bytes, nativeBytes, 0);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultColumnDictionary(JNIEnv *env, jobject thiz,
+                                                                   jlong wrappedResult, jint column,
+                                                                   jint first, jint rowCount,
+                                                                   jint maxCodes, jbyteArray types,
+                                                                   jintArray codes, jintArray offsets) {
+    // As rowsetResultColumn for a TEXT column with at most maxCodes distinct values: codes gets
+    // the code of each row (-1 for NULL) and offsets the bounds of the distinct values, copied by
+    // rowsetResultColumnDictionaryBytes, so that every value crosses JNI once. Returns the number
+    // of distinct values, or -1 if the column does not qualify and must go through
+    // rowsetResultColumn.
+    TraceSection section("sqlitecloud jni dictionary");
+    auto result = unwrapResult(wrappedResult);
+    if (first < 0 || rowCount < 0 || maxCodes <= 0) {
+        return -1;
+    }
+
+    auto nativeCodes = static_cast<uint32_t *>(malloc((rowCount + 1) * sizeof(uint32_t)));
+    auto firstRows = static_cast<uint32_t *>(malloc(maxCodes * sizeof(uint32_t)));
+    jint count = -1;
+    if (nativeCodes && firstRows) {
+        count = (jint) SQCloudRowsetColumnDictionary(result, column, first, rowCount, maxCodes,
+                                                     nativeCodes, firstRows);
+    }
+    if (count < 0) {
+        free(nativeCodes);
+        free(firstRows);
+        return -1;
+    }
+
+    auto nativeTypes = static_cast<jbyte *>(malloc(rowCount + 1));
+    for (jint row = 0; row < rowCount; row++) {
+        bool isNull = nativeCodes[row] == SQCLOUD_DICTIONARY_NULL;
+        nativeTypes[row] = (jbyte) (isNull ? VALUE_NULL : VALUE_TEXT);
+    }
+
+    auto nativeOffsets = static_cast<jint *>(malloc((count + 1) * sizeof(jint)));
+    jint totalLength = 0;
+    for (jint code = 0; code < count; code++) {
+        nativeOffsets[code] = totalLength;
+        totalLength += (jint) SQCloudRowsetValueLen(result, firstRows[code], column);
+    }
+    nativeOffsets[count] = totalLength;
+
+    env->SetByteArrayRegion(types, 0, (jsize) rowCount, nativeTypes);
+    // SQCLOUD_DICTIONARY_NULL is -1 as a jint.
+    env->SetIntArrayRegion(codes, 0, (jsize) rowCount, reinterpret_cast<const jint *>(nativeCodes));
+    env->SetIntArrayRegion(offsets, 0, (jsize) count + 1, nativeOffsets);
+    free(nativeCodes);
+    free(firstRows);
+    free(nativeTypes);
+    free(nativeOffsets);
+
+    return count;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultColumnDictionaryBytes(JNIEnv *env, jobject thiz,
+                                                                        jlong wrappedResult, jint column,
+                                                                        jint first, jint rowCount,
+                                                                        jintArray codes, jbyteArray bytes) {
+    // The distinct values of the codes returned by rowsetResultColumnDictionary, one after the
+    // other from the start of bytes. Codes are given in order of first appearance, so the value
+    // of a code is the one of the row where it is first met.
+    auto result = unwrapResult(wrappedResult);
+    const uint32_t *valueLengths;
+    uint32_t count;
+    auto values = SQCloudRowsetColumnValueArray(result, column, &valueLengths, &count);
+    if (!values || first < 0 || rowCount < 0 || (uint32_t) first + (uint32_t) rowCount > count) {
+        return;
+    }
+
+    auto nativeCodes = static_cast<jint *>(env->GetPrimitiveArrayCritical(codes, nullptr));
+    if (!nativeCodes) {
+        return;
+    }
+    auto nativeBytes = static_cast<jbyte *>(env->GetPrimitiveArrayCritical(bytes, nullptr));
+    if (nativeBytes) {
+        jint next = 0;
+        jint offset = 0;
+        for (jint row = 0; row < rowCount; row++) {
+            if (nativeCodes[row] != next) continue;
+            uint32_t index = (uint32_t) (first + row);
+            memcpy(nativeBytes + offset, values[index], valueLengths[index]);
+            offset += (jint) valueLengths[index];
+            next++;
+        }
+        env->ReleasePrimitiveArrayCritical(bytes, nativeBytes, 0);
+    }
+    env->ReleasePrimitiveArrayCritical(codes, nativeCodes, JNI_ABORT);
+}
+
+// Puts the cell of row and column into the last row allocated in window, returns false when the
+// window is full (or the put threw).
+static bool putWindowCell(JNIEnv *env, SQCloudResult *result, jobject window, uint32_t row, uint32_t column) {
+    jboolean done;
+    switch (SQCloudRowsetValueType(result, row, column)) {
+        case VALUE_INTEGER:
+            done = env->CallBooleanMethod(window, ids.windowPutLong,
+                                          static_cast<jlong>(SQCloudRowsetInt64Value(result, row, column)),
+                                          (jint) row, (jint) column);
+            break;
+        case VALUE_FLOAT:
+            done = env->CallBooleanMethod(window, ids.windowPutDouble, SQCloudRowsetDoubleValue(result, row, column),
+                                          (jint) row, (jint) column);
+            break;
+        case VALUE_TEXT: {
+            uint32_t length;
+            auto value = SQCloudRowsetValue(result, row, column, &length);
+            auto string = newString(env, value, length);
+            if (!string) return false;
+            done = env->CallBooleanMethod(window, ids.windowPutString, string, (jint) row, (jint) column);
+            env->DeleteLocalRef(string);
+            break;
+        }
+        case VALUE_BLOB: {
+            uint32_t length;
+            auto value = SQCloudRowsetValue(result, row, column, &length);
+            auto bytes = env->NewByteArray((jsize) length);
+            if (!bytes) return false;
+            env->SetByteArrayRegion(bytes, 0, (jsize) length, reinterpret_cast<const jbyte *>(value));
+            done = env->CallBooleanMethod(window, ids.windowPutBlob, bytes, (jint) row, (jint) column);
+            env->DeleteLocalRef(bytes);
+            break;
+        }
+        default:
+            done = env->CallBooleanMethod(window, ids.windowPutNull, (jint) row, (jint) column);
+            break;
+    }
+    return done && !env->ExceptionCheck();
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultRowCount(JNIEnv *env, jobject thiz,
-                                                            jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
-    return SQCloudRowsetRows(result);
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultFillWindow(JNIEnv *env, jobject thiz,
+                                                             jlong wrappedResult, jobject window,
+                                                             jint first) {
+    // Fills an empty CursorWindow, whose start position is first, with the rows from first until
+    // the window is full or the rows run out, and returns the number of rows put: a cursor pages
+    // through the result with one JNI call per window instead of one per cell, and without any
+    // intermediate Kotlin object. A row that does not fit is left out whole.
+    TraceSection section("sqlitecloud jni cursor window");
+    auto result = unwrapResult(wrappedResult);
+    uint32_t rows = SQCloudRowsetRows(result);
+    uint32_t columns = SQCloudRowsetCols(result);
+    if (first < 0 || (uint32_t) first > rows ||
+        !env->CallBooleanMethod(window, ids.windowSetNumColumns, (jint) columns) || env->ExceptionCheck()) {
+        return 0;
+    }
+
+    jint count = 0;
+    for (uint32_t row = (uint32_t) first; row < rows; row++, count++) {
+        if (!env->CallBooleanMethod(window, ids.windowAllocRow) || env->ExceptionCheck()) {
+            break;
+        }
+
+        uint32_t column = 0;
+        while (column < columns && putWindowCell(env, result, window, row, column)) {
+            column++;
+        }
+        if (column < columns) {
+            if (!env->ExceptionCheck()) env->CallVoidMethod(window, ids.windowFreeLastRow);
+            break;
+        }
+    }
+    return count;
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultColumnCount(JNIEnv *env, jobject thiz,
-                                                               jobject wrappedResult) {
-    auto result = unwrapResult(env, wrappedResult);
-    return SQCloudRowsetCols(result);
+struct NativeSelection {
+    const uint32_t *rows;
+    uint32_t count;
+    jint *elements;
+};
+
+// A null selection vector selects every row, Kotlin ints are reinterpreted as row indexes (a
+// negative index becomes out of range and makes the native aggregate fail).
+NativeSelection getNativeSelection(JNIEnv *env, jintArray selection) {
+    NativeSelection nativeSelection = {nullptr, 0, nullptr};
+    if (selection) {
+        nativeSelection.elements = env->GetIntArrayElements(selection, nullptr);
+        nativeSelection.rows = reinterpret_cast<const uint32_t *>(nativeSelection.elements);
+        nativeSelection.count = env->GetArrayLength(selection);
+    }
+    return nativeSelection;
 }
 
-extern "C" JNIEXPORT jstring JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultColumnName(JNIEnv *env, jobject thiz,
-                                                              jobject wrappedResult, jint column) {
-    auto result = unwrapResult(env, wrappedResult);
-    uint32_t columnNameLength;
-    auto columnName = SQCloudRowsetColumnName(result, column, &columnNameLength);
-    return env->NewStringUTF(columnName);
+void releaseNativeSelection(JNIEnv *env, jintArray selection, NativeSelection &nativeSelection) {
+    if (selection) {
+        env->ReleaseIntArrayElements(selection, nativeSelection.elements, JNI_ABORT);
+    }
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultValueType(JNIEnv *env, jobject thiz,
-                                                             jobject wrappedResult, jint row,
-                                                             jint column) {
-    auto result = unwrapResult(env, wrappedResult);
-    return SQCloudRowsetValueType(result, row, column);
+extern "C" JNIEXPORT jdoubleArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetAggregate(JNIEnv *env, jobject thiz,
+                                                      jlong wrappedResult, jint column,
+                                                      jintArray selection) {
+    // Returns [count, sum, min, max] of the numeric cells of the column (min and max are NaN if
+    // count is 0), or null if the aggregates could not be computed.
+    auto result = unwrapResult(wrappedResult);
+    auto nativeSelection = getNativeSelection(env, selection);
+    auto rows = nativeSelection.rows;
+    auto count = nativeSelection.count;
+
+    jdouble values[4] = {0, 0, NAN, NAN};
+    bool success = SQCloudRowsetColumnSum(result, column, rows, count, &values[1]);
+    if (success) {
+        values[0] = SQCloudRowsetColumnCount(result, column, rows, count);
+        if (values[0] > 0) {
+            SQCloudRowsetColumnMin(result, column, rows, count, &values[2]);
+            SQCloudRowsetColumnMax(result, column, rows, count, &values[3]);
+        }
+    }
+    releaseNativeSelection(env, selection, nativeSelection);
+    if (!success) return nullptr;
+
+    auto aggregate = env->NewDoubleArray(4);
+    if (aggregate) env->SetDoubleArrayRegion(aggregate, 0, 4, values);
+    return aggregate;
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetFilter(JNIEnv *env, jobject thiz, jlong wrappedResult,
+                                                   jint column, jint op, jdouble value,
+                                                   jintArray selection) {
+    auto result = unwrapResult(wrappedResult);
+    auto nativeSelection = getNativeSelection(env, selection);
+    uint32_t capacity = selection ? nativeSelection.count : SQCloudRowsetRows(result);
+    auto rows = static_cast<uint32_t *>(malloc(std::max(capacity, 1u) * sizeof(uint32_t)));
+
+    int64_t count = -1;
+    if (rows) {
+        count = SQCloudRowsetColumnFilter(result, column, static_cast<SQCLOUD_COMPARE_OP>(op), value,
+                                          nativeSelection.rows, nativeSelection.count, rows);
+    }
+    releaseNativeSelection(env, selection, nativeSelection);
+
+    jintArray filtered = nullptr;
+    if (count >= 0) {
+        filtered = env->NewIntArray((jsize) count);
+        if (filtered) {
+            env->SetIntArrayRegion(filtered, 0, (jsize) count, reinterpret_cast<const jint *>(rows));
+        }
+    }
+    free(rows);
+    return filtered;
+}
+
+extern "C" JNIEXPORT jdoubleArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetGroupBy(JNIEnv *env, jobject thiz,
+                                                    jlong wrappedResult, jint keyColumn,
+                                                    jint column, jintArray selection) {
+    // Returns six values for each group: [row, count, numbers, sum, min, max], all the counters fit
+    // a double exactly. Returns null if the groups could not be computed.
+    auto result = unwrapResult(wrappedResult);
+    auto nativeSelection = getNativeSelection(env, selection);
+    uint32_t groupCount;
+    auto groups = SQCloudRowsetGroupBy(result, keyColumn, column, nativeSelection.rows,
+                                       nativeSelection.count, &groupCount);
+    releaseNativeSelection(env, selection, nativeSelection);
+    if (!groups) return nullptr;
+
+    auto values = static_cast<jdouble *>(malloc(std::max(groupCount, 1u) * 6 * sizeof(jdouble)));
+    jdoubleArray array = nullptr;
+    if (values) {
+        for (uint32_t i = 0; i < groupCount; i++) {
+            values[i * 6] = groups[i].row;
+            values[i * 6 + 1] = groups[i].count;
+            values[i * 6 + 2] = groups[i].numbers;
+            values[i * 6 + 3] = groups[i].sum;
+            values[i * 6 + 4] = groups[i].min;
+            values[i * 6 + 5] = groups[i].max;
+        }
+        array = env->NewDoubleArray((jsize) groupCount * 6);
+        if (array) env->SetDoubleArrayRegion(array, 0, (jsize) groupCount * 6, values);
+        free(values);
+    }
+    SQCloudRowsetGroupFree(groups);
+    return array;
 }
 
 extern "C" JNIEXPORT jlong JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultLongValue(JNIEnv *env, jobject thiz,
-                                                             jobject wrappedResult, jint row,
-                                                             jint column) {
-    auto result = unwrapResult(env, wrappedResult);
-    return SQCloudRowsetInt64Value(result, row, column);
-}
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetBuildIndex(JNIEnv *env, jobject thiz,
+                                                       jlong wrappedResult, jint column) {
+    return wrapPointer(SQCloudRowsetBuildIndex(unwrapResult(wrappedResult), column));
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetIndexFind(JNIEnv *env, jobject thiz,
+                                                      jlong wrappedIndex, jint type, jlong integer,
+                                                      jdouble real, jbyteArray bytes) {
+    // The key is passed by type: integer, real or the UTF-8/BLOB bytes. Returns every matching
+    // row in ascending order.
+    auto index = unwrapIndex(wrappedIndex);
+    SQCloudValue key = {};
+    key.type = static_cast<SQCLOUD_VALUE_TYPE>(type);
+    jbyte *elements = nullptr;
+    if (key.type == VALUE_INTEGER) {
+        key.i64 = integer;
+    } else if (key.type == VALUE_FLOAT) {
+        key.f64 = real;
+    } else if (bytes) {
+        elements = env->GetByteArrayElements(bytes, nullptr);
+        key.value = reinterpret_cast<const char *>(elements);
+        key.len = env->GetArrayLength(bytes);
+    }
 
+    // The chain is walked twice, to size the array and to fill it.
+    auto first = SQCloudRowsetIndexLookup(index, &key);
+    if (elements) env->ReleaseByteArrayElements(bytes, elements, JNI_ABORT);
 
-extern "C" JNIEXPORT jdouble JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultDoubleValue(JNIEnv *env, jobject thiz,
-                                                               jobject wrappedResult, jint row,
-                                                               jint column) {
-    auto result = unwrapResult(env, wrappedResult);
-    return SQCloudRowsetDoubleValue(result, row, column);
-}
+    jsize count = 0;
+    for (auto row = first; row >= 0; row = SQCloudRowsetIndexNext(index, (uint32_t) row)) count++;
+    auto rows = static_cast<jint *>(malloc(std::max(count, 1) * sizeof(jint)));
+    if (!rows) return nullptr;
 
-extern "C" JNIEXPORT jstring JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultStringValue(JNIEnv *env, jobject thiz,
-                                                               jobject wrappedResult, jint row,
-                                                               jint column) {
-    auto result = unwrapResult(env, wrappedResult);
-    uint32_t valueSize;
-    return env->NewStringUTF(SQCloudRowsetValue(result, row, column, &valueSize));
+    jsize i = 0;
+    for (auto row = first; row >= 0; row = SQCloudRowsetIndexNext(index, (uint32_t) row)) {
+        rows[i++] = (jint) row;
+    }
+    auto array = env->NewIntArray(count);
+    if (array) env->SetIntArrayRegion(array, 0, count, rows);
+    free(rows);
+    return array;
 }
 
-extern "C" JNIEXPORT jobject JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetResultBufferValue(JNIEnv *env, jobject thiz,
-                                                               jobject wrappedResult, jint row,
-                                                               jint column) {
-    auto result = unwrapResult(env, wrappedResult);
-    uint32_t valueSize;
-    auto value = SQCloudRowsetValue(result, row, column, &valueSize);
-    return env->NewDirectByteBuffer(value, valueSize);
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetIndexFree(JNIEnv *env, jobject thiz,
+                                                      jlong wrappedIndex) {
+    SQCloudRowsetIndexFree(unwrapIndex(wrappedIndex));
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetSortedView(JNIEnv *env, jobject thiz,
+                                                       jlong wrappedResult, jintArray columns,
+                                                       jbooleanArray descending) {
+    // Returns the row indexes in sorted order, or null if the rowset could not be sorted.
+    auto result = unwrapResult(wrappedResult);
+    auto count = env->GetArrayLength(columns);
+    auto cols = env->GetIntArrayElements(columns, nullptr);
+    auto desc = static_cast<bool *>(calloc(std::max(count, 1), sizeof(bool)));
+    if (desc && descending) {
+        auto elements = env->GetBooleanArrayElements(descending, nullptr);
+        auto n = std::min(count, env->GetArrayLength(descending));
+        for (jsize i = 0; i < n; i++) desc[i] = elements[i];
+        env->ReleaseBooleanArrayElements(descending, elements, JNI_ABORT);
+    }
+
+    uint32_t *rows = nullptr;
+    if (desc) {
+        rows = SQCloudRowsetSortedView(result, reinterpret_cast<const uint32_t *>(cols), desc, count);
+    }
+    env->ReleaseIntArrayElements(columns, cols, JNI_ABORT);
+    free(desc);
+    if (!rows) return nullptr;
+
+    auto nrows = SQCloudRowsetRows(result);
+    auto array = env->NewIntArray((jsize) nrows);
+    if (array) env->SetIntArrayRegion(array, 0, (jsize) nrows, reinterpret_cast<const jint *>(rows));
+    SQCloudRowsetSortedViewFree(rows);
+    return array;
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
@@ -456,7 +2191,76 @@ Java_io_sqlitecloud_SQLiteCloudBridge_downloadDatabase(JNIEnv *env, jobject thiz
     );
 }
 
-extern "C" JNIEXPORT jobject JNICALL
+struct ProgressData {
+    JNIEnv *env;
+    jobject callback;
+};
+
+int transferProgress(void *data, int64_t total, int64_t progress) {
+    // Invoked on the calling thread. An exception thrown by the callback cancels the transfer and
+    // stays pending, so it is rethrown once the native method returns.
+    auto progressData = static_cast<ProgressData *>(data);
+    auto env = progressData->env;
+    env->CallVoidMethod(progressData->callback, ids.onProgress, (jlong) total, (jlong) progress);
+    return env->ExceptionCheck() ? 1 : 0;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_uploadDatabaseFile(JNIEnv *env, jobject thiz, jstring name,
+                                                          jstring encryption_key, jint fd,
+                                                          jint chunk_size, jobject callback) {
+    ProgressData data = {env, callback};
+    auto nativeName = cString(env, name);
+    auto nativeKey = cString(env, encryption_key);
+    auto uploaded = SQCloudUploadDatabaseFile(getConnection(env, thiz), nativeName, nativeKey, fd,
+                                              chunk_size > 0 ? chunk_size : 0, transferProgress,
+                                              &data);
+    env->ReleaseStringUTFChars(name, nativeName);
+    if (nativeKey) {
+        env->ReleaseStringUTFChars(encryption_key, nativeKey);
+    }
+    return uploaded;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_downloadDatabaseFile(JNIEnv *env, jobject thiz, jstring name,
+                                                            jint fd, jobject callback) {
+    ProgressData data = {env, callback};
+    auto nativeName = cString(env, name);
+    auto downloaded = SQCloudDownloadDatabaseFile(getConnection(env, thiz), nativeName, fd,
+                                                  transferProgress, &data);
+    env->ReleaseStringUTFChars(name, nativeName);
+    return downloaded;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_downloadDatabaseResumable(JNIEnv *env, jobject thiz,
+                                                                 jstring name, jint fd,
+                                                                 jint checkpoint_fd,
+                                                                 jobject callback) {
+    ProgressData data = {env, callback};
+    auto nativeName = cString(env, name);
+    auto downloaded = SQCloudDownloadDatabaseResumable(getConnection(env, thiz), nativeName, fd,
+                                                       checkpoint_fd, transferProgress, &data);
+    env->ReleaseStringUTFChars(name, nativeName);
+    return downloaded;
+}
+
+// Returns the raft index of the synced copy, or -1 on error.
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_syncDatabase(JNIEnv *env, jobject thiz, jstring name,
+                                                    jstring local_path, jlong last_raft_index) {
+    auto nativeName = cString(env, name);
+    auto nativePath = cString(env, local_path);
+    uint64_t raftIndex = 0;
+    auto synced = SQCloudSyncDatabase(getConnection(env, thiz), nativeName, nativePath,
+                                      (uint64_t) last_raft_index, &raftIndex);
+    env->ReleaseStringUTFChars(name, nativeName);
+    env->ReleaseStringUTFChars(local_path, nativePath);
+    return synced ? (jlong) raftIndex : -1;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_openBlob(JNIEnv *env, jobject thiz, jstring schema,
                                                 jstring table, jstring column, jlong row_id,
                                                 jboolean read_write) {
@@ -468,233 +2272,777 @@ Java_io_sqlitecloud_SQLiteCloudBridge_openBlob(JNIEnv *env, jobject thiz, jstrin
             row_id,
             read_write
     );
-    return wrapPointer(env, handle);
+    return wrapPointer(handle);
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_blobSizes(JNIEnv *env, jobject thiz, jstring schema,
+                                                 jstring table, jstring column, jlongArray row_ids) {
+    auto n = env->GetArrayLength(row_ids);
+    auto rowIds = env->GetLongArrayElements(row_ids, nullptr);
+    auto sizes = static_cast<jlong *>(malloc(std::max(n, 1) * sizeof(jlong)));
+    auto nativeSchema = cString(env, schema);
+    auto nativeTable = cString(env, table);
+    auto nativeColumn = cString(env, column);
+
+    bool success = sizes && SQCloudBlobSizes(getConnection(env, thiz), nativeSchema, nativeTable,
+                                             nativeColumn, reinterpret_cast<const int64_t *>(rowIds),
+                                             static_cast<uint32_t>(n), reinterpret_cast<int64_t *>(sizes));
+
+    if (nativeSchema) env->ReleaseStringUTFChars(schema, nativeSchema);
+    env->ReleaseStringUTFChars(table, nativeTable);
+    env->ReleaseStringUTFChars(column, nativeColumn);
+    env->ReleaseLongArrayElements(row_ids, rowIds, JNI_ABORT);
+
+    jlongArray array = nullptr;
+    if (success) {
+        array = env->NewLongArray(n);
+        env->SetLongArrayRegion(array, 0, n, sizes);
+    }
+    free(sizes);
+    return array;
+}
+
+struct BlobRowsData {
+    JNIEnv *env;
+    jobject callback;
+    SQCloudConnection *connection;
+};
+
+int blobRowsProgress(void *data, uint32_t row, int errcode, int64_t total, int64_t progress) {
+    // Invoked on the calling thread, the error message of a failed row is the connection error. An
+    // exception thrown by the callback stops the writes and stays pending, like transferProgress.
+    auto rowsData = static_cast<BlobRowsData *>(data);
+    auto env = rowsData->env;
+    jstring message = errcode ? env->NewStringUTF(SQCloudErrorMsg(rowsData->connection)) : nullptr;
+    env->CallVoidMethod(rowsData->callback, ids.onBlobRow, static_cast<jint>(row), errcode, message,
+                        (jlong) total, (jlong) progress);
+    if (message) env->DeleteLocalRef(message);
+    return env->ExceptionCheck() ? 1 : 0;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_writeBlobRows(JNIEnv *env, jobject thiz, jstring schema,
+                                                    jstring table, jstring column, jlongArray row_ids,
+                                                    jobjectArray buffers, jintArray fds,
+                                                    jintArray lengths, jint chunk_size, jint window,
+                                                    jobject callback) {
+    // A row is written from its direct buffer, or from its file descriptor when the buffer is null.
+    auto connection = getConnection(env, thiz);
+    auto n = env->GetArrayLength(row_ids);
+    auto rows = static_cast<SQCloudBlobWriteRow *>(malloc(std::max(n, 1) * sizeof(SQCloudBlobWriteRow)));
+    if (!rows) return false;
+
+    auto rowIds = env->GetLongArrayElements(row_ids, nullptr);
+    auto nativeFds = env->GetIntArrayElements(fds, nullptr);
+    auto nativeLengths = env->GetIntArrayElements(lengths, nullptr);
+    for (jsize i = 0; i < n; ++i) {
+        auto buffer = env->GetObjectArrayElement(buffers, i);
+        rows[i].rowid = rowIds[i];
+        rows[i].buffer = buffer ? env->GetDirectBufferAddress(buffer) : nullptr;
+        rows[i].fd = nativeFds[i];
+        rows[i].foffset = 0;
+        rows[i].len = static_cast<uint32_t>(nativeLengths[i]);
+        if (buffer) env->DeleteLocalRef(buffer);
+    }
+    env->ReleaseLongArrayElements(row_ids, rowIds, JNI_ABORT);
+    env->ReleaseIntArrayElements(fds, nativeFds, JNI_ABORT);
+    env->ReleaseIntArrayElements(lengths, nativeLengths, JNI_ABORT);
+
+    BlobRowsData data = {env, callback, connection};
+    auto nativeSchema = cString(env, schema);
+    auto nativeTable = cString(env, table);
+    auto nativeColumn = cString(env, column);
+    bool success = SQCloudBlobWriteRows(connection, nativeSchema, nativeTable, nativeColumn, rows,
+                                        static_cast<uint32_t>(n),
+                                        static_cast<uint32_t>(chunk_size > 0 ? chunk_size : 0),
+                                        static_cast<uint32_t>(window > 0 ? window : 0),
+                                        blobRowsProgress, &data);
+
+    if (nativeSchema) env->ReleaseStringUTFChars(schema, nativeSchema);
+    env->ReleaseStringUTFChars(table, nativeTable);
+    env->ReleaseStringUTFChars(column, nativeColumn);
+    free(rows);
+    return success;
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_reopenBlob(JNIEnv *env, jobject thiz, jobject handle,
+Java_io_sqlitecloud_SQLiteCloudBridge_reopenBlob(JNIEnv *env, jobject thiz, jlong handle,
                                                   jlong row_id) {
-    return SQCloudBlobReOpen(unwrapBlob(env, handle), row_id);
+    return SQCloudBlobReOpen(unwrapBlob(handle), row_id);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_closeBlob(JNIEnv *env, jobject thiz, jobject handle) {
-    return SQCloudBlobClose(unwrapBlob(env, handle));
+Java_io_sqlitecloud_SQLiteCloudBridge_closeBlob(JNIEnv *env, jobject thiz, jlong handle) {
+    return SQCloudBlobClose(unwrapBlob(handle));
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_blobFieldSize(JNIEnv *env, jobject thiz, jobject handle) {
-    return SQCloudBlobBytes(unwrapBlob(env, handle));
+Java_io_sqlitecloud_SQLiteCloudBridge_blobFieldSize(JNIEnv *env, jobject thiz, jlong handle) {
+    return SQCloudBlobBytes(unwrapBlob(handle));
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_readBlob(JNIEnv *env, jobject thiz, jobject handle,
+Java_io_sqlitecloud_SQLiteCloudBridge_readBlob(JNIEnv *env, jobject thiz, jlong handle,
                                                 jobject buffer) {
+    TraceSection section("sqlitecloud jni blob read");
     return SQCloudBlobRead(
-            unwrapBlob(env, handle),
+            unwrapBlob(handle),
             env->GetDirectBufferAddress(buffer),
             env->GetDirectBufferCapacity(buffer),
             0
     );
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_openBlobStream(JNIEnv *env, jobject thiz, jlong handle,
+                                                      jint chunk_size, jint read_ahead) {
+    auto stream = SQCloudBlobStreamOpen(unwrapBlob(handle), chunk_size,
+                                        static_cast<uint32_t>(read_ahead > 0 ? read_ahead : 0));
+    return wrapPointer(stream);
+}
+
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_writeBlob(JNIEnv *env, jobject thiz, jobject handle,
-                                                 jobject buffer) {
-    auto result = SQCloudBlobWrite(
-            unwrapBlob(env, handle),
-            env->GetDirectBufferAddress(buffer),
-            env->GetDirectBufferCapacity(buffer),
-            0
-    );
-    return result;
+Java_io_sqlitecloud_SQLiteCloudBridge_readBlobStream(JNIEnv *env, jobject thiz, jlong stream,
+                                                      jobject buffer, jint position, jint length) {
+    auto address = static_cast<char *>(env->GetDirectBufferAddress(buffer));
+    return SQCloudBlobStreamRead(unwrapBlobStream(stream), address + position, length);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindInt(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_closeBlobStream(JNIEnv *env, jobject thiz, jlong stream) {
+    return SQCloudBlobStreamClose(unwrapBlobStream(stream));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindInt(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                  jint row_index, jint value) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindInt(vm, row_index, value);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindInt64(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindInt64(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                    jint row_index, jlong value) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindInt64(vm, row_index, value);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindDouble(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindDouble(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                     jint row_index, jdouble value) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindDouble(vm, row_index, value);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindText(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindText(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                   jint row_index, jstring value, jint byteSize) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindText(vm, row_index, cString(env, value),
                              byteSize);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindBlob(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindBlob(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                   jint row_index, jobject value) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindBlob(vm, row_index,
-                             unwrapPointer(env, value), env->GetDirectBufferCapacity(value));
+                             env->GetDirectBufferAddress(value), env->GetDirectBufferCapacity(value));
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindZeroBlob(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindZeroBlob(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                       jint row_index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindZeroBlob(vm, row_index, 0);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindNull(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindNull(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                   jint row_index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindNull(vm, row_index);
 }
 
-extern "C" JNIEXPORT jobject JNICALL
+extern "C" JNIEXPORT jlong JNICALL
 Java_io_sqlitecloud_SQLiteCloudBridge_vmCompile(JNIEnv *env, jobject thiz, jstring query) {
     auto result = SQCloudVMCompile(getConnection(env, thiz), cString(env, query), -1,
                                    nullptr);
-    return wrapPointer(env, result);
+    return wrapPointer(result);
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmCompileMany(JNIEnv *env, jobject thiz, jobjectArray queries) {
+    // One handle per query, 0 for the queries that failed: the connection error is the one of the
+    // first of them. The queries are copied, so every JNI reference is released at once.
+    jsize count = env->GetArrayLength(queries);
+    auto sqls = static_cast<char **>(calloc(count + 1, sizeof(char *)));
+    auto vms = static_cast<SQCloudVM **>(calloc(count + 1, sizeof(SQCloudVM *)));
+    bool copied = sqls && vms;
+    for (jsize i = 0; copied && i < count; i++) {
+        auto query = static_cast<jstring>(env->GetObjectArrayElement(queries, i));
+        auto command = cString(env, query);
+        sqls[i] = command ? strdup(command) : nullptr;
+        copied = sqls[i] != nullptr;
+        if (command) env->ReleaseStringUTFChars(query, command);
+        env->DeleteLocalRef(query);
+    }
+
+    jlongArray handles = nullptr;
+    if (copied) {
+        SQCloudVMCompileMany(getConnection(env, thiz), const_cast<const char **>(sqls), nullptr,
+                             (uint32_t) count, vms);
+        auto wrapped = static_cast<jlong *>(malloc((count + 1) * sizeof(jlong)));
+        handles = wrapped ? env->NewLongArray(count) : nullptr;
+        for (jsize i = 0; i < count; i++) {
+            if (handles) {
+                wrapped[i] = wrapPointer(vms[i]);
+            } else if (vms[i]) {
+                SQCloudVMClose(vms[i]);
+            }
+        }
+        if (handles) env->SetLongArrayRegion(handles, 0, count, wrapped);
+        free(wrapped);
+    }
+
+    for (jsize i = 0; sqls && i < count; i++) free(sqls[i]);
+    free(sqls);
+    free(vms);
+    return handles;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setStatementCacheSize(JNIEnv *env, jobject thiz, jint size) {
+    SQCloudSetVMCache(getConnection(env, thiz), size > 0 ? size : 0, 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setAutoParameterize(JNIEnv *env, jobject thiz, jint count) {
+    SQCloudSetAutoParameterize(getConnection(env, thiz), count > 0 ? count : 0);
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_statementCacheStats(JNIEnv *env, jobject thiz) {
+    uint32_t hits, misses;
+    SQCloudVMCacheStats(getConnection(env, thiz), &hits, &misses);
+
+    jint stats[2] = {static_cast<jint>(hits), static_cast<jint>(misses)};
+    auto array = env->NewIntArray(2);
+    env->SetIntArrayRegion(array, 0, 2, stats);
+    return array;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_transferChecksum(JNIEnv *env, jobject thiz) {
+    return static_cast<jint>(SQCloudTransferChecksum(getConnection(env, thiz)));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setResultPoolSize(JNIEnv *env, jobject thiz, jint bytes) {
+    SQCloudSetMemoryPool(getConnection(env, thiz), bytes > 0 ? static_cast<size_t>(bytes) : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setAdaptiveChunks(JNIEnv *env, jobject thiz, jint min_rows, jint max_rows,
+                                                        jint target_ms) {
+    SQCloudSetAdaptiveChunks(getConnection(env, thiz), min_rows > 0 ? min_rows : 0, max_rows > 0 ? max_rows : 0,
+                             target_ms > 0 ? target_ms : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setUploadCompression(JNIEnv *env, jobject thiz, jint min_size) {
+    SQCloudSetUploadCompression(getConnection(env, thiz), min_size > 0 ? min_size : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setDownloadWindow(JNIEnv *env, jobject thiz, jint window) {
+    SQCloudSetDownloadWindow(getConnection(env, thiz), window > 0 ? window : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setDownloadCompression(JNIEnv *env, jobject thiz, jboolean enabled) {
+    SQCloudSetDownloadCompression(getConnection(env, thiz), enabled == JNI_TRUE);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_primeCompressionDictionary(JNIEnv *env, jobject thiz, jint size) {
+    SQCloudPrimeCompressionDictionary(getConnection(env, thiz), size > 0 ? size : 0);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setCompressionDictionary(JNIEnv *env, jobject thiz, jbyteArray dictionary) {
+    // not a critical region: the dictionary is sent to the server before it is released
+    jsize length = env->GetArrayLength(dictionary);
+    jbyte *bytes = env->GetByteArrayElements(dictionary, nullptr);
+    if (!bytes) return false;
+    bool rc = SQCloudSetCompressionDictionary(getConnection(env, thiz), bytes, (uint32_t) length);
+    env->ReleaseByteArrayElements(dictionary, bytes, JNI_ABORT);
+    return rc;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setHeaderCache(JNIEnv *env, jobject thiz, jint slots) {
+    SQCloudSetHeaderCache(getConnection(env, thiz), slots > 0 ? slots : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setSpill(JNIEnv *env, jobject thiz, jstring directory,
+                                               jint threshold) {
+    auto nativeDirectory = cString(env, directory);
+    SQCloudSetSpill(getConnection(env, thiz), nativeDirectory, threshold > 0 ? threshold : 0);
+    if (nativeDirectory) {
+        env->ReleaseStringUTFChars(directory, nativeDirectory);
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setMemoryBudget(JNIEnv *env, jobject thiz, jlong soft, jlong hard) {
+    SQCloudSetMemoryBudget(getConnection(env, thiz), soft > 0 ? soft : 0, hard > 0 ? hard : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setProcessMemoryBudget(JNIEnv *env, jclass clazz, jlong soft,
+                                                             jlong hard) {
+    SQCloudSetProcessMemoryBudget(soft > 0 ? soft : 0, hard > 0 ? hard : 0);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_initialize(
+        JNIEnv *env,
+        jclass clazz,
+        jstring hostname,
+        jint port,
+        jint family,
+        jstring tls_root_certificate,
+        jstring tls_certificate,
+        jstring tls_certificate_key,
+        jstring tls_ciphers,
+        jboolean insecure
+) {
+    SQCloudConfig config = {
+            .family = family,
+            .tls_root_certificate = cString(env, tls_root_certificate),
+            .tls_certificate = cString(env, tls_certificate),
+            .tls_certificate_key = cString(env, tls_certificate_key),
+            .tls_ciphers = cString(env, tls_ciphers),
+            .insecure = static_cast<bool>(insecure),
+    };
+    auto host = cString(env, hostname);
+
+    bool result = SQCloudInitialize(host, port, &config);
+
+    // unlike the connection configs, this one does not outlive the call
+    auto release = [env](jstring string, const char *chars) {
+        if (chars) env->ReleaseStringUTFChars(string, chars);
+    };
+    release(hostname, host);
+    release(tls_root_certificate, config.tls_root_certificate);
+    release(tls_certificate, config.tls_certificate);
+    release(tls_certificate_key, config.tls_certificate_key);
+    release(tls_ciphers, config.tls_ciphers);
+    return result;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setResolvedAddresses(JNIEnv *env, jclass clazz, jstring hostname,
+                                                           jint port, jstring addresses) {
+    auto host = cString(env, hostname);
+    auto list = cString(env, addresses);
+    bool result = SQCloudSetResolvedAddresses(host, port, list);
+    if (host) env->ReleaseStringUTFChars(hostname, host);
+    if (list) env->ReleaseStringUTFChars(addresses, list);
+    return result;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setNetwork(JNIEnv *env, jclass clazz, jlong handle) {
+    SQCloudSetNetwork(static_cast<uint64_t>(handle));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setChunkWorkers(JNIEnv *env, jobject thiz, jint workers) {
+    SQCloudSetChunkWorkers(getConnection(env, thiz), workers > 0 ? workers : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setParallelParse(JNIEnv *env, jobject thiz, jint min_bytes) {
+    SQCloudSetParallelParse(getConnection(env, thiz), min_bytes > 0 ? min_bytes : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setCompressionPolicy(JNIEnv *env, jobject thiz, jint min_size,
+                                                           jint network_class) {
+    SQCloudSetCompressionPolicy(getConnection(env, thiz), min_size > 0 ? min_size : 0,
+                                static_cast<SQCLOUD_NETWORK_CLASS>(network_class));
+}
+
+// The decompression rate, the cost of a call and the ratio of the calibration, or null if it failed.
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_compressionCalibrate(JNIEnv *env, jclass clazz, jint budget_ms) {
+    SQCloudCompressionCalibration calibration;
+    if (!SQCloudCompressionCalibrate(&calibration, budget_ms > 0 ? budget_ms : 0)) return nullptr;
+
+    jlong values[3] = {static_cast<jlong>(calibration.decompress_rate),
+                       static_cast<jlong>(calibration.decompress_call_ns),
+                       static_cast<jlong>(calibration.ratio)};
+    auto array = env->NewLongArray(3);
+    env->SetLongArrayRegion(array, 0, 3, values);
+    return array;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setCompressionCalibration(JNIEnv *env, jclass clazz,
+                                                                jlong decompress_rate,
+                                                                jint decompress_call_ns) {
+    if (decompress_rate <= 0) {
+        SQCloudSetCompressionCalibration(nullptr);
+        return;
+    }
+    SQCloudCompressionCalibration calibration = {static_cast<uint64_t>(decompress_rate),
+                                                 static_cast<uint32_t>(decompress_call_ns > 0 ? decompress_call_ns : 0), 0};
+    SQCloudSetCompressionCalibration(&calibration);
+}
+
+// The minimum reply size and the ratio of the compression policy, then 1 if they are calibrated.
+extern "C" JNIEXPORT jintArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_compressionThreshold(JNIEnv *env, jobject thiz) {
+    uint32_t min_size, ratio_max;
+    bool calibrated = SQCloudCompressionThreshold(getConnection(env, thiz), &min_size, &ratio_max);
+
+    jint values[3] = {static_cast<jint>(min_size), static_cast<jint>(ratio_max), calibrated ? 1 : 0};
+    auto array = env->NewIntArray(3);
+    env->SetIntArrayRegion(array, 0, 3, values);
+    return array;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_compressionStats(JNIEnv *env, jobject thiz) {
+    uint64_t compressed;
+    int64_t saved;
+    SQCloudCompressionStats(getConnection(env, thiz), &compressed, &saved);
+
+    jlong stats[2] = {static_cast<jlong>(compressed), static_cast<jlong>(saved)};
+    auto array = env->NewLongArray(2);
+    env->SetLongArrayRegion(array, 0, 2, stats);
+    return array;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_connectionStats(JNIEnv *env, jobject thiz) {
+    SQCloudStats stats;
+    SQCloudConnectionStats(getConnection(env, thiz), &stats);
+
+    // The counters in the order of SQCloudStats, the client error counters last.
+    jlong values[25 + SQCLOUD_STATS_ERRCODES] = {
+            static_cast<jlong>(stats.commands), static_cast<jlong>(stats.replies),
+            static_cast<jlong>(stats.round_trips), static_cast<jlong>(stats.bytes_out),
+            static_cast<jlong>(stats.bytes_out_raw), static_cast<jlong>(stats.bytes_in),
+            static_cast<jlong>(stats.bytes_in_raw), static_cast<jlong>(stats.read_calls),
+            static_cast<jlong>(stats.write_calls), static_cast<jlong>(stats.tls_records_out),
+            static_cast<jlong>(stats.chunked_rowsets), static_cast<jlong>(stats.chunks),
+            static_cast<jlong>(stats.reconnects), static_cast<jlong>(stats.errors_server),
+            static_cast<jlong>(stats.link_rate),
+    };
+    allocationValues(stats.allocations, &values[15]);
+    for (int i = 0; i < SQCLOUD_STATS_ERRCODES; i++) {
+        values[25 + i] = static_cast<jlong>(stats.errors[i]);
+    }
+
+    auto array = env->NewLongArray(25 + SQCLOUD_STATS_ERRCODES);
+    env->SetLongArrayRegion(array, 0, 25 + SQCLOUD_STATS_ERRCODES, values);
+    return array;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setAllocationCounters(JNIEnv *env, jobject thiz, jboolean enabled) {
+    SQCloudSetAllocationCounters(getConnection(env, thiz), enabled);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_setLatencyHistograms(JNIEnv *env, jobject thiz, jboolean enabled) {
+    SQCloudSetLatencyHistograms(getConnection(env, thiz), enabled);
+}
+
+// The histograms of the SQCLOUD_LATENCY_CLASS values one after the other.
+extern "C" JNIEXPORT jintArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_latencyHistograms(JNIEnv *env, jobject thiz) {
+    auto connection = getConnection(env, thiz);
+    auto array = env->NewIntArray(LATENCY_CLASSES * SQCLOUD_LATENCY_BUCKETS);
+    jint counters[SQCLOUD_LATENCY_BUCKETS];
+    for (int i = 0; i < LATENCY_CLASSES; i++) {
+        SQCloudLatencySnapshot(connection, static_cast<SQCLOUD_LATENCY_CLASS>(i),
+                               reinterpret_cast<uint32_t *>(counters));
+        env->SetIntArrayRegion(array, i * SQCLOUD_LATENCY_BUCKETS, SQCLOUD_LATENCY_BUCKETS, counters);
+    }
+    return array;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_tlsCipher(JNIEnv *env, jobject thiz) {
+    auto cipher = SQCloudTLSCipher(getConnection(env, thiz));
+    return cipher ? env->NewStringUTF(cipher) : nullptr;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_memoryUsage(JNIEnv *env, jobject thiz) {
+    int64_t connection;
+    int64_t process;
+    SQCloudMemoryUsage(getConnection(env, thiz), &connection, &process);
+
+    jlong usage[2] = {static_cast<jlong>(connection), static_cast<jlong>(process)};
+    auto array = env->NewLongArray(2);
+    env->SetLongArrayRegion(array, 0, 2, usage);
+    return array;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_trimMemory(JNIEnv *env, jobject thiz) {
+    SQCloudConnectionTrimMemory(getConnection(env, thiz));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_memoryPressure(JNIEnv *env, jobject thiz, jint level) {
+    SQCloudMemoryPressure(getConnection(env, thiz), static_cast<SQCLOUD_MEMORY_PRESSURE>(level));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmSetFetchRows(JNIEnv *env, jobject thiz, jlong wrappedVM,
+                                                      jint rows) {
+    SQCloudVMSetFetchRows(unwrapVM(wrappedVM), rows);
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmStep(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+Java_io_sqlitecloud_SQLiteCloudBridge_vmStep(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     auto result = SQCloudVMStep(vm);
     return result;
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmFetchRows(JNIEnv *env, jobject thiz, jlong wrappedVM,
+                                                  jint maxRows) {
+    // The rows of vmResult visited by up to maxRows steps, as the first row in the high 32 bits
+    // and their count in the low ones, or -1 on error.
+    uint32_t first;
+    auto count = SQCloudVMFetchRows(unwrapVM(wrappedVM), (maxRows > 0) ? (uint32_t) maxRows : 0, &first);
+    if (count < 0) {
+        return -1;
+    }
+    return (static_cast<jlong>(first) << 32) | static_cast<jlong>(count);
+}
+
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmClose(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+Java_io_sqlitecloud_SQLiteCloudBridge_vmClose(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMClose(vm);
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnCount(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmReset(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
+    return SQCloudVMReset(vm);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmClearBindings(JNIEnv *env, jobject thiz,
+                                                       jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
+    return SQCloudVMClearBindings(vm);
+}
+
+static jint JNICALL
+accessorVMColumnCount(jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMColumnCount(vm);
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmLastRowID(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+static jlong JNICALL
+accessorVMLastRowID(jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMLastRowID(vm);
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmChanges(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+static jlong JNICALL
+accessorVMChanges(jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMChanges(vm);
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmTotalChanges(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+static jlong JNICALL
+accessorVMTotalChanges(jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMTotalChanges(vm);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmIsReadOnly(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+Java_io_sqlitecloud_SQLiteCloudBridge_vmIsReadOnly(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMIsReadOnly(vm);
 }
 
 extern "C"
 JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmIsExplain(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+Java_io_sqlitecloud_SQLiteCloudBridge_vmIsExplain(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMIsExplain(vm);
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmIsFinalized(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+Java_io_sqlitecloud_SQLiteCloudBridge_vmIsFinalized(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMIsFinalized(vm);
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindParameterCount(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindParameterCount(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindParameterCount(vm);
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindParameterIndex(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindParameterIndex(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                             jstring name) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMBindParameterIndex(vm, cString(env, name));
 }
 
 extern "C" JNIEXPORT jstring JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmBindParameterName(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmBindParameterName(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                            jint index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return env->NewStringUTF(SQCloudVMBindParameterName(vm, index));
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnType(JNIEnv *env, jobject thiz, jobject wrappedVM,
-                                                    jint index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+static jint JNICALL
+accessorVMColumnType(jlong wrappedVM, jint index) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMColumnType(vm, index);
 }
 
-extern "C" JNIEXPORT jobject JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmResult(JNIEnv *env, jobject thiz, jobject wrappedVM) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmResult(JNIEnv *env, jobject thiz, jlong wrappedVM) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     auto result = SQCloudVMResult(vm);
-    return wrapPointer(env, result);
+    return wrapPointer(result);
 }
 
 extern "C" JNIEXPORT jstring JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_rowsetColumnName(JNIEnv *env, jobject thiz, jobject wrappedResult,
+Java_io_sqlitecloud_SQLiteCloudBridge_rowsetColumnName(JNIEnv *env, jobject thiz, jlong wrappedResult,
                                                         jint index) {
-    auto result = unwrapResult(env, wrappedResult);
+    auto result = unwrapResult(wrappedResult);
     uint32_t nameLength;
     auto name = SQCloudRowsetColumnName(result, index, &nameLength);
-    return env->NewStringUTF(name);
+    return newString(env, name, nameLength);
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnInt64(JNIEnv *env, jobject thiz, jobject wrappedVM,
-                                                     jint index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+static jlong JNICALL
+accessorVMColumnInt64(jlong wrappedVM, jint index) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMColumnInt64(vm, index);
 }
 
-extern "C" JNIEXPORT jdouble JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnDouble(JNIEnv *env, jobject thiz, jobject wrappedVM,
-                                                      jint index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+static jdouble JNICALL
+accessorVMColumnDouble(jlong wrappedVM, jint index) {
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     return SQCloudVMColumnDouble(vm, index);
 }
 
 extern "C" JNIEXPORT jstring JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnText(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnText(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                     jint index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     uint32_t textLength;
     auto text = SQCloudVMColumnText(vm, index, &textLength);
-    return env->NewStringUTF(text);
+    return newString(env, text, textLength);
 }
 
 extern "C" JNIEXPORT jobject JNICALL
-Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnBlob(JNIEnv *env, jobject thiz, jobject wrappedVM,
+Java_io_sqlitecloud_SQLiteCloudBridge_vmColumnBlob(JNIEnv *env, jobject thiz, jlong wrappedVM,
                                                     jint index) {
-    SQCloudVM *vm = unwrapVM(env, wrappedVM);
+    SQCloudVM *vm = unwrapVM(wrappedVM);
     uint32_t blobLength;
     auto blob = SQCloudVMColumnBlob(vm, index, &blobLength);
     return env->NewDirectByteBuffer(const_cast<void *>(blob), blobLength);
 }
+
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_io_sqlitecloud_SQLiteCloudBridge_vmCurrentRow(JNIEnv *env, jobject thiz, jlong wrappedVM,
+                                                    jbyteArray types, jlongArray longs,
+                                                    jdoubleArray doubles, jintArray offsets) {
+    // Same layout as rowsetResultColumn, for the cells of the current VM row (the arrays are sized
+    // on the column count), so that a row is read with one JNI call instead of two per column.
+    SQCloudVM *vm = unwrapVM(wrappedVM);
+    auto columnCount = env->GetArrayLength(types);
+
+    auto nativeTypes = static_cast<jbyte *>(malloc(columnCount + 1));
+    auto nativeLongs = static_cast<jlong *>(malloc((columnCount + 1) * sizeof(jlong)));
+    auto nativeDoubles = static_cast<jdouble *>(malloc((columnCount + 1) * sizeof(jdouble)));
+    auto nativeOffsets = static_cast<jint *>(malloc((columnCount + 1) * sizeof(jint)));
+    jint totalLength = 0;
+    for (jsize column = 0; column < columnCount; column++) {
+        auto type = SQCloudVMColumnType(vm, column);
+        nativeTypes[column] = (jbyte) type;
+        nativeLongs[column] = (type == VALUE_INTEGER) ? SQCloudVMColumnInt64(vm, column) : 0;
+        nativeDoubles[column] = (type == VALUE_FLOAT) ? SQCloudVMColumnDouble(vm, column) : 0;
+        nativeOffsets[column] = totalLength;
+        if (type == VALUE_TEXT || type == VALUE_BLOB) {
+            totalLength += (jint) SQCloudVMColumnLen(vm, column);
+        }
+    }
+    nativeOffsets[columnCount] = totalLength;
+
+    auto bytes = env->NewByteArray(totalLength);
+    if (bytes) {
+        auto nativeBytes = static_cast<jbyte *>(env->GetPrimitiveArrayCritical(bytes, nullptr));
+        for (jsize column = 0; column < columnCount; column++) {
+            auto length = nativeOffsets[column + 1] - nativeOffsets[column];
+            if (length > 0) {
+                uint32_t valueLength;
+                auto value = SQCloudVMColumnBlob(vm, column, &valueLength);
+                memcpy(nativeBytes + nativeOffsets[column], value, length);
+            }
+        }
+        env->ReleasePrimitiveArrayCritical(bytes, nativeBytes, 0);
+    }
+
+    env->SetByteArrayRegion(types, 0, columnCount, nativeTypes);
+    env->SetLongArrayRegion(longs, 0, columnCount, nativeLongs);
+    env->SetDoubleArrayRegion(doubles, 0, columnCount, nativeDoubles);
+    env->SetIntArrayRegion(offsets, 0, columnCount + 1, nativeOffsets);
+    free(nativeTypes);
+    free(nativeLongs);
+    free(nativeDoubles);
+    free(nativeOffsets);
+
+    return bytes;
+}
+
+jint registerAccessors(JNIEnv *env) {
+    // The @CriticalNative methods of SQLiteCloudAccessors have no JNIEnv nor jclass parameters, they
+    // are registered explicitly instead of being looked up by name.
+    static const JNINativeMethod methods[] = {
+        {"resultType", "(J)I", reinterpret_cast<void *>(accessorResultType)},
+        {"resultLength", "(J)I", reinterpret_cast<void *>(accessorResultLength)},
+        {"resultIsChunked", "(J)Z", reinterpret_cast<void *>(accessorResultIsChunked)},
+        {"rowsetResultRowCount", "(J)I", reinterpret_cast<void *>(accessorRowsetResultRowCount)},
+        {"rowsetResultColumnCount", "(J)I", reinterpret_cast<void *>(accessorRowsetResultColumnCount)},
+        {"rowsetResultValueType", "(JII)I", reinterpret_cast<void *>(accessorRowsetResultValueType)},
+        {"rowsetResultLongValue", "(JII)J", reinterpret_cast<void *>(accessorRowsetResultLongValue)},
+        {"rowsetResultDoubleValue", "(JII)D", reinterpret_cast<void *>(accessorRowsetResultDoubleValue)},
+        {"vmColumnCount", "(J)I", reinterpret_cast<void *>(accessorVMColumnCount)},
+        {"vmColumnType", "(JI)I", reinterpret_cast<void *>(accessorVMColumnType)},
+        {"vmColumnInt64", "(JI)J", reinterpret_cast<void *>(accessorVMColumnInt64)},
+        {"vmColumnDouble", "(JI)D", reinterpret_cast<void *>(accessorVMColumnDouble)},
+        {"vmLastRowID", "(J)J", reinterpret_cast<void *>(accessorVMLastRowID)},
+        {"vmChanges", "(J)J", reinterpret_cast<void *>(accessorVMChanges)},
+        {"vmTotalChanges", "(J)J", reinterpret_cast<void *>(accessorVMTotalChanges)},
+    };
+    auto accessorsClass = env->FindClass("io/sqlitecloud/SQLiteCloudAccessors");
+    if (!accessorsClass) {
+        return JNI_ERR;
+    }
+    auto registered = env->RegisterNatives(accessorsClass, methods, sizeof(methods) / sizeof(methods[0]));
+    env->DeleteLocalRef(accessorsClass);
+    return registered;
+}
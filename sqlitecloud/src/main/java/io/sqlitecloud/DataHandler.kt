@@ -32,14 +32,14 @@ class DataHandler(path: Path, val progressHandler: ProgressHandler) {
 
     fun read(
         buffer: ByteBuffer?,
-        bufferLength: OpaquePointer<Int>?,
+        bufferLength: ByteBuffer?,
         totalLength: Long,
         previouslyReadLength: Long,
     ) = transfer(mode = Mode.Read, buffer, bufferLength, totalLength, previouslyReadLength)
 
     fun write(
         buffer: ByteBuffer?,
-        bufferLength: OpaquePointer<Int>?,
+        bufferLength: ByteBuffer?,
         totalLength: Long,
         previouslyReadLength: Long,
     ) = transfer(mode = Mode.Write, buffer, bufferLength, totalLength, previouslyReadLength)
@@ -47,7 +47,7 @@ class DataHandler(path: Path, val progressHandler: ProgressHandler) {
     private fun transfer(
         mode: Mode,
         buffer: ByteBuffer?,
-        bufferLength: OpaquePointer<Int>?,
+        bufferLength: ByteBuffer?,
         totalLength: Long,
         previouslyReadLength: Long,
     ): DataTransferResult {
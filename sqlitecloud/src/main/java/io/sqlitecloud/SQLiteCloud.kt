@@ -1,18 +1,56 @@
 package io.sqlitecloud
 
+import android.content.ComponentCallbacks2
 import android.content.Context
+import android.content.res.Configuration
+import android.net.ConnectivityManager
+import android.net.Network
+import android.os.ParcelFileDescriptor
 import android.util.Log
+import kotlinx.coroutines.CompletableDeferred
 import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.CoroutineStart
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.NonCancellable
+import kotlinx.coroutines.asCoroutineDispatcher
+import kotlinx.coroutines.cancelAndJoin
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.MutableSharedFlow
+import kotlinx.coroutines.flow.asSharedFlow
+import kotlinx.coroutines.flow.buffer
+import kotlinx.coroutines.flow.channelFlow
+import kotlinx.coroutines.flow.flow
+import kotlinx.coroutines.flow.flowOn
+import kotlinx.coroutines.isActive
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
 import kotlinx.coroutines.withContext
+import kotlinx.coroutines.withTimeoutOrNull
+import kotlinx.coroutines.yield
 import kotlinx.serialization.encodeToString
 import kotlinx.serialization.json.Json
+import kotlinx.serialization.json.jsonObject
+import kotlinx.serialization.json.jsonPrimitive
 import java.io.File
+import java.io.FileNotFoundException
+import java.nio.channels.FileChannel
 import java.nio.file.Files
 import java.nio.file.Path
+import java.nio.file.StandardOpenOption
 import java.util.UUID
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.ConcurrentLinkedQueue
+import java.util.concurrent.LinkedBlockingQueue
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
 
 /**
  * SQLiteCloud acts as an actor that interfaces with SQLite Cloud, providing methods for database
@@ -65,17 +103,181 @@ class SQLiteCloud(
 
     private val bridge = SQLiteCloudBridge(logger)
 
+    // Every native call of the connection runs on this single thread, so concurrent callers can
+    // never interleave on the socket. The thread is started on demand and exits when idle.
+    @Volatile
+    private var connectionThread: Thread? = null
+
+    private val dispatcher = ThreadPoolExecutor(0, 1, 30, TimeUnit.SECONDS, LinkedBlockingQueue()) { runnable ->
+        Thread(runnable, "SQLiteCloudConnection").apply {
+            isDaemon = true
+            connectionThread = this
+        }
+    }.asCoroutineDispatcher()
+
+    private val connectionScope = CoroutineScope(scope.coroutineContext + dispatcher)
+
+    // Commands waiting to be sent by [execute], coalesced into a pipeline when more than one.
+    private val pendingCommands = ConcurrentLinkedQueue<PendingCommand>()
+
+    // Notifications waiting for the end of the window, see [sendNotification].
+    private val pendingNotifications = ConcurrentLinkedQueue<PendingNotification>()
+
+    private val notifyWindowOpen = AtomicBoolean()
+
+    // Writes waiting for the end of the window, see [executeBatched], and how many they are.
+    private val pendingWrites = ConcurrentLinkedQueue<PendingCommand>()
+
+    private val pendingWriteCount = AtomicInteger()
+
+    private val writeWindowOpen = AtomicBoolean()
+
+    private val inFlight = AtomicInteger()
+
+    // Reads sent by [execute] and not yet answered, by query and parameters, see
+    // [SQLiteCloudConfig.dedupReads]. Guarded by itself.
+    private val inFlightReads = HashMap<SharedReadKey, SharedRead>()
+
+    // Set when a cancelled command closed the connection, see [cancellable].
+    @Volatile
+    private var reconnectAfterCancel = false
+
+    // Connection thread only. Set by [connect] with [SQLiteCloudConfig.lazyConnect] until the first command.
+    private var connectPending = false
+
+    // The spare connection kept by [standbyJob], see [SQLiteCloudConfig.standbyRefreshMs]. Whoever
+    // takes it out with getAndSet owns it.
+    private val standby = AtomicLong(nullOpaquePointer)
+
+    @Volatile
+    private var standbyJob: Job? = null
+
+    // Wakes [standbyJob] up as soon as the standby has been adopted.
+    private val standbyWanted = Channel<Unit>(Channel.CONFLATED)
+
+    // Registered while connected with [SQLiteCloudConfig.networkAware], see [networkChanged].
+    private val connectivityManager = appContext.getSystemService(ConnectivityManager::class.java)
+
+    @Volatile
+    private var networkCallback: ConnectivityManager.NetworkCallback? = null
+
+    // Updated by [setNetworkClass] and applied again on every connect and checkout.
+    @Volatile
+    private var networkClass = config.networkClass
+
+    // Temporary files of the rowsets spilled to disk, see [SQLiteCloudConfig.spillThreshold].
+    private val spillDirectory = appContext.cacheDir.path
+
+    // The calibration of the device, see [SQLiteCloudConfig.compressionCalibration].
+    private val compressionCalibrationFile = SQLiteCloudCompressionCalibration.file(appContext.filesDir)
+
+    // Replaced on every connect, see [resetResultCache]. Null if the cache is disabled.
+    @Volatile
+    private var resultCache: SQLiteCloudResultCache? = null
+
+    // The follow-up queries of each parent query, see [registerPrefetch].
+    private val prefetches = ConcurrentHashMap<String, List<SQLiteCloudPrefetch>>()
+
+    // Emptied on every connect and used only while [blobCacheEnabled], see [resetResultCache]. Null
+    // if the cache is disabled.
+    private val blobCache = if (config.blobCacheSize > 0) {
+        SQLiteCloudBlobCache(SQLiteCloudBlobCache.newDirectory(appContext.cacheDir), config.blobCacheSize)
+    } else {
+        null
+    }
+
+    @Volatile
+    private var blobCacheEnabled = false
+
+    // Signalled on the pub/sub thread once the native notification queue has something to drain,
+    // see [drainNotifications].
+    private val notificationsReady = Channel<Unit>(Channel.CONFLATED)
+
+    // Set by [sharePubSub]: the client whose pub/sub connection receives the notifications of this one.
+    @Volatile
+    private var pubSubHost: SQLiteCloud? = null
+
+    // Connection thread only. The number of guests, the clients that share the pub/sub connection of
+    // this one, listening to each channel, see [listenForGuest].
+    private val guestChannels = mutableMapOf<SQLiteCloudChannel, Int>()
+
+    // The writes of [enqueueWrite], opened on first use.
+    private val offlineQueue by lazy {
+        val database = "${config.username}@${config.hostname}:${config.port}/${config.dbname ?: ""}"
+        SQLiteCloudOfflineQueue(File(appContext.filesDir, "sqlitecloud-offline-${database.hashCode().toUInt().toString(16)}.queue"))
+    }
+
+    // Signaled when the offline queue may be replayed: a write was queued, or the connection is back.
+    private val offlineReplayWanted = Channel<Unit>(Channel.CONFLATED)
+
+    // Held by a replay of the offline queue, so that two replays do not send the same writes.
+    private val offlineReplayLock = Mutex()
+
+    private val offlineFailureEvents = MutableSharedFlow<SQLiteCloudOfflineFailure>(
+        extraBufferCapacity = notificationBufferSize,
+    )
+
+    /**
+     * The writes of [enqueueWrite] that the server refused when they were replayed, and that have
+     * been dropped from the offline queue.
+     */
+    val offlineFailures: Flow<SQLiteCloudOfflineFailure> = offlineFailureEvents.asSharedFlow()
+
+    // Notifications dropped by a full native queue, see [liveQuery].
+    @Volatile
+    private var droppedNotifications = 0L
+
+    private val notificationBatches = MutableSharedFlow<List<SQLiteCloudPayload>>(
+        extraBufferCapacity = notificationBufferSize,
+    )
+
+    /**
+     * The notifications of every channel listened to, in batches of the notifications received
+     * together. With [SQLiteCloudConfig.pubSubQueueSize] a slow collector holds the next batches
+     * back in the native queue, which applies [SQLiteCloudConfig.pubSubOverflow] once full;
+     * otherwise every notification is a batch of its own.
+     */
+    val notifications: Flow<List<SQLiteCloudPayload>> = notificationBatches.asSharedFlow()
+
+    private class PendingCommand(val command: SQLiteCloudCommand) {
+        val result = CompletableDeferred<SQLiteCloudResult>()
+    }
+
+    private data class SharedReadKey(val query: String, val parameters: List<SQLiteCloudValue>)
+
+    // A read of [execute] awaited by [waiters] callers, it is cancelled when the last one leaves.
+    private class SharedRead(val pending: PendingCommand) {
+        var waiters = 1
+    }
+
+    private class PendingNotification(val channel: String, val payload: String) {
+        val result = CompletableDeferred<Unit>()
+    }
+
     init {
-        if (config.rootCertificate == null) {
-            val file = File(appContext.filesDir, tlsDefaultCertificateName)
-            if (!file.exists()) {
-                val inputStream = appContext.assets.open(tlsDefaultCertificateName)
-                val outputStream = file.outputStream()
-                outputStream.write(inputStream.readBytes())
-                inputStream.close()
-                outputStream.close()
+        this.config = withDefaultRootCertificate(appContext, config)
+        if (this.config.arrayPoolSize > 0) {
+            bridge.arrayPool = SQLiteCloudArrayPool(this.config.arrayPoolSize)
+        }
+        bridge.lazyRowsetCells = this.config.lazyRowsetCells
+        bridge.lazyRowsetBytes = this.config.lazyRowsetBytes
+
+        scope.launch {
+            for (signal in notificationsReady) {
+                drainNotifications()
+            }
+        }
+        if (this.config.offlineQueue) {
+            scope.launch {
+                for (signal in offlineReplayWanted) {
+                    try {
+                        replayOfflineQueue()
+                    } catch (error: SQLiteCloudError) {
+                        logger?.logDebug(category = "COMMAND", message = "📴 Offline writes kept for later: $error")
+                    }
+                }
             }
-            this.config = config.copy(rootCertificate = file.path)
+            offlineReplayWanted.trySend(Unit)
         }
     }
 
@@ -83,44 +285,154 @@ class SQLiteCloud(
      * Whether the client is currently connected to the SQLite Cloud server.
      */
     val isConnected
-        get() = runBlocking(scope.coroutineContext) { bridge.isConnected }
+        get() = onConnectionThread { bridge.isConnected }
+
+    /**
+     * The number of [execute] calls that are queued or waiting for their reply.
+     */
+    val inFlightCommands: Int
+        get() = inFlight.get()
 
     /**
      * Whether an error has occurred during the preceding database operations.
      */
     val isError: Boolean
-        get() = runBlocking(scope.coroutineContext) { bridge.isError() }
+        get() = onConnectionThread { bridge.isError() }
 
     /**
      * Whether the error is an SQLite error.
      */
     val isSQLiteError: Boolean
-        get() = runBlocking(scope.coroutineContext) { bridge.isSQLiteError() }
+        get() = onConnectionThread { bridge.isSQLiteError() }
 
     /**
      * The code for the eventual error occurred during the preceding database operations.
      */
     val errorCode: Int?
-        get() = runBlocking(scope.coroutineContext) { bridge.errorCode() }
+        get() = onConnectionThread { bridge.errorCode() }
 
     /**
      * The message for the eventual error occurred during the preceding database operations.
      */
     val errorMessage: String?
-        get() = runBlocking(scope.coroutineContext) { bridge.errorMessage() }
+        get() = onConnectionThread { bridge.errorMessage() }
 
     /**
      * The extended error code for the eventual error occurred during the preceding database
      * operations.
      */
     val extendedErrorCode: Int?
-        get() = runBlocking(scope.coroutineContext) { bridge.extendedErrorCode() }
+        get() = onConnectionThread { bridge.extendedErrorCode() }
+
+    /**
+     * The number of [compileQuery] calls served by a virtual machine kept in the statement cache
+     * of the connection, instead of being compiled again by the server.
+     */
+    val statementCacheHits: Int
+        get() = onConnectionThread { bridge.statementCacheStats()[0] }
+
+    /**
+     * The number of [compileQuery] calls that compiled a new virtual machine on the server.
+     */
+    val statementCacheMisses: Int
+        get() = onConnectionThread { bridge.statementCacheStats()[1] }
+
+    /**
+     * The CRC32C (Castagnoli) of the database bytes moved by the last [upload], [download] or
+     * [sync], computed natively on each chunk as it is transferred. A download is already verified
+     * against the checksum of the server when the server sends one; this value lets the caller
+     * compare a file with a checksum of its own without reading it again. It is `0` after a sync
+     * that had nothing to download.
+     */
+    val transferChecksum: Int
+        get() = onConnectionThread { bridge.transferChecksum() }
+
+    /**
+     * The compressed bytes received by the connection.
+     */
+    val compressedBytes: Long
+        get() = onConnectionThread { bridge.compressionStats()[0] }
+
+    /**
+     * The bytes that compression saved on the connection, net of the framing overhead;
+     * negative when the compressed replies were larger than the uncompressed ones.
+     */
+    val compressionSavedBytes: Long
+        get() = onConnectionThread { bridge.compressionStats()[1] }
+
+    /**
+     * The reply size and the ratio from which the compression policy turns compression on, see
+     * [SQLiteCloudCompressionThreshold]. They follow the link rate of the connection once a
+     * [SQLiteCloudCompressionCalibration] is set.
+     */
+    val compressionThreshold: SQLiteCloudCompressionThreshold
+        get() = onConnectionThread {
+            val values = bridge.compressionThreshold()
+            SQLiteCloudCompressionThreshold(values[0], values[1], values[2] != 0)
+        }
+
+    /**
+     * The wire counters of the connection since it was opened: commands, replies, round trips,
+     * bytes, system calls and errors, see [SQLiteCloudConnectionStats].
+     */
+    val connectionStats: SQLiteCloudConnectionStats
+        get() = onConnectionThread { SQLiteCloudConnectionStats.fromNative(bridge.connectionStats()) }
+
+    /**
+     * How many rowsets were boxed when parsed and how many are boxed row by row when read, with
+     * the thresholds that decide it, see [SQLiteCloudConfig.lazyRowsetCells].
+     */
+    val materializationStats: SQLiteCloudMaterializationStats
+        get() = bridge.materializationStats()
+
+    /**
+     * The latency histograms of the commands, steps and notifications of the connection, by kind;
+     * empty histograms unless [SQLiteCloudConfig.latencyHistograms] is set.
+     */
+    val commandLatency: SQLiteCloudCommandLatency
+        get() = onConnectionThread { SQLiteCloudCommandLatency.fromNative(bridge.latencyHistograms()) }
+
+    /**
+     * Receives the spans of the native work of the connection: connections, TLS handshakes,
+     * commands, rowset chunks and notifications, see [SQLiteCloudTracer]. Set it before [connect]
+     * for the connection itself to be traced.
+     */
+    var tracer: SQLiteCloudTracer?
+        get() = bridge.tracer
+        set(value) = onConnectionThread { bridge.tracer = value }
+
+    /**
+     * The TLS cipher suite negotiated with the server, `null` for an insecure connection,
+     * see [SQLiteCloudConfig.tlsCiphers].
+     */
+    val tlsCipher: String?
+        get() = onConnectionThread { bridge.tlsCipher() }
+
+    /**
+     * The native bytes held by the connection: receive buffers, decompressed replies, chunk
+     * arrays and the results not yet released, see [SQLiteCloudConfig.memoryHardLimit].
+     */
+    val memoryBytes: Long
+        get() = onConnectionThread { bridge.memoryUsage()[0] }
+
+    /**
+     * The native bytes held by every connection of the process, see [setProcessMemoryBudget].
+     */
+    val processMemoryBytes: Long
+        get() = onConnectionThread { bridge.memoryUsage()[1] }
+
+    /**
+     * The latency histograms of the notifications of each channel, from the socket of the
+     * connection to the handlers; empty unless [SQLiteCloudConfig.pubSubLatency] is set.
+     */
+    val pubSubLatency: List<SQLiteCloudPubSubLatency>
+        get() = onConnectionThread { bridge.pubSubLatencyHistograms() }
 
     /**
      * The error offset for the eventual error occurred during the preceding database operations.
      */
     val errorOffset: Int?
-        get() = runBlocking(scope.coroutineContext) { bridge.errorOffset() }
+        get() = onConnectionThread { bridge.errorOffset() }
 
     /**
      * Establishes a connection to a database node using the specified
@@ -138,11 +450,23 @@ class SQLiteCloud(
      *  }
      *  ```
      *
+     * With [SQLiteCloudConfig.lazyConnect] it returns immediately and the connection is
+     * established by the first command, which then reports its errors; [isConnected] is
+     * `false` until then.
+     *
      * @throws SQLiteCloudError If an error occurs during the connection process, this
      *            method throws an SQLiteCloudError.connectionFailure with context details
      *            about the error.
      */
-    suspend fun connect(): Unit = withContext(scope.coroutineContext) {
+    suspend fun connect(): Unit = withContext(connectionScope.coroutineContext) {
+        if (config.lazyConnect && !bridge.hasConnection) {
+            connectPending = true
+            return@withContext
+        }
+        openConnection()
+    }
+
+    private suspend fun openConnection() {
         logger?.logDebug(
             category = "CONNECTION",
             message = "📡 Connecting to ${config.connectionString}...",
@@ -170,7 +494,17 @@ class SQLiteCloud(
             tlsRootCertificate = config.rootCertificate,
             tlsCertificate = config.clientCertificate,
             tlsCertificateKey = config.clientCertificateKey,
+            tlsCiphers = config.tlsCiphers,
             insecure = config.insecure,
+            binaryRowset = config.binaryRowset,
+            compactIndex = config.compactIndex,
+            deferConfig = config.deferConfig,
+            keepAliveIdle = config.keepAliveIdle,
+            keepAliveInterval = config.keepAliveInterval,
+            keepAliveCount = config.keepAliveCount,
+            userTimeoutMs = config.userTimeoutMs,
+            wireRecordPath = config.wireRecordPath,
+            wireReplayPath = config.wireReplayPath,
         )
 
         if (!success) {
@@ -178,7 +512,39 @@ class SQLiteCloud(
             throw error()
         }
 
+        configureConnection()
+        startStandby()
+        startNetworkCallback()
+        startCompressionCalibration()
+        offlineReplayWanted.trySend(Unit)
+
+        logger?.logDebug(
+            category = "CONNECTION",
+            message = "📡 Connection to ${config.connectionString} successful",
+        )
+    }
+
+    // Applies the client side settings of the config to a connection just bound to the bridge.
+    private suspend fun configureConnection() {
+        bridge.setStatementCacheSize(config.statementCacheSize)
+        bridge.setAutoParameterize(config.autoParameterizeSize)
+        bridge.setResultPoolSize(config.resultPoolSize)
+        bridge.setAdaptiveChunks(config.adaptiveChunkMinRows, config.adaptiveChunkMaxRows, config.adaptiveChunkMs)
+        bridge.setCompressionPolicy(config.compressionMinSize, networkClass.value)
+        bridge.setUploadCompression(config.uploadCompressionMinSize)
+        bridge.setDownloadWindow(config.downloadWindow)
+        bridge.setDownloadCompression(config.downloadCompression)
+        bridge.primeCompressionDictionary(config.compressionDictionarySize)
+        bridge.setChunkWorkers(config.chunkWorkers)
+        bridge.setParallelParse(config.parallelParseMinBytes)
+        bridge.setHeaderCache(config.headerCacheSize)
+        bridge.setSpill(spillDirectory, config.spillThreshold)
+        bridge.setMemoryBudget(config.memorySoftLimit, config.memoryHardLimit)
+        bridge.setLatencyHistograms(config.latencyHistograms)
+        bridge.setAllocationCounters(config.allocationCounters)
         setupPubSubCallback()
+        pubSubHost?.let { attachPubSubHost(it) }
+        resetResultCache(enabled = !config.isReadonlyConnection)
 
         if (config.isReadonlyConnection) {
             bridge.setPubSubOnly()
@@ -193,11 +559,118 @@ class SQLiteCloud(
                 throw error
             }
         }
+    }
 
-        logger?.logDebug(
-            category = "CONNECTION",
-            message = "📡 Connection to ${config.connectionString} successful",
-        )
+    private fun startStandby() {
+        if (config.standbyRefreshMs <= 0 || standbyJob?.isActive == true) {
+            return
+        }
+        standbyJob = scope.launch {
+            while (isActive) {
+                val current = standby.getAndSet(nullOpaquePointer)
+                if (current != nullOpaquePointer && SQLiteCloudBridge.isStandbyReady(current)) {
+                    standby.set(current)
+                } else {
+                    SQLiteCloudBridge.closeStandby(current)
+                    val fresh = bridge.connectStandby(config) ?: nullOpaquePointer
+                    standby.set(fresh)
+                }
+                withTimeoutOrNull(config.standbyRefreshMs.toLong()) { standbyWanted.receive() }
+            }
+        }
+    }
+
+    private suspend fun stopStandby() {
+        standbyJob?.cancelAndJoin()
+        standbyJob = null
+        SQLiteCloudBridge.closeStandby(standby.getAndSet(nullOpaquePointer))
+    }
+
+    // Sets the calibration saved by an earlier launch, or measures it in the background, once per
+    // process: the policy of every connection uses it as soon as it is set.
+    private fun startCompressionCalibration() {
+        if (!config.compressionCalibration || !compressionCalibrationStarted.compareAndSet(false, true)) {
+            return
+        }
+        scope.launch(Dispatchers.Default) {
+            val saved = SQLiteCloudCompressionCalibration.load(compressionCalibrationFile)
+            val calibration = saved ?: calibrateCompression(compressionCalibrationFile)
+            setCompressionCalibration(calibration)
+            logger?.logDebug(
+                category = "CONNECTION",
+                message = "🗜️ Compression calibration ${if (saved != null) "loaded" else "measured"}: $calibration",
+            )
+        }
+    }
+
+    private fun startNetworkCallback() {
+        if (!config.networkAware || networkCallback != null || connectivityManager == null) {
+            return
+        }
+        val callback = object : ConnectivityManager.NetworkCallback() {
+            override fun onAvailable(network: Network) = networkChanged(network)
+        }
+        connectivityManager.registerDefaultNetworkCallback(callback)
+        networkCallback = callback
+    }
+
+    private fun stopNetworkCallback() {
+        networkCallback?.let { connectivityManager?.unregisterNetworkCallback(it) }
+        networkCallback = null
+    }
+
+    // The default network changed, Wi-Fi to cellular for example: the sockets of the previous one
+    // are dead even if no read failed yet. New sockets are bound to the new network, which makes
+    // the connections open not alive, then the standby and the connection are opened again right
+    // away, with the TLS session and the DNS answers of the previous ones, instead of by the next
+    // command after a timeout.
+    private fun networkChanged(network: Network) {
+        SQLiteCloudBridge.setNetwork(network.networkHandle)
+        standbyWanted.trySend(Unit)
+        offlineReplayWanted.trySend(Unit)
+        scope.launch(connectionScope.coroutineContext) {
+            if (connectPending || !bridge.hasConnection || bridge.isAlive()) return@launch
+            try {
+                logger?.logInfo(category = "CONNECTION", message = "📶 Network changed, opening the connection again")
+                reopenConnection()
+            } catch (error: SQLiteCloudError) {
+                // The next command tries again.
+                logger?.logError(category = "CONNECTION", message = "🚨 Reconnect after a network change failed: $error")
+            }
+        }
+    }
+
+    // Replaces a dead connection with the standby, without the DNS, TCP, TLS and AUTH round trips.
+    private suspend fun adoptStandby(): Boolean {
+        val current = standby.getAndSet(nullOpaquePointer)
+        if (current == nullOpaquePointer) {
+            return false
+        }
+        standbyWanted.trySend(Unit)
+        if (!SQLiteCloudBridge.isStandbyReady(current)) {
+            SQLiteCloudBridge.closeStandby(current)
+            return false
+        }
+
+        logger?.logInfo(category = "CONNECTION", message = "🔁 Connection lost, switching to the standby connection")
+        bridge.adopt(current)
+        configureConnection()
+        return true
+    }
+
+    // Prefers the standby, then the same connection reopened in place (its session is replayed and
+    // its settings are kept), then a new connection.
+    private suspend fun reopenConnection() {
+        if (adoptStandby()) return
+
+        if (bridge.reconnect()) {
+            logger?.logInfo(category = "CONNECTION", message = "🔁 Connection reopened, session restored")
+            // notifications may have been missed while the connection was down
+            resetResultCache(enabled = !config.isReadonlyConnection)
+            return
+        }
+        bridge.disconnect()
+        openConnection()
     }
 
     /**
@@ -229,184 +702,1522 @@ class SQLiteCloud(
      * }
      * ```
     */
-    suspend fun disconnect() = withContext(scope.coroutineContext) {
+    suspend fun disconnect() = withContext(connectionScope.coroutineContext) {
+        stopStandby()
+        stopNetworkCallback()
+        // The writes still waiting for their window are sent before the connection is closed.
+        while (pendingWrites.isNotEmpty()) sendPendingWrites()
+        if (connectPending) {
+            connectPending = false
+            return@withContext
+        }
+        // The connection has already been closed by a cancelled command.
+        resetResultCache(enabled = false)
+        if (reconnectAfterCancel) {
+            reconnectAfterCancel = false
+            return@withContext
+        }
+        if (bridge.isOutOfSync) {
+            bridge.disconnect()
+            return@withContext
+        }
         ensureConnectedOrThrow()
         bridge.disconnect()
     }
 
-    private fun ensureConnectedOrThrow() {
-        if (!isConnected) {
-            throw SQLiteCloudError.Connection.invalidConnection
-        }
+    /**
+     * Drops the cached results that read [table], or every cached result if [table] is null.
+     *
+     * Cached results are dropped when the change notification of a table arrives, which happens
+     * asynchronously also for the writes of this client: call this method after a write to read
+     * its effects immediately. It has effect only when [SQLiteCloudConfig.resultCacheSize] is set.
+     */
+    fun invalidateResultCache(table: String? = null) {
+        resultCache?.invalidate(table)
     }
 
-    private fun setupPubSubCallback() {
-        bridge.setPubSubCallback { result ->
-            if (result is SQLiteCloudResult.Json) {
-                val data = result.value
-                val payload = try {
-                    Json.decodeFromString<SQLiteCloudPayload>(data)
-                } catch (e: Error) {
-                    logger?.logError(
-                        category = "PUB/SUB",
-                        message = "🚨 Message decoding error: $e",
-                    )
-                    return@setPubSubCallback
-                }
+    /**
+     * Runs [prefetches] ahead of time every time [parentQuery] returns a rowset from [execute],
+     * replacing the ones registered before for the same query.
+     *
+     * Once the parent result has been returned, the follow-up commands of its first rows are sent
+     * in the background with a single round trip, after the commands already queued on the
+     * connection, and their results are stored in the result cache without being parsed. The
+     * screen that runs one of them next with [execute] is then served from memory. Follow-ups
+     * already cached are not sent again, and the ones that fail are dropped silently.
+     *
+     * It has effect only when [SQLiteCloudConfig.resultCacheSize] is set. The cache belongs to
+     * this connection, so the follow-ups must be executed by this same client to be served from
+     * it.
+     *
+     * @param parentQuery The query text of the parent command, as passed to [SQLiteCloudCommand].
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * sqliteCloud.registerPrefetch(
+     *     "SELECT id, customer FROM orders ORDER BY created DESC LIMIT 50",
+     *     SQLiteCloudPrefetch(
+     *         query = "SELECT * FROM order_items WHERE order_id = ?",
+     *         keyColumn = "id",
+     *         cacheTables = listOf("order_items"),
+     *         rows = 5,
+     *     ),
+     * )
+     * ```
+     */
+    fun registerPrefetch(parentQuery: String, vararg prefetches: SQLiteCloudPrefetch) {
+        this.prefetches[parentQuery] = prefetches.toList()
+    }
 
-                observers.forEach { observer ->
-                    if (observer.channel.name == payload.channel) {
-                        observer.callback(payload)
-                    }
-                }
+    /**
+     * Stops running ahead of time the follow-up queries registered for [parentQuery] with
+     * [registerPrefetch]. The results already prefetched stay cached.
+     */
+    fun unregisterPrefetch(parentQuery: String) {
+        prefetches.remove(parentQuery)
+    }
+
+    // Sends the follow-up commands of a parent result in the background, see [registerPrefetch].
+    private fun prefetch(prefetches: List<SQLiteCloudPrefetch>, result: SQLiteCloudResult) {
+        val rowset = (result as? SQLiteCloudResult.Rowset)?.value ?: return
+        if (resultCache == null) return
+        val commands = prefetches.flatMap { it.commands(rowset) }
+        if (commands.isEmpty()) return
 
-                logger?.logDebug(category = "PUB/SUB", message = "✉️ Message received: $payload")
+        scope.launch(connectionScope.coroutineContext) {
+            // Let the commands queued meanwhile go first, most likely the ones of the caller.
+            yield()
+            if (connectPending || !bridge.hasConnection) return@launch
+            try {
+                resultCache?.let { bridge.prefetchCached(commands, it) }
+            } catch (error: SQLiteCloudError) {
+                logger?.logDebug(category = "COMMAND", message = "🔮 Prefetch skipped: $error")
             }
         }
     }
 
+    // A new connection listens to no table yet and may have missed notifications, so the cached
+    // results and BLOBs of the previous one are released.
+    private fun resetResultCache(enabled: Boolean) {
+        blobCache?.clear()
+        blobCacheEnabled = enabled
+        resultCache?.clear()
+        resultCache = if (enabled && config.resultCacheSize > 0) {
+            bridge.newResultCache(config.resultCacheSize.toLong())
+        } else {
+            null
+        }
+    }
+
     /**
-     * Get the unique client UUID associated with the current connection.
-     *
-     * This method retrieves the unique client UUID value for the active database connection.
-     * The UUID serves as a client identifier and can be used for various purposes, such as
-     * tracking client-specific data.
-     *
-     * @return A `UUID` instance representing the client's unique identifier.
+     * Releases the memory the connection keeps only to speed up the next operations: the receive
+     * buffers and results recycled by the result pool (see [SQLiteCloudConfig.resultPoolSize]) and
+     * the socket read buffer. The connection stays open and allocates them again when needed.
      *
-     * @throws SQLiteCloudError if an error if the connection cannot be established, or
-     *           if the UUID retrieved from the database is invalid or null.
+     * Call it from `ComponentCallbacks2.onTrimMemory` to give memory back to the system.
      *
      * Example usage:
      *
      * ```kotlin
-     * try {
-     *     val clientUUID = await sqliteCloud.getClientUUID()
-     *     print("Client UUID: $clientUUID")
-     * } catch (error) {
-     *     print("Error: $error")
+     * override fun onTrimMemory(level: Int) {
+     *     super.onTrimMemory(level)
+     *     lifecycleScope.launch { sqliteCloud.trimMemory() }
      * }
      * ```
-     *
-     * - Note: The UUID is typically represented as a string in the format
-     *         "E621E1F8-C36C-495A-93FC-0C247A3E6E5F". This method retrieves it from the
-     *          database as a raw string and converts it into a [UUID] instance.
-    */
-    suspend fun getClientUUID(): UUID = withContext(scope.coroutineContext) {
-        ensureConnectedOrThrow()
-        val uuidString = bridge.getClientUUID() ?: throw SQLiteCloudError.Connection.invalidUUID
-        UUID.fromString(uuidString)
+     */
+    suspend fun trimMemory() = withContext(connectionScope.coroutineContext) {
+        bridge.trimMemory()
+    }
+
+    /// How much memory [releaseMemory] gives back to the system, from the mildest.
+    enum class MemoryPressure(val value: Int) {
+        /// The pressure is over: rowsets spill at the configured threshold again.
+        None(0),
+
+        /// The buffers kept only for speed, as [trimMemory], and the arrays of the array pool.
+        Low(1),
+
+        /// Also the least recently used half of the result cache and of the statement cache, and
+        /// the next rowsets spill their chunks to disk beyond 4 MB.
+        Moderate(2),
+
+        /// Also the whole result cache and statement cache, and the next rowsets spill beyond 1 MB.
+        Critical(3);
+
+        companion object {
+            /**
+             * The pressure of a `ComponentCallbacks2.onTrimMemory` level.
+             */
+            fun fromTrimLevel(level: Int): MemoryPressure = when {
+                level >= ComponentCallbacks2.TRIM_MEMORY_COMPLETE -> Critical
+                level >= ComponentCallbacks2.TRIM_MEMORY_BACKGROUND -> Moderate
+                level >= ComponentCallbacks2.TRIM_MEMORY_UI_HIDDEN -> Low
+                level >= ComponentCallbacks2.TRIM_MEMORY_RUNNING_CRITICAL -> Critical
+                level >= ComponentCallbacks2.TRIM_MEMORY_RUNNING_LOW -> Moderate
+                else -> Low
+            }
+        }
     }
 
     /**
-     * Execute a SQL command on the SQLite Cloud database.
-     *
-     * This method allows to execute SQL commands (queries or updates) on the SQLite Cloud database
-     * associated with the active connection. It takes a `SQLiteCloudCommand` object as input,
-     * which includes the SQL query string and any parameters if needed.
-     *
-     * @param command A `SQLiteCloudCommand` object containing the SQL command and optional parameters.
-     *
-     * @return A [SQLiteCloudResult] object containing the result of the SQL command execution.
+     * Releases memory according to [pressure], from every cache of the client in one pass: the
+     * native buffers and results kept only for speed, the arrays of the array pool (see
+     * [SQLiteCloudConfig.arrayPoolSize]), the coldest entries of the result cache and of the
+     * statement cache, whose most recently used entries are kept until [MemoryPressure.Critical].
+     * Under [MemoryPressure.Moderate] and above, the rowsets received next also spill their chunks
+     * to disk earlier, until this method is called with [MemoryPressure.None] or the connection is
+     * opened again.
+     *
+     * Use [componentCallbacks] to call it whenever Android asks the application to trim memory.
+     */
+    suspend fun releaseMemory(pressure: MemoryPressure) = withContext(connectionScope.coroutineContext) {
+        bridge.memoryPressure(pressure.value)
+        if (pressure == MemoryPressure.None) return@withContext
+
+        bridge.arrayPool?.clear()
+        when (pressure) {
+            MemoryPressure.Moderate -> resultCache?.let { it.trim(it.currentSize / 2) }
+            MemoryPressure.Critical -> resultCache?.trim(0)
+            else -> Unit
+        }
+    }
+
+    /**
+     * Callbacks that call [releaseMemory] with the pressure of every `onTrimMemory` level, and with
+     * [MemoryPressure.Critical] on `onLowMemory`.
      *
-     * @throws SQLiteCloudError.Connection if the connection cannot be established,
+     * Example usage:
      *
-     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
-     *           parameters, or if an error occurs during the execution of the query.
+     * ```kotlin
+     * override fun onCreate() {
+     *     super.onCreate()
+     *     registerComponentCallbacks(sqliteCloud.componentCallbacks)
+     * }
+     * ```
+     */
+    val componentCallbacks: ComponentCallbacks2 by lazy {
+        object : ComponentCallbacks2 {
+            override fun onTrimMemory(level: Int) {
+                scope.launch { releaseMemory(MemoryPressure.fromTrimLevel(level)) }
+            }
+
+            @Deprecated("Deprecated in Java")
+            override fun onLowMemory() {
+                scope.launch { releaseMemory(MemoryPressure.Critical) }
+            }
+
+            override fun onConfigurationChanged(newConfig: Configuration) = Unit
+        }
+    }
+
+    /**
+     * Tells the compression policy which network the connection is using, so that compression
+     * is only kept on where it pays off. It has effect when [SQLiteCloudConfig.compressionMinSize]
+     * is set.
      *
      * Example usage:
      *
      * ```kotlin
-     * try {
-     *     val sql = "SELECT * FROM users WHERE id = ?"
-     *     val command = SQLiteCloudCommand(query: sql, parameters: [.integer(42)])
-     *     val result = try sqliteCloud.execute(command: command)
-     *     // Process the result
-     * } catch (error) {
-     *     print("Error: $error")
+     * val capabilities = connectivityManager.getNetworkCapabilities(network)
+     * val networkClass = when {
+     *     capabilities?.hasCapability(NET_CAPABILITY_NOT_METERED) == false -> NetworkClass.Metered
+     *     capabilities?.hasTransport(TRANSPORT_CELLULAR) == true -> NetworkClass.Cellular
+     *     else -> NetworkClass.WiFi
      * }
+     * sqliteCloud.setNetworkClass(networkClass)
      * ```
      */
-    suspend fun execute(command: SQLiteCloudCommand) = withContext(scope.coroutineContext) {
-        ensureConnectedOrThrow()
-        bridge.execute(command)
+    suspend fun setNetworkClass(networkClass: SQLiteCloudConfig.NetworkClass) =
+        withContext(connectionScope.coroutineContext) {
+            this@SQLiteCloud.networkClass = networkClass
+            bridge.setCompressionPolicy(config.compressionMinSize, networkClass.value)
+            // A network change is the usual sign that the server can be reached again.
+            offlineReplayWanted.trySend(Unit)
+        }
+
+    /**
+     * Registers [dictionary] with the server as the dictionary of the compressed replies, which
+     * improves the ratio of small rowsets that repeat the same column names and values. A
+     * dictionary is usually built offline from typical replies; one is also built from the first
+     * replies of the session when [SQLiteCloudConfig.compressionDictionarySize] is set. It lasts
+     * until the connection is closed; an empty array stops dictionary compression.
+     *
+     * @return `false` if the server does not support dictionaries (replies stay LZ4 compressed).
+     */
+    suspend fun setCompressionDictionary(dictionary: ByteArray): Boolean =
+        withContext(connectionScope.coroutineContext) {
+            bridge.setCompressionDictionary(dictionary)
+        }
+
+    private fun <T> onConnectionThread(block: () -> T): T =
+        if (Thread.currentThread() === connectionThread) {
+            block()
+        } else {
+            runBlocking(connectionScope.coroutineContext) { block() }
+        }
+
+    private suspend fun ensureConnectedOrThrow() {
+        if (connectPending) {
+            connectPending = false
+            openConnection()
+        }
+        if (reconnectAfterCancel) {
+            reconnectAfterCancel = false
+            reopenConnection()
+        }
+        if (bridge.isOutOfSync) {
+            logger?.logInfo(category = "COMMAND", message = "⏱️ Command deadline exceeded, opening the connection again")
+            reopenConnection()
+        }
+        if (config.networkAware && bridge.hasConnection && !bridge.isAlive()) {
+            // Opened on a network that is gone, and not reopened yet by [networkChanged].
+            reopenConnection()
+        }
+        if (config.standbyRefreshMs > 0 && bridge.hasConnection && !bridge.isAlive()) {
+            adoptStandby()
+        }
+        if (!isConnected) {
+            throw SQLiteCloudError.Connection.invalidConnection
+        }
+    }
+
+    private fun setupPubSubCallback() {
+        bridge.setPubSubCallback(
+            queueSize = config.pubSubQueueSize,
+            overflow = config.pubSubOverflow,
+            ready = { notificationsReady.trySend(Unit) },
+        ) { message ->
+            receiveNotification(message)?.let { notificationBatches.tryEmit(listOf(it)) }
+        }
+        bridge.setPubSubFilter(config.pubSubFilter)
+        bridge.setPubSubLatency(config.pubSubLatency)
+    }
+
+    // Collects the notifications queued natively in batches, on the connection thread so that the
+    // connection cannot be closed meanwhile. A slow collector of [notifications] suspends the
+    // emit, and the native queue fills up in the meantime.
+    private suspend fun drainNotifications() {
+        while (true) {
+            val (messages, dropped) = withContext(dispatcher) {
+                if (bridge.hasConnection) {
+                    bridge.drainPubSub(notificationBatchSize)
+                } else {
+                    emptyList<SQLiteCloudPubSubMessage>() to 0
+                }
+            }
+            if (dropped > 0) {
+                // The dropped notifications could have changed any cached table.
+                invalidateCaches(null)
+                droppedNotifications += dropped
+                logger?.logDebug(category = "PUB/SUB", message = "✉️ $dropped messages dropped")
+            }
+
+            val payloads = messages.mapNotNull { receiveNotification(it) }
+            if (payloads.isNotEmpty()) {
+                notificationBatches.emit(payloads)
+            }
+            if (messages.size < notificationBatchSize) return
+        }
+    }
+
+    // Invalidates the cached results of the channel and passes the payload to its observers.
+    private fun receiveNotification(message: SQLiteCloudPubSubMessage): SQLiteCloudPayload? {
+        val payload = message.payload?.also { invalidateCaches(it.channel) }
+            ?: decodeNotification(message.result)
+            ?: return null
+
+        observers.forEach { observer ->
+            if (observer.channel.name == payload.channel) {
+                observer.callback(payload)
+            }
+        }
+
+        logger?.logDebug(category = "PUB/SUB", message = "✉️ Message received: $payload")
+        return payload
+    }
+
+    // Decodes a notification that could not be decoded natively.
+    private fun decodeNotification(result: SQLiteCloudResult?): SQLiteCloudPayload? {
+        if (result !is SQLiteCloudResult.Json) return null
+
+        val data = result.value
+        invalidateCaches(notificationChannel(data))
+        return try {
+            Json.decodeFromString<SQLiteCloudPayload>(data)
+        } catch (e: Error) {
+            logger?.logError(
+                category = "PUB/SUB",
+                message = "🚨 Message decoding error: $e",
+            )
+            null
+        }
+    }
+
+    private fun invalidateCaches(table: String?) {
+        resultCache?.invalidate(table)
+        blobCache?.invalidate(table)
+    }
+
+    // The channel of a notification, read even if the rest of the payload cannot be decoded. Null
+    // when it is missing, which makes the result cache drop everything.
+    private fun notificationChannel(data: String): String? = try {
+        Json.parseToJsonElement(data).jsonObject["channel"]?.jsonPrimitive?.content
+    } catch (e: Exception) {
+        null
+    }
+
+    /**
+     * Get the unique client UUID associated with the current connection.
+     *
+     * This method retrieves the unique client UUID value for the active database connection.
+     * The UUID serves as a client identifier and can be used for various purposes, such as
+     * tracking client-specific data.
+     *
+     * @return A `UUID` instance representing the client's unique identifier.
+     *
+     * @throws SQLiteCloudError if an error if the connection cannot be established, or
+     *           if the UUID retrieved from the database is invalid or null.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * try {
+     *     val clientUUID = await sqliteCloud.getClientUUID()
+     *     print("Client UUID: $clientUUID")
+     * } catch (error) {
+     *     print("Error: $error")
+     * }
+     * ```
+     *
+     * - Note: The UUID is typically represented as a string in the format
+     *         "E621E1F8-C36C-495A-93FC-0C247A3E6E5F". This method retrieves it from the
+     *          database as a raw string and converts it into a [UUID] instance.
+    */
+    suspend fun getClientUUID(): UUID = withContext(connectionScope.coroutineContext) {
+        ensureConnectedOrThrow()
+        val uuidString = bridge.getClientUUID() ?: throw SQLiteCloudError.Connection.invalidUUID
+        UUID.fromString(uuidString)
+    }
+
+    /**
+     * Execute a SQL command on the SQLite Cloud database.
+     *
+     * This method allows to execute SQL commands (queries or updates) on the SQLite Cloud database
+     * associated with the active connection. It takes a `SQLiteCloudCommand` object as input,
+     * which includes the SQL query string and any parameters if needed.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL command and optional parameters.
+     *
+     * @return A [SQLiteCloudResult] object containing the result of the SQL command execution.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established,
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if an error occurs during the execution of the query.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * try {
+     *     val sql = "SELECT * FROM users WHERE id = ?"
+     *     val command = SQLiteCloudCommand(query: sql, parameters: [.integer(42)])
+     *     val result = try sqliteCloud.execute(command: command)
+     *     // Process the result
+     * } catch (error) {
+     *     print("Error: $error")
+     * }
+     * ```
+     */
+    suspend fun execute(command: SQLiteCloudCommand): SQLiteCloudResult {
+        val result = executeCommand(command)
+        prefetches[command.query]?.let { prefetch(it, result) }
+        return result
+    }
+
+    private suspend fun executeCommand(command: SQLiteCloudCommand): SQLiteCloudResult {
+        // Cacheable commands are not coalesced, a hit does not even need the connection thread.
+        resultCache?.takeIf { it.isCacheable(command) }?.let { cache ->
+            bridge.cachedResult(command, cache)?.let { return it }
+            return submit {
+                // The cache is replaced when the connection changes, use the current one.
+                resultCache?.let { bridge.executeCached(command, it) } ?: bridge.execute(command)
+            }
+        }
+
+        if (config.dedupReads) {
+            if (command.isReadOnly && command.deadlineMs == 0 && command.parameters.none { it is SQLiteCloudValue.Blob || it is SQLiteCloudValue.BlobFile }) {
+                return executeShared(command)
+            }
+            // A read sent after this command must not get the reply of one sent before it.
+            synchronized(inFlightReads) { inFlightReads.clear() }
+        }
+
+        val pending = PendingCommand(command)
+        enqueue(pending)
+        try {
+            return pending.result.await()
+        } finally {
+            // A command cancelled while still queued is skipped instead of being sent later.
+            pending.result.cancel()
+            inFlight.decrementAndGet()
+        }
+    }
+
+    // Attaches to the identical read already in flight, or sends [command] for the next ones to
+    // attach to. The result is immutable, so every caller gets the same one.
+    private suspend fun executeShared(command: SQLiteCloudCommand): SQLiteCloudResult {
+        val key = SharedReadKey(command.query, command.parameters)
+        var leader = false
+        val shared = synchronized(inFlightReads) {
+            inFlightReads[key]?.takeIf { it.pending.result.isActive }?.also { it.waiters++ }
+                ?: SharedRead(PendingCommand(command)).also {
+                    inFlightReads[key] = it
+                    leader = true
+                }
+        }
+        if (leader) {
+            shared.pending.result.invokeOnCompletion { synchronized(inFlightReads) { inFlightReads.remove(key, shared) } }
+            enqueue(shared.pending)
+        }
+        try {
+            return shared.pending.result.await()
+        } finally {
+            val last = synchronized(inFlightReads) { --shared.waiters == 0 }
+            if (last) {
+                shared.pending.result.cancel()
+                inFlight.decrementAndGet()
+            }
+        }
+    }
+
+    private fun enqueue(pending: PendingCommand) {
+        inFlight.incrementAndGet()
+        pendingCommands.add(pending)
+        connectionScope.launch { sendPendingCommands() }.invokeOnCompletion { cause ->
+            if (cause != null) pending.result.completeExceptionally(cause)
+        }
+    }
+
+    // Connection thread only. The commands queued while the previous ones were running are sent
+    // together, with a single round trip, except for commands with a deadline that are always sent
+    // alone so that their deadline covers their own round trip only.
+    private suspend fun sendPendingCommands() {
+        val commands = pollPendingCommands()
+        if (commands.isEmpty()) return
+
+        val results = try {
+            ensureConnectedOrThrow()
+            cancellable(commands.map { it.result }) {
+                if (commands.size == 1) {
+                    listOf(runCatching { bridge.execute(commands[0].command) })
+                } else {
+                    bridge.executeCoalesced(commands.map { it.command })
+                }
+            }
+        } catch (error: Throwable) {
+            commands.map { Result.failure(error) }
+        }
+        results.forEachIndexed { index, result -> commands[index].result.completeWith(result) }
+    }
+
+    // Connection thread only. Every [execute] launches one [sendPendingCommands] after queuing its
+    // command, so the commands left in the queue are picked up by the next launches.
+    private fun pollPendingCommands(): List<PendingCommand> {
+        val commands = mutableListOf<PendingCommand>()
+        while (true) {
+            val next = pendingCommands.peek() ?: break
+            if (!next.result.isActive) {
+                pendingCommands.poll()
+                continue
+            }
+            val hasDeadline = next.command.deadlineMs > 0
+            if (hasDeadline && commands.isNotEmpty()) break
+            commands.add(pendingCommands.poll())
+            if (hasDeadline) break
+        }
+        return commands
+    }
+
+    // Runs [block] on the connection thread while the caller only suspends, so that cancelling the
+    // caller aborts the native call instead of waiting for it.
+    private suspend fun <T> submit(block: () -> T): T {
+        val result = CompletableDeferred<T>()
+        connectionScope.launch {
+            result.completeWith(runCatching {
+                ensureConnectedOrThrow()
+                cancellable(listOf(result), block)
+            })
+        }.invokeOnCompletion { cause ->
+            if (cause != null) result.completeExceptionally(cause)
+        }
+        try {
+            return result.await()
+        } finally {
+            result.cancel()
+        }
+    }
+
+    // Connection thread only. Runs a blocking native call that is aborted as soon as every one of
+    // [requests] has been cancelled. An aborted call leaves the connection closed, it is opened
+    // again by the next command.
+    private fun <T> cancellable(requests: List<Job>, block: () -> T): T {
+        val lock = Any()
+        var armed = true
+        val handle = bridge.cancelArm()
+        val registrations = requests.map { request ->
+            request.invokeOnCompletion {
+                if (requests.all { it.isCancelled }) synchronized(lock) { if (armed) bridge.cancel(handle) }
+            }
+        }
+        try {
+            return block()
+        } finally {
+            val cancelled = synchronized(lock) {
+                armed = false
+                bridge.cancelDisarm(handle)
+            }
+            registrations.forEach { it.dispose() }
+            if (cancelled) {
+                logger?.logInfo(category = "COMMAND", message = "🛑 Command cancelled, closing the connection")
+                bridge.disconnect()
+                resultCache?.clear()
+                reconnectAfterCancel = true
+            }
+        }
+    }
+
+    /**
+     * Execute a SQL query on the SQLite Cloud database.
+     *
+     * This method allows to execute SQL commands (queries or updates) on the SQLite Cloud database
+     * associated with the active connection. It takes a generic SQL statement as input.
+     *
+     * @param query A generic SQL statement to execute.
+     * @param parameters An array of `SQLiteCloudValue` objects representing optional parameters to
+     *                 bind into the query.
+     *
+     * @return A `SQLiteCloudResult` object containing the result of the SQL command execution.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if an error occurs during the execution of the query.
+     *
+     * - Important: Please use [execute] with [SQLiteCloudCommand] if you have parameters in SQL statement.
+     *              This is important for safely binding values into the query and preventing SQL injection.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * try {
+     *     val sql = "SELECT * FROM users"
+     *     val result = sqliteCloud.execute(query = sql)
+     *     // Process the result
+     * } catch (error) {
+     *     print("Error: $error")
+     * }
+     * ```
+     */
+    suspend fun execute(query: String, vararg parameters: SQLiteCloudValue) =
+        withContext(connectionScope.coroutineContext) {
+            execute(SQLiteCloudCommand(query = query, parameters = parameters))
+        }
+
+    /**
+     * Execute a query and keep its rows in native memory, reading the cells only when accessed.
+     *
+     * Use this method instead of [execute] for large results, or results with blobs, when only
+     * part of the cells are needed or when blobs can be processed in place: blob values wrap the
+     * native memory without being copied. The returned rowset must be closed to release it.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL query and optional parameters.
+     *
+     * @return A [SQLiteCloudNativeRowset] that stays valid until it is closed.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if the command does not return a rowset.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * sqliteCloud.executeRowset(SQLiteCloudCommand("SELECT * FROM users")).use { rowset ->
+     *     val name = rowset.value(row = 0, column = 1)
+     * }
+     * ```
+     */
+    suspend fun executeRowset(command: SQLiteCloudCommand) = withContext(connectionScope.coroutineContext) {
+        ensureConnectedOrThrow()
+        bridge.executeRowset(command)
+    }
+
+    /**
+     * Load a rowset saved with [SQLiteCloudNativeRowset.save], with no connection.
+     *
+     * The file is memory-mapped and its cells are read in place, so the rows cached by a previous
+     * run are available at startup before the connection is established. The returned rowset
+     * must be closed to release the mapping.
+     *
+     * @param path The path passed to [SQLiteCloudNativeRowset.save].
+     *
+     * @return The loaded rowset, or null if the file is missing, truncated or was saved on a
+     *         device with a different byte order.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * sqliteCloud.loadRowset(cacheFile.path)?.use { rowset -> showUsers(rowset) }
+     * ```
+     */
+    fun loadRowset(path: String): SQLiteCloudNativeRowset? = bridge.loadRowset(path)
+
+    /**
+     * Load a rowset shared by another process with [SQLiteCloudNativeRowset.share], with no
+     * connection.
+     *
+     * The shared memory region is mapped and its cells are read in place, so a result handed over
+     * by a sync service costs no parsing and no copy of its cells. The descriptor can be closed as
+     * soon as this method returns, the returned rowset must be closed to release the mapping.
+     *
+     * @param descriptor The descriptor returned by [SQLiteCloudNativeRowset.share], as received
+     *                   through Binder.
+     *
+     * @return The loaded rowset, or null if the region was not written by
+     *         [SQLiteCloudNativeRowset.share] on this device.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val descriptor = bundle.getParcelable<ParcelFileDescriptor>("users")!!
+     * val rowset = descriptor.use { sqliteCloud.loadSharedRowset(it) }
+     * ```
+     */
+    fun loadSharedRowset(descriptor: ParcelFileDescriptor): SQLiteCloudNativeRowset? =
+        bridge.loadSharedRowset(descriptor)
+
+    /**
+     * Execute a query and return its rows stored column by column in primitive arrays.
+     *
+     * Use this method instead of [execute] for large results: a [SQLiteCloudColumnarRowset] needs a
+     * few arrays per column rather than one object per cell, and its typed getters read numeric
+     * cells without allocating.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL query and optional parameters.
+     *
+     * @return A [SQLiteCloudColumnarRowset] containing the rows of the result.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if the command does not return a rowset.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val rowset = sqliteCloud.executeColumnar(SQLiteCloudCommand("SELECT id FROM users"))
+     * val ids = LongArray(rowset.rowCount) { row -> rowset.getLong(row, 0) }
+     * ```
+     */
+    suspend fun executeColumnar(command: SQLiteCloudCommand) = submit {
+        bridge.executeColumnar(command)
+    }
+
+    /**
+     * Execute a query and return only some of its columns, stored column by column in primitive
+     * arrays.
+     *
+     * Use this method when the query returns more columns than needed and cannot be changed, as
+     * with views or `SELECT *`: the cells of the other columns are received but never decoded nor
+     * copied to the JVM.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL query and optional parameters.
+     * @param columns The zero-based indexes of the columns to return, in the order they are
+     *                wanted. An index can be repeated.
+     *
+     * @return A [SQLiteCloudColumnarRowset] whose column `i` is the column `columns[i]` of the result.
+     *
+     * @throws IndexOutOfBoundsException if an index is out of range.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if the command does not return a rowset.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val rowset = sqliteCloud.executeColumnar(SQLiteCloudCommand("SELECT * FROM users"), intArrayOf(0, 3))
+     * ```
+     */
+    suspend fun executeColumnar(command: SQLiteCloudCommand, columns: IntArray) = submit {
+        bridge.executeColumnar(command, columns = columns)
+    }
+
+    /**
+     * Execute a query and return only the columns called [columnNames], stored column by column
+     * in primitive arrays. See the variant that takes the column indexes.
+     *
+     * @throws SQLiteCloudError.Execution if a column is missing from the result, if there is an
+     *           issue with the SQL command or parameters, or if the command does not return a
+     *           rowset.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val rowset = sqliteCloud.executeColumnar(
+     *     SQLiteCloudCommand("SELECT * FROM users_view"),
+     *     listOf("id", "name", "email"),
+     * )
+     * ```
+     */
+    suspend fun executeColumnar(command: SQLiteCloudCommand, columnNames: List<String>) = submit {
+        bridge.executeColumnar(command, columnNames = columnNames)
+    }
+
+    /**
+     * Execute a query and export its rows through the Apache Arrow C Data Interface.
+     *
+     * The rowset is exported as a struct array with a child array for each column, into the
+     * `ArrowSchema` and `ArrowArray` structs allocated by the caller at [schemaAddress] and
+     * [arrayAddress]. The values are not copied: INTEGER and FLOAT columns point to the decoded
+     * column arrays, while TEXT and BLOB columns use the view layout and point to the received
+     * bytes. The native rowset stays alive until the release callback of the array is called.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL query and optional parameters.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if the command does not return a rowset.
+     *
+     * Example usage with Arrow Java's C Data module:
+     *
+     * ```kotlin
+     * ArrowSchema.allocateNew(allocator).use { schema ->
+     *     ArrowArray.allocateNew(allocator).use { array ->
+     *         sqliteCloud.executeArrow(SQLiteCloudCommand("SELECT * FROM users"), schema.memoryAddress(), array.memoryAddress())
+     *         Data.importVectorSchemaRoot(allocator, array, schema, CDataDictionaryProvider()).use { root -> /* ... */ }
+     *     }
+     * }
+     * ```
+     */
+    suspend fun executeArrow(command: SQLiteCloudCommand, schemaAddress: Long, arrayAddress: Long) = submit {
+        bridge.executeArrow(command, schemaAddress, arrayAddress)
+    }
+
+    /**
+     * Execute a SQL query on the SQLite Cloud database.
+     *
+     * This method allows to execute SQL commands (queries or updates) on the SQLite Cloud database
+     * associated with the active connection. It takes a generic SQL statement as input.
+     *
+     * @param query A generic SQL statement to execute.
+     * @param parameters An array of `SQLiteCloudValue` objects representing optional parameters to
+     *                 bind into the query.
+     *
+     * @return A [SQLiteCloudResult] object containing the result of the SQL command execution.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established,
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if an error occurs during the execution of the query.
+     *
+     * - Important: Please use [execute] with [SQLiteCloudCommand] if you have parameters in SQL statement.
+     *              This is important for safely binding values into the query and preventing SQL injection.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * try {
+     *     val sql = "SELECT * FROM users"
+     *     val result = try sqliteCloud.execute(query = sql)
+     *     // Process the result
+     * } catch (error) {
+     *     print("Error: $error")
+     * }
+     * ```
+     */
+    suspend fun execute(query: String, parameters: List<SQLiteCloudValue>) =
+        withContext(connectionScope.coroutineContext) {
+            execute(SQLiteCloudCommand(query = query, parameters = parameters))
+        }
+
+    /**
+     * Execute a SQL command on the SQLite Cloud database without blocking a thread while the
+     * reply is in flight.
+     *
+     * The command is sent from a shared event loop that waits for the replies of all the
+     * non-blocking commands at once, so many requests (on one or more connections) can be
+     * outstanding without occupying one thread each. Commands sent on the same connection are
+     * answered in order.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL command and optional parameters.
+     *
+     * @return A [SQLiteCloudResult] object containing the result of the SQL command execution.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if an error occurs during the execution of the query.
+     *
+     * - Important: Blocking methods such as [execute] fail on this connection while
+     *              non-blocking commands are still waiting for their reply. Commands whose reply
+     *              makes the client run other commands (e.g. `LISTEN`) are not supported.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val results = listOf("SELECT * FROM albums", "SELECT * FROM artists").map { sql ->
+     *     async { sqliteCloud.executeNonBlocking(SQLiteCloudCommand(sql)) }
+     * }.awaitAll()
+     * ```
+     */
+    suspend fun executeNonBlocking(command: SQLiteCloudCommand): SQLiteCloudResult {
+        ensureConnectedOrThrow()
+        return SQLiteCloudEventLoop.execute(bridge, command)
+    }
+
+    /**
+     * Execute a list of SQL commands on the SQLite Cloud database as a single pipeline.
+     *
+     * All the commands are written to the connection at once and their replies are read back
+     * in order, so the whole batch costs a single network round trip instead of one per command.
+     * Commands are executed by the server independently of each other: a failing command does not
+     * prevent the following ones from running.
+     *
+     * @param commands The list of [SQLiteCloudCommand] objects to execute.
+     *
+     * @return A list of [SQLiteCloudResult] objects, one for each command, in the same order.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if any of the commands fails. The error describes
+     *           the first failed command.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * try {
+     *     val results = sqliteCloud.executeAll(
+     *         listOf(
+     *             SQLiteCloudCommand("INSERT INTO users (name) VALUES (?)", SQLiteCloudValue.String("Alice")),
+     *             SQLiteCloudCommand("SELECT COUNT(*) FROM users"),
+     *         )
+     *     )
+     *     // Process the results
+     * } catch (error) {
+     *     print("Error: $error")
+     * }
+     * ```
+     */
+    suspend fun executeAll(commands: List<SQLiteCloudCommand>) = submit {
+        bridge.executeAll(commands)
+    }
+
+    /**
+     * Execute every statement of a multi-statement SQL string, with one result per statement.
+     *
+     * The statements are split on the client, quoted text, comments and trigger bodies included,
+     * and sent as a single pipeline like [executeAll], so loading a screen that needs several
+     * queries costs one round trip. Statements that contain only comments are skipped.
+     *
+     * @param sql The SQL statements, separated by semicolons.
+     *
+     * @return A list of [SQLiteCloudResult] objects, one for each statement, in the same order.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if any of the statements fails. The error describes
+     *           the first failed statement, the following statements were still executed.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val (artist, albums, tracks) = sqliteCloud.executeMulti(
+     *     "SELECT * FROM artists WHERE id = 1; SELECT * FROM albums WHERE artist_id = 1; SELECT COUNT(*) FROM tracks;"
+     * )
+     * ```
+     */
+    suspend fun executeMulti(sql: String) = submit {
+        bridge.executeMulti(sql)
+    }
+
+    /**
+     * Execute the same parameterized SQL statement once for each row of parameters.
+     *
+     * The rows are streamed to the server in pipelined batches instead of paying one network
+     * round trip per row, and the whole operation runs inside a savepoint: either every row is
+     * applied or, if any of them fails, none is. This makes it the preferred way to ingest large
+     * amounts of data with a single `INSERT` statement.
+     *
+     * @param query The SQL statement to execute, with one `?` placeholder per value.
+     * @param rows The parameters of each execution. Every row must contain the same number of
+     *             values, `SQLiteCloudValue.Null` included.
+     *
+     * @return A [SQLiteCloudBatchResult] with the total number of changes and the last inserted rowid.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if the rows do not have the same number of values or if
+     *           any of the executions fails. The error describes the first failed row.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val result = sqliteCloud.executeMany(
+     *     "INSERT INTO users (name, age) VALUES (?, ?)",
+     *     listOf(
+     *         listOf(SQLiteCloudValue.String("Alice"), SQLiteCloudValue.Integer(30)),
+     *         listOf(SQLiteCloudValue.String("Bob"), SQLiteCloudValue.Null),
+     *     ),
+     * )
+     * println("Inserted ${result.changes} rows")
+     * ```
+     */
+    suspend fun executeMany(query: String, rows: List<List<SQLiteCloudValue>>) = submit {
+        bridge.executeMany(query, rows)
+    }
+
+    /**
+     * Execute a write that does not depend on the writes before it, batched with the other writes
+     * of the same time window.
+     *
+     * With [SQLiteCloudConfig.writeBatchWindowMs] set, the write waits up to that many milliseconds
+     * (or until [SQLiteCloudConfig.writeBatchMaxStatements] writes are waiting), then all the writes
+     * of the window are sent as one pipeline and committed as a single transaction: one round trip
+     * and one commit on the server instead of one each. Every caller still gets the result or the
+     * error of its own write. A failed write affects the others as set by
+     * [SQLiteCloudConfig.writeBatchFailure]. Without a window, and for commands with a deadline,
+     * this is the same as [execute].
+     *
+     * Use it for small fire-and-forget writes such as analytics events or settings updates, not for
+     * reads or for writes whose order matters with the commands sent through [execute].
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL write and optional parameters.
+     *
+     * @return The `SQLiteCloudResult` of the write.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if the write fails, or with
+     *           [SQLiteCloudError.Execution.writeBatchRolledBack] if it was rolled back because of
+     *           another write of its batch.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * sqliteCloud.executeBatched(
+     *     SQLiteCloudCommand("INSERT INTO events (name) VALUES (?)", listOf(SQLiteCloudValue.String("open")))
+     * )
+     * ```
+     */
+    suspend fun executeBatched(command: SQLiteCloudCommand): SQLiteCloudResult {
+        val window = config.writeBatchWindowMs
+        if (window <= 0 || command.deadlineMs > 0) {
+            return execute(command)
+        }
+
+        val pending = PendingCommand(command)
+        pendingWrites.add(pending)
+        if (pendingWriteCount.incrementAndGet() >= maxWriteBatch) {
+            launchPendingWrites(0)
+        } else if (writeWindowOpen.compareAndSet(false, true)) {
+            launchPendingWrites(window.toLong())
+        }
+        try {
+            return pending.result.await()
+        } finally {
+            // A write cancelled while still queued is skipped instead of being sent later.
+            pending.result.cancel()
+        }
+    }
+
+    /**
+     * Run [block] as a transaction, with as few round trips as its statements allow.
+     *
+     * `BEGIN` travels with the first statements of the block, and the statements queued with
+     * [SQLiteCloudTransaction.enqueue] travel together with the next one whose result is needed,
+     * see [SQLiteCloudTransaction]. The transaction is committed when [block] returns and rolled
+     * back when it throws, a failed statement included.
+     *
+     * - Important: The transaction belongs to the connection: commands sent through other methods
+     *              while [block] runs are part of it. Transactions do not nest.
+     *
+     * @param block The statements of the transaction.
+     *
+     * @return The value returned by [block].
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if a statement or the commit fails.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * sqliteCloud.transaction {
+     *     enqueue(SQLiteCloudCommand("UPDATE accounts SET balance = balance - 10 WHERE id = 1"))
+     *     enqueue(SQLiteCloudCommand("UPDATE accounts SET balance = balance + 10 WHERE id = 2"))
+     * }
+     * ```
+     */
+    suspend fun <T> transaction(block: suspend SQLiteCloudTransaction.() -> T): T {
+        val transaction = SQLiteCloudTransaction { commands -> submit { bridge.executeCoalesced(commands) } }
+        try {
+            return block(transaction).also { transaction.commit() }
+        } catch (error: Throwable) {
+            withContext(NonCancellable) { transaction.rollback() }
+            throw error
+        }
+    }
+
+    /**
+     * Queue a write to be sent whenever the server can be reached, surviving disconnections and
+     * restarts of the app.
+     *
+     * The write is appended to a file of the app and synced to the disk before this method
+     * returns, which takes no round trip: use it for writes that must not be lost and whose result
+     * is not needed, such as the changes made while offline. The writes are replayed in the order
+     * they were queued, in pipelines of up to [SQLiteCloudOfflineQueue.replayBatchSize] writes
+     * committed as a single transaction, as soon as the connection is open: after [connect], after
+     * [setNetworkClass], after another call to this method, or when [replayOfflineQueue] is called.
+     *
+     * Every write carries an idempotency key that is recorded by the server in the
+     * `sqlitecloud_offline_log` table together with the write, so a write is applied once even when
+     * the connection drops before its batch is acknowledged. A write that the server refuses is
+     * dropped and reported by [offlineFailures].
+     *
+     * - Important: Requires [SQLiteCloudConfig.offlineQueue]. The queue is a file per database
+     *              and user, only one client of the process should queue writes for each. The
+     *              writes are not ordered with the commands sent through the other methods.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL write and optional parameters.
+     *
+     * @return The idempotency key of the write.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * sqliteCloud.enqueueWrite(
+     *     SQLiteCloudCommand("UPDATE notes SET body = ? WHERE id = ?", listOf(SQLiteCloudValue.String(body), SQLiteCloudValue.Integer(id)))
+     * )
+     * ```
+     */
+    suspend fun enqueueWrite(command: SQLiteCloudCommand): String {
+        check(config.offlineQueue) { "The offline queue is not enabled, see SQLiteCloudConfig.offlineQueue" }
+        val key = withContext(Dispatchers.IO) { offlineQueue.append(command) }
+        offlineReplayWanted.trySend(Unit)
+        return key
+    }
+
+    /**
+     * Send the writes of [enqueueWrite] still queued, see [enqueueWrite].
+     *
+     * @return The number of writes applied.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established, the writes are
+     *           then replayed later.
+     */
+    suspend fun replayOfflineQueue(): Int {
+        if (!config.offlineQueue) return 0
+        return offlineReplayLock.withLock {
+            withContext(Dispatchers.IO) {
+                offlineQueue.replay(
+                    send = { commands -> submit { bridge.executeCoalesced(commands) } },
+                    failed = { failure ->
+                        logger?.logError(category = "COMMAND", message = "🚨 Offline write ${failure.key} refused: ${failure.error}")
+                        offlineFailureEvents.tryEmit(failure)
+                    },
+                )
+            }
+        }
+    }
+
+    private val maxWriteBatch: Int
+        get() = config.writeBatchMaxStatements.coerceAtLeast(1)
+
+    private fun launchPendingWrites(delayMs: Long) {
+        connectionScope.launch {
+            if (delayMs > 0) {
+                delay(delayMs)
+                // Closed before polling, so that a write queued meanwhile opens a new window if it
+                // is not picked up by this batch.
+                writeWindowOpen.set(false)
+            }
+            sendPendingWrites()
+        }.invokeOnCompletion { cause ->
+            if (cause != null) {
+                if (delayMs > 0) writeWindowOpen.set(false)
+                generateSequence { pendingWrites.poll() }.forEach {
+                    pendingWriteCount.decrementAndGet()
+                    it.result.completeExceptionally(cause)
+                }
+            }
+        }
+    }
+
+    // Connection thread only. Sends the oldest writes queued, up to a full batch.
+    private suspend fun sendPendingWrites() {
+        val writes = mutableListOf<PendingCommand>()
+        while (writes.size < maxWriteBatch) {
+            val next = pendingWrites.poll() ?: break
+            pendingWriteCount.decrementAndGet()
+            if (next.result.isActive) writes.add(next)
+        }
+        if (writes.isEmpty()) return
+
+        val results = try {
+            ensureConnectedOrThrow()
+            cancellable(writes.map { it.result }) {
+                if (writes.size == 1) {
+                    listOf(runCatching { bridge.execute(writes[0].command) })
+                } else {
+                    bridge.executeWriteBatch(
+                        commands = writes.map { it.command },
+                        atomic = config.writeBatchFailure == SQLiteCloudConfig.WriteBatchFailure.Atomic,
+                    )
+                }
+            }
+        } catch (error: Throwable) {
+            writes.map { Result.failure(error) }
+        }
+        results.forEachIndexed { index, result -> writes[index].result.completeWith(result) }
+    }
+
+    /**
+     * Execute a SQL query on the SQLite Cloud database and stream its rows.
+     *
+     * Instead of materializing the whole rowset, rows are emitted as soon as each chunk is received
+     * from the server and every chunk is released once its rows have been emitted. Use this method
+     * for large results, together with the `maxrows` or `maxrowset` connection options so that the
+     * server sends the rowset in chunks.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL query and optional parameters.
+     *
+     * @return A cold [Flow] emitting one list of values for each row of the result.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if an error occurs while receiving the rows.
+     *
+     * - Important: The connection cannot be used for other commands until the flow completes.
+     *              Cancelling the collection drains the remaining chunks before returning.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * sqliteCloud.stream(SQLiteCloudCommand("SELECT * FROM events")).collect { row ->
+     *     // Process the row
+     * }
+     * ```
+     */
+    fun stream(command: SQLiteCloudCommand): Flow<List<SQLiteCloudValue>> = flow {
+        ensureConnectedOrThrow()
+        val cursor = bridge.openCursor(command)
+        try {
+            while (true) {
+                val rows = bridge.nextCursorRows(cursor) ?: break
+                rows.forEach { emit(it) }
+            }
+        } finally {
+            bridge.closeCursor(cursor)
+        }
+    }.flowOn(connectionScope.coroutineContext.minusKey(Job))
+
+    /**
+     * Execute a query and stream its result one chunk at a time, in columnar form.
+     *
+     * Chunks are emitted as they are received, so the whole result never has to be held in memory.
+     * The server sends at most [SQLiteCloudConfig.maxRows] rows per chunk when it is set.
+     *
+     * When [SQLiteCloudConfig.chunkWindow] is set, at most that many chunks are received ahead of
+     * the collector: once the window is full the socket is no longer read, and TCP flow control
+     * stops the server until the collector catches up. Memory is then bounded by the window
+     * whatever the size of the result.
+     *
+     * @param command A `SQLiteCloudCommand` object containing the SQL query and optional parameters.
+     *
+     * @return A cold [Flow] emitting one [SQLiteCloudColumnarRowset] for each chunk of the result.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if an error occurs while receiving the chunks.
+     *
+     * - Important: The connection cannot be used for other commands until the flow completes.
+     *              Cancelling the collection drains the remaining chunks before returning.
+     */
+    fun streamColumnar(command: SQLiteCloudCommand): Flow<SQLiteCloudColumnarRowset> = flow {
+        ensureConnectedOrThrow()
+        val cursor = bridge.openCursor(command)
+        try {
+            while (true) {
+                emit(bridge.nextCursorChunk(cursor) ?: break)
+            }
+        } finally {
+            bridge.closeCursor(cursor)
+        }
+    }.buffer(chunkBufferCapacity).flowOn(connectionScope.coroutineContext.minusKey(Job))
+
+    // The chunk being sent by the producer is received too, so the buffer holds one chunk less
+    // than the window.
+    private val chunkBufferCapacity: Int
+        get() = if (config.chunkWindow > 0) config.chunkWindow - 1 else Channel.BUFFERED
+
+    /**
+     * Execute a read query and keep its result up to date with the change notifications of its
+     * tables, instead of polling it.
+     *
+     * The flow first emits the whole result, then listens to the tables declared in
+     * [SQLiteCloudCommand.cacheTables]. The first of them is the table whose primary key, or
+     * rowid, is selected by the query as [keyColumn]. A notification for rows of that table
+     * carries their key, so only those rows are sent again, filtered by the query, and the flow
+     * emits the rows inserted, updated or deleted: the cost of a refresh follows the number of
+     * changed rows, not the size of the result. Any other notification, for another table, a
+     * composite primary key or a whole table, as well as notifications dropped by a full queue or
+     * more than a few hundred changed rows, send the whole query again and emit a reset diff.
+     *
+     * @param command The read query, with the tables it reads in
+     *                [SQLiteCloudCommand.cacheTables].
+     * @param keyColumn The column of the result holding the primary key of the first table.
+     *
+     * @return A cold [Flow] of [SQLiteCloudRowsetDiff], the first of which is a reset.
+     *
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
+     *
+     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
+     *           parameters, or if the result has no [keyColumn].
+     *
+     * - Important: Changed rows are filtered again by the query as a subquery, so a query that
+     *              aggregates, orders or limits its rows only stays exact through reset diffs.
+     *              Declare a single table, or join others only through notifications that are
+     *              rare, for those queries.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val command = SQLiteCloudCommand(
+     *     query = "SELECT id, name, score FROM players WHERE team = ?",
+     *     parameters = listOf(SQLiteCloudValue.String("red")),
+     *     cacheTables = listOf("players"),
+     * )
+     * var rowset: SQLiteCloudColumnarRowset? = null
+     * sqliteCloud.liveQuery(command, keyColumn = "id").collect { diff ->
+     *     rowset = diff.applyTo(rowset)
+     * }
+     * ```
+     */
+    fun liveQuery(command: SQLiteCloudCommand, keyColumn: String): Flow<SQLiteCloudRowsetDiff> = channelFlow {
+        require(command.cacheTables.isNotEmpty()) { "A live query must declare the tables it reads" }
+        val tables = command.cacheTables.map { it.lowercase() }
+        val changes = Channel<List<SQLiteCloudPayload>>(Channel.UNLIMITED)
+        val collector = launch(start = CoroutineStart.UNDISPATCHED) {
+            notifications.collect { changes.send(it) }
+        }
+
+        val retained = mutableListOf<SQLiteCloudChannel>()
+        try {
+            for (table in tables.distinct()) {
+                val channel = SQLiteCloudChannel.Table(table)
+                retainChannel(channel)
+                retained.add(channel)
+            }
+
+            var dropped = droppedNotifications
+            var rowset = executeColumnar(command)
+            var keys = liveQueryKeys(rowset, keyColumn)
+            send(SQLiteCloudRowsetDiff.reset(keyColumn, rowset))
+
+            while (true) {
+                val batch = changes.receive().toMutableList()
+                while (true) batch += changes.tryReceive().getOrNull() ?: break
+                val payloads = batch.filter { it.channel.lowercase() in tables }
+                if (payloads.isEmpty() && dropped == droppedNotifications) continue
+
+                // Keys of the rows of the first table, the last notification of a row wins.
+                val changed = LinkedHashSet<String>()
+                val deleted = mutableSetOf<String>()
+                var keyed = dropped == droppedNotifications
+                for (payload in payloads) {
+                    if (payload.channel.lowercase() != tables[0] || payload.pk.size != 1) {
+                        keyed = false
+                        break
+                    }
+                    when (payload.messageType) {
+                        SQLiteCloudPayload.MessageType.Insert, SQLiteCloudPayload.MessageType.Update -> {
+                            deleted.remove(payload.pk[0])
+                            changed.add(payload.pk[0])
+                        }
+
+                        SQLiteCloudPayload.MessageType.Delete -> {
+                            changed.remove(payload.pk[0])
+                            deleted.add(payload.pk[0])
+                        }
+
+                        else -> keyed = false
+                    }
+                }
+
+                if (!keyed || changed.size > liveQueryMaxKeys) {
+                    dropped = droppedNotifications
+                    rowset = executeColumnar(command)
+                    keys = liveQueryKeys(rowset, keyColumn)
+                    send(SQLiteCloudRowsetDiff.reset(keyColumn, rowset))
+                    continue
+                }
+
+                val fetched = if (changed.isEmpty()) {
+                    rowset.copyRows(emptyList())
+                } else {
+                    executeColumnar(liveQueryRows(command, keyColumn, changed))
+                }
+                val fetchedKey = fetched.columnIndex(keyColumn)
+                val inserted = mutableListOf<Int>()
+                val updated = mutableListOf<Int>()
+                for (row in 0..<fetched.rowCount) {
+                    val key = fetched.getString(row, fetchedKey) ?: continue
+                    changed.remove(key)
+                    (if (keys.add(key)) inserted else updated).add(row)
+                }
+                // The rows that the query no longer returns left the result.
+                deleted.addAll(changed)
+                deleted.retainAll(keys)
+                keys.removeAll(deleted)
+
+                if (inserted.isEmpty() && updated.isEmpty() && deleted.isEmpty()) continue
+                send(
+                    SQLiteCloudRowsetDiff(
+                        keyColumn,
+                        false,
+                        fetched.copyRows(inserted),
+                        fetched.copyRows(updated),
+                        deleted,
+                    ),
+                )
+            }
+        } finally {
+            collector.cancel()
+            withContext(NonCancellable) {
+                retained.forEach { change(channel = it, counter = -1) }
+            }
+        }
+    }
+
+    // The rows of a live query with the given keys, by filtering the query as a subquery. Keys
+    // that are integers are bound as such, so that they match INTEGER PRIMARY KEY and rowid.
+    private fun liveQueryRows(command: SQLiteCloudCommand, keyColumn: String, keys: Collection<String>) =
+        SQLiteCloudCommand(
+            query = "SELECT * FROM (${command.query.trim().trimEnd(';')}) " +
+                "WHERE \"${keyColumn.replace("\"", "\"\"")}\" IN " +
+                keys.joinToString(",", "(", ")") { "?" },
+            parameters = command.parameters + keys.map { key ->
+                key.toLongOrNull()?.let { SQLiteCloudValue.Integer(it) } ?: SQLiteCloudValue.String(key)
+            },
+            priority = command.priority,
+            options = command.options,
+        )
+
+    // The keys of the rows of a live query.
+    private fun liveQueryKeys(rowset: SQLiteCloudColumnarRowset, keyColumn: String): MutableSet<String> {
+        val column = rowset.columnIndex(keyColumn)
+        return (0..<rowset.rowCount).mapNotNullTo(HashSet(rowset.rowCount)) { rowset.getString(it, column) }
+    }
+
+    /// Text formats of [export] and [import].
+    enum class FileFormat(val value: Int) {
+        /// RFC 4180 CSV with a header line of column names. NULL is an empty field.
+        Csv(1),
+
+        /// One JSON object per line, keyed by column name.
+        NdJson(2),
     }
 
     /**
-     * Execute a SQL query on the SQLite Cloud database.
+     * Execute a query and write its rows to a file, formatted natively as they are received.
      *
-     * This method allows to execute SQL commands (queries or updates) on the SQLite Cloud database
-     * associated with the active connection. It takes a generic SQL statement as input.
+     * The rows never reach the JVM: each chunk is formatted from the received bytes into a large
+     * buffer and released before the next one is read, so the export runs at network speed with
+     * constant memory. Use it together with the `maxrows` or `maxrowset` connection options so
+     * that the server sends the rowset in chunks. BLOB cells are written in base64.
      *
-     * @param query A generic SQL statement to execute.
-     * @param parameters An array of `SQLiteCloudValue` objects representing optional parameters to
-     *                 bind into the query.
+     * @param command A `SQLiteCloudCommand` object containing the SQL query and optional parameters.
+     * @param format The format of the file.
+     * @param path The file to write, created or truncated.
      *
-     * @return A `SQLiteCloudResult` object containing the result of the SQL command execution.
+     * @return The number of rows written.
      *
      * @throws SQLiteCloudError.Connection if the connection cannot be established.
      *
      * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
-     *           parameters, or if an error occurs during the execution of the query.
-     *
-     * - Important: Please use [execute] with [SQLiteCloudCommand] if you have parameters in SQL statement.
-     *              This is important for safely binding values into the query and preventing SQL injection.
+     *           parameters, or if the file cannot be written. The file then holds the rows
+     *           written so far.
      *
      * Example usage:
      *
      * ```kotlin
-     * try {
-     *     val sql = "SELECT * FROM users"
-     *     val result = sqliteCloud.execute(query = sql)
-     *     // Process the result
-     * } catch (error) {
-     *     print("Error: $error")
-     * }
+     * val rows = sqliteCloud.export(
+     *     SQLiteCloudCommand("SELECT * FROM events"),
+     *     SQLiteCloud.FileFormat.Csv,
+     *     File(context.filesDir, "events.csv").toPath(),
+     * )
      * ```
      */
-    suspend fun execute(query: String, vararg parameters: SQLiteCloudValue) =
-        withContext(scope.coroutineContext) {
-            execute(SQLiteCloudCommand(query = query, parameters = parameters))
+    suspend fun export(
+        command: SQLiteCloudCommand,
+        format: FileFormat,
+        path: Path,
+    ): Long = withContext(connectionScope.coroutineContext) {
+        ensureConnectedOrThrow()
+        val mode = ParcelFileDescriptor.MODE_WRITE_ONLY or ParcelFileDescriptor.MODE_CREATE or
+            ParcelFileDescriptor.MODE_TRUNCATE
+        openDatabaseFile(path.toFile(), mode).use { file ->
+            bridge.exportRowset(command, format, file.fd)
         }
+    }
 
     /**
-     * Execute a SQL query on the SQLite Cloud database.
-     *
-     * This method allows to execute SQL commands (queries or updates) on the SQLite Cloud database
-     * associated with the active connection. It takes a generic SQL statement as input.
-     *
-     * @param query A generic SQL statement to execute.
-     * @param parameters An array of `SQLiteCloudValue` objects representing optional parameters to
-     *                 bind into the query.
+     * Execute a statement once for every record of a CSV or NDJSON file, parsed natively.
      *
-     * @return A [SQLiteCloudResult] object containing the result of the SQL command execution.
+     * The file is mapped and split into records while the previous batch is uploaded, and each
+     * batch of [batchRows] records is executed as an array batch in a transaction of its own, so
+     * the import runs at network speed and none of the records reaches the JVM. [command] takes a
+     * `?` for each field: the fields of a CSV record (its first line is a header and is skipped),
+     * or the values of an NDJSON object in key order. Every record must have as many fields as
+     * the first one.
      *
-     * @throws SQLiteCloudError.Connection if the connection cannot be established,
+     * CSV fields are NULL when empty, INTEGER or FLOAT when they are JSON numbers and TEXT
+     * otherwise; quoted fields are always TEXT. JSON booleans become 1 and 0, nested objects and
+     * arrays are passed as their JSON text.
      *
-     * @throws SQLiteCloudError.Execution if there is an issue with the SQL command or
-     *           parameters, or if an error occurs during the execution of the query.
+     * @param command The SQL statement, for example `INSERT INTO events VALUES (?, ?, ?)`.
+     * @param format The format of the file.
+     * @param path The file to read.
+     * @param batchRows The number of records executed in each transaction, 0 for the default.
      *
-     * - Important: Please use [execute] with [SQLiteCloudCommand] if you have parameters in SQL statement.
-     *              This is important for safely binding values into the query and preventing SQL injection.
+     * @return The number of records and of changes.
      *
-     * Example usage:
+     * @throws SQLiteCloudError.Connection if the connection cannot be established.
      *
-     * ```kotlin
-     * try {
-     *     val sql = "SELECT * FROM users"
-     *     val result = try sqliteCloud.execute(query = sql)
-     *     // Process the result
-     * } catch (error) {
-     *     print("Error: $error")
-     * }
-     * ```
+     * @throws SQLiteCloudError.Execution if the statement fails or a record is malformed. The
+     *           batches executed before it stay committed.
      */
-    suspend fun execute(query: String, parameters: List<SQLiteCloudValue>) =
-        withContext(scope.coroutineContext) {
-            execute(SQLiteCloudCommand(query = query, parameters = parameters))
+    suspend fun import(
+        command: String,
+        format: FileFormat,
+        path: Path,
+        batchRows: Int = 0,
+    ): SQLiteCloudImportResult = withContext(connectionScope.coroutineContext) {
+        ensureConnectedOrThrow()
+        openDatabaseFile(path.toFile(), ParcelFileDescriptor.MODE_READ_ONLY).use { file ->
+            bridge.importFile(command, format, file.fd, batchRows)
         }
+    }
 
-    suspend fun useDatabase(databaseName: String) = withContext(scope.coroutineContext) {
+    suspend fun useDatabase(databaseName: String) = withContext(connectionScope.coroutineContext) {
+        // Table names of the cached results refer to the previous database.
+        resultCache?.clear()
         execute(SQLiteCloudCommand.useDatabase(databaseName))
     }
 
@@ -485,31 +2296,136 @@ class SQLiteCloud(
      * }
      * ```
      */
-    suspend inline fun <reified P> notify(message: SQLiteCloudMessage<P>): SQLiteCloudResult =
-        withContext(scope.coroutineContext) {
-            if (message.createChannelIfNotExist) {
-                execute(
-                    command = SQLiteCloudCommand.createChannel(
-                        message.channel,
-                        ifNotExists = true,
-                    ),
-                )
-            }
-
+    suspend inline fun <reified P> notify(message: SQLiteCloudMessage<P>): SQLiteCloudResult {
+        // execute and sendNotification run on the connection thread themselves.
+        if (message.createChannelIfNotExist) {
             execute(
-                command = SQLiteCloudCommand.notify(
-                    channel = message.channel,
-                    payload = Json.encodeToString(message.payload),
+                command = SQLiteCloudCommand.createChannel(
+                    message.channel,
+                    ifNotExists = true,
                 ),
             )
         }
 
+        return sendNotification(
+            channel = message.channel,
+            payload = Json.encodeToString(message.payload),
+        )
+    }
+
+    /**
+     * Sends a notification to the specified channel for each one of the payloads.
+     *
+     * The notifications are pipelined, so that a batch costs one round trip for every 1024
+     * payloads instead of one per payload. Every payload is sent even if one of them fails, in
+     * which case the error of the first failure is thrown once the batch is complete.
+     *
+     * - Parameters:
+     *   - channel: The channel on which to send the notifications.
+     *   - payloads: The payloads of the notifications, in the order in which they are sent.
+     *   - createChannelIfNotExist: Whether to create the channel before sending the notifications.
+     * - Throws: `SQLiteCloudError` if an error occurs while sending the notifications.
+     */
+    suspend inline fun <reified P> notifyAll(
+        channel: String,
+        payloads: List<P>,
+        createChannelIfNotExist: Boolean = false,
+    ) {
+        if (createChannelIfNotExist) {
+            execute(command = SQLiteCloudCommand.createChannel(channel, ifNotExists = true))
+        }
+
+        sendNotifications(channel, payloads.map { Json.encodeToString(it) })
+    }
+
+    @PublishedApi
+    internal suspend fun sendNotifications(channel: String, payloads: List<String>) {
+        submit { bridge.notifyMany(channel, payloads) }
+    }
+
+    // With [SQLiteCloudConfig.notifyWindowMs] the notification waits for the window opened by the
+    // first one queued, then every notification of the window is sent as one batch per channel.
+    @PublishedApi
+    internal suspend fun sendNotification(channel: String, payload: String): SQLiteCloudResult {
+        val window = config.notifyWindowMs
+        if (window <= 0) {
+            return execute(command = SQLiteCloudCommand.notify(channel = channel, payload = payload))
+        }
+
+        val pending = PendingNotification(channel, payload)
+        pendingNotifications.add(pending)
+        if (notifyWindowOpen.compareAndSet(false, true)) {
+            connectionScope.launch {
+                delay(window.toLong())
+                // Closed before polling, so that a notification queued meanwhile opens a new window
+                // if it is not picked up by this one.
+                notifyWindowOpen.set(false)
+                sendPendingNotifications()
+            }.invokeOnCompletion { cause ->
+                if (cause != null) {
+                    notifyWindowOpen.set(false)
+                    generateSequence { pendingNotifications.poll() }
+                        .forEach { it.result.completeExceptionally(cause) }
+                }
+            }
+        }
+        try {
+            pending.result.await()
+            return SQLiteCloudResult.Success
+        } finally {
+            // A notification cancelled while still queued is skipped instead of being sent later.
+            pending.result.cancel()
+        }
+    }
+
+    // Connection thread only. The channels are sent in the order of their first notification, the
+    // order of the notifications of each channel is preserved.
+    private suspend fun sendPendingNotifications() {
+        val notifications = generateSequence { pendingNotifications.poll() }
+            .filter { it.result.isActive }
+            .toList()
+        if (notifications.isEmpty()) return
+
+        val connected = runCatching { ensureConnectedOrThrow() }
+        notifications.groupBy { it.channel }.forEach { (channel, batch) ->
+            val result = connected.mapCatching {
+                cancellable(batch.map { it.result }) {
+                    bridge.notifyMany(channel, batch.map { it.payload })
+                }
+            }
+            batch.forEach { it.result.completeWith(result) }
+        }
+    }
+
+    // Starts listening notifications for a given channel/table, on the connection of the host for
+    // a client that shares its pub/sub connection. Released with [change].
+    private suspend fun retainChannel(channel: SQLiteCloudChannel): Unit =
+        withContext(connectionScope.coroutineContext) {
+            val host = pubSubHost
+            if (host == null) {
+                execute(SQLiteCloudCommand.listen(channel))
+            } else if ((channels[channel] ?: 0) == 0) {
+                host.listenForGuest(channel)
+            }
+
+            channels[channel] = (channels[channel] ?: 0) + 1
+            bridge.pubSubFilterAdd(channel.name)
+        }
+
     private suspend fun change(channel: SQLiteCloudChannel, counter: Int): Unit =
-        withContext(scope.coroutineContext) {
+        withContext(connectionScope.coroutineContext) {
             channels[channel] = (channels[channel] ?: 0) + counter
+            if (counter < 0) {
+                repeat(-counter) { bridge.pubSubFilterRemove(channel.name) }
+            }
 
             if (channels[channel] == 0) {
-                execute(SQLiteCloudCommand.unlisten(channel))
+                val host = pubSubHost
+                if (host != null) {
+                    host.unlistenForGuest(channel)
+                } else if ((guestChannels[channel] ?: 0) == 0) {
+                    execute(SQLiteCloudCommand.unlisten(channel))
+                }
                 logger?.logInfo(
                     category = "PUB/SUB",
                     message = "🙉 Unlisten channel '${channel.name}'",
@@ -517,6 +2433,84 @@ class SQLiteCloud(
             }
         }
 
+    /**
+     * Receives the notifications of this client through the pub/sub connection of [host], which
+     * must connect to the same server as the same user, instead of opening a pub/sub connection
+     * of its own. The channels of this client are listened to by [host] on its behalf and their
+     * notifications are routed natively to this client by channel. Pass null to go back to a
+     * pub/sub connection of its own.
+     *
+     * The sharing is restored when this client connects again, but it ends when [host]
+     * disconnects or loses its pub/sub connection. The tables listened to by the result cache
+     * still use the pub/sub connection of this client.
+     *
+     * @param host The client whose pub/sub connection is shared, or null.
+     * @throws SQLiteCloudError if [host] cannot share its pub/sub connection with this client.
+     */
+    suspend fun sharePubSub(host: SQLiteCloud?): Unit = withContext(connectionScope.coroutineContext) {
+        require(host !== this) { "A client cannot share its own pub/sub connection" }
+        val previous = pubSubHost
+        if (previous === host) return@withContext
+
+        ensureConnectedOrThrow()
+        attachPubSubHost(host)
+        pubSubHost = host
+
+        // The channels are listened to on the new connection before they are released by the
+        // previous one, so that no notification is missed.
+        channels.filterValues { it > 0 }.keys.forEach { channel ->
+            if (host != null) {
+                host.listenForGuest(channel)
+            } else {
+                execute(SQLiteCloudCommand.listen(channel))
+            }
+            if (previous != null) {
+                previous.unlistenForGuest(channel)
+            } else {
+                execute(SQLiteCloudCommand.unlisten(channel))
+            }
+        }
+
+        logger?.logInfo(
+            category = "PUB/SUB",
+            message = host?.let { "🔗 Sharing the pub/sub connection of ${it.config.connectionString}" }
+                ?: "🔗 Using a pub/sub connection of its own",
+        )
+    }
+
+    // Connection thread only. The connection of [host] is read on its own thread.
+    private suspend fun attachPubSubHost(host: SQLiteCloud?) {
+        val attached = if (host != null) {
+            withContext(host.connectionScope.coroutineContext) {
+                host.ensureConnectedOrThrow()
+                bridge.setPubSubHost(host.bridge)
+            }
+        } else {
+            bridge.setPubSubHost(null)
+        }
+        if (!attached) {
+            throw bridge.error()
+        }
+    }
+
+    // Listens to [channel] on behalf of a guest, when the first handler of the guest is added.
+    private suspend fun listenForGuest(channel: SQLiteCloudChannel): Unit =
+        withContext(connectionScope.coroutineContext) {
+            execute(SQLiteCloudCommand.listen(channel))
+            guestChannels[channel] = (guestChannels[channel] ?: 0) + 1
+        }
+
+    // The channel stays listened to while this client or another guest still has handlers.
+    private suspend fun unlistenForGuest(channel: SQLiteCloudChannel): Unit =
+        withContext(connectionScope.coroutineContext) {
+            val guests = (guestChannels[channel] ?: 0) - 1
+            if (guests > 0) guestChannels[channel] = guests else guestChannels.remove(channel)
+
+            if (guests <= 0 && (channels[channel] ?: 0) == 0) {
+                execute(SQLiteCloudCommand.unlisten(channel))
+            }
+        }
+
     /**
      * Listen for notifications on a specified SQLite Cloud channel.
      *
@@ -559,11 +2553,8 @@ class SQLiteCloud(
      *         from the channel when you no longer wish to receive notifications, freeing up resources.
      */
     suspend fun listen(channel: SQLiteCloudChannel, callback: NotificationHandler): Any =
-        withContext(scope.coroutineContext) {
-            // Starts listening notifications for a given channel/table.
-            execute(SQLiteCloudCommand.listen(channel))
-
-            channels[channel] = (channels[channel] ?: 0) + 1
+        withContext(connectionScope.coroutineContext) {
+            retainChannel(channel)
 
             val onUnsubscribe: Callback<SQLiteCloudChannel> = { channel ->
                 scope.launch {
@@ -593,6 +2584,8 @@ class SQLiteCloud(
      * @param databaseName the uploaded database name.
      * @param databasePath the path of the local database file.
      * @param databaseEncryptionKey the optional key the database was encrypted with.
+     * @param chunkSize the size of the uploaded chunks (up to 4 MB), `0` tunes it from the
+     * measured throughput.
      * @throws SQLiteCloudError
      *
      * Example usage:
@@ -611,23 +2604,19 @@ class SQLiteCloud(
         databaseName: String,
         databasePath: Path,
         databaseEncryptionKey: String?,
+        chunkSize: Int = 0,
         progressHandler: ProgressHandler,
-    ) = withContext(scope.coroutineContext) {
+    ) = withContext(connectionScope.coroutineContext) {
         ensureConnectedOrThrow()
-        // Create an upload helper that manages the data stream and the progress of the upload.
-        val dataHandler = DataHandler(path = databasePath, progressHandler = progressHandler)
-        val success = bridge.uploadDatabase(
-            name = databaseName,
-            encryptionKey = databaseEncryptionKey,
-            dataHandler = dataHandler,
-            fileSize = dataHandler.fileSize,
-        ) { dataHandler, buffer, bufferLength, totalLength, previousProgress ->
-            dataHandler.read(
-                buffer,
-                bufferLength,
-                totalLength,
-                previousProgress,
-            ).bytesTransferred
+        // The file is read natively, only the progress crosses into the JVM.
+        val success = openDatabaseFile(databasePath.toFile(), ParcelFileDescriptor.MODE_READ_ONLY).use { file ->
+            bridge.uploadDatabaseFile(
+                name = databaseName,
+                encryptionKey = databaseEncryptionKey,
+                fd = file.fd,
+                chunkSize = chunkSize,
+                callback = progressCallback(progressHandler),
+            )
         }
 
         if (!success) {
@@ -666,20 +2655,16 @@ class SQLiteCloud(
     suspend fun download(
         databaseName: String,
         progressHandler: ProgressHandler,
-    ): Path = withContext(scope.coroutineContext) {
+    ): Path = withContext(connectionScope.coroutineContext) {
         ensureConnectedOrThrow()
         val path = Files.createTempFile(UUID.randomUUID().toString(), null)
-        val dataHandler = DataHandler(path = path, progressHandler = progressHandler)
-        val success = bridge.downloadDatabase(
-            name = databaseName,
-            dataHandler = dataHandler,
-        ) { dataHandler, buffer, bufferLength, totalLength, previousProgress ->
-            dataHandler.write(
-                buffer,
-                bufferLength,
-                totalLength,
-                previousProgress,
-            ).bytesTransferred
+        val mode = ParcelFileDescriptor.MODE_WRITE_ONLY or ParcelFileDescriptor.MODE_CREATE
+        val success = openDatabaseFile(path.toFile(), mode).use { file ->
+            bridge.downloadDatabaseFile(
+                name = databaseName,
+                fd = file.fd,
+                callback = progressCallback(progressHandler),
+            )
         }
 
         if (success) {
@@ -691,6 +2676,98 @@ class SQLiteCloud(
         }
     }
 
+    /**
+     * Downloads a database from SQLite Cloud into [destination], resuming an interrupted download.
+     *
+     * The progress of the download is saved next to [destination] in a `.checkpoint` file. If the
+     * download fails, calling this method again with the same [destination] verifies the bytes
+     * already downloaded and asks the server only for the missing part, unless the database has
+     * changed meanwhile. The checkpoint file is deleted once the download completes.
+     *
+     * @param databaseName the name of the database to download.
+     * @param destination the path of the downloaded database file.
+     * @param progressHandler A closure that receives progress updates during the download.
+     *
+     * @throws SQLiteCloudError if the download process fails.
+     */
+    suspend fun download(
+        databaseName: String,
+        destination: Path,
+        progressHandler: ProgressHandler,
+    ) = download(databaseName, destination, progressCallback(progressHandler))
+
+    // Same as download(databaseName, destination, progressHandler), but reports the progress in
+    // bytes, used by SQLiteCloudDownloadManager to weigh the downloads by their size.
+    internal suspend fun download(
+        databaseName: String,
+        destination: Path,
+        callback: SQLiteCloudProgressCallback,
+    ) = withContext(connectionScope.coroutineContext) {
+        ensureConnectedOrThrow()
+        val checkpoint = File("$destination.checkpoint")
+        val mode = ParcelFileDescriptor.MODE_READ_WRITE or ParcelFileDescriptor.MODE_CREATE
+        val success = openDatabaseFile(destination.toFile(), mode).use { file ->
+            openDatabaseFile(checkpoint, mode).use { checkpointFile ->
+                bridge.downloadDatabaseResumable(
+                    name = databaseName,
+                    fd = file.fd,
+                    checkpointFd = checkpointFile.fd,
+                    callback = callback,
+                )
+            }
+        }
+
+        if (!success) {
+            val error = error()
+            logger?.logError(category = "DOWNLOAD", message = "🚨 Database download failed: $error")
+            throw error
+        }
+        checkpoint.delete()
+    }
+
+    /**
+     * Synchronizes a local copy of a database with SQLite Cloud.
+     *
+     * If the database has not changed since the copy was synced, that is if [lastRaftIndex] is
+     * still its raft index, nothing is downloaded. Otherwise the database is downloaded and only
+     * the blocks that differ are written to the local copy. The local copy must not be open while
+     * it is synced.
+     *
+     * @param databaseName the name of the database to sync.
+     * @param localPath the path of the local copy, created if missing.
+     * @param lastRaftIndex the raft index returned by the previous sync, `0` if none.
+     * @return The raft index of the synced copy, to pass to the next sync.
+     * @throws SQLiteCloudError if the sync fails.
+     */
+    suspend fun sync(
+        databaseName: String,
+        localPath: Path,
+        lastRaftIndex: Long = 0,
+    ): Long = withContext(connectionScope.coroutineContext) {
+        ensureConnectedOrThrow()
+        val raftIndex = bridge.syncDatabase(databaseName, localPath.toString(), lastRaftIndex)
+        if (raftIndex < 0) {
+            val error = error()
+            logger?.logError(category = "DOWNLOAD", message = "🚨 Database sync failed: $error")
+            throw error
+        }
+        raftIndex
+    }
+
+    private fun openDatabaseFile(file: File, mode: Int): ParcelFileDescriptor =
+        try {
+            ParcelFileDescriptor.open(file, mode)
+        } catch (e: FileNotFoundException) {
+            throw SQLiteCloudError.Task.urlHandlerFailed
+        }
+
+    private fun progressCallback(progressHandler: ProgressHandler) =
+        SQLiteCloudProgressCallback { total, progress ->
+            if (total > 0) {
+                progressHandler(progress.toDouble() / total.toDouble())
+            }
+        }
+
     /**
      * Retrieve the size in bytes of one or more BLOB (Binary Large Object) fields in the
      * SQLite Cloud database.
@@ -719,7 +2796,7 @@ class SQLiteCloud(
      * ```
      */
     suspend fun blobFieldSizes(blobInfo: SQLiteCloudBlobInfo, rowIds: List<Long>): List<Int> =
-        withContext(scope.coroutineContext) {
+        withContext(connectionScope.coroutineContext) {
             ensureConnectedOrThrow()
             bridge.blobFieldSizes(blobInfo, rowIds)
         }
@@ -746,6 +2823,11 @@ class SQLiteCloud(
      *
      * @throws SQLiteCloudError.Task if the blob read failed.
      *
+     * - Note: When [SQLiteCloudConfig.blobCacheSize] is set, the BLOBs read are also stored in
+     *         files, and read again from there, mapped read-only, until a change notification
+     *         arrives for their table or this client updates them. The connection listens to the
+     *         table with `LISTEN TABLE` the first time.
+     *
      * Example usage:
      *
      * ```kotlin
@@ -760,9 +2842,87 @@ class SQLiteCloud(
     suspend fun readBlob(
         blob: SQLiteCloudBlobStructure<BlobIO.Read>,
         progressHandler: ProgressHandler? = null,
-    ): List<BlobIO.Write> = withContext(scope.coroutineContext) {
+    ): List<BlobIO.Write> = withContext(connectionScope.coroutineContext) {
+        ensureConnectedOrThrow()
+        val cache = blobCache?.takeIf { blobCacheEnabled }
+            ?: return@withContext bridge.readBlob(blob, progressHandler)
+        readBlobCached(blob, progressHandler, cache)
+    }
+
+    // Connection thread only. Serves the rows of [blob] found in [cache] from their files and
+    // reads the others together, which are then stored.
+    private fun readBlobCached(
+        blob: SQLiteCloudBlobStructure<BlobIO.Read>,
+        progressHandler: ProgressHandler?,
+        cache: SQLiteCloudBlobCache,
+    ): List<BlobIO.Write> {
+        val hits = blob.rows.map { row -> cache.get(blob.info, row.id) }
+        val misses = blob.rows.filterIndexed { index, _ -> hits[index] == null }
+
+        val results = if (misses.isNotEmpty()) {
+            // Listen before the first read, so that no change can be missed once it is stored.
+            cache.unlistenedTable(blob.info)?.let { table ->
+                bridge.execute(SQLiteCloudCommand.listenToTable(table))
+                cache.setListening(table)
+                bridge.pubSubFilterAdd(table)
+            }
+            val generation = cache.currentGeneration
+            bridge.readBlob(blob.copy(rows = misses), progressHandler).also { results ->
+                misses.zip(results).forEach { (row, data) -> cache.put(blob.info, row.id, generation, data) }
+            }
+        } else {
+            progressHandler?.invoke(1.0)
+            emptyList()
+        }
+
+        val read = results.iterator()
+        return blob.rows.mapIndexed { index, row ->
+            val hit = hits[index] ?: return@mapIndexed read.next()
+            when (val dataIO = row.dataIO) {
+                is BlobIO.Read.Buffer -> BlobIO.Write.Buffer(hit)
+                is BlobIO.Read.File -> {
+                    FileChannel.open(
+                        dataIO.path,
+                        StandardOpenOption.CREATE,
+                        StandardOpenOption.WRITE,
+                        StandardOpenOption.TRUNCATE_EXISTING,
+                    ).use { channel ->
+                        while (hit.hasRemaining()) channel.write(hit)
+                    }
+                    BlobIO.Write.File(dataIO.path)
+                }
+            }
+        }
+    }
+
+    /**
+     * Opens a BLOB field for streaming: its bytes are read in order through the returned channel,
+     * with [readAhead] chunks requested ahead of the reader.
+     *
+     * Unlike [readBlob], nothing is buffered beyond the chunks in flight, so a large BLOB such as
+     * a video can be played while it is received. The connection is dedicated to the channel
+     * until the channel is closed.
+     *
+     * @param blobInfo A [SQLiteCloudBlobInfo] object containing information about the BLOB field.
+     * @param rowId The row ID of the BLOB to read.
+     * @param readAhead The number of chunks requested ahead of the reader, `0` for the default.
+     * @param chunkSize The size in bytes of each chunk, `0` for the default.
+     *
+     * @return A [SQLiteCloudBlobChannel] to read and then close.
+     *
+     * @throws SQLiteCloudError.Connection if the connection is not invalid or a
+     * network error has occurred.
+     *
+     * @throws SQLiteCloudError.Task if the blob cannot be opened.
+     */
+    suspend fun openBlobStream(
+        blobInfo: SQLiteCloudBlobInfo,
+        rowId: Long,
+        readAhead: Int = 0,
+        chunkSize: Int = 0,
+    ): SQLiteCloudBlobChannel = withContext(connectionScope.coroutineContext) {
         ensureConnectedOrThrow()
-        bridge.readBlob(blob, progressHandler)
+        bridge.openBlobStream(blobInfo, rowId, chunkSize, readAhead)
     }
 
     /**
@@ -774,6 +2934,10 @@ class SQLiteCloud(
      * The `autoIncreaseFieldSize` property controls whether the method should
      * automatically expand the BLOB field if the new data exceeds the current size.
      *
+     * The rows are pipelined: chunks are sent without waiting for each acknowledgement and the
+     * next row starts while the previous one is still in flight. A row that cannot be written
+     * does not stop the others, the first failure is thrown once every row has been processed.
+     *
      * @param blob A `SQLiteCloudBlobWrite` object containing information about the BLOB field
      *            and the new data to be written.
      * @param progressHandler An optional callback to track the progress of the BLOB data writing.
@@ -808,15 +2972,25 @@ class SQLiteCloud(
     suspend fun updateBlob(
         blob: SQLiteCloudBlobStructure<BlobIO.Write>,
         progressHandler: ProgressHandler? = null,
-    ) = withContext(scope.coroutineContext) {
+    ) = withContext(connectionScope.coroutineContext) {
         ensureConnectedOrThrow()
-        bridge.updateBlob(blob, progressHandler)
+        try {
+            bridge.updateBlob(blob, progressHandler)
+        } finally {
+            // Rows written before a failure changed too.
+            blobCache?.invalidate(blob.info, blob.rows.map { it.id })
+        }
     }
 
     /**
      * Compiles an SQL query into a byte-code virtual machine (VM). This method creates a
      * [SQLiteCloudVM] instance that you can use to execute the compiled SQL statement.
      *
+     * Closed VMs are kept in a per-connection statement cache of
+     * [SQLiteCloudConfig.statementCacheSize] entries, keyed by the SQL text without leading and
+     * trailing whitespace: compiling the same query again resets and reuses the cached VM instead
+     * of asking the server to compile it. See [statementCacheHits] and [statementCacheMisses].
+     *
      * @param query The SQL query to compile.
      *
      * @throws SQLiteCloudError.Connection If the connection to the SQLite Cloud backend has failed.
@@ -834,10 +3008,10 @@ class SQLiteCloud(
      *  vm.step()
      *  ```
      */
-    suspend fun compileQuery(query: String): SQLiteCloudVM = withContext(scope.coroutineContext) {
+    suspend fun compileQuery(query: String): SQLiteCloudVM = withContext(connectionScope.coroutineContext) {
         ensureConnectedOrThrow()
         val vm = bridge.vmCompile(query)
-        if (vm == null) {
+        if (vm == nullOpaquePointer) {
             val error = error()
             logger?.logError(category = "VIRTUAL MACHINE", message = "🚨 VM compile failed: $error")
             throw error
@@ -846,10 +3020,52 @@ class SQLiteCloud(
             category = "VIRTUAL MACHINE",
             message = "🚀 '$query' virtual machine created successfully",
         )
-        SQLiteCloudVM(vm, bridge, scope)
+        SQLiteCloudVM(vm, bridge, connectionScope)
     }
 
-    private suspend fun error(): SQLiteCloudError = withContext(scope.coroutineContext) {
+    /**
+     * Compiles several SQL queries at once, as [compileQuery] does for one query, with a single
+     * round trip to the server instead of one per query.
+     *
+     * The queries found in the statement cache are reset and the others compiled by requests sent
+     * together. Use this method at startup to prepare the statements of the first screens: closing
+     * the returned VMs keeps them in the statement cache, see
+     * [SQLiteCloudConfig.statementCacheSize], so that the following [compileQuery] calls for the
+     * same queries cost no round trip.
+     *
+     * @param queries The SQL queries to compile.
+     *
+     * @throws SQLiteCloudError.Connection If the connection to the SQLite Cloud backend has failed.
+     *
+     * @throws SQLiteCloudError If a query cannot be compiled, after the VMs of the other queries
+     *    have been closed.
+     *
+     * @return The [SQLiteCloudVM] instances, in the order of [queries].
+     *
+     *  Example usage:
+     *
+     *  ```kotlin
+     *  sqliteCloud.compileAll(startupQueries).forEach { it.close() }
+     *  ```
+     */
+    suspend fun compileAll(queries: List<String>): List<SQLiteCloudVM> =
+        withContext(connectionScope.coroutineContext) {
+            ensureConnectedOrThrow()
+            val vms = bridge.vmCompileMany(queries.toTypedArray())
+            if (vms == null || vms.any { it == nullOpaquePointer }) {
+                val error = error()
+                vms?.filter { it != nullOpaquePointer }?.forEach { bridge.vmClose(it) }
+                logger?.logError(category = "VIRTUAL MACHINE", message = "🚨 VM compile failed: $error")
+                throw error
+            }
+            logger?.logInfo(
+                category = "VIRTUAL MACHINE",
+                message = "🚀 ${queries.size} virtual machines created successfully",
+            )
+            vms.map { vm -> SQLiteCloudVM(vm, bridge, connectionScope) }
+        }
+
+    private suspend fun error(): SQLiteCloudError = withContext(connectionScope.coroutineContext) {
         if (isError) {
             val code = errorCode!!
             val message = errorMessage!!
@@ -864,7 +3080,164 @@ class SQLiteCloud(
         SQLiteCloudError.Unhandled
     }
 
+    /**
+     * Binds this instance to a connection checked out from a [SQLiteCloudPool].
+     */
+    internal suspend fun checkout(
+        pool: OpaquePointer<SQLiteCloudNativePool>,
+        timeout: Int,
+    ): Unit = withContext(connectionScope.coroutineContext) {
+        if (!bridge.checkout(pool, timeout)) {
+            val error = if (bridge.hasConnection) {
+                bridge.error()
+            } else {
+                SQLiteCloudError.Connection.poolTimeout
+            }
+            bridge.checkin(pool)
+            throw error
+        }
+        bridge.setStatementCacheSize(config.statementCacheSize)
+        bridge.setAutoParameterize(config.autoParameterizeSize)
+        bridge.setResultPoolSize(config.resultPoolSize)
+        bridge.setAdaptiveChunks(config.adaptiveChunkMinRows, config.adaptiveChunkMaxRows, config.adaptiveChunkMs)
+        bridge.setCompressionPolicy(config.compressionMinSize, networkClass.value)
+        bridge.setUploadCompression(config.uploadCompressionMinSize)
+        bridge.setDownloadWindow(config.downloadWindow)
+        bridge.setDownloadCompression(config.downloadCompression)
+        bridge.primeCompressionDictionary(config.compressionDictionarySize)
+        bridge.setChunkWorkers(config.chunkWorkers)
+        bridge.setParallelParse(config.parallelParseMinBytes)
+        bridge.setHeaderCache(config.headerCacheSize)
+        bridge.setSpill(spillDirectory, config.spillThreshold)
+        bridge.setMemoryBudget(config.memorySoftLimit, config.memoryHardLimit)
+        bridge.setLatencyHistograms(config.latencyHistograms)
+        bridge.setAllocationCounters(config.allocationCounters)
+        // Notifications of a pooled connection are not delivered to this instance.
+        resetResultCache(enabled = false)
+    }
+
+    /**
+     * Returns the pooled connection bound by [checkout] to its pool.
+     */
+    internal suspend fun checkin(pool: OpaquePointer<SQLiteCloudNativePool>): Unit =
+        withContext(connectionScope.coroutineContext) {
+            bridge.checkin(pool)
+        }
+
     companion object {
         private const val tlsDefaultCertificateName = "cert.pem"
+        private const val notificationBatchSize = 64
+        private const val notificationBufferSize = 16
+
+        // Over this many changed rows, a live query sends the whole query again.
+        private const val liveQueryMaxKeys = 500
+
+        @Volatile
+        private var defaultRootCertificate: String? = null
+
+        // Set by the first connect with [SQLiteCloudConfig.compressionCalibration].
+        private val compressionCalibrationStarted = AtomicBoolean(false)
+
+        /**
+         * Limits the native bytes held by all the connections of the process: over [softLimit]
+         * the chunks of large rowsets are spilled to disk, and a reply that would exceed
+         * [hardLimit] fails with a memory error before it is allocated; `0` means no limit.
+         */
+        fun setProcessMemoryBudget(softLimit: Long, hardLimit: Long) {
+            SQLiteCloudBridge.setProcessMemoryBudget(softLimit, hardLimit)
+        }
+
+        /**
+         * Measures how fast this device decompresses LZ4, for about [budgetMs] milliseconds (`0`
+         * for 200), saves the result in the files directory of the app and sets it for every
+         * connection of the process, see [SQLiteCloudCompressionCalibration]. It blocks, so call it
+         * from a background thread; with [SQLiteCloudConfig.compressionCalibration] the first
+         * connect of the process does it on its own, unless an earlier launch saved a result.
+         *
+         * @return `null` when the calibration could not allocate its buffers; nothing is changed then.
+         */
+        fun calibrateCompression(appContext: Context, budgetMs: Int = 0): SQLiteCloudCompressionCalibration? {
+            val calibration = calibrateCompression(SQLiteCloudCompressionCalibration.file(appContext.filesDir), budgetMs)
+            setCompressionCalibration(calibration)
+            return calibration
+        }
+
+        /**
+         * Sets the decompression speed used by the compression policy of every connection of the
+         * process, for example a calibration measured by the app on its own schedule; `null`
+         * goes back to [SQLiteCloudConfig.compressionMinSize] and the ratio of the network class.
+         */
+        fun setCompressionCalibration(calibration: SQLiteCloudCompressionCalibration?) {
+            SQLiteCloudBridge.setCompressionCalibration(
+                calibration?.decompressBytesPerSecond ?: 0,
+                calibration?.decompressCallNanos ?: 0,
+            )
+        }
+
+        private fun calibrateCompression(file: File, budgetMs: Int = 0): SQLiteCloudCompressionCalibration? {
+            val calibration = SQLiteCloudBridge.compressionCalibrate(budgetMs)
+                ?.let { SQLiteCloudCompressionCalibration.fromNative(it) }
+                ?: return null
+            runCatching { SQLiteCloudCompressionCalibration.save(file, calibration) }
+            return calibration
+        }
+
+        /**
+         * Makes every connection to [hostname]:[port] (including the pub/sub one and the
+         * reconnects) use [addresses], numeric IPv4 or IPv6 addresses resolved by the app,
+         * instead of querying the DNS. An empty list goes back to the resolver, whose answers
+         * are cached by the process for a minute and then refreshed in the background.
+         *
+         * @return `false` when one of the addresses is not numeric; nothing is changed then.
+         */
+        fun setResolvedAddresses(hostname: String, port: Int, addresses: List<String>): Boolean {
+            return SQLiteCloudBridge.setResolvedAddresses(
+                hostname,
+                port,
+                addresses.takeIf { it.isNotEmpty() }?.joinToString(","),
+            )
+        }
+
+        /**
+         * Loads the native library and does the work of the first connect that does not depend
+         * on the server: the TLS library setup, the read of the root certificates of [config]
+         * and the DNS resolution of its host. It blocks, so call it from a background thread
+         * (for example during `Application.onCreate`) before the first [connect].
+         *
+         * @return `false` when the TLS configuration could not be loaded or the host could not
+         * be resolved; [connect] then reports the error.
+         */
+        fun prewarm(appContext: Context, config: SQLiteCloudConfig): Boolean {
+            val tlsConfig = withDefaultRootCertificate(appContext, config)
+            return SQLiteCloudBridge.initialize(
+                hostname = tlsConfig.hostname.takeIf { it.isNotEmpty() },
+                port = tlsConfig.port,
+                family = tlsConfig.family.value,
+                tlsRootCertificate = tlsConfig.rootCertificate,
+                tlsCertificate = tlsConfig.clientCertificate,
+                tlsCertificateKey = tlsConfig.clientCertificateKey,
+                tlsCiphers = tlsConfig.tlsCiphers,
+                insecure = tlsConfig.insecure,
+            )
+        }
+
+        /**
+         * Returns [config] with the bundled root certificate when it does not specify one.
+         * The certificate is passed to the native layer as PEM data, so it is read from the app
+         * assets once per process and never written to disk.
+         */
+        internal fun withDefaultRootCertificate(
+            appContext: Context,
+            config: SQLiteCloudConfig,
+        ): SQLiteCloudConfig {
+            if (config.rootCertificate != null) {
+                return config
+            }
+
+            val certificate = defaultRootCertificate
+                ?: appContext.assets.open(tlsDefaultCertificateName).reader().use { it.readText() }
+                    .also { defaultRootCertificate = it }
+            return config.copy(rootCertificate = certificate)
+        }
     }
 }
@@ -0,0 +1,75 @@
+package io.sqlitecloud
+
+import dalvik.annotation.optimization.CriticalNative
+
+/**
+ * Native accessors that only take and return primitives, for the scalar reads done once per cell
+ * or per row.
+ *
+ * They are static and annotated with [CriticalNative], so ART calls them like plain C functions:
+ * no JNIEnv, no class reference and no thread state transition, which makes each call several
+ * times cheaper than a regular JNI call. The garbage collector cannot suspend a thread inside
+ * such a call, so only reads of memory owned by a result or a VM belong here: nothing that
+ * blocks, allocates or throws. The methods are registered by JNI_OnLoad.
+ */
+internal object SQLiteCloudAccessors {
+    @JvmStatic
+    @CriticalNative
+    external fun resultType(result: OpaquePointer<SQLiteCloudResult>): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun resultLength(result: OpaquePointer<SQLiteCloudResult>): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun resultIsChunked(result: OpaquePointer<SQLiteCloudResult>): Boolean
+
+    @JvmStatic
+    @CriticalNative
+    external fun rowsetResultRowCount(result: OpaquePointer<SQLiteCloudResult>): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun rowsetResultColumnCount(result: OpaquePointer<SQLiteCloudResult>): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun rowsetResultValueType(result: OpaquePointer<SQLiteCloudResult>, row: Int, column: Int): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun rowsetResultLongValue(result: OpaquePointer<SQLiteCloudResult>, row: Int, column: Int): Long
+
+    @JvmStatic
+    @CriticalNative
+    external fun rowsetResultDoubleValue(result: OpaquePointer<SQLiteCloudResult>, row: Int, column: Int): Double
+
+    @JvmStatic
+    @CriticalNative
+    external fun vmColumnCount(vm: OpaquePointer<SQLiteCloudVM>): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun vmColumnType(vm: OpaquePointer<SQLiteCloudVM>, index: Int): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun vmColumnInt64(vm: OpaquePointer<SQLiteCloudVM>, index: Int): Long
+
+    @JvmStatic
+    @CriticalNative
+    external fun vmColumnDouble(vm: OpaquePointer<SQLiteCloudVM>, index: Int): Double
+
+    @JvmStatic
+    @CriticalNative
+    external fun vmLastRowID(vm: OpaquePointer<SQLiteCloudVM>): Long
+
+    @JvmStatic
+    @CriticalNative
+    external fun vmChanges(vm: OpaquePointer<SQLiteCloudVM>): Long
+
+    @JvmStatic
+    @CriticalNative
+    external fun vmTotalChanges(vm: OpaquePointer<SQLiteCloudVM>): Long
+}
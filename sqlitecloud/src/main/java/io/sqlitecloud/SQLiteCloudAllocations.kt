@@ -0,0 +1,51 @@
+package io.sqlitecloud
+
+/**
+ * The native allocations made by a command for its reply, see [SQLiteCloudResult.allocations],
+ * or by all the commands of a connection, see [SQLiteCloudConnectionStats.allocations]. Only the
+ * allocations of the connection thread are counted, not the ones of the chunk workers.
+ *
+ * The calls are the ones of the native allocator; the bytes are the ones requested, whether they
+ * came from the heap, from the memory pool or from the arena of a rowset, so that a change that
+ * saves allocations shows in the calls while the bytes stay the same.
+ *
+ * @property allocs The allocation calls.
+ * @property reallocs The reallocation calls.
+ * @property frees The free calls.
+ * @property poolReuses The reply buffers and results served by the memory pool without an
+ *           allocation.
+ * @property bytes The bytes requested by the allocation and reallocation calls.
+ * @property receiveBytes The bytes of the buffers receiving the reply.
+ * @property decompressBytes The bytes of the buffers holding an uncompressed reply.
+ * @property rowsetBytes The bytes of the results and of the index arrays sized with them.
+ * @property chunkGrowthBytes The bytes of the index arrays of a chunked rowset grown to hold a
+ *           new chunk.
+ * @property metadataBytes The bytes of the column names, widths and metadata arrays.
+ */
+data class SQLiteCloudAllocations(
+    val allocs: Long,
+    val reallocs: Long,
+    val frees: Long,
+    val poolReuses: Long,
+    val bytes: Long,
+    val receiveBytes: Long,
+    val decompressBytes: Long,
+    val rowsetBytes: Long,
+    val chunkGrowthBytes: Long,
+    val metadataBytes: Long,
+) {
+    internal companion object {
+        fun fromNative(values: LongArray) = SQLiteCloudAllocations(
+            allocs = values[0],
+            reallocs = values[1],
+            frees = values[2],
+            poolReuses = values[3],
+            bytes = values[4],
+            receiveBytes = values[5],
+            decompressBytes = values[6],
+            rowsetBytes = values[7],
+            chunkGrowthBytes = values[8],
+            metadataBytes = values[9],
+        )
+    }
+}
@@ -0,0 +1,88 @@
+package io.sqlitecloud
+
+/**
+ * Primitive arrays of closed columnar rowsets, kept to be filled again by the next ones.
+ *
+ * Arrays are grouped in power of two size classes, so a polling query whose result keeps about
+ * the same shape gets back the arrays of its previous result and allocates nothing on the Java
+ * heap. A borrowed array can be longer than requested and its content is stale. At most
+ * [capacity] bytes are kept, the arrays released beyond it are left to the garbage collector.
+ *
+ * - Note: Rowsets can be closed on any thread, every method is synchronized.
+ */
+internal class SQLiteCloudArrayPool(private val capacity: Long) {
+    // Free arrays by kind and size class, the last released is borrowed first (it is more likely
+    // to be still in the CPU caches).
+    private val free = Array(KINDS) { Array(CLASSES) { ArrayDeque<Any>() } }
+
+    private var size = 0L
+
+    fun bytes(length: Int): ByteArray = borrow(BYTES, length) as ByteArray? ?: ByteArray(classLength(length))
+
+    fun ints(length: Int): IntArray = borrow(INTS, length) as IntArray? ?: IntArray(classLength(length))
+
+    fun longs(length: Int): LongArray = borrow(LONGS, length) as LongArray? ?: LongArray(classLength(length))
+
+    fun doubles(length: Int): DoubleArray =
+        borrow(DOUBLES, length) as DoubleArray? ?: DoubleArray(classLength(length))
+
+    /**
+     * Keeps [arrays] for reuse. Arrays that were not allocated by the pool are ignored.
+     */
+    @Synchronized
+    fun release(vararg arrays: Any) {
+        for (array in arrays) {
+            val (kind, length) = when (array) {
+                is ByteArray -> BYTES to array.size
+                is IntArray -> INTS to array.size
+                is LongArray -> LONGS to array.size
+                is DoubleArray -> DOUBLES to array.size
+                else -> continue
+            }
+            if (length < MIN_LENGTH || length.countOneBits() != 1) continue
+
+            val bytes = length.toLong() * WIDTHS[kind]
+            if (size + bytes > capacity) continue
+            free[kind][sizeClass(length)].addLast(array)
+            size += bytes
+        }
+    }
+
+    /**
+     * Drops every free array.
+     */
+    @Synchronized
+    fun clear() {
+        free.forEach { classes -> classes.forEach { it.clear() } }
+        size = 0
+    }
+
+    @Synchronized
+    private fun borrow(kind: Int, length: Int): Any? {
+        val sizeClass = sizeClass(length)
+        if (sizeClass >= CLASSES) return null
+
+        val array = free[kind][sizeClass].removeLastOrNull() ?: return null
+        size -= classLength(length).toLong() * WIDTHS[kind]
+        return array
+    }
+
+    private companion object {
+        const val BYTES = 0
+        const val INTS = 1
+        const val LONGS = 2
+        const val DOUBLES = 3
+        const val KINDS = 4
+
+        val WIDTHS = intArrayOf(1, 4, 8, 8)
+
+        // Smaller arrays cost less to allocate than to look up.
+        const val MIN_LENGTH = 16
+        const val CLASSES = 31
+
+        fun sizeClass(length: Int) = 32 - (maxOf(length, MIN_LENGTH) - 1).countLeadingZeroBits()
+
+        // The length of the arrays of the size class of [length], larger ones are allocated as is.
+        fun classLength(length: Int) = if (sizeClass(length) < CLASSES) 1 shl sizeClass(length) else length
+    }
+}
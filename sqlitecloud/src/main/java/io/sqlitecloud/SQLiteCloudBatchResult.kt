@@ -0,0 +1,11 @@
+package io.sqlitecloud
+
+/// Aggregate outcome of a [SQLiteCloud.executeMany] batch.
+///
+/// - Parameters:
+///   - changes: The total number of rows inserted, updated or deleted by the batch.
+///   - lastRowId: The rowid of the last row inserted on the connection once the batch completed.
+data class SQLiteCloudBatchResult(
+    val changes: Long,
+    val lastRowId: Long,
+)
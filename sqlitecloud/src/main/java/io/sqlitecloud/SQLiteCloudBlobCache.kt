@@ -0,0 +1,189 @@
+package io.sqlitecloud
+
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.channels.FileChannel
+import java.nio.file.Files
+import java.nio.file.StandardCopyOption
+import java.nio.file.StandardOpenOption
+import java.util.UUID
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * Contents of BLOB fields kept in files, keyed by table, column and rowid.
+ *
+ * Hits are mapped read-only from their file, so they cost neither round trips nor heap. The least
+ * recently used files are deleted once [capacity] bytes are exceeded, and a change notification on
+ * a table deletes every file of that table. Entries are only valid while the connection listens to
+ * their tables: the cache is emptied when the connection changes, see [clear].
+ *
+ * - Note: Change notifications arrive on the pub/sub thread, every method is synchronized.
+ */
+internal class SQLiteCloudBlobCache(
+    private val directory: File,
+    private val capacity: Long,
+) {
+    private data class Key(val schema: String?, val table: String, val column: String, val rowId: Long)
+
+    private class Entry(val file: File, val size: Long)
+
+    private val entries = LinkedHashMap<Key, Entry>(16, 0.75f, true)
+
+    // Tables the connection is already listening to, see [unlistenedTable].
+    private val listening = mutableSetOf<String>()
+
+    // Incremented by every invalidation, so that a BLOB read while its table was changing is not
+    // stored (see [put]).
+    private var generation = 0L
+
+    private var size = 0L
+
+    private val nextFile = AtomicLong()
+
+    init {
+        directory.mkdirs()
+    }
+
+    val currentGeneration: Long
+        @Synchronized get() = generation
+
+    /**
+     * The cached content of the BLOB of [rowId], mapped read-only, or null on a miss.
+     */
+    @Synchronized
+    fun get(info: SQLiteCloudBlobInfo, rowId: Long): ByteBuffer? {
+        val entry = entries[key(info, rowId)] ?: return null
+        // Mapped under the lock, an invalidation cannot delete the file in between.
+        return FileChannel.open(entry.file.toPath(), StandardOpenOption.READ).use { channel ->
+            channel.map(FileChannel.MapMode.READ_ONLY, 0, entry.size)
+        }
+    }
+
+    /**
+     * Stores the content of the BLOB of [rowId], as read into [data], unless its table was
+     * invalidated since [generation] was read, before the BLOB was opened. The position of a
+     * buffer is not moved.
+     */
+    fun put(info: SQLiteCloudBlobInfo, rowId: Long, generation: Long, data: BlobIO.Write) {
+        // The file is written outside the lock, only its entry is added under it.
+        val file = File(directory, "${nextFile.incrementAndGet()}.blob")
+        try {
+            when (data) {
+                is BlobIO.Write.Buffer -> FileChannel.open(
+                    file.toPath(),
+                    StandardOpenOption.CREATE_NEW,
+                    StandardOpenOption.WRITE,
+                ).use { channel ->
+                    val buffer = data.buffer.duplicate()
+                    while (buffer.hasRemaining()) channel.write(buffer)
+                }
+
+                is BlobIO.Write.File -> Files.copy(data.path, file.toPath(), StandardCopyOption.REPLACE_EXISTING)
+            }
+        } catch (e: Exception) {
+            file.delete()
+            return
+        }
+
+        val fileSize = file.length()
+        if (!store(key(info, rowId), Entry(file, fileSize), generation)) {
+            file.delete()
+        }
+    }
+
+    @Synchronized
+    private fun store(key: Key, entry: Entry, generation: Long): Boolean {
+        if (generation != this.generation || entry.size > capacity) return false
+
+        entries.put(key, entry)?.let { previous ->
+            size -= previous.size
+            previous.file.delete()
+        }
+        size += entry.size
+
+        val iterator = entries.values.iterator()
+        while (size > capacity && iterator.hasNext()) {
+            val eldest = iterator.next()
+            iterator.remove()
+            size -= eldest.size
+            eldest.file.delete()
+        }
+        return true
+    }
+
+    /**
+     * The table of [info] if it still needs a `LISTEN TABLE` on this connection.
+     */
+    @Synchronized
+    fun unlistenedTable(info: SQLiteCloudBlobInfo): String? =
+        info.table.takeIf { it.lowercase() !in listening }
+
+    @Synchronized
+    fun setListening(table: String) {
+        listening.add(table.lowercase())
+    }
+
+    /**
+     * Deletes the BLOBs of [rowIds] in the table of [info], written by this client.
+     */
+    @Synchronized
+    fun invalidate(info: SQLiteCloudBlobInfo, rowIds: List<Long>) {
+        generation++
+        rowIds.forEach { rowId ->
+            entries.remove(key(info, rowId))?.let { entry ->
+                size -= entry.size
+                entry.file.delete()
+            }
+        }
+    }
+
+    /**
+     * Deletes the BLOBs of [table], or every BLOB if [table] is null or `*`.
+     */
+    @Synchronized
+    fun invalidate(table: String?) {
+        generation++
+        val name = table?.lowercase()
+        val iterator = entries.entries.iterator()
+        while (iterator.hasNext()) {
+            val (key, entry) = iterator.next()
+            if (name == null || name == SQLiteCloudChannel.AllTables.name || name == key.table) {
+                iterator.remove()
+                size -= entry.size
+                entry.file.delete()
+            }
+        }
+    }
+
+    /**
+     * Deletes every BLOB and forgets the tables listened to, for a connection that is closed or
+     * replaced.
+     */
+    @Synchronized
+    fun clear() {
+        invalidate(null)
+        listening.clear()
+    }
+
+    // SQL identifiers are case insensitive.
+    private fun key(info: SQLiteCloudBlobInfo, rowId: Long) =
+        Key(info.schema?.lowercase(), info.table.lowercase(), info.column.lowercase(), rowId)
+
+    companion object {
+        private var staleDeleted = false
+
+        /**
+         * A new directory for the cache of a client, under [cacheDir]. The directories left by a
+         * previous process, whose entries could no longer be validated, are deleted first.
+         */
+        @Synchronized
+        fun newDirectory(cacheDir: File): File {
+            val root = File(cacheDir, "sqlitecloud-blobs")
+            if (!staleDeleted) {
+                root.deleteRecursively()
+                staleDeleted = true
+            }
+            return File(root, UUID.randomUUID().toString())
+        }
+    }
+}
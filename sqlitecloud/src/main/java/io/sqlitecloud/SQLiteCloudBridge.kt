@@ -2,24 +2,117 @@
 
 package io.sqlitecloud
 
+import android.database.CursorWindow
+import android.os.ParcelFileDescriptor
+import io.sqlitecloud.SQLiteCloudAccessors.resultIsChunked
+import io.sqlitecloud.SQLiteCloudAccessors.resultLength
+import io.sqlitecloud.SQLiteCloudAccessors.resultType
+import io.sqlitecloud.SQLiteCloudAccessors.rowsetResultColumnCount
+import io.sqlitecloud.SQLiteCloudAccessors.rowsetResultDoubleValue
+import io.sqlitecloud.SQLiteCloudAccessors.rowsetResultLongValue
+import io.sqlitecloud.SQLiteCloudAccessors.rowsetResultRowCount
+import io.sqlitecloud.SQLiteCloudAccessors.rowsetResultValueType
 import io.sqlitecloud.SQLiteCloudResult.Type.*
+import java.io.FileNotFoundException
 import java.nio.ByteBuffer
+import java.util.concurrent.atomic.AtomicLong
 
-typealias OpaquePointer<T> = ByteBuffer
+/** Native handle passed through JNI as a plain `long`, [nullOpaquePointer] stands for a null pointer. */
+typealias OpaquePointer<T> = Long
+
+internal const val nullOpaquePointer: Long = 0
 
 internal object SQLiteCloudConnection
 
 internal object SQLiteCloudBlob
 
+internal object SQLiteCloudNativeBlobStream
+
+internal object SQLiteCloudRowsetCursor
+
+internal object SQLiteCloudRowsetIndex
+
+internal object SQLiteCloudNativePool
+
+internal fun interface SQLiteCloudResultCallback {
+    fun onResult(result: OpaquePointer<SQLiteCloudResult>)
+}
+
+internal fun interface SQLiteCloudProgressCallback {
+    fun onProgress(total: Long, progress: Long)
+}
+
+internal fun interface SQLiteCloudBlobRowsCallback {
+    fun onRow(row: Int, errorCode: Int, errorMessage: String?, total: Long, progress: Long)
+}
+
+/**
+ * A pub/sub message: the [payload] of a notification decoded natively, or the [result] to decode
+ * in Kotlin.
+ */
+internal class SQLiteCloudPubSubMessage(
+    val result: SQLiteCloudResult?,
+    val payload: SQLiteCloudPayload?,
+)
+
 internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
-    private var connection: OpaquePointer<SQLiteCloudConnection>? = null
-    private var pubSubCallback: ((SQLiteCloudResult) -> Unit)? = null
+    private var connection: OpaquePointer<SQLiteCloudConnection> = nullOpaquePointer
+    private var pubSubCallback: ((SQLiteCloudPubSubMessage) -> Unit)? = null
+    private var pubSubReadyCallback: (() -> Unit)? = null
+
+    // Native data of the pub/sub and trace callbacks, released by [doDisconnect].
+    private var pubSubData: Long = 0
+
+    /**
+     * Receives the spans of the bound connection, see [SQLiteCloudTracer]. The connection itself
+     * is traced if set before [connect].
+     */
+    var tracer: SQLiteCloudTracer? = null
+
+    /**
+     * Arrays reused by the columnar rowsets once they are closed, see
+     * [SQLiteCloudConfig.arrayPoolSize]. Null if the pool is disabled.
+     */
+    var arrayPool: SQLiteCloudArrayPool? = null
+        set(value) {
+            field = value
+            if (hasConnection) setTrace(value != null, value?.includesCommandText == false)
+        }
+
+    /**
+     * The thresholds above which [parseResult] keeps a rowset in columnar arrays and boxes its
+     * rows only when they are read, see [SQLiteCloudMaterializationStats]. `0` disables one.
+     */
+    var lazyRowsetCells = SQLiteCloudConfig.defaultLazyRowsetCells
+    var lazyRowsetBytes = SQLiteCloudConfig.defaultLazyRowsetBytes
+
+    // The rowsets parsed with each strategy, see [materializationStats].
+    private val eagerRowsets = AtomicLong()
+    private val lazyRowsets = AtomicLong()
 
+    // The handles returned by [SQLiteCloudTracer.beginSpan] for the spans still open on each thread.
+    private val openSpans = ThreadLocal.withInitial { ArrayDeque<Any?>() }
+
+    // A command that overran its deadline leaves the connection usable, see [SQLiteCloudCommand.deadlineMs].
     val isConnected: Boolean
-        get() = connection != null && !isError()
+        get() = connection != nullOpaquePointer &&
+            (!isError() || errorCode() == SQLiteCloudError.Connection.deadlineExceededCode)
+
+    val hasConnection: Boolean
+        get() = connection != nullOpaquePointer
+
+    /**
+     * Set when a command overran its deadline while its reply was being received: the native
+     * connection is out of sync with the server and must be closed.
+     */
+    var isOutOfSync = false
+        private set
 
     external fun isError(): Boolean
 
+    /** Whether the connection can still be used: no network error and not closed by the server. */
+    external fun isAlive(): Boolean
+
     external fun isSQLiteError(): Boolean
 
     external fun errorCode(): Int?
@@ -61,7 +154,19 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
         tlsRootCertificate: String?,
         tlsCertificate: String?,
         tlsCertificateKey: String?,
+        tlsCiphers: String?,
         insecure: Boolean,
+        binaryRowset: Boolean,
+        compactIndex: Boolean,
+        deferConfig: Boolean,
+        keepAliveIdle: Int,
+        keepAliveInterval: Int,
+        keepAliveCount: Int,
+        userTimeoutMs: Int,
+        trace: Boolean,
+        traceHashOnly: Boolean,
+        wireRecordPath: String?,
+        wireReplayPath: String?,
     ): OpaquePointer<SQLiteCloudConnection>
 
     fun connect(
@@ -86,7 +191,17 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
         tlsRootCertificate: String?,
         tlsCertificate: String?,
         tlsCertificateKey: String?,
+        tlsCiphers: String?,
         insecure: Boolean,
+        binaryRowset: Boolean,
+        compactIndex: Boolean,
+        deferConfig: Boolean,
+        keepAliveIdle: Int,
+        keepAliveInterval: Int,
+        keepAliveCount: Int,
+        userTimeoutMs: Int,
+        wireRecordPath: String?,
+        wireReplayPath: String?,
     ): Boolean {
         connection = doConnect(
             hostname = hostname,
@@ -110,32 +225,240 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
             tlsRootCertificate = tlsRootCertificate,
             tlsCertificate = tlsCertificate,
             tlsCertificateKey = tlsCertificateKey,
+            tlsCiphers = tlsCiphers,
             insecure = insecure,
+            binaryRowset = binaryRowset,
+            compactIndex = compactIndex,
+            deferConfig = deferConfig,
+            keepAliveIdle = keepAliveIdle,
+            keepAliveInterval = keepAliveInterval,
+            keepAliveCount = keepAliveCount,
+            userTimeoutMs = userTimeoutMs,
+            trace = tracer != null,
+            traceHashOnly = tracer?.includesCommandText == false,
+            wireRecordPath = wireRecordPath,
+            wireReplayPath = wireReplayPath,
         )
         return !isError()
     }
 
     private external fun doDisconnect()
 
+    private external fun doReconnect(): Boolean
+
+    /**
+     * Opens the sockets of the bound connection again, with the same configuration, and restores
+     * its session (`USE DATABASE`, client keys and `LISTEN`) in a single round trip. Prepared
+     * statements and open blobs of the old session are lost. Returns `false` if it failed.
+     */
+    fun reconnect(): Boolean {
+        if (!hasConnection || !doReconnect()) return false
+        isOutOfSync = false
+        return true
+    }
+
     fun disconnect() {
         doDisconnect()
-        connection?.clear()
-        connection = null
+        connection = nullOpaquePointer
+        isOutOfSync = false
+    }
+
+    private external fun doCreatePool(
+        hostname: String,
+        port: Int,
+        username: String,
+        password: String,
+        database: String?,
+        timeout: Int,
+        family: Int,
+        compression: Boolean,
+        sqliteMode: Boolean,
+        zeroText: Boolean,
+        passwordHashed: Boolean,
+        nonlinearizable: Boolean,
+        dbMemory: Boolean,
+        noBlob: Boolean,
+        dbCreate: Boolean,
+        maxData: Int,
+        maxRows: Int,
+        maxRowset: Int,
+        tlsRootCertificate: String?,
+        tlsCertificate: String?,
+        tlsCertificateKey: String?,
+        tlsCiphers: String?,
+        insecure: Boolean,
+        binaryRowset: Boolean,
+        compactIndex: Boolean,
+        deferConfig: Boolean,
+        keepAliveIdle: Int,
+        keepAliveInterval: Int,
+        keepAliveCount: Int,
+        userTimeoutMs: Int,
+        pingTimeoutMs: Int,
+        size: Int,
+    ): OpaquePointer<SQLiteCloudNativePool>
+
+    fun createPool(config: SQLiteCloudConfig, size: Int): OpaquePointer<SQLiteCloudNativePool>? {
+        val pool = doCreatePool(
+            hostname = config.hostname,
+            port = config.port,
+            username = config.username,
+            password = config.password,
+            database = config.dbname,
+            timeout = config.timeout,
+            family = config.family.value,
+            compression = config.compression,
+            sqliteMode = config.sqliteMode,
+            zeroText = config.zerotext,
+            passwordHashed = config.passwordHashed,
+            nonlinearizable = config.nonlinearizable,
+            dbMemory = config.memory,
+            noBlob = config.noblob,
+            dbCreate = config.dbCreate,
+            maxData = config.maxData,
+            maxRows = config.maxRows,
+            maxRowset = config.maxRowset,
+            tlsRootCertificate = config.rootCertificate,
+            tlsCertificate = config.clientCertificate,
+            tlsCertificateKey = config.clientCertificateKey,
+            tlsCiphers = config.tlsCiphers,
+            insecure = config.insecure,
+            binaryRowset = config.binaryRowset,
+            compactIndex = config.compactIndex,
+            deferConfig = config.deferConfig,
+            keepAliveIdle = config.keepAliveIdle,
+            keepAliveInterval = config.keepAliveInterval,
+            keepAliveCount = config.keepAliveCount,
+            userTimeoutMs = config.userTimeoutMs,
+            pingTimeoutMs = config.pingTimeoutMs,
+            size = size,
+        )
+        return pool.takeIf { it != nullOpaquePointer }
+    }
+
+    external fun destroyPool(pool: OpaquePointer<SQLiteCloudNativePool>)
+
+    /**
+     * Opens a connection with [config] that is not bound to this bridge, see [adopt]. Its
+     * configuration is never deferred, so it is authenticated once this returns. It can run on
+     * any thread; returns `null` if the connection failed.
+     */
+    fun connectStandby(config: SQLiteCloudConfig): OpaquePointer<SQLiteCloudConnection>? {
+        val standby = doConnect(
+            hostname = config.hostname,
+            port = config.port,
+            username = config.username,
+            password = config.password,
+            database = config.dbname,
+            timeout = config.timeout,
+            family = config.family.value,
+            compression = config.compression,
+            sqliteMode = config.sqliteMode,
+            zeroText = config.zerotext,
+            passwordHashed = config.passwordHashed,
+            nonlinearizable = config.nonlinearizable,
+            dbMemory = config.memory,
+            noBlob = config.noblob,
+            dbCreate = config.dbCreate,
+            maxData = config.maxData,
+            maxRows = config.maxRows,
+            maxRowset = config.maxRowset,
+            tlsRootCertificate = config.rootCertificate,
+            tlsCertificate = config.clientCertificate,
+            tlsCertificateKey = config.clientCertificateKey,
+            tlsCiphers = config.tlsCiphers,
+            insecure = config.insecure,
+            binaryRowset = config.binaryRowset,
+            compactIndex = config.compactIndex,
+            deferConfig = false,
+            keepAliveIdle = config.keepAliveIdle,
+            keepAliveInterval = config.keepAliveInterval,
+            keepAliveCount = config.keepAliveCount,
+            userTimeoutMs = config.userTimeoutMs,
+            trace = tracer != null,
+            traceHashOnly = tracer?.includesCommandText == false,
+            // a standby would overwrite the recording of the connection (and has no server to replay)
+            wireRecordPath = null,
+            wireReplayPath = null,
+        )
+        if (standby != nullOpaquePointer && isStandbyReady(standby)) {
+            return standby
+        }
+        closeStandby(standby)
+        return null
+    }
+
+    private external fun transferSession(standby: OpaquePointer<SQLiteCloudConnection>): Boolean
+
+    /**
+     * Closes the connection bound to this bridge and binds [standby] in its place. The `USE
+     * DATABASE`, client keys and `LISTEN` run on the closed connection are run again on [standby].
+     */
+    fun adopt(standby: OpaquePointer<SQLiteCloudConnection>) {
+        transferSession(standby)
+        doDisconnect()
+        connection = standby
+        isOutOfSync = false
+        // The native data of the trace callback was released with the old connection.
+        tracer?.let { setTrace(true, !it.includesCommandText) }
+    }
+
+    private external fun poolCheckout(
+        pool: OpaquePointer<SQLiteCloudNativePool>,
+        timeout: Int,
+    ): OpaquePointer<SQLiteCloudConnection>
+
+    private external fun poolCheckin(
+        pool: OpaquePointer<SQLiteCloudNativePool>,
+        connection: OpaquePointer<SQLiteCloudConnection>,
+    )
+
+    /**
+     * Binds this bridge to a connection checked out from [pool]. Returns `false` if no
+     * connection became available within [timeout] seconds or if the new connection failed;
+     * in both cases [checkin] must still be called.
+     */
+    fun checkout(pool: OpaquePointer<SQLiteCloudNativePool>, timeout: Int): Boolean {
+        connection = poolCheckout(pool, timeout)
+        if (connection != nullOpaquePointer) tracer?.let { setTrace(true, !it.includesCommandText) }
+        return connection != nullOpaquePointer && !isError()
+    }
+
+    fun checkin(pool: OpaquePointer<SQLiteCloudNativePool>) {
+        if (connection != nullOpaquePointer) {
+            poolCheckin(pool, connection)
+        }
+        connection = nullOpaquePointer
     }
 
     external fun getClientUUID(): String?
 
-    private external fun executeCommand(query: String): OpaquePointer<SQLiteCloudResult>?
+    private external fun executeCommand(query: ByteBuffer, deadlineMs: Int, options: IntArray?): OpaquePointer<SQLiteCloudResult>
 
-    private external fun executeArrayCommand(
-        query: String,
-        params: Array<Any>,
+    private external fun executeTypedArrayCommand(
+        query: ByteBuffer,
+        text: ByteBuffer?,
+        blobs: Array<Any?>,
         paramTypes: IntArray,
-    ): OpaquePointer<SQLiteCloudResult>?
+        longs: LongArray,
+        doubles: DoubleArray,
+        deadlineMs: Int,
+        options: IntArray?,
+    ): OpaquePointer<SQLiteCloudResult>
+
+    private external fun executePipeline(
+        queries: Array<String>,
+        params: Array<Array<Any>>,
+        paramTypes: Array<IntArray>,
+    ): LongArray?
+
+    private external fun executeStatements(sql: String): LongArray?
 
     private external fun freeResult(result: OpaquePointer<SQLiteCloudResult>)
 
-    private external fun resultType(result: OpaquePointer<SQLiteCloudResult>): Int
+    private external fun resultTimings(result: OpaquePointer<SQLiteCloudResult>): LongArray?
+
+    private external fun resultAllocations(result: OpaquePointer<SQLiteCloudResult>): LongArray?
 
     private external fun intResult(result: OpaquePointer<SQLiteCloudResult>): Int
 
@@ -174,102 +497,750 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
         index: Int,
     ): ByteBuffer
 
-    private external fun rowsetResultRowCount(result: OpaquePointer<SQLiteCloudResult>): Int
-
-    private external fun rowsetResultColumnCount(result: OpaquePointer<SQLiteCloudResult>): Int
+    private external fun arrayResultValues(
+        result: OpaquePointer<SQLiteCloudResult>,
+        types: ByteArray,
+        longs: LongArray,
+        doubles: DoubleArray,
+        offsets: IntArray,
+    ): ByteArray?
 
     private external fun rowsetResultColumnName(
         result: OpaquePointer<SQLiteCloudResult>,
         column: Int,
     ): String
 
-    private external fun rowsetResultValueType(
+    private external fun rowsetResultStringValue(
         result: OpaquePointer<SQLiteCloudResult>,
         row: Int,
         column: Int,
-    ): Int
+    ): String
 
-    private external fun rowsetResultLongValue(
+    private external fun rowsetResultBufferValue(
         result: OpaquePointer<SQLiteCloudResult>,
         row: Int,
         column: Int,
-    ): Long
+    ): ByteBuffer
 
-    private external fun rowsetResultDoubleValue(
+    private external fun exportArrow(
+        result: OpaquePointer<SQLiteCloudResult>,
+        schemaAddress: Long,
+        arrayAddress: Long,
+    ): Boolean
+
+    private external fun rowsetResultColumn(
         result: OpaquePointer<SQLiteCloudResult>,
-        row: Int,
         column: Int,
-    ): Double
+        first: Int,
+        rowCount: Int,
+        types: ByteArray,
+        longs: LongArray,
+        doubles: DoubleArray,
+        offsets: IntArray,
+    ): Int
 
-    private external fun rowsetResultStringValue(
+    private external fun rowsetResultColumnBytes(
         result: OpaquePointer<SQLiteCloudResult>,
-        row: Int,
         column: Int,
-    ): String
+        first: Int,
+        rowCount: Int,
+        bytes: ByteArray,
+    )
 
-    private external fun rowsetResultBufferValue(
+    private external fun rowsetResultColumnDictionary(
         result: OpaquePointer<SQLiteCloudResult>,
-        row: Int,
         column: Int,
-    ): ByteBuffer
+        first: Int,
+        rowCount: Int,
+        maxCodes: Int,
+        types: ByteArray,
+        codes: IntArray,
+        offsets: IntArray,
+    ): Int
+
+    private external fun rowsetResultColumnDictionaryBytes(
+        result: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        first: Int,
+        rowCount: Int,
+        codes: IntArray,
+        bytes: ByteArray,
+    )
+
+    private external fun rowsetResultFillWindow(
+        result: OpaquePointer<SQLiteCloudResult>,
+        window: CursorWindow,
+        first: Int,
+    ): Int
+
+    private external fun rowsetAggregate(
+        result: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        selection: IntArray?,
+    ): DoubleArray?
+
+    private external fun rowsetFilter(
+        result: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        op: Int,
+        value: Double,
+        selection: IntArray?,
+    ): IntArray?
+
+    private external fun rowsetGroupBy(
+        result: OpaquePointer<SQLiteCloudResult>,
+        keyColumn: Int,
+        column: Int,
+        selection: IntArray?,
+    ): DoubleArray?
+
+    private external fun rowsetBuildIndex(
+        result: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+    ): OpaquePointer<SQLiteCloudRowsetIndex>
+
+    private external fun rowsetIndexFind(
+        index: OpaquePointer<SQLiteCloudRowsetIndex>,
+        type: Int,
+        integer: Long,
+        real: Double,
+        bytes: ByteArray?,
+    ): IntArray?
+
+    private external fun rowsetIndexFree(index: OpaquePointer<SQLiteCloudRowsetIndex>)
+
+    private external fun rowsetSortedView(
+        result: OpaquePointer<SQLiteCloudResult>,
+        columns: IntArray,
+        descending: BooleanArray?,
+    ): IntArray?
+
+    private external fun saveResult(result: OpaquePointer<SQLiteCloudResult>, path: String): Boolean
+
+    private external fun loadMappedResult(path: String): OpaquePointer<SQLiteCloudResult>
+
+    private external fun exportSharedResult(result: OpaquePointer<SQLiteCloudResult>): Int
+
+    private external fun loadSharedResult(fd: Int): OpaquePointer<SQLiteCloudResult>
+
+    private external fun compactResult(result: OpaquePointer<SQLiteCloudResult>): OpaquePointer<SQLiteCloudResult>
 
     fun execute(command: SQLiteCloudCommand): SQLiteCloudResult {
+        val nativeResult = executeNative(command)
+
+        // Try parsing the result. Parsing can throw several errors.
+        val result = try {
+            parseResult(nativeResult)
+        } finally {
+            // Before returning the result it is necessary to free the opaque pointer.
+            freeResult(nativeResult)
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 '${command.query}' command executed successfully",
+        )
+
+        return result
+    }
+
+    // Serves [command] from [cache] when possible, otherwise executes it and stores its native
+    // result, which is then released by the cache instead of here.
+    fun executeCached(command: SQLiteCloudCommand, cache: SQLiteCloudResultCache): SQLiteCloudResult {
+        cache.get(command, ::parseResult)?.let { return it }
+
+        // Listen before the first execution, so that no change can be missed once it is stored.
+        cache.unlistenedTables(command).forEach { table ->
+            execute(SQLiteCloudCommand.listenToTable(table))
+            cache.setListening(table)
+            pubSubFilterAdd(table)
+        }
+
+        val generation = cache.currentGeneration
+        val nativeResult = executeNative(command)
+        val result = try {
+            parseResult(nativeResult)
+        } catch (error: Throwable) {
+            freeResult(nativeResult)
+            throw error
+        }
+        val stored = compact(nativeResult)
+        if (!cache.put(command, stored, resultLength(stored).toLong(), generation)) {
+            freeResult(stored)
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 '${command.query}' command executed successfully",
+        )
+
+        return result
+    }
+
+    // A cache hit only parses the stored native result, it needs neither the connection nor its
+    // thread.
+    fun cachedResult(command: SQLiteCloudCommand, cache: SQLiteCloudResultCache): SQLiteCloudResult? =
+        cache.get(command, ::parseResult)
+
+    /**
+     * Sends the [commands] missing from [cache] with a single round trip and stores their results
+     * as they are, without parsing them. A command that fails is not stored and is not reported,
+     * see [SQLiteCloud.registerPrefetch].
+     */
+    fun prefetchCached(commands: List<SQLiteCloudCommand>, cache: SQLiteCloudResultCache) {
+        val missing = commands.filter { cache.isCacheable(it) && !cache.contains(it) }
+        if (missing.isEmpty()) return
+
+        missing.flatMapTo(LinkedHashSet()) { cache.unlistenedTables(it) }.forEach { table ->
+            execute(SQLiteCloudCommand.listenToTable(table))
+            cache.setListening(table)
+            pubSubFilterAdd(table)
+        }
+
+        val generation = cache.currentGeneration
+        val nativeResults = executePipeline(
+            queries = missing.map { it.query }.toTypedArray(),
+            params = missing.map { nativeParams(it) }.toTypedArray(),
+            paramTypes = missing.map { nativeParamTypes(it) }.toTypedArray(),
+        ) ?: return
+
+        nativeResults.forEachIndexed { index, nativeResult ->
+            if (nativeResult == nullOpaquePointer) return@forEachIndexed
+            if (SQLiteCloudResult.Type.fromRawValue(resultType(nativeResult)) == ERROR) {
+                freeResult(nativeResult)
+                return@forEachIndexed
+            }
+            val stored = compact(nativeResult)
+            if (!cache.put(missing[index], stored, resultLength(stored).toLong(), generation)) {
+                freeResult(stored)
+            }
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 ${missing.size} commands prefetched",
+        )
+    }
+
+    fun newResultCache(capacity: Long) = SQLiteCloudResultCache(capacity) { freeResult(it) }
+
+    // A rowset that is kept around is copied into a single block without the chunk framing and the
+    // slack of its index, other results are kept as they are.
+    private fun compact(result: OpaquePointer<SQLiteCloudResult>): OpaquePointer<SQLiteCloudResult> {
+        val compacted = compactResult(result)
+        if (compacted == nullOpaquePointer) return result
+        freeResult(result)
+        return compacted
+    }
+
+    fun executeRowset(command: SQLiteCloudCommand): SQLiteCloudNativeRowset {
+        val nativeResult = executeNative(command)
+        val resultType = SQLiteCloudResult.Type.fromRawValue(resultType(nativeResult))
+        if (resultType != ROWSET) {
+            freeResult(nativeResult)
+            throw if (resultType == ERROR) error() else SQLiteCloudError.Execution.unsupportedResultType
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 '${command.query}' command executed successfully",
+        )
+
+        return SQLiteCloudNativeRowset(this, nativeResult)
+    }
+
+    fun executeColumnar(
+        command: SQLiteCloudCommand,
+        columns: IntArray? = null,
+        columnNames: List<String>? = null,
+    ): SQLiteCloudColumnarRowset {
+        val nativeResult = executeNative(command)
+        val rowset = try {
+            when (SQLiteCloudResult.Type.fromRawValue(resultType(nativeResult))) {
+                ROWSET -> parseColumnarRowset(nativeResult, columns ?: columnNames?.let { projection(nativeResult, it) })
+                ERROR -> throw error()
+                else -> throw SQLiteCloudError.Execution.unsupportedResultType
+            }
+        } finally {
+            freeResult(nativeResult)
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 '${command.query}' command executed successfully",
+        )
+
+        return rowset
+    }
+
+    fun executeArrow(command: SQLiteCloudCommand, schemaAddress: Long, arrayAddress: Long) {
+        val nativeResult = executeNative(command)
+        val resultType = SQLiteCloudResult.Type.fromRawValue(resultType(nativeResult))
+
+        // Once exported, the native result is freed by the release callback of the Arrow array.
+        if (resultType != ROWSET || !exportArrow(nativeResult, schemaAddress, arrayAddress)) {
+            freeResult(nativeResult)
+            throw if (resultType == ERROR) error() else SQLiteCloudError.Execution.unsupportedResultType
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 '${command.query}' command executed successfully",
+        )
+    }
+
+    private fun executeNative(command: SQLiteCloudCommand): OpaquePointer<SQLiteCloudResult> {
+        val encoded = command.encoded
+        val options = command.options?.encoded
         val nativeResult = if (command.parameters.isEmpty()) {
-            executeCommand(command.query)
+            executeCommand(encoded.query, command.deadlineMs, options)
         } else {
-            val params: Array<Any> = command.parameters.mapNotNull {
-                when (it) {
-                    is SQLiteCloudValue.Null -> null
-                    is SQLiteCloudValue.Blob -> it.value
-                    else -> it.stringValue
-                }
-            }.toTypedArray()
-            val types = command.parameters.mapNotNull {
-                if (it is SQLiteCloudValue.Null) {
-                    null
-                } else {
-                    it.typeValue
-                }
-            }.toIntArray()
-            executeArrayCommand(command.query, params, types)
+            encoded.run { executeTypedArrayCommand(query, text, blobs, types, longs, doubles, command.deadlineMs, options) }
         }
 
         // If the result is null, there was an error either during the
         // connection (e.g. invalid credentials) or during the execution
         // of the query (e.g. database does not exist.)
-        if (nativeResult == null) {
+        if (nativeResult == nullOpaquePointer) {
+            val error = error()
+            logger?.logError(
+                category = "COMMAND",
+                message = "🚨 '${command.query}' command failed: $error",
+            )
+            if ((error as? SQLiteCloudError.Connection)?.code == SQLiteCloudError.Connection.deadlineResetCode) {
+                isOutOfSync = true
+            }
+            throw error
+        }
+
+        return nativeResult
+    }
+
+    fun executeAll(commands: List<SQLiteCloudCommand>): List<SQLiteCloudResult> {
+        if (commands.isEmpty()) {
+            return emptyList()
+        }
+
+        val nativeResults = executePipeline(
+            queries = commands.map { it.query }.toTypedArray(),
+            params = commands.map { nativeParams(it) }.toTypedArray(),
+            paramTypes = commands.map { nativeParamTypes(it) }.toTypedArray(),
+        )
+        return pipelineResults(nativeResults, commands.size)
+    }
+
+    /**
+     * Runs every statement of [sql] with a single round trip, see [executeAll]. The statements are
+     * split natively, and each one gets its own result.
+     */
+    fun executeMulti(sql: String): List<SQLiteCloudResult> {
+        val nativeResults = executeStatements(sql)
+        return pipelineResults(nativeResults, nativeResults?.size ?: 0)
+    }
+
+    private fun pipelineResults(nativeResults: LongArray?, count: Int): List<SQLiteCloudResult> {
+        // A null slot means that the corresponding command failed. The replies of all the
+        // commands have already been read, so the successful ones must be freed before throwing.
+        if (nativeResults == null || nativeResults.any { it == nullOpaquePointer }) {
+            val error = error()
+            nativeResults?.forEach { if (it != nullOpaquePointer) freeResult(it) }
+            logger?.logError(
+                category = "COMMAND",
+                message = "🚨 Pipeline of $count commands failed: $error",
+            )
+            throw error
+        }
+
+        val results = try {
+            nativeResults.map { parseResult(it) }
+        } finally {
+            nativeResults.forEach(::freeResult)
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 Pipeline of $count commands executed successfully",
+        )
+
+        return results
+    }
+
+    /**
+     * Same as [executeAll], but each command gets its own outcome instead of the whole pipeline
+     * failing with the first error. The native layer only keeps the error of the first failed
+     * command, the following failures are reported with [SQLiteCloudError.Execution.pipelineCommandFailed].
+     */
+    fun executeCoalesced(commands: List<SQLiteCloudCommand>): List<Result<SQLiteCloudResult>> {
+        val nativeResults = executePipeline(
+            queries = commands.map { it.query }.toTypedArray(),
+            params = commands.map { nativeParams(it) }.toTypedArray(),
+            paramTypes = commands.map { nativeParamTypes(it) }.toTypedArray(),
+        )
+        if (nativeResults == null) {
+            val error = error()
+            return commands.map { Result.failure(error) }
+        }
+
+        var firstError: SQLiteCloudError? = if (nativeResults.any { it == nullOpaquePointer }) error() else null
+        val results = commands.indices.map { index ->
+            val nativeResult = nativeResults.getOrElse(index) { nullOpaquePointer }
+            if (nativeResult == nullOpaquePointer) {
+                val error = firstError ?: SQLiteCloudError.Execution.pipelineCommandFailed
+                firstError = null
+                Result.failure(error)
+            } else {
+                try {
+                    Result.success(parseResult(nativeResult))
+                } catch (error: SQLiteCloudError) {
+                    Result.failure(error)
+                } finally {
+                    freeResult(nativeResult)
+                }
+            }
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 Pipeline of ${commands.size} coalesced commands executed",
+        )
+
+        return results
+    }
+
+    /**
+     * Runs independent writes as one transaction, inside a savepoint so that it also works within
+     * a transaction already open. With [atomic] a failed write rolls back all the others, which then
+     * fail with [SQLiteCloudError.Execution.writeBatchRolledBack]; otherwise only the failed write is
+     * undone. Either way, if the savepoint cannot be released every write is rolled back and fails.
+     *
+     * The savepoint, the writes and the release are a single pipeline, except that with [atomic] the
+     * release (or the rollback) is sent after the replies of the writes.
+     */
+    fun executeWriteBatch(commands: List<SQLiteCloudCommand>, atomic: Boolean): List<Result<SQLiteCloudResult>> {
+        val release = SQLiteCloudCommand("RELEASE $writeBatchSavepoint")
+        val results = executeCoalesced(
+            listOf(SQLiteCloudCommand("SAVEPOINT $writeBatchSavepoint")) + commands +
+                if (atomic) emptyList() else listOf(release)
+        )
+        val writes = results.subList(1, commands.size + 1)
+        // Without the savepoint every write was committed on its own.
+        if (results.first().isFailure) {
+            return writes
+        }
+
+        val error = when {
+            atomic && writes.any { it.isFailure } -> SQLiteCloudError.Execution.writeBatchRolledBack
+            atomic -> executeCoalesced(listOf(release)).single().exceptionOrNull()
+            else -> results.last().exceptionOrNull()
+        } ?: return writes
+
+        logger?.logError(
+            category = "COMMAND",
+            message = "🚨 Write batch of ${commands.size} commands rolled back: $error",
+        )
+        executeCoalesced(listOf(SQLiteCloudCommand("ROLLBACK TO $writeBatchSavepoint"), release))
+        return writes.map { write -> if (write.isFailure) write else Result.failure(error) }
+    }
+
+    private external fun executeAsync(
+        query: String,
+        params: Array<Any>,
+        paramTypes: IntArray,
+        callback: SQLiteCloudResultCallback,
+    ): Boolean
+
+    external fun connectionFD(): Int
+
+    external fun processEvents(): Int
+
+    /**
+     * Watches the connection in [events] for the mask returned by [processEvents], a mask `<= 0`
+     * stops watching it.
+     */
+    external fun watchEvents(events: Long, mask: Int): Boolean
+
+    /**
+     * Arms the cancellation of the next blocking call and returns its handle. [cancel] can be
+     * called from any thread until [cancelDisarm] is called with the same handle.
+     */
+    external fun cancelArm(): Long
+
+    /**
+     * Disarms [handle], returns true if the call has been cancelled and the connection must be
+     * closed.
+     */
+    external fun cancelDisarm(handle: Long): Boolean
+
+    external fun cancel(handle: Long): Boolean
+
+    /**
+     * Queues [command] on the connection without waiting for its reply. [onResult] is invoked from
+     * [processEvents] once the reply has been received, or with the connection error if it failed.
+     */
+    fun executeAsync(
+        command: SQLiteCloudCommand,
+        onResult: (Result<SQLiteCloudResult>) -> Unit,
+    ): Boolean = executeAsync(command.query, nativeParams(command), nativeParamTypes(command)) {
+        val result = if (it == nullOpaquePointer) {
+            // The error is only valid for the duration of the callback.
             val error = error()
             logger?.logError(
                 category = "COMMAND",
                 message = "🚨 '${command.query}' command failed: $error",
             )
+            Result.failure(error)
+        } else {
+            try {
+                Result.success(parseResult(it))
+            } catch (error: Throwable) {
+                Result.failure(error)
+            } finally {
+                freeResult(it)
+            }
+        }
+        onResult(result)
+    }
+
+    private external fun executeBatch(
+        query: String,
+        params: Array<Any>,
+        paramTypes: IntArray,
+        rows: Int,
+        cols: Int,
+    ): LongArray?
+
+    fun executeMany(query: String, rows: List<List<SQLiteCloudValue>>): SQLiteCloudBatchResult {
+        val cols = rows.firstOrNull()?.size ?: 0
+        rows.forEachIndexed { index, row ->
+            if (row.size != cols) throw SQLiteCloudError.Execution.invalidBatchRow(index)
+        }
+
+        // Unlike nativeParams, nulls must keep their slot because every row has the same shape.
+        val values = rows.flatten()
+        val counters = executeBatch(
+            query,
+            values.map {
+                when (it) {
+                    is SQLiteCloudValue.Null -> ""
+                    is SQLiteCloudValue.Blob -> it.value
+                    is SQLiteCloudValue.BlobFile -> it.mapped()
+                    else -> it.stringValue!!
+                }
+            }.toTypedArray(),
+            values.map { it.typeValue }.toIntArray(),
+            rows.size,
+            cols,
+        )
+
+        if (counters == null) {
+            val error = error()
+            logger?.logError(
+                category = "COMMAND",
+                message = "🚨 '$query' batch of ${rows.size} rows failed: $error",
+            )
             throw error
         }
 
-        // Try parsing the result. Parsing can throw several errors.
-        val result = parseResult(nativeResult)
-        // Before returning the result it is necessary to free the opaque pointer.
-        freeResult(nativeResult)
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 '$query' batch of ${rows.size} rows executed successfully",
+        )
+
+        return SQLiteCloudBatchResult(changes = counters[0], lastRowId = counters[1])
+    }
+
+    private external fun notifyBatch(channel: String, payloads: Array<String>): Boolean
+
+    fun notifyMany(channel: String, payloads: List<String>) {
+        if (payloads.isEmpty()) return
+
+        // Every payload is sent even when one of them fails, the error reported is the first one.
+        if (!notifyBatch(channel, payloads.toTypedArray())) {
+            val error = error()
+            logger?.logError(
+                category = "PUB/SUB",
+                message = "🚨 Batch of ${payloads.size} notifications on '$channel' failed: $error",
+            )
+            throw error
+        }
+
+        logger?.logInfo(
+            category = "PUB/SUB",
+            message = "📣 Batch of ${payloads.size} notifications sent on '$channel'",
+        )
+    }
+
+    private fun nativeParams(command: SQLiteCloudCommand): Array<Any> =
+        command.parameters.mapNotNull {
+            when (it) {
+                is SQLiteCloudValue.Null -> null
+                is SQLiteCloudValue.Blob -> it.value
+                is SQLiteCloudValue.BlobFile -> it.mapped()
+                else -> it.stringValue
+            }
+        }.toTypedArray()
+
+    private fun nativeParamTypes(command: SQLiteCloudCommand): IntArray =
+        command.parameters.mapNotNull {
+            if (it is SQLiteCloudValue.Null) {
+                null
+            } else {
+                it.typeValue
+            }
+        }.toIntArray()
+
+    /**
+     * Sets the callback of the notifications or, with a [queueSize], of the failures only: the
+     * notifications are then queued natively and [ready] is called on the pub/sub thread once
+     * there are some to collect with [drainPubSub]. A full queue applies [overflow].
+     */
+    fun setPubSubCallback(
+        queueSize: Int,
+        overflow: SQLiteCloudConfig.PubSubOverflow,
+        ready: () -> Unit,
+        callback: (SQLiteCloudPubSubMessage) -> Unit,
+    ) {
+        pubSubCallback = callback
+        pubSubReadyCallback = ready
+        setPubSubCallback(queueSize, overflow.value)
+    }
+
+    fun pubSubCallback(result: OpaquePointer<SQLiteCloudResult>) {
+        pubSubCallback?.invoke(pubSubMessage(result))
+    }
 
-        logger?.logInfo(
-            category = "COMMAND",
-            message = "🚀 '${command.query}' command executed successfully",
+    fun pubSubReady() {
+        pubSubReadyCallback?.invoke()
+    }
+
+    private external fun setTrace(enabled: Boolean, hashOnly: Boolean)
+
+    fun traceEvent(
+        kind: Int,
+        end: Boolean,
+        command: String?,
+        commandHash: Long,
+        bytesOut: Long,
+        bytesIn: Long,
+        resultType: Int,
+        errorCode: Int,
+        timestampMicros: Long,
+    ) {
+        val tracer = tracer ?: return
+        val span = SQLiteCloudSpan(
+            kind = SQLiteCloudSpan.Kind.values()[kind],
+            command = command,
+            commandHash = commandHash,
+            bytesOut = bytesOut,
+            bytesIn = bytesIn,
+            resultType = if (end) SQLiteCloudResult.Type.fromRawValue(resultType) else null,
+            errorCode = errorCode,
+            timestampMicros = timestampMicros,
         )
 
-        return result
+        // A tracer that throws still gets balanced begin and end calls.
+        val spans = openSpans.get()
+        if (!end) {
+            spans.addLast(runCatching { tracer.beginSpan(span) }.getOrNull())
+        } else {
+            val handle = spans.removeLastOrNull()
+            runCatching { tracer.endSpan(handle, span) }
+        }
     }
 
-    fun setPubSubCallback(callback: (SQLiteCloudResult) -> Unit) {
-        pubSubCallback = callback
-        setPubSubCallback()
+    /**
+     * Collects up to [max] queued notifications, oldest first, along with the number of
+     * notifications dropped by the overflow policy since the previous call.
+     */
+    fun drainPubSub(max: Int): Pair<List<SQLiteCloudPubSubMessage>, Int> {
+        val drained = pubSubDrain(max)
+        val messages = (1 until drained.size).map { i ->
+            try {
+                pubSubMessage(drained[i])
+            } finally {
+                freeResult(drained[i])
+            }
+        }
+        return messages to drained[0].toInt()
     }
 
-    fun pubSubCallback(result: OpaquePointer<SQLiteCloudResult>) {
-        val liteResult = parseResult(result)
-        pubSubCallback?.invoke(liteResult)
+    // Notifications are decoded natively when they have the members of [SQLiteCloudPayload], which
+    // skips building their JSON text and parsing it again in Kotlin.
+    private fun pubSubMessage(result: OpaquePointer<SQLiteCloudResult>): SQLiteCloudPubSubMessage {
+        val payload = if (SQLiteCloudResult.Type.fromRawValue(resultType(result)) == JSON) {
+            decodeNotification(result)
+        } else {
+            null
+        }
+        return if (payload != null) {
+            SQLiteCloudPubSubMessage(null, payload)
+        } else {
+            SQLiteCloudPubSubMessage(parseResult(result), null)
+        }
+    }
+
+    private fun decodeNotification(result: OpaquePointer<SQLiteCloudResult>): SQLiteCloudPayload? {
+        val fields = notificationFields(result) ?: return null
+        val messageType = SQLiteCloudPayload.MessageType.values().firstOrNull { it.name == fields[2] }
+            ?: return null
+        @Suppress("UNCHECKED_CAST")
+        return SQLiteCloudPayload(
+            sender = fields[0] as String,
+            channel = fields[1] as String,
+            messageType = messageType,
+            pk = (fields[4] as Array<String>).asList(),
+            payload = fields[3] as String?,
+        )
     }
 
-    private external fun setPubSubCallback()
+    private external fun notificationFields(result: OpaquePointer<SQLiteCloudResult>): Array<Any?>?
+
+    private external fun setPubSubCallback(queueSize: Int, overflow: Int)
+
+    /**
+     * With [enabled], the notifications of the channels not added with [pubSubFilterAdd] are
+     * dropped natively, before they are passed to Kotlin.
+     */
+    external fun setPubSubFilter(enabled: Boolean)
+
+    /** Adds a handler of [channel] to the filter; `*` accepts the notifications of every table. */
+    external fun pubSubFilterAdd(channel: String): Boolean
+
+    /** Removes a handler of [channel] from the filter. */
+    external fun pubSubFilterRemove(channel: String)
+
+    /**
+     * Receives the notifications of the channels added to the filter of this connection through
+     * the pub/sub socket of the connection of [host], or through a socket of its own if null. The
+     * channels must be listened to by [host].
+     */
+    external fun setPubSubHost(host: SQLiteCloudBridge?): Boolean
+
+    /**
+     * With [enabled], the delivery of every notification is timestamped natively and counted in
+     * latency histograms of its channel, see [pubSubLatency]. Disabling it resets the histograms.
+     */
+    external fun setPubSubLatency(enabled: Boolean)
+
+    private external fun pubSubLatency(): Array<Any?>
+
+    fun pubSubLatencyHistograms(): List<SQLiteCloudPubSubLatency> {
+        val histograms = pubSubLatency()
+        return (histograms.indices step 2).mapNotNull { i ->
+            val channel = histograms[i] as String? ?: return@mapNotNull null
+            val counters = (histograms[i + 1] as IntArray).asList()
+                .chunked(SQLiteCloudPubSubLatency.bucketCount)
+            SQLiteCloudPubSubLatency(
+                channel = channel,
+                network = counters[0],
+                parse = counters[1],
+                dispatch = counters[2],
+                callback = counters[3],
+            )
+        }
+    }
+
+    private external fun pubSubDrain(max: Int): LongArray
 
     external fun setPubSubOnly(): OpaquePointer<SQLiteCloudResult>
 
@@ -280,7 +1251,7 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
     ): OpaquePointer<SQLiteCloudBlob> {
         val handle = openBlob(info.schema, info.table, info.column, rowId, readWrite)
 
-        if (handle == null) {
+        if (handle == nullOpaquePointer) {
             val error = error()
             logger?.logError(category = "BLOB", message = "🚨 Blob Open failed: $error")
             throw error
@@ -311,18 +1282,20 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
     }
 
     fun blobFieldSizes(blobInfo: SQLiteCloudBlobInfo, rowIds: List<Long>): List<Int> {
-        val firstRowId = rowIds.firstOrNull() ?: throw SQLiteCloudError.Task.invalidNumberOfRows
+        if (rowIds.isEmpty()) throw SQLiteCloudError.Task.invalidNumberOfRows
 
-        val handle = openBlob(info = blobInfo, rowId = firstRowId, readWrite = false)
-
-        val sizes = rowIds.mapIndexed { index, rowId ->
-            reopenBlobIfNeeded(handle, index, rowId)
-            blobFieldSize(handle)
+        // The rows are pipelined natively instead of costing two round trips each.
+        val sizes = blobSizes(blobInfo.schema, blobInfo.table, blobInfo.column, rowIds.toLongArray())
+        if (sizes == null) {
+            val error = error()
+            logger?.logError(category = "BLOB", message = "🚨 Blob sizes failed: $error")
+            throw error
+        }
+        if (sizes.any { it < 0 }) {
+            throw SQLiteCloudError.Task.invalidNumberOfRows
         }
 
-        closeBlob(handle)
-
-        return sizes
+        return sizes.map { it.toInt() }
     }
 
     fun readBlob(
@@ -377,88 +1350,139 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
         return result
     }
 
+    /**
+     * Writes the data of every row of [blob]: the rows are pipelined natively, each chunk write is
+     * sent without waiting for the previous reply and a row starts while the previous one is
+     * still being acknowledged. A row that fails is logged and the other rows are written anyway,
+     * the first failure is thrown once every row is done.
+     */
     fun updateBlob(
         blob: SQLiteCloudBlobStructure<BlobIO.Write>,
         progressHandler: ProgressHandler?,
     ) {
-        val firstRow = blob.rows.firstOrNull() ?: return
-
-        val handle = openBlob(info = blob.info, rowId = firstRow.id, readWrite = true)
-
-        blob.rows.forEachIndexed { index, row ->
-            reopenBlobIfNeeded(handle, index, row.id)
+        if (blob.rows.isEmpty()) return
 
-            // We need to check whether the blob field is large enough to store the entire data.
-            // If it is not large enough we need to "expand" the column via a sql query.
-            val currentFieldSize = blobFieldSize(handle)
-            val dataSize = row.dataIO.size
+        val info = blob.info
+        val sizes = blob.rows.map { it.dataIO.size }
 
-            if (currentFieldSize < dataSize && blob.autoIncreaseFieldSize) {
-                val info = blob.info
+        // The blob field must be large enough to store the entire data, otherwise it is
+        // "expanded" via a sql query. The sizes of every field cost a single pipelined request.
+        if (blob.autoIncreaseFieldSize) {
+            val fieldSizes = blobFieldSizes(info, blob.rows.map { it.id })
+            blob.rows.forEachIndexed { index, row ->
+                if (fieldSizes[index] >= sizes[index]) return@forEachIndexed
                 try {
-                    val result = execute(
+                    execute(
                         command = SQLiteCloudCommand.expandBlobField(
                             table = info.table,
                             column = info.column,
                             rowId = row.id,
-                            size = dataSize,
+                            size = sizes[index],
                         )
                     )
-                    println(result.stringValue)
                 } catch (e: Error) {
                     logger?.logDebug(
                         category = "BLOB",
-                        message = "🚨 Blob field size increase failed - rowId: ${row.id} - bytes: $dataSize",
+                        message = "🚨 Blob field size increase failed - rowId: ${row.id} - bytes: ${sizes[index]}",
                     )
                     throw error()
                 }
-
-                // After increasing the blob size, it is necessary to reopen the handle in order
-                // to acknowledge the change.
-                reopenBlob(handle, row.id)
             }
+        }
 
-            val internalProgress: ProgressHandler = { progress ->
-                val total = blob.rows.count()
-                val totalProgress = (progress + index.toDouble()) / total.toDouble()
-                if (progressHandler != null) {
-                    progressHandler(totalProgress)
+        // Files are sent natively without being mapped into the JVM, buffers must be direct.
+        val files = mutableListOf<ParcelFileDescriptor>()
+        val fds = IntArray(blob.rows.size) { -1 }
+        val buffers = arrayOfNulls<ByteBuffer>(blob.rows.size)
+        val failures = mutableListOf<SQLiteCloudError>()
+        try {
+            blob.rows.forEachIndexed { index, row ->
+                when (val data = row.dataIO) {
+                    is BlobIO.Write.Buffer -> buffers[index] = if (data.buffer.isDirect) {
+                        data.buffer.slice()
+                    } else {
+                        ByteBuffer.allocateDirect(sizes[index]).put(data.buffer.duplicate())
+                    }
+
+                    is BlobIO.Write.File -> {
+                        val file = try {
+                            ParcelFileDescriptor.open(data.path.toFile(), ParcelFileDescriptor.MODE_READ_ONLY)
+                        } catch (e: FileNotFoundException) {
+                            throw SQLiteCloudError.Task.urlHandlerFailed
+                        }
+                        files.add(file)
+                        fds[index] = file.fd
+                    }
                 }
             }
 
-            try {
-                SQLiteCloudBlobReadWrite.writeRow(blob, row, internalProgress) { buffer ->
-                    val bufferSlice = buffer.slice()
-                    val result = writeBlob(handle, bufferSlice)
-                    if (result < 1) {
-                        val nativeError = error()
-                        logger?.logError(
-                            category = "BLOB",
-                            message = "🚨 Blob writing failed: $nativeError",
-                        )
-                        throw SQLiteCloudError.Task.errorWritingBlob
-                    }
-                    buffer.position(buffer.position() + bufferSlice.capacity())
-                    bufferSlice.capacity()
+            val callback = SQLiteCloudBlobRowsCallback { row, errorCode, errorMessage, total, progress ->
+                if (errorCode != 0) {
+                    val rowId = blob.rows[row].id
+                    val error = SQLiteCloudError.Task(errorCode, errorMessage ?: "")
+                    logger?.logError(category = "BLOB", message = "🚨 Blob writing failed - rowId $rowId: $error")
+                    failures.add(error)
+                }
+                if (progressHandler != null && total > 0) {
+                    progressHandler(progress.toDouble() / total.toDouble())
                 }
-            } catch (e: Error) {
-                throw error()
             }
 
-            // Checks if writing is failed.
-            if (isError()) {
+            val success = writeBlobRows(
+                schema = info.schema,
+                table = info.table,
+                column = info.column,
+                rowIds = blob.rows.map { it.id }.toLongArray(),
+                buffers = buffers,
+                fds = fds,
+                lengths = sizes.toIntArray(),
+                chunkSize = blob.chunkSize(sizes.max()),
+                window = 0,
+                callback = callback,
+            )
+            if (!success) {
                 val error = error()
                 logger?.logError(category = "BLOB", message = "🚨 Blob writing failed: $error")
-                closeBlob(handle)
                 throw error
             }
+        } finally {
+            files.forEach { it.close() }
+        }
 
-            logger?.logDebug(
-                category = "BLOB",
-                message = "🗃️ Blob writing successful - rowId ${row.id} - bytes: $dataSize",
-            )
+        failures.firstOrNull()?.let { throw it }
+
+        // The buffers have been consumed, as when they were written chunk by chunk.
+        blob.rows.forEach { row -> (row.dataIO as? BlobIO.Write.Buffer)?.buffer?.let { it.position(it.limit()) } }
+
+        logger?.logDebug(
+            category = "BLOB",
+            message = "🗃️ Blob writing successful - rows: ${blob.rows.size} - bytes: ${sizes.sum()}",
+        )
+    }
+
+    fun openBlobStream(
+        info: SQLiteCloudBlobInfo,
+        rowId: Long,
+        chunkSize: Int,
+        readAhead: Int,
+    ): SQLiteCloudBlobChannel {
+        val handle = openBlob(info = info, rowId = rowId, readWrite = false)
+        val stream = openBlobStream(handle, chunkSize, readAhead)
+        if (stream == nullOpaquePointer) {
+            val error = error()
+            closeBlob(handle)
+            logger?.logError(category = "BLOB", message = "🚨 Blob stream open failed: $error")
+            throw error
         }
 
+        return SQLiteCloudBlobChannel(this, handle, stream)
+    }
+
+    fun closeBlobStream(
+        handle: OpaquePointer<SQLiteCloudBlob>,
+        stream: OpaquePointer<SQLiteCloudNativeBlobStream>,
+    ) {
+        closeBlobStream(stream)
         closeBlob(handle)
     }
 
@@ -472,22 +1496,221 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
         column: String,
         rowId: Long,
         readWrite: Boolean,
-    ): OpaquePointer<SQLiteCloudBlob>?
+    ): OpaquePointer<SQLiteCloudBlob>
 
     private external fun reopenBlob(handle: OpaquePointer<SQLiteCloudBlob>, rowId: Long): Boolean
 
+    /**
+     * Returns the size of the blob of each row of [rowIds], `-1` for a row whose blob cannot be
+     * opened, or null on a network error.
+     */
+    private external fun blobSizes(
+        schema: String?,
+        table: String,
+        column: String,
+        rowIds: LongArray,
+    ): LongArray?
+
     private external fun closeBlob(handle: OpaquePointer<SQLiteCloudBlob>): Boolean
 
     private external fun blobFieldSize(handle: OpaquePointer<SQLiteCloudBlob>): Int
 
     private external fun readBlob(handle: OpaquePointer<SQLiteCloudBlob>, buffer: ByteBuffer): Int
 
-    private external fun writeBlob(handle: OpaquePointer<SQLiteCloudBlob>, buffer: ByteBuffer): Int
+    /**
+     * Writes the [lengths] bytes of each row of [rowIds], from its direct buffer or from its file
+     * descriptor when the buffer is null, with up to [window] requests of [chunkSize] bytes in
+     * flight (`0` picks the native defaults). Progress and the failure of a row are reported to
+     * [callback]; returns false on a network error.
+     */
+    private external fun writeBlobRows(
+        schema: String?,
+        table: String,
+        column: String,
+        rowIds: LongArray,
+        buffers: Array<ByteBuffer?>,
+        fds: IntArray,
+        lengths: IntArray,
+        chunkSize: Int,
+        window: Int,
+        callback: SQLiteCloudBlobRowsCallback,
+    ): Boolean
+
+    /**
+     * Starts reading the blob of [handle] from its beginning, with up to [readAhead] requests of
+     * [chunkSize] bytes in flight (`0` picks the native defaults).
+     */
+    private external fun openBlobStream(
+        handle: OpaquePointer<SQLiteCloudBlob>,
+        chunkSize: Int,
+        readAhead: Int,
+    ): OpaquePointer<SQLiteCloudNativeBlobStream>
+
+    /**
+     * Copies the next bytes of the blob into the direct [buffer], from [position] and up to
+     * [length] bytes. Returns the number of bytes copied, `0` at the end of the blob, or `-1`.
+     */
+    external fun readBlobStream(
+        stream: OpaquePointer<SQLiteCloudNativeBlobStream>,
+        buffer: ByteBuffer,
+        position: Int,
+        length: Int,
+    ): Int
+
+    private external fun closeBlobStream(stream: OpaquePointer<SQLiteCloudNativeBlobStream>): Boolean
 
-    external fun vmCompile(query: String): OpaquePointer<SQLiteCloudVM>?
+    external fun vmCompile(query: String): OpaquePointer<SQLiteCloudVM>
+
+    /**
+     * Compiles every query with a single round trip, see [vmCompile]. Returns one VM per query,
+     * [nullOpaquePointer] for the queries that failed, or null if nothing could be sent.
+     */
+    external fun vmCompileMany(queries: Array<String>): LongArray?
 
     external fun vmClose(vm: OpaquePointer<SQLiteCloudVM>): Boolean
 
+    external fun vmReset(vm: OpaquePointer<SQLiteCloudVM>): Boolean
+
+    external fun vmClearBindings(vm: OpaquePointer<SQLiteCloudVM>): Boolean
+
+    /**
+     * Sets how many idle VMs the connection keeps for reuse by [vmCompile]; `0` disables the
+     * statement cache.
+     */
+    external fun setStatementCacheSize(size: Int)
+
+    /**
+     * Sets how many statement forms the connection remembers to lift the literals of the commands
+     * run by [executeCommand] into parameters of a cached VM; `0` disables it.
+     */
+    external fun setAutoParameterize(count: Int)
+
+    /** Returns the statement cache hits and misses of the connection, in this order. */
+    external fun statementCacheStats(): IntArray
+
+    /** Returns the CRC32C of the current or last database upload or download. */
+    external fun transferChecksum(): Int
+
+    /**
+     * Sets how many bytes of freed receive buffers and results the connection keeps for reuse;
+     * `0` disables the result pool.
+     */
+    external fun setResultPoolSize(bytes: Int)
+
+    /**
+     * Lets the connection retune the chunk size between [minRows] and [maxRows] so that a chunk
+     * arrives about every [targetMs] milliseconds; a [maxRows] of `0` disables the adaptive mode.
+     */
+    external fun setAdaptiveChunks(minRows: Int, maxRows: Int, targetMs: Int)
+
+    /**
+     * Lets the connection turn compression on and off between commands from the size and the
+     * compression ratio of the replies; a [minSize] of `0` restores the configured setting.
+     */
+    external fun setCompressionPolicy(minSize: Int, networkClass: Int)
+
+    /**
+     * Sends uploaded database chunks and array commands of at least [minSize] bytes LZ4
+     * compressed, if the server accepts compressed frames; `0` sends everything as is.
+     */
+    external fun setUploadCompression(minSize: Int)
+
+    /**
+     * Keeps up to [window] `DOWNLOAD STEP` requests in flight while a database is downloaded, so
+     * that the next chunks are already on their way while one is written; `0` uses the default.
+     */
+    external fun setDownloadWindow(window: Int)
+
+    /**
+     * Asks the `DOWNLOAD STEP` replies of database downloads LZ4 compressed, if the server can
+     * send them; they are decompressed by the chunk workers while the next steps are read.
+     */
+    external fun setDownloadCompression(enabled: Boolean)
+
+    /**
+     * Collects the first [size] bytes of the small rowsets received and registers them with the
+     * server as the dictionary of the compressed replies; `0` stops collecting them.
+     */
+    external fun primeCompressionDictionary(size: Int)
+
+    /**
+     * Registers [dictionary] with the server as the dictionary of the compressed replies of this
+     * session; an empty array stops dictionary compression. Returns `false` if the server refused it.
+     */
+    external fun setCompressionDictionary(dictionary: ByteArray): Boolean
+
+    /**
+     * Sets how many threads decompress and parse the chunks of a rowset while the next ones are
+     * being received; `0` parses them on the connection thread.
+     */
+    external fun setChunkWorkers(workers: Int)
+
+    /**
+     * Lets the server send the rowsets of a query it has already answered without their header,
+     * which is taken from up to [slots] headers cached by the connection; `0` disables the cache.
+     */
+    external fun setHeaderCache(slots: Int)
+
+    /**
+     * Once the chunks of a rowset exceed [threshold] bytes, writes the following ones to a
+     * temporary file in [directory] and reads them through a memory mapping; `0` disables it.
+     */
+    external fun setSpill(directory: String, threshold: Int)
+
+    /**
+     * Spills the chunks of large rowsets to disk once the connection holds [soft] native bytes,
+     * and fails a reply that would exceed [hard] bytes before allocating it; `0` means no limit.
+     */
+    external fun setMemoryBudget(soft: Long, hard: Long)
+
+    /**
+     * Lets the chunk workers and the connection thread split the parse of a single rowset reply
+     * of at least [minBytes] bytes; `0` keeps the serial parse for every reply.
+     */
+    external fun setParallelParse(minBytes: Int)
+
+    /** Returns the compressed bytes received and the bytes saved by compression, in this order. */
+    external fun compressionStats(): LongArray
+
+    /**
+     * Returns the reply size and the permille ratio the compression policy decides with, then `1`
+     * when they come from the calibration and the link rate, see [SQLiteCloudCompressionThreshold].
+     */
+    external fun compressionThreshold(): IntArray
+
+    /** Returns the counters of [SQLiteCloudConnectionStats], in the order of its properties. */
+    external fun connectionStats(): LongArray
+
+    /**
+     * With [enabled], the commands, steps and notifications of the connection are timed natively
+     * in a histogram of their kind, see [latencyHistograms]. Disabling it keeps the histograms.
+     */
+    external fun setLatencyHistograms(enabled: Boolean)
+
+    /** Returns the histograms of [SQLiteCloudCommandLatency], in the order of its kinds. */
+    external fun latencyHistograms(): IntArray
+
+    /**
+     * With [enabled], the allocations made by each command for its reply are counted natively,
+     * see [SQLiteCloudAllocations].
+     */
+    external fun setAllocationCounters(enabled: Boolean)
+
+    /** Returns the cipher suite negotiated by the last TLS handshake, `null` without TLS. */
+    external fun tlsCipher(): String?
+
+    /** Returns the native bytes held by the connection and by the whole process, in this order. */
+    external fun memoryUsage(): LongArray
+
+    /** Releases the pooled buffers and the idle read buffer of the connection. */
+    external fun trimMemory()
+
+    /**
+     * Releases the native memory of the connection for a [SQLiteCloud.MemoryPressure] level, see
+     * [SQLiteCloud.releaseMemory].
+     */
+    external fun memoryPressure(level: Int)
+
     external fun vmBindInt(vm: OpaquePointer<SQLiteCloudVM>, rowIndex: Int, value: Int): Boolean
 
     external fun vmBindInt64(
@@ -519,15 +1742,12 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
 
     external fun vmBindNull(vm: OpaquePointer<SQLiteCloudVM>, rowIndex: Int): Boolean
 
-    external fun vmStep(vm: OpaquePointer<SQLiteCloudVM>): Int
-
-    external fun vmColumnCount(vm: OpaquePointer<SQLiteCloudVM>): Int
+    external fun vmSetFetchRows(vm: OpaquePointer<SQLiteCloudVM>, rows: Int)
 
-    external fun vmLastRowID(vm: OpaquePointer<SQLiteCloudVM>): Long
-
-    external fun vmChanges(vm: OpaquePointer<SQLiteCloudVM>): Long
+    external fun vmStep(vm: OpaquePointer<SQLiteCloudVM>): Int
 
-    external fun vmTotalChanges(vm: OpaquePointer<SQLiteCloudVM>): Long
+    // The first row of the range in the high 32 bits and the row count in the low ones, -1 on error.
+    private external fun vmFetchRows(vm: OpaquePointer<SQLiteCloudVM>, maxRows: Int): Long
 
     external fun vmIsReadOnly(vm: OpaquePointer<SQLiteCloudVM>): Boolean
 
@@ -541,38 +1761,128 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
 
     external fun vmBindParameterName(vm: OpaquePointer<SQLiteCloudVM>, index: Int): String?
 
-    external fun vmColumnType(vm: OpaquePointer<SQLiteCloudVM>, index: Int): Int
-
     external fun vmResult(vm: OpaquePointer<SQLiteCloudVM>): OpaquePointer<SQLiteCloudResult>
 
     external fun rowsetColumnName(result: OpaquePointer<SQLiteCloudResult>, index: Int): String
 
-    external fun vmColumnInt64(vm: OpaquePointer<SQLiteCloudVM>, index: Int): Long
-
-    external fun vmColumnDouble(vm: OpaquePointer<SQLiteCloudVM>, index: Int): Double
-
     external fun vmColumnText(vm: OpaquePointer<SQLiteCloudVM>, index: Int): String
 
     external fun vmColumnBlob(vm: OpaquePointer<SQLiteCloudVM>, index: Int): ByteBuffer
 
+    private external fun vmCurrentRow(
+        vm: OpaquePointer<SQLiteCloudVM>,
+        types: ByteArray,
+        longs: LongArray,
+        doubles: DoubleArray,
+        offsets: IntArray,
+    ): ByteArray?
+
+    fun vmCurrentRow(vm: OpaquePointer<SQLiteCloudVM>, columnCount: Int): List<SQLiteCloudVMValue> {
+        val types = ByteArray(columnCount)
+        val longs = LongArray(columnCount)
+        val doubles = DoubleArray(columnCount)
+        val offsets = IntArray(columnCount + 1)
+        val bytes = vmCurrentRow(vm, types, longs, doubles, offsets)
+            ?: throw SQLiteCloudError.Execution.unsupportedValueType
+
+        return (0..<columnCount).map { column ->
+            val length = offsets[column + 1] - offsets[column]
+            when (SQLiteCloudValue.Type.fromRawValue(types[column].toInt())) {
+                SQLiteCloudValue.Type.Integer -> SQLiteCloudVMValue.Integer64(longs[column])
+                SQLiteCloudValue.Type.Double -> SQLiteCloudVMValue.Double(doubles[column])
+                SQLiteCloudValue.Type.String -> SQLiteCloudVMValue.String(
+                    String(bytes, offsets[column], length, Charsets.UTF_8),
+                )
+
+                SQLiteCloudValue.Type.Blob -> {
+                    val buffer = ByteBuffer.allocateDirect(length).put(bytes, offsets[column], length)
+                    buffer.flip()
+                    SQLiteCloudVMValue.Blob(buffer)
+                }
+
+                SQLiteCloudValue.Type.Null -> SQLiteCloudVMValue.Null
+                SQLiteCloudValue.Type.Unknown -> throw SQLiteCloudError.Execution.unsupportedValueType
+            }
+        }
+    }
+
+    /**
+     * Steps [vm] up to [maxRows] times and copies the rows visited into a columnar rowset.
+     */
+    fun vmFetch(vm: OpaquePointer<SQLiteCloudVM>, maxRows: Int): SQLiteCloudColumnarRowset {
+        // Each native call returns rows of the current chunk only, which the next call can replace:
+        // every range is copied before asking for the following one.
+        val parts = mutableListOf<SQLiteCloudColumnarRowset>()
+        var fetched = 0
+        while (fetched < maxRows) {
+            val range = vmFetchRows(vm, maxRows - fetched)
+            if (range < 0) {
+                parts.forEach { it.close() }
+                throw vmError(vm)
+            }
+
+            val count = (range and 0xFFFFFFFFL).toInt()
+            if (count == 0) break
+            parts.add(parseColumnarRowset(vmResult(vm), null, (range ushr 32).toInt(), count))
+            fetched += count
+        }
+
+        return when (parts.size) {
+            0 -> parseColumnarRowset(vmResult(vm), null, 0, 0)
+            1 -> parts.single()
+            else -> SQLiteCloudColumnarRowset.copyOf(parts.first().columns, parts.flatMap { part ->
+                (0..<part.rowCount).map { row -> part to row }
+            }).also { parts.forEach { it.close() } }
+        }
+    }
+
     private fun parseResult(result: OpaquePointer<SQLiteCloudResult>): SQLiteCloudResult {
         val resultType = SQLiteCloudResult.Type.fromRawValue(resultType(result))
-        return when (resultType) {
+        val parsed = when (resultType) {
             OK -> SQLiteCloudResult.Success
             NULL -> SQLiteCloudResult.Value(SQLiteCloudValue.Null)
             INTEGER -> SQLiteCloudResult.Value(SQLiteCloudValue.Integer(longResult(result)))
             FLOAT -> SQLiteCloudResult.Value(SQLiteCloudValue.Double(doubleResult(result)))
             STRING -> SQLiteCloudResult.Value(SQLiteCloudValue.String(stringResult(result)))
             JSON -> SQLiteCloudResult.Json(stringResult(result))
-            BLOB -> SQLiteCloudResult.Value(SQLiteCloudValue.Blob(bufferResult(result)))
+            BLOB -> SQLiteCloudResult.Value(SQLiteCloudValue.Blob(copyBuffer(bufferResult(result))))
             ARRAY -> SQLiteCloudResult.Array(parseArrayResult(result))
-            ROWSET -> SQLiteCloudResult.Rowset(parseRowsetResult(result))
+            ROWSET -> {
+                val materialization = materialization(result)
+                SQLiteCloudResult.Rowset(
+                    if (materialization == SQLiteCloudResult.Materialization.Lazy) {
+                        parseColumnarRowset(result).let { SQLiteCloudRowset(it.columns, it.lazyRows()) }
+                    } else {
+                        parseRowsetResult(result)
+                    },
+                ).also { it.materialization = materialization }
+            }
+
             ERROR -> throw error()
         }
+        if (parsed !== SQLiteCloudResult.Success) {
+            parsed.timings = resultTimings(result)?.let(SQLiteCloudTimings::fromNative)
+            parsed.allocations = resultAllocations(result)?.let(SQLiteCloudAllocations::fromNative)
+        }
+        return parsed
     }
 
     private fun parseArrayResult(array: OpaquePointer<SQLiteCloudResult>): List<SQLiteCloudValue> {
         val count = arrayResultSize(array)
+
+        // The whole array with one native call, falling back to per-item calls if the native side
+        // could not allocate the bytes of its TEXT/BLOB items.
+        val types = ByteArray(count)
+        val longs = LongArray(count)
+        val doubles = DoubleArray(count)
+        val offsets = IntArray(count + 1)
+        arrayResultValues(array, types, longs, doubles, offsets)?.let { bytes ->
+            val items = SQLiteCloudColumnarRowset(
+                listOf(""), count, listOf(SQLiteCloudColumnarRowset.Column(types, longs, doubles, offsets, bytes)),
+            )
+            return (0..<count).map { index -> items.value(index, 0) }
+        }
+
         return (0..<count).map { index ->
             val valueType = SQLiteCloudValue.Type.fromRawValue(arrayResultValueType(array, index))
             when (valueType) {
@@ -589,7 +1899,7 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
                 }
 
                 SQLiteCloudValue.Type.Blob -> {
-                    SQLiteCloudValue.Blob(arrayResultBufferValue(array, index))
+                    SQLiteCloudValue.Blob(copyBuffer(arrayResultBufferValue(array, index)))
                 }
 
                 SQLiteCloudValue.Type.Null -> {
@@ -603,46 +1913,421 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
         }
     }
 
-    private fun parseRowsetResult(rowset: OpaquePointer<SQLiteCloudResult>): SQLiteCloudRowset {
-        val rowCount = rowsetResultRowCount(rowset)
-        val columnCount = rowsetResultColumnCount(rowset)
+    // Chosen from the header alone, before any cell is decoded: the server sends a large rowset in
+    // chunks, and the row and column counts and the total length are known upfront. Boxing every
+    // cell of a large rowset costs more than the rows the caller usually reads of it.
+    private fun materialization(rowset: OpaquePointer<SQLiteCloudResult>): SQLiteCloudResult.Materialization {
+        val cells = rowsetResultRowCount(rowset).toLong() * rowsetResultColumnCount(rowset)
+        val bytes = resultLength(rowset).toUInt().toLong()
+        val lazy = (lazyRowsetCells > 0 || lazyRowsetBytes > 0) && (
+            resultIsChunked(rowset) ||
+                (lazyRowsetCells > 0 && cells > lazyRowsetCells) ||
+                (lazyRowsetBytes > 0 && bytes > lazyRowsetBytes)
+            )
+        if (!lazy) {
+            eagerRowsets.incrementAndGet()
+            return SQLiteCloudResult.Materialization.Eager
+        }
+        lazyRowsets.incrementAndGet()
+        return SQLiteCloudResult.Materialization.Lazy
+    }
 
-        val columns = (0..<columnCount).map { index -> rowsetResultColumnName(rowset, index) }
+    fun materializationStats() = SQLiteCloudMaterializationStats(
+        eagerRowsets = eagerRowsets.get(),
+        lazyRowsets = lazyRowsets.get(),
+        lazyRowsetCells = lazyRowsetCells,
+        lazyRowsetBytes = lazyRowsetBytes,
+    )
+
+    // The columnar copy is only an intermediate step, its arrays go back to the pool at once.
+    private fun parseRowsetResult(rowset: OpaquePointer<SQLiteCloudResult>): SQLiteCloudRowset =
+        parseColumnarRowset(rowset).use { it.toRowset() }
+
+    // Only the columns of [projection], in its order, are decoded and copied: the cells of the
+    // other columns are never read on the native side.
+    internal fun parseColumnarRowset(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        projection: IntArray? = null,
+    ): SQLiteCloudColumnarRowset = parseColumnarRowset(rowset, projection, 0, rowsetResultRowCount(rowset))
+
+    // The [rowCount] rows of [rowset] starting at [first].
+    private fun parseColumnarRowset(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        projection: IntArray?,
+        first: Int,
+        rowCount: Int,
+    ): SQLiteCloudColumnarRowset {
+        val names = rowsetColumns(rowset)
+        val columns = projection ?: IntArray(names.size) { it }
+        columns.forEach { column ->
+            if (column !in names.indices) throw IndexOutOfBoundsException("Column $column is out of range.")
+        }
 
-        val rows = (0..<rowCount).map { row ->
-            (0..<columnCount).map { column ->
-                val valueType = SQLiteCloudValue.Type.fromRawValue(
-                    rowsetResultValueType(rowset, row, column),
-                )
-                when (valueType) {
-                    SQLiteCloudValue.Type.Integer -> {
-                        SQLiteCloudValue.Integer(rowsetResultLongValue(rowset, row, column))
-                    }
+        // Transfer the whole rowset with one native call per column, falling back to
+        // per-cell calls if the native side could not build the column arrays.
+        val data = columns.map { column ->
+            parseRowsetDictionary(rowset, column, first, rowCount)
+                ?: parseRowsetColumn(rowset, column, first, rowCount)
+                ?: parseRowsetCells(rowset, column, first, rowCount)
+        }
+        return SQLiteCloudColumnarRowset(columns.map { names[it] }, rowCount, data, arrayPool)
+    }
 
-                    SQLiteCloudValue.Type.Double -> {
-                        SQLiteCloudValue.Double(rowsetResultDoubleValue(rowset, row, column))
-                    }
+    // The indexes of the columns called [names], in their order.
+    internal fun projection(rowset: OpaquePointer<SQLiteCloudResult>, names: List<String>): IntArray {
+        val columns = rowsetColumns(rowset)
+        return names.map { name ->
+            columns.indexOf(name).takeIf { it >= 0 } ?: throw SQLiteCloudError.Execution.missingColumn(name)
+        }.toIntArray()
+    }
 
-                    SQLiteCloudValue.Type.String -> {
-                        SQLiteCloudValue.String(rowsetResultStringValue(rowset, row, column))
-                    }
+    // A TEXT column with few distinct values (status, country, category...) is transferred as a
+    // code per row and each distinct value once, decoded into a single shared String. Any other
+    // column is rejected by the native side, usually in its first rows.
+    private fun parseRowsetDictionary(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        first: Int,
+        rowCount: Int,
+    ): SQLiteCloudColumnarRowset.Column? {
+        if (rowCount < dictionaryMinRows) return null
+
+        val pool = arrayPool
+        val maxCodes = rowCount / dictionaryRowsPerValue
+        val types = pool?.bytes(rowCount) ?: ByteArray(rowCount)
+        val codes = pool?.ints(rowCount) ?: IntArray(rowCount)
+        val offsets = pool?.ints(maxCodes + 1) ?: IntArray(maxCodes + 1)
+        val count = rowsetResultColumnDictionary(rowset, column, first, rowCount, maxCodes, types, codes, offsets)
+        if (count < 0) {
+            pool?.release(types, codes, offsets)
+            return null
+        }
 
-                    SQLiteCloudValue.Type.Blob -> {
-                        SQLiteCloudValue.Blob(rowsetResultBufferValue(rowset, row, column))
-                    }
+        val bytes = pool?.bytes(offsets[count]) ?: ByteArray(offsets[count])
+        if (offsets[count] > 0) rowsetResultColumnDictionaryBytes(rowset, column, first, rowCount, codes, bytes)
+        val strings = Array(count) { code ->
+            String(bytes, offsets[code], offsets[code + 1] - offsets[code], Charsets.UTF_8)
+        }
+        return SQLiteCloudColumnarRowset.Column(
+            types, emptyLongs, emptyDoubles, offsets, bytes, rowCount, codes, strings,
+        )
+    }
 
-                    SQLiteCloudValue.Type.Null -> {
-                        SQLiteCloudValue.Null
-                    }
+    private fun parseRowsetColumn(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        first: Int,
+        rowCount: Int,
+    ): SQLiteCloudColumnarRowset.Column? {
+        // The native side fills the arrays of the caller, borrowed from the pool when there is one.
+        val pool = arrayPool
+        val types = pool?.bytes(rowCount) ?: ByteArray(rowCount)
+        val longs = pool?.longs(rowCount) ?: LongArray(rowCount)
+        val doubles = pool?.doubles(rowCount) ?: DoubleArray(rowCount)
+        val offsets = pool?.ints(rowCount + 1) ?: IntArray(rowCount + 1)
+        val length = rowsetResultColumn(rowset, column, first, rowCount, types, longs, doubles, offsets)
+        if (length < 0) {
+            pool?.release(types, longs, doubles, offsets)
+            return null
+        }
 
-                    SQLiteCloudValue.Type.Unknown -> {
-                        throw SQLiteCloudError.Execution.unsupportedResultType
-                    }
-                }
+        val bytes = pool?.bytes(length) ?: ByteArray(length)
+        if (length > 0) rowsetResultColumnBytes(rowset, column, first, rowCount, bytes)
+        return SQLiteCloudColumnarRowset.Column(types, longs, doubles, offsets, bytes, rowCount)
+    }
+
+    private fun parseRowsetCells(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        first: Int,
+        rowCount: Int,
+    ): SQLiteCloudColumnarRowset.Column {
+        val types = ByteArray(rowCount)
+        val longs = LongArray(rowCount)
+        val doubles = DoubleArray(rowCount)
+        val offsets = IntArray(rowCount + 1)
+        val values = arrayOfNulls<ByteArray>(rowCount)
+
+        for (row in 0..<rowCount) {
+            val value = rowsetValue(rowset, first + row, column)
+            types[row] = value.typeValue.toByte()
+            when (value) {
+                is SQLiteCloudValue.Integer -> longs[row] = value.value
+                is SQLiteCloudValue.Double -> doubles[row] = value.value
+                is SQLiteCloudValue.String -> values[row] = value.value.toByteArray(Charsets.UTF_8)
+                is SQLiteCloudValue.Blob -> values[row] = ByteArray(value.value.remaining()).also { value.value.get(it) }
+                is SQLiteCloudValue.BlobFile, is SQLiteCloudValue.Null -> Unit
+            }
+            offsets[row + 1] = offsets[row] + (values[row]?.size ?: 0)
+        }
+
+        val bytes = ByteArray(offsets[rowCount])
+        values.forEachIndexed { row, value -> value?.copyInto(bytes, offsets[row]) }
+        return SQLiteCloudColumnarRowset.Column(types, longs, doubles, offsets, bytes)
+    }
+
+    // The returned blobs point into the native result and are only valid until it is freed.
+    internal fun rowsetValue(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        row: Int,
+        column: Int,
+    ): SQLiteCloudValue {
+        val valueType = SQLiteCloudValue.Type.fromRawValue(
+            rowsetResultValueType(rowset, row, column),
+        )
+        return when (valueType) {
+            SQLiteCloudValue.Type.Integer -> {
+                SQLiteCloudValue.Integer(rowsetResultLongValue(rowset, row, column))
+            }
+
+            SQLiteCloudValue.Type.Double -> {
+                SQLiteCloudValue.Double(rowsetResultDoubleValue(rowset, row, column))
+            }
+
+            SQLiteCloudValue.Type.String -> {
+                SQLiteCloudValue.String(rowsetResultStringValue(rowset, row, column))
+            }
+
+            SQLiteCloudValue.Type.Blob -> {
+                SQLiteCloudValue.Blob(rowsetResultBufferValue(rowset, row, column))
+            }
+
+            SQLiteCloudValue.Type.Null -> {
+                SQLiteCloudValue.Null
             }
+
+            SQLiteCloudValue.Type.Unknown -> {
+                throw SQLiteCloudError.Execution.unsupportedResultType
+            }
+        }
+    }
+
+    internal fun rowsetRowCount(rowset: OpaquePointer<SQLiteCloudResult>) = rowsetResultRowCount(rowset)
+
+    internal fun rowsetColumns(rowset: OpaquePointer<SQLiteCloudResult>): List<String> =
+        (0..<rowsetResultColumnCount(rowset)).map { index -> rowsetResultColumnName(rowset, index) }
+
+    internal fun copyRowset(rowset: OpaquePointer<SQLiteCloudResult>) = parseRowsetResult(rowset)
+
+    // The window must be empty and start at [first], see SQLiteCloudCursor.
+    internal fun fillWindow(rowset: OpaquePointer<SQLiteCloudResult>, window: CursorWindow, first: Int) =
+        rowsetResultFillWindow(rowset, window, first)
+
+    // The aggregates run over the native column arrays, only their results cross JNI.
+    internal fun aggregateRowset(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        selection: IntArray?,
+    ): SQLiteCloudNativeRowset.Aggregate {
+        val values = rowsetAggregate(rowset, column, selection)
+            ?: throw SQLiteCloudError.Execution.aggregateFailed
+        return SQLiteCloudNativeRowset.Aggregate(
+            count = values[0].toInt(),
+            sum = values[1],
+            min = values[2].takeUnless { it.isNaN() },
+            max = values[3].takeUnless { it.isNaN() },
+        )
+    }
+
+    internal fun filterRowset(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+        comparison: SQLiteCloudNativeRowset.Comparison,
+        value: Double,
+        selection: IntArray?,
+    ): IntArray = rowsetFilter(rowset, column, comparison.rawValue, value, selection)
+        ?: throw SQLiteCloudError.Execution.aggregateFailed
+
+    internal fun groupRowset(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        keyColumn: Int,
+        column: Int,
+        selection: IntArray?,
+    ): List<SQLiteCloudNativeRowset.Group> {
+        // Six values for each group: row, count, numbers, sum, min, max.
+        val values = rowsetGroupBy(rowset, keyColumn, column, selection)
+            ?: throw SQLiteCloudError.Execution.aggregateFailed
+        return (0..<values.size / 6).map { index ->
+            val group = values.copyOfRange(index * 6, index * 6 + 6)
+            val numbers = group[2].toInt()
+            SQLiteCloudNativeRowset.Group(
+                key = rowsetValue(rowset, group[0].toInt(), keyColumn),
+                count = group[1].toInt(),
+                aggregate = SQLiteCloudNativeRowset.Aggregate(
+                    count = numbers,
+                    sum = group[3],
+                    min = group[4].takeIf { numbers > 0 },
+                    max = group[5].takeIf { numbers > 0 },
+                ),
+            )
+        }
+    }
+
+    internal fun buildRowsetIndex(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        column: Int,
+    ): OpaquePointer<SQLiteCloudRowsetIndex> = rowsetBuildIndex(rowset, column)
+        .takeUnless { it == nullOpaquePointer }
+        ?: throw SQLiteCloudError.Execution.aggregateFailed
+
+    internal fun findIndexRows(index: OpaquePointer<SQLiteCloudRowsetIndex>, key: SQLiteCloudValue): IntArray {
+        // Text keys are passed as UTF-8 bytes, the encoding of the cells they are compared with.
+        val rows = when (key) {
+            is SQLiteCloudValue.Integer -> rowsetIndexFind(index, key.typeValue, key.value, 0.0, null)
+            is SQLiteCloudValue.Double -> rowsetIndexFind(index, key.typeValue, 0, key.value, null)
+            is SQLiteCloudValue.String -> rowsetIndexFind(index, key.typeValue, 0, 0.0, key.value.toByteArray())
+            is SQLiteCloudValue.Blob -> {
+                val buffer = key.value.duplicate()
+                val bytes = ByteArray(buffer.remaining()).also { buffer.get(it) }
+                rowsetIndexFind(index, key.typeValue, 0, 0.0, bytes)
+            }
+            is SQLiteCloudValue.BlobFile -> {
+                val buffer = key.mapped()
+                val bytes = ByteArray(buffer.remaining()).also { buffer.get(it) }
+                rowsetIndexFind(index, key.typeValue, 0, 0.0, bytes)
+            }
+            is SQLiteCloudValue.Null -> return IntArray(0)
+        }
+        return rows ?: throw SQLiteCloudError.Execution.aggregateFailed
+    }
+
+    internal fun releaseRowsetIndex(index: OpaquePointer<SQLiteCloudRowsetIndex>) = rowsetIndexFree(index)
+
+    internal fun sortRowset(
+        rowset: OpaquePointer<SQLiteCloudResult>,
+        columns: IntArray,
+        descending: BooleanArray?,
+    ): IntArray = rowsetSortedView(rowset, columns, descending)
+        ?: throw SQLiteCloudError.Execution.aggregateFailed
+
+    internal fun releaseResult(result: OpaquePointer<SQLiteCloudResult>) = freeResult(result)
+
+    internal fun saveRowset(rowset: OpaquePointer<SQLiteCloudResult>, path: String) = saveResult(rowset, path)
+
+    // The loaded result maps the file and needs no connection, it is released like any other.
+    internal fun loadRowset(path: String): SQLiteCloudNativeRowset? {
+        val nativeResult = loadMappedResult(path)
+        if (nativeResult == nullOpaquePointer) return null
+        return SQLiteCloudNativeRowset(this, nativeResult)
+    }
+
+    internal fun shareRowset(rowset: OpaquePointer<SQLiteCloudResult>): ParcelFileDescriptor? {
+        val fd = exportSharedResult(rowset)
+        if (fd < 0) return null
+        return ParcelFileDescriptor.adoptFd(fd)
+    }
+
+    // The loaded result maps the region, so the descriptor can be closed at once.
+    internal fun loadSharedRowset(descriptor: ParcelFileDescriptor): SQLiteCloudNativeRowset? {
+        val nativeResult = loadSharedResult(descriptor.fd)
+        if (nativeResult == nullOpaquePointer) return null
+        return SQLiteCloudNativeRowset(this, nativeResult)
+    }
+
+    // Native buffers wrap memory owned by the result, copy them before the result is freed.
+    // Blob parameters are read through GetDirectBufferAddress, so keep the copy direct.
+    private fun copyBuffer(buffer: ByteBuffer): ByteBuffer {
+        val copy = ByteBuffer.allocateDirect(buffer.remaining()).put(buffer)
+        copy.flip()
+        return copy
+    }
+
+    private external fun openCursor(
+        query: String,
+        params: Array<Any>,
+        paramTypes: IntArray,
+    ): OpaquePointer<SQLiteCloudRowsetCursor>
+
+    private external fun cursorNextChunk(
+        cursor: OpaquePointer<SQLiteCloudRowsetCursor>,
+    ): OpaquePointer<SQLiteCloudResult>
+
+    private external fun doCloseCursor(cursor: OpaquePointer<SQLiteCloudRowsetCursor>): Boolean
+
+    fun openCursor(command: SQLiteCloudCommand): OpaquePointer<SQLiteCloudRowsetCursor> {
+        val cursor = openCursor(command.query, nativeParams(command), nativeParamTypes(command))
+        if (cursor == nullOpaquePointer) {
+            val error = error()
+            logger?.logError(
+                category = "COMMAND",
+                message = "🚨 '${command.query}' cursor failed: $error",
+            )
+            throw error
+        }
+        return cursor
+    }
+
+    private external fun doExportRowset(
+        query: String,
+        params: Array<Any>,
+        paramTypes: IntArray,
+        format: Int,
+        fd: Int,
+    ): Long
+
+    /**
+     * Writes the rowset of [command] to the file open for writing as [fd], in [format], and
+     * returns the number of rows written.
+     */
+    fun exportRowset(command: SQLiteCloudCommand, format: SQLiteCloud.FileFormat, fd: Int): Long {
+        val rows = doExportRowset(command.query, nativeParams(command), nativeParamTypes(command), format.value, fd)
+        if (rows < 0) {
+            val error = error()
+            logger?.logError(
+                category = "COMMAND",
+                message = "🚨 '${command.query}' export failed: $error",
+            )
+            throw error
+        }
+        return rows
+    }
+
+    private external fun doImportFile(query: String, format: Int, fd: Int, batchRows: Int): LongArray?
+
+    /**
+     * Executes [query] for every record of the file open for reading as [fd], in [format],
+     * [batchRows] records at a time in a transaction each.
+     */
+    fun importFile(query: String, format: SQLiteCloud.FileFormat, fd: Int, batchRows: Int): SQLiteCloudImportResult {
+        val counters = doImportFile(query, format.value, fd, batchRows)
+        if (counters == null) {
+            val error = error()
+            logger?.logError(
+                category = "COMMAND",
+                message = "🚨 '$query' import failed: $error",
+            )
+            throw error
+        }
+
+        logger?.logInfo(
+            category = "COMMAND",
+            message = "🚀 '$query' import of ${counters[0]} records executed successfully",
+        )
+
+        return SQLiteCloudImportResult(rows = counters[0], changes = counters[1])
+    }
+
+    /**
+     * Returns the rows of the next chunk received from the server, or null once the rowset has been
+     * fully consumed. The native chunk is released as soon as the following one is requested.
+     */
+    fun nextCursorRows(cursor: OpaquePointer<SQLiteCloudRowsetCursor>): List<List<SQLiteCloudValue>>? =
+        nextCursorChunk(cursor)?.toRowset()?.rows
+
+    /**
+     * Same as [nextCursorRows], returning the chunk in columnar form.
+     */
+    fun nextCursorChunk(cursor: OpaquePointer<SQLiteCloudRowsetCursor>): SQLiteCloudColumnarRowset? {
+        val chunk = cursorNextChunk(cursor)
+        if (chunk == nullOpaquePointer) {
+            if (isError()) throw error()
+            return null
         }
+        return parseColumnarRowset(chunk)
+    }
 
-        return SQLiteCloudRowset(columns, rows)
+    fun closeCursor(cursor: OpaquePointer<SQLiteCloudRowsetCursor>) {
+        doCloseCursor(cursor)
     }
 
     external fun uploadDatabase(
@@ -650,15 +2335,59 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
         encryptionKey: String?,
         dataHandler: DataHandler,
         fileSize: Long,
-        callback: (dataHandler: DataHandler, buffer: ByteBuffer?, bufferLength: OpaquePointer<Int>?, totalLength: Long, previousProgress: Long) -> Int,
+        callback: (dataHandler: DataHandler, buffer: ByteBuffer?, bufferLength: ByteBuffer?, totalLength: Long, previousProgress: Long) -> Int,
     ): Boolean
 
     external fun downloadDatabase(
         name: String,
         dataHandler: DataHandler,
-        callback: (dataHandler: DataHandler, buffer: ByteBuffer?, bufferLength: OpaquePointer<Int>?, totalLength: Long, previousProgress: Long) -> Int,
+        callback: (dataHandler: DataHandler, buffer: ByteBuffer?, bufferLength: ByteBuffer?, totalLength: Long, previousProgress: Long) -> Int,
+    ): Boolean
+
+    /**
+     * Uploads the content of the file open as [fd] natively, the chunks never reach the JVM. The
+     * next chunks are read ahead while one is sent, [chunkSize] bytes each or, if `0`, tuned from
+     * the time each chunk takes. [callback] is called on this thread at most every 100 ms, an
+     * exception it throws cancels the upload and is rethrown.
+     */
+    external fun uploadDatabaseFile(
+        name: String,
+        encryptionKey: String?,
+        fd: Int,
+        chunkSize: Int,
+        callback: SQLiteCloudProgressCallback,
+    ): Boolean
+
+    /**
+     * Downloads a database into the file open for writing as [fd] natively, the chunks never
+     * reach the JVM. [callback] is called as for [uploadDatabaseFile].
+     */
+    external fun downloadDatabaseFile(
+        name: String,
+        fd: Int,
+        callback: SQLiteCloudProgressCallback,
     ): Boolean
 
+    /**
+     * Downloads a database into the file open for reading and writing as [fd], saving checkpoints
+     * to the file open as [checkpointFd]. After a failure, the next call with the same files
+     * verifies the bytes already written and downloads only the missing tail, if the database has
+     * not changed meanwhile. The checkpoint is cleared once the download completes.
+     */
+    external fun downloadDatabaseResumable(
+        name: String,
+        fd: Int,
+        checkpointFd: Int,
+        callback: SQLiteCloudProgressCallback,
+    ): Boolean
+
+    /**
+     * Brings the local copy at [localPath] to the current version of a database, downloading
+     * nothing if [lastRaftIndex] is still its raft index and writing only the blocks that changed
+     * otherwise. Returns the new raft index, or `-1` on error.
+     */
+    external fun syncDatabase(name: String, localPath: String, lastRaftIndex: Long): Long
+
     fun error(): SQLiteCloudError {
         if (isError()) {
             val code = errorCode()!!
@@ -686,8 +2415,76 @@ internal class SQLiteCloudBridge(val logger: SQLiteCloudLogger?) {
     }
 
     companion object {
+        // Distinct from the savepoint of the native batches of [executeMany].
+        private const val writeBatchSavepoint = "sqlitecloud_write_batch"
+
+        // Columns are dictionary encoded from this many rows, when they have at most one distinct
+        // value every [dictionaryRowsPerValue] rows.
+        private const val dictionaryMinRows = 64
+        private const val dictionaryRowsPerValue = 4
+
+        // Dictionary encoded columns have no numeric cells.
+        private val emptyLongs = LongArray(0)
+        private val emptyDoubles = DoubleArray(0)
+
         init {
             System.loadLibrary("sqlitecloud")
         }
+
+        @JvmStatic
+        external fun setProcessMemoryBudget(soft: Long, hard: Long)
+
+        /**
+         * Times the LZ4 decompression of synthetic rowsets for about [budgetMs] milliseconds (`0`
+         * for the native default) on the calling thread. Returns the uncompressed bytes per second,
+         * the nanoseconds of a call and the permille ratio, or `null` when it could not allocate.
+         */
+        @JvmStatic
+        external fun compressionCalibrate(budgetMs: Int): LongArray?
+
+        /**
+         * Sets the decompression speed used by the compression policy of every connection of the
+         * process; a [decompressRate] of `0` removes it.
+         */
+        @JvmStatic
+        external fun setCompressionCalibration(decompressRate: Long, decompressCallNanos: Int)
+
+        /** Whether a connection opened by [connectStandby] is still authenticated and open. */
+        @JvmStatic
+        external fun isStandbyReady(connection: OpaquePointer<SQLiteCloudConnection>): Boolean
+
+        /** Closes a connection opened by [connectStandby] that has not been adopted. */
+        @JvmStatic
+        external fun closeStandby(connection: OpaquePointer<SQLiteCloudConnection>)
+
+        /**
+         * Pins the numeric [addresses] (separated by commas) used to connect to [hostname]:[port]
+         * instead of resolving it; `null` goes back to the DNS cache of the process.
+         */
+        @JvmStatic
+        external fun setResolvedAddresses(hostname: String, port: Int, addresses: String?): Boolean
+
+        /**
+         * Binds the sockets opened from now on to the network of [handle] (`Network.getNetworkHandle`,
+         * `0` for the default one). A change makes the connections already open not alive.
+         */
+        @JvmStatic
+        external fun setNetwork(handle: Long)
+
+        /**
+         * Runs the one-time native initialization, loads the TLS configuration of a connection
+         * and resolves [hostname] (when not `null`) so that the first connect does not pay for them.
+         */
+        @JvmStatic
+        external fun initialize(
+            hostname: String?,
+            port: Int,
+            family: Int,
+            tlsRootCertificate: String?,
+            tlsCertificate: String?,
+            tlsCertificateKey: String?,
+            tlsCiphers: String?,
+            insecure: Boolean,
+        ): Boolean
     }
 }
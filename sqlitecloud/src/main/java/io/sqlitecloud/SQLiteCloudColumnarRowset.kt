@@ -0,0 +1,318 @@
+package io.sqlitecloud
+
+import java.nio.ByteBuffer
+import java.util.BitSet
+
+/**
+ * A result set stored column by column in primitive arrays.
+ *
+ * [SQLiteCloudRowset] boxes every cell into a [SQLiteCloudValue] inside nested lists, which for
+ * large results means one heap object per cell. [SQLiteCloudColumnarRowset] keeps each column in
+ * a handful of arrays instead: integers in a [LongArray], floating point values in a
+ * [DoubleArray], the bytes of TEXT and BLOB cells concatenated in a single [ByteArray] indexed by
+ * offset, and NULL cells in a [BitSet]. Cells are read with the typed getters, without allocating
+ * for numeric values. TEXT columns with few distinct values are dictionary encoded: each distinct
+ * value is transferred and decoded once, and [getString] returns the same [String] instance for
+ * every cell that holds it.
+ *
+ * Create an instance with [SQLiteCloud].[executeColumnar], or from a
+ * [SQLiteCloudNativeRowset]. Use [toRowset] when a [SQLiteCloudRowset] is required. When
+ * [SQLiteCloudConfig.arrayPoolSize] is set, [close] a rowset that is no longer needed so that
+ * the next one reuses its arrays.
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * val rowset = sqliteCloud.executeColumnar(SQLiteCloudCommand("SELECT id, score FROM players"))
+ * var total = 0.0
+ * for (row in 0..<rowset.rowCount) {
+ *     total += rowset.getDouble(row, 1)
+ * }
+ * ```
+ */
+class SQLiteCloudColumnarRowset internal constructor(
+    /** The column names of the result set. */
+    val columns: List<String>,
+    /** The number of rows in the result set. */
+    val rowCount: Int,
+    private val data: List<Column>,
+    // The pool the arrays were borrowed from, they are given back by [close].
+    private var pool: SQLiteCloudArrayPool? = null,
+) : AutoCloseable {
+    // Arrays borrowed from a pool can be longer than [rows], only their first [rows] cells are set.
+    // A dictionary encoded TEXT column has [codes], the code of each row (-1 for NULL): [offsets]
+    // and [bytes] then hold the distinct values, decoded once into [strings].
+    internal class Column(
+        val types: ByteArray,
+        val longs: LongArray,
+        val doubles: DoubleArray,
+        val offsets: IntArray,
+        val bytes: ByteArray,
+        val rows: Int = types.size,
+        val codes: IntArray? = null,
+        val strings: Array<String>? = null,
+    ) {
+        val nulls = BitSet(rows).apply {
+            for (row in 0..<rows) if (types[row].toInt() == nullType) set(row)
+        }
+
+        // The bounds in [bytes] of the TEXT or BLOB cell of [row].
+        fun start(row: Int) = if (codes == null) offsets[row] else offsets[codes[row]]
+
+        fun end(row: Int) = if (codes == null) offsets[row + 1] else offsets[codes[row] + 1]
+
+        fun string(row: Int): String =
+            strings?.get(codes!![row]) ?: String(bytes, start(row), end(row) - start(row), Charsets.UTF_8)
+    }
+
+    private var isClosed = false
+
+    /** The number of columns in the result set. */
+    val columnCount: Int
+        get() = columns.size
+
+    /**
+     * Returns the type of the cell at [row] and [column].
+     *
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun type(row: Int, column: Int): SQLiteCloudValue.Type =
+        SQLiteCloudValue.Type.fromRawValue(columnAt(row, column).types[row].toInt())
+
+    /**
+     * Returns true if the cell at [row] and [column] is NULL.
+     *
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun isNull(row: Int, column: Int): Boolean = columnAt(row, column).nulls.get(row)
+
+    /**
+     * Returns the cell at [row] and [column] as a [Long]. Floating point values are truncated and
+     * NULL is returned as `0`.
+     *
+     * @throws SQLiteCloudError.Execution if the cell is TEXT or BLOB.
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun getLong(row: Int, column: Int): Long {
+        val data = columnAt(row, column)
+        return when (data.types[row].toInt()) {
+            integerType -> data.longs[row]
+            doubleType -> data.doubles[row].toLong()
+            nullType -> 0
+            else -> throw SQLiteCloudError.Execution.unsupportedValueType
+        }
+    }
+
+    /**
+     * Returns the cell at [row] and [column] as a [Double]. NULL is returned as `0.0`.
+     *
+     * @throws SQLiteCloudError.Execution if the cell is TEXT or BLOB.
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun getDouble(row: Int, column: Int): Double {
+        val data = columnAt(row, column)
+        return when (data.types[row].toInt()) {
+            integerType -> data.longs[row].toDouble()
+            doubleType -> data.doubles[row]
+            nullType -> 0.0
+            else -> throw SQLiteCloudError.Execution.unsupportedValueType
+        }
+    }
+
+    /**
+     * Returns the cell at [row] and [column] as a [String], or null if the cell is NULL.
+     * Numeric values are formatted and BLOB values decoded as UTF-8.
+     *
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun getString(row: Int, column: Int): String? {
+        val data = columnAt(row, column)
+        return when (data.types[row].toInt()) {
+            integerType -> data.longs[row].toString()
+            doubleType -> data.doubles[row].toString()
+            nullType -> null
+            else -> data.string(row)
+        }
+    }
+
+    /**
+     * Returns a read-only view over the bytes of the TEXT or BLOB cell at [row] and [column], or
+     * null for any other type. The view shares the storage of the rowset, no bytes are copied.
+     *
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun getBlob(row: Int, column: Int): ByteBuffer? {
+        val data = columnAt(row, column)
+        return when (data.types[row].toInt()) {
+            stringType, blobType -> {
+                val offset = data.start(row)
+                ByteBuffer.wrap(data.bytes, offset, data.end(row) - offset).slice().asReadOnlyBuffer()
+            }
+
+            else -> null
+        }
+    }
+
+    /**
+     * Returns a copy of the bytes of the TEXT or BLOB cell at [row] and [column], or null for any
+     * other type.
+     *
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun getBytes(row: Int, column: Int): ByteArray? {
+        val data = columnAt(row, column)
+        return when (data.types[row].toInt()) {
+            stringType, blobType -> data.bytes.copyOfRange(data.start(row), data.end(row))
+            else -> null
+        }
+    }
+
+    /**
+     * Returns the cell at [row] and [column] boxed into a [SQLiteCloudValue]. Blob values are
+     * copied into a new direct buffer.
+     *
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     */
+    fun value(row: Int, column: Int): SQLiteCloudValue {
+        val data = columnAt(row, column)
+        return when (data.types[row].toInt()) {
+            integerType -> SQLiteCloudValue.Integer(data.longs[row])
+            doubleType -> SQLiteCloudValue.Double(data.doubles[row])
+            stringType -> SQLiteCloudValue.String(getString(row, column)!!)
+            blobType -> {
+                // Blob parameters are read through GetDirectBufferAddress, so keep the buffer direct.
+                val offset = data.start(row)
+                val length = data.end(row) - offset
+                val buffer = ByteBuffer.allocateDirect(length).put(data.bytes, offset, length)
+                buffer.flip()
+                SQLiteCloudValue.Blob(buffer)
+            }
+
+            nullType -> SQLiteCloudValue.Null
+            else -> throw SQLiteCloudError.Execution.unsupportedResultType
+        }
+    }
+
+    /**
+     * Returns the index of the column called [name].
+     *
+     * @throws SQLiteCloudError.Execution if there is no such column.
+     */
+    fun columnIndex(name: String): Int {
+        val index = columns.indexOf(name)
+        if (index < 0) throw SQLiteCloudError.Execution.missingColumn(name)
+        return index
+    }
+
+    /**
+     * Decodes every row with [mapper], usually generated for a [SQLiteCloudRow] class.
+     */
+    fun <T> map(mapper: SQLiteCloudRowMapper<T>): List<T> = mapper.decode(this)
+
+    /**
+     * Boxes the whole result set into a [SQLiteCloudRowset], for the APIs that expect one.
+     */
+    fun toRowset(): SQLiteCloudRowset = SQLiteCloudRowset(
+        columns,
+        (0..<rowCount).map { row -> (0..<columnCount).map { column -> value(row, column) } },
+    )
+
+    /**
+     * The rows of the result set as a read-only list that boxes the cells of a row only when the
+     * row is read, each time it is read. The rowset must not be closed while the list is in use.
+     */
+    internal fun lazyRows(): List<List<SQLiteCloudValue>> = object : AbstractList<List<SQLiteCloudValue>>() {
+        override val size: Int
+            get() = rowCount
+
+        override fun get(index: Int): List<SQLiteCloudValue> {
+            if (index !in 0..<rowCount) throw IndexOutOfBoundsException("Row $index is out of range.")
+            return List(columnCount) { column -> value(index, column) }
+        }
+    }
+
+    /**
+     * A rowset with copies of the given [rows] of this one, in that order.
+     */
+    internal fun copyRows(rows: List<Int>): SQLiteCloudColumnarRowset {
+        if (isClosed) throw SQLiteCloudError.Execution.closedRowset
+        return copyOf(columns, rows.map { this to it })
+    }
+
+    /**
+     * Gives the arrays of the rowset back to the pool of its connection, see
+     * [SQLiteCloudConfig.arrayPoolSize], so that the next rowsets fill them instead of allocating
+     * new ones. The rowset and the buffers returned by [getBlob] must not be used afterwards.
+     *
+     * Closing is optional, a rowset that is not closed is collected as usual. Calling this method
+     * more than once has no effect.
+     */
+    override fun close() {
+        if (isClosed) return
+        isClosed = true
+        pool?.let { pool ->
+            data.forEach { column ->
+                pool.release(column.types, column.longs, column.doubles, column.offsets, column.bytes)
+                column.codes?.let { pool.release(it) }
+            }
+        }
+        pool = null
+    }
+
+    private fun columnAt(row: Int, column: Int): Column {
+        if (isClosed) throw SQLiteCloudError.Execution.closedRowset
+        if (row !in 0..<rowCount || column !in columns.indices) {
+            throw IndexOutOfBoundsException("Cell [$row, $column] is out of range.")
+        }
+        return data[column]
+    }
+
+    internal companion object {
+        private val integerType = SQLiteCloudValue.Type.Integer.rawValue
+        private val doubleType = SQLiteCloudValue.Type.Double.rawValue
+        private val stringType = SQLiteCloudValue.Type.String.rawValue
+        private val blobType = SQLiteCloudValue.Type.Blob.rawValue
+        private val nullType = SQLiteCloudValue.Type.Null.rawValue
+
+        /**
+         * A rowset made of copies of [rows], each a row of a rowset with the same [columns].
+         */
+        fun copyOf(
+            columns: List<String>,
+            rows: List<Pair<SQLiteCloudColumnarRowset, Int>>,
+        ): SQLiteCloudColumnarRowset {
+            val data = columns.indices.map { column ->
+                val types = ByteArray(rows.size)
+                val longs = LongArray(rows.size)
+                val doubles = DoubleArray(rows.size)
+                val offsets = IntArray(rows.size + 1)
+                // Dictionary encoded columns are copied cell by cell, only TEXT cells have values there.
+                rows.forEachIndexed { index, (rowset, row) ->
+                    val source = rowset.data[column]
+                    val type = source.types[row]
+                    types[index] = type
+                    if (source.codes == null) {
+                        longs[index] = source.longs[row]
+                        doubles[index] = source.doubles[row]
+                    }
+                    val length = if (type.toInt() == stringType || type.toInt() == blobType) {
+                        source.end(row) - source.start(row)
+                    } else {
+                        0
+                    }
+                    offsets[index + 1] = offsets[index] + length
+                }
+
+                val bytes = ByteArray(offsets[rows.size])
+                rows.forEachIndexed { index, (rowset, row) ->
+                    val source = rowset.data[column]
+                    if (offsets[index + 1] > offsets[index]) {
+                        source.bytes.copyInto(bytes, offsets[index], source.start(row), source.end(row))
+                    }
+                }
+                Column(types, longs, doubles, offsets, bytes)
+            }
+            return SQLiteCloudColumnarRowset(columns, rows.size, data)
+        }
+    }
+}
@@ -1,14 +1,175 @@
 package io.sqlitecloud
 
+import java.nio.ByteBuffer
+
 data class SQLiteCloudCommand(
     val query: String,
     val parameters: List<SQLiteCloudValue> = emptyList(),
+    /**
+     * The time budget of the command in milliseconds, covering both sending the command and
+     * receiving its reply. It replaces [SQLiteCloudConfig.timeout] for this command only, `0`
+     * means no deadline.
+     *
+     * A command that overruns its deadline fails with [SQLiteCloudError.Connection] and the
+     * connection remains usable: its late reply is discarded before the next one, or the
+     * connection is opened again when the reply had already been partially received. Commands
+     * sent together by [SQLiteCloud.executeAll] ignore it.
+     */
+    val deadlineMs: Int = 0,
+    /**
+     * The tables read by the query. When [SQLiteCloudConfig.resultCacheSize] is set, a command
+     * that declares them is served from the result cache of [SQLiteCloud.execute] until a change
+     * notification arrives for one of those tables; the connection listens to them with
+     * `LISTEN TABLE` the first time. Commands without tables, or with blob parameters, are never
+     * cached.
+     */
+    val cacheTables: List<String> = emptyList(),
+    /**
+     * The class of work of the command, used by [SQLiteCloudPool] to choose which waiting command
+     * gets the next free connection and to keep connections for [Priority.Interactive] commands.
+     */
+    val priority: Priority = Priority.Normal,
+    /**
+     * Client keys that apply to this command only, in place of the ones of [SQLiteCloudConfig].
+     * They are sent in the same write as the command and set back together with the next one, so
+     * they cost no round trip, and the keys that match the connection are not sent at all.
+     * Commands sent together by [SQLiteCloud.executeAll] ignore them.
+     */
+    val options: Options? = null,
 ) {
+    /// Constants that describe the class of work of a command, from the most urgent.
+    enum class Priority(val value: Int) {
+        /// A lookup that a user is waiting for.
+        Interactive(0),
+
+        /// The default.
+        Normal(1),
+
+        /// An export, a sync or any other long-running command.
+        Bulk(2),
+    }
+
     constructor(
         query: String,
         vararg parameters: SQLiteCloudValue,
     ) : this(query, parameters.toList())
 
+    /**
+     * Client keys of a single command, a null property keeps the setting of the connection.
+     *
+     * ```kotlin
+     * // a list that skips the blobs and truncates long text, on a connection that sends everything
+     * SQLiteCloudCommand("SELECT * FROM photos", options = SQLiteCloudCommand.Options(noBlob = true, maxData = 256))
+     * ```
+     */
+    data class Options(
+        /** Whether BLOB cells are replaced with NULL, see [SQLiteCloudConfig.noblob]. */
+        val noBlob: Boolean? = null,
+        /** Whether TEXT cells are zero terminated, see [SQLiteCloudConfig.zerotext]. */
+        val zeroText: Boolean? = null,
+        /** Whether the read may be served by a node that is behind, see [SQLiteCloudConfig.nonlinearizable]. */
+        val nonLinearizable: Boolean? = null,
+        /** Whether the reply is compressed, see [SQLiteCloudConfig.compression]. */
+        val compression: Boolean? = null,
+        /** The maximum size of a cell in bytes, `0` removes the limit. See [SQLiteCloudConfig.maxData]. */
+        val maxData: Int? = null,
+        /** The rows of each chunk of the rowset, `0` sends it whole. See [SQLiteCloudConfig.maxRows]. */
+        val maxRows: Int? = null,
+        /** The maximum size of the rowset in bytes, `0` removes the limit. See [SQLiteCloudConfig.maxRowset]. */
+        val maxRowset: Int? = null,
+    ) {
+        /**
+         * Native layout, in the order of `SQCloudCommandOptions`: `0` keeps the setting of the
+         * connection, `-1` turns a key off or removes its limit.
+         */
+        internal val encoded: IntArray
+            get() = intArrayOf(
+                flag(noBlob),
+                flag(zeroText),
+                flag(nonLinearizable),
+                flag(compression),
+                limit(maxData),
+                limit(maxRows),
+                limit(maxRowset),
+            )
+
+        private fun flag(value: Boolean?) = when (value) {
+            null -> 0
+            true -> 1
+            false -> -1
+        }
+
+        private fun limit(value: Int?) = when {
+            value == null -> 0
+            value > 0 -> value
+            else -> -1
+        }
+    }
+
+    /**
+     * UTF-8 encoding of the command, computed once so that repeated executions
+     * hand the same direct buffers to the native side without any copy.
+     */
+    internal val encoded: Encoded by lazy { Encoded(this) }
+
+    /**
+     * Whether the query only reads, judged from its text without a round trip: a single
+     * `SELECT`, `VALUES` or `EXPLAIN` statement, a `WITH` not followed by a write, or a
+     * `PRAGMA` that does not assign. Everything else, server commands included, is a write.
+     * [SQLiteCloudRouter] uses it to send the command to a replica.
+     */
+    val isReadOnly: Boolean by lazy { isReadOnlyQuery(query) }
+
+    /**
+     * Native layout of a command. Null parameters are skipped. Integers and doubles are
+     * stored in [longs] and [doubles]; text parameters are packed one after the other
+     * in [text], each followed by a zero byte, and [longs] holds their length in bytes;
+     * blobs are kept in [blobs], and the path of a file blob, which is opened natively while
+     * the command is sent, as well. [query] is zero terminated as well.
+     */
+    internal class Encoded(command: SQLiteCloudCommand) {
+        val query: ByteBuffer = zeroTerminated(listOf(command.query.toByteArray(Charsets.UTF_8)))
+        val types: IntArray
+        val longs: LongArray
+        val doubles: DoubleArray
+        val blobs: Array<Any?>
+        val text: ByteBuffer?
+
+        init {
+            val values = command.parameters.filter { it !is SQLiteCloudValue.Null }
+            types = values.map { it.typeValue }.toIntArray()
+            longs = LongArray(values.size)
+            doubles = DoubleArray(values.size)
+            blobs = arrayOfNulls(values.size)
+
+            val strings = mutableListOf<ByteArray>()
+            values.forEachIndexed { index, value ->
+                when (value) {
+                    is SQLiteCloudValue.Integer -> longs[index] = value.value
+                    is SQLiteCloudValue.Double -> doubles[index] = value.value
+                    is SQLiteCloudValue.String -> {
+                        val bytes = value.value.toByteArray(Charsets.UTF_8)
+                        longs[index] = bytes.size.toLong()
+                        strings.add(bytes)
+                    }
+                    is SQLiteCloudValue.Blob -> blobs[index] = value.value
+                    is SQLiteCloudValue.BlobFile -> {
+                        types[index] = SQLiteCloudValue.blobFileTypeValue
+                        blobs[index] = value.value.path
+                    }
+                    is SQLiteCloudValue.Null -> Unit
+                }
+            }
+            text = if (strings.isEmpty()) null else zeroTerminated(strings)
+        }
+
+        private fun zeroTerminated(strings: List<ByteArray>): ByteBuffer {
+            val buffer = ByteBuffer.allocateDirect(strings.sumOf { it.size + 1 })
+            strings.forEach { buffer.put(it).put(0) }
+            return buffer
+        }
+    }
+
     override fun toString(): String {
         val params = parameters.toMutableList()
         val resultString = query.replace(Regex("\\?")) {
@@ -18,6 +179,22 @@ data class SQLiteCloudCommand(
     }
 
     companion object {
+        private val commentsRegex = Regex("--[^\\n]*|/\\*.*?(\\*/|$)", RegexOption.DOT_MATCHES_ALL)
+        private val writeKeywordRegex = Regex("\\b(INSERT|UPDATE|DELETE|REPLACE)\\b", RegexOption.IGNORE_CASE)
+
+        internal fun isReadOnlyQuery(query: String): Boolean {
+            val sql = query.replace(commentsRegex, " ").trim().trimEnd(';').trim()
+            // a second statement could write
+            if (sql.isEmpty() || sql.contains(';')) return false
+
+            return when (sql.takeWhile { it.isLetter() }.uppercase()) {
+                "SELECT", "VALUES", "EXPLAIN" -> true
+                "WITH" -> !writeKeywordRegex.containsMatchIn(sql)
+                "PRAGMA" -> !sql.contains('=') && !sql.contains('(')
+                else -> false
+            }
+        }
+
         fun expandBlobField(
             table: String,
             column: String,
@@ -0,0 +1,87 @@
+package io.sqlitecloud
+
+import kotlin.math.ceil
+
+/// HDR style latency histograms of the operations of a connection, see
+/// [SQLiteCloud.commandLatency].
+///
+/// Counter n of a histogram counts the latencies below [bucketLimitMicros] of n microseconds and
+/// not below the limit of counter n - 1: each microsecond below 16 has a counter of its own, each
+/// following power of two is split in 8 counters, so a percentile is at most 12.5% above the
+/// measured latency. The last counter also counts every latency longer than about 4.7 hours.
+///
+/// The histograms of several connections, for example the ones of a pool, are merged with [plus].
+///
+/// - Parameters:
+///   - histograms: The histogram of each [Kind], of [bucketCount] counters.
+data class SQLiteCloudCommandLatency(
+    val histograms: Map<Kind, List<Int>>,
+) {
+    /// The operations timed by a histogram.
+    enum class Kind {
+        /// The plain commands, from the write of the command to its reply being parsed.
+        Query,
+
+        /// The commands with bound values.
+        ExecArray,
+
+        /// The steps of a [SQLiteCloudVM], a step within a rowset already received included.
+        VMStep,
+
+        /// The blob reads and writes.
+        Blob,
+
+        /// The wait for the reply of each step of a database download.
+        DownloadStep,
+
+        /// The steps of a backup, without the write of their pages.
+        BackupStep,
+
+        /// From the pub/sub socket being readable to the notification handlers returning.
+        PubSub,
+    }
+
+    /// The upper bound in microseconds of the [fraction] percentile of [kind], 0 if empty.
+    fun percentileMicros(kind: Kind, fraction: Double): Long =
+        percentileMicros(histograms[kind].orEmpty(), fraction)
+
+    /// The histograms of this connection and of [other] added together.
+    operator fun plus(other: SQLiteCloudCommandLatency) = SQLiteCloudCommandLatency(
+        Kind.values().associateWith { kind ->
+            val counters = histograms[kind] ?: List(bucketCount) { 0 }
+            val otherCounters = other.histograms[kind] ?: List(bucketCount) { 0 }
+            counters.zip(otherCounters) { a, b -> a + b }
+        },
+    )
+
+    companion object {
+        const val bucketCount = 256
+
+        private const val subBuckets = 8
+
+        /// The microseconds above the latencies counted by counter [index] of a histogram.
+        fun bucketLimitMicros(index: Int): Long {
+            val bucket = index.coerceIn(0, bucketCount - 1)
+            if (bucket < 2 * subBuckets) return bucket + 1L
+            return (subBuckets + bucket % subBuckets + 1).toLong() shl (bucket / subBuckets - 1)
+        }
+
+        /// The upper bound in microseconds of the [fraction] percentile of [histogram], 0 if empty.
+        fun percentileMicros(histogram: List<Int>, fraction: Double): Long {
+            val total = histogram.sumOf { it.toLong() }
+            if (total == 0L) return 0
+
+            val target = maxOf(1L, ceil(total * fraction).toLong())
+            var count = 0L
+            histogram.forEachIndexed { index, counter ->
+                count += counter
+                if (count >= target) return bucketLimitMicros(index)
+            }
+            return bucketLimitMicros(histogram.size - 1)
+        }
+
+        internal fun fromNative(counters: IntArray) = SQLiteCloudCommandLatency(
+            Kind.values().zip(counters.asList().chunked(bucketCount)).toMap(),
+        )
+    }
+}
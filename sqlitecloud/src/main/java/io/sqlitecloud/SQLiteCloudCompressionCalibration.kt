@@ -0,0 +1,77 @@
+package io.sqlitecloud
+
+import android.os.Build
+import java.io.File
+
+/**
+ * How fast this device decompresses LZ4, measured by [SQLiteCloud.calibrateCompression] on
+ * synthetic rowsets of a few KiB and of a MiB.
+ *
+ * Together with the link rate of each connection, [SQLiteCloudConnectionStats.linkRate], it
+ * replaces the guesses of the compression policy: compression pays off when receiving the bytes
+ * that it saves takes longer than decompressing the reply, so the policy keeps it on for ratios
+ * below `1 - linkRate / decompressBytesPerSecond` and for replies large enough that the bytes
+ * saved also cover [decompressCallNanos] and the framing. Only the decompression is measured, the
+ * time the server spends compressing a reply is not known to the client. On a
+ * [SQLiteCloudConfig.NetworkClass.Metered] network the ratio of the class still applies, since
+ * the bytes themselves cost there.
+ *
+ * @property decompressBytesPerSecond The uncompressed bytes per second of `LZ4_decompress_safe`
+ *           on large replies.
+ * @property decompressCallNanos The fixed cost of a decompression, whatever its size.
+ * @property ratio The permille ratio of the synthetic rowsets, for reference only: the policy
+ *           uses the ratio of the actual replies.
+ */
+data class SQLiteCloudCompressionCalibration(
+    val decompressBytesPerSecond: Long,
+    val decompressCallNanos: Int,
+    val ratio: Int,
+) {
+    internal companion object {
+        private const val fileName = "sqlitecloud-compression.calibration"
+
+        fun file(filesDir: File) = File(filesDir, fileName)
+
+        fun fromNative(values: LongArray) = SQLiteCloudCompressionCalibration(
+            decompressBytesPerSecond = values[0],
+            decompressCallNanos = values[1].toInt(),
+            ratio = values[2].toInt(),
+        )
+
+        // The first line is the build fingerprint of the device that measured it, so that an OS
+        // update or a restored backup calibrates again.
+        fun load(file: File): SQLiteCloudCompressionCalibration? = runCatching {
+            val lines = file.readLines()
+            if (lines.size < 2 || lines[0] != Build.FINGERPRINT) {
+                return null
+            }
+            val (rate, callNanos, ratio) = lines[1].split(' ')
+            SQLiteCloudCompressionCalibration(rate.toLong(), callNanos.toInt(), ratio.toInt())
+        }.getOrNull()
+
+        fun save(file: File, calibration: SQLiteCloudCompressionCalibration) {
+            val temporary = File(file.path + ".tmp")
+            temporary.writeText(
+                "${Build.FINGERPRINT}\n" +
+                    "${calibration.decompressBytesPerSecond} ${calibration.decompressCallNanos} ${calibration.ratio}\n",
+            )
+            temporary.renameTo(file)
+        }
+    }
+}
+
+/**
+ * What the compression policy of a connection decides with now, see
+ * [SQLiteCloud.compressionThreshold]. Compression is turned on for replies of at least [minSize]
+ * bytes that compress below [ratioMax] permille, and kept on down to half that size.
+ *
+ * @property minSize The reply size, from the calibration or [SQLiteCloudConfig.compressionMinSize].
+ * @property ratioMax The permille ratio, from the calibration or the network class.
+ * @property calibrated Whether both come from a [SQLiteCloudCompressionCalibration] and the link
+ *           rate of the connection.
+ */
+data class SQLiteCloudCompressionThreshold(
+    val minSize: Int,
+    val ratioMax: Int,
+    val calibrated: Boolean,
+)
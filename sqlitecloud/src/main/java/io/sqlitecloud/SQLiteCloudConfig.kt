@@ -8,7 +8,7 @@ data class SQLiteCloudConfig(
     val username: String,
     val password: String,
     val port: Int = defaultPort,
-    val family: Family = Family.IPv4,
+    val family: Family = Family.IPvAny,
     val passwordHashed: Boolean = false,
     val nonlinearizable: Boolean = false,
     val timeout: Int = 0,
@@ -19,6 +19,17 @@ data class SQLiteCloudConfig(
     val dbCreate: Boolean = false,
     val insecure: Boolean = false,
     val noblob: Boolean = false,
+    val binaryRowset: Boolean = false,
+    val compactIndex: Boolean = false,
+    val deferConfig: Boolean = false,
+    val keepAliveIdle: Int = 0,
+    val keepAliveInterval: Int = 0,
+    val keepAliveCount: Int = 0,
+    val userTimeoutMs: Int = 0,
+    val pingTimeoutMs: Int = 0,
+    val lazyConnect: Boolean = false,
+    val standbyRefreshMs: Int = 0,
+    val networkAware: Boolean = false,
     val isReadonlyConnection: Boolean = false,
     val maxData: Int = 0,
     val maxRows: Int = 0,
@@ -27,18 +38,65 @@ data class SQLiteCloudConfig(
     val rootCertificate: String? = null,
     val clientCertificate: String? = null,
     val clientCertificateKey: String? = null,
+    val tlsCiphers: String? = null,
+    val statementCacheSize: Int = defaultStatementCacheSize,
+    val autoParameterizeSize: Int = 0,
+    val resultPoolSize: Int = 0,
+    val chunkWindow: Int = 0,
+    val adaptiveChunkMinRows: Int = 0,
+    val adaptiveChunkMaxRows: Int = 0,
+    val adaptiveChunkMs: Int = defaultAdaptiveChunkMs,
+    val compressionMinSize: Int = 0,
+    val networkClass: NetworkClass = NetworkClass.Unknown,
+    val compressionCalibration: Boolean = false,
+    val chunkWorkers: Int = 0,
+    val parallelParseMinBytes: Int = 0,
+    val uploadCompressionMinSize: Int = 0,
+    val downloadWindow: Int = 0,
+    val downloadCompression: Boolean = false,
+    val compressionDictionarySize: Int = 0,
+    val headerCacheSize: Int = 0,
+    val resultCacheSize: Int = 0,
+    val arrayPoolSize: Long = 0,
+    val blobCacheSize: Long = 0,
+    val spillThreshold: Int = 0,
+    val lazyRowsetCells: Int = defaultLazyRowsetCells,
+    val lazyRowsetBytes: Int = defaultLazyRowsetBytes,
+    val memorySoftLimit: Long = 0,
+    val memoryHardLimit: Long = 0,
+    val pubSubQueueSize: Int = 0,
+    val pubSubOverflow: PubSubOverflow = PubSubOverflow.DropOldest,
+    val pubSubFilter: Boolean = false,
+    val notifyWindowMs: Int = 0,
+    val writeBatchWindowMs: Int = 0,
+    val writeBatchMaxStatements: Int = defaultWriteBatchMaxStatements,
+    val writeBatchFailure: WriteBatchFailure = WriteBatchFailure.Isolated,
+    val offlineQueue: Boolean = false,
+    val dedupReads: Boolean = false,
+    val pubSubLatency: Boolean = false,
+    val latencyHistograms: Boolean = false,
+    val allocationCounters: Boolean = false,
+    val wireRecordPath: String? = null,
+    val wireReplayPath: String? = null,
 ) {
     val connectionString: String
         get() = "sqlitecloud://$username:****@$hostname:$port/${dbname ?: ""}"
 
     companion object {
         const val defaultPort = 8860
+        const val defaultStatementCacheSize = 16
+        const val defaultAdaptiveChunkMs = 100
+        const val defaultWriteBatchMaxStatements = 64
+        const val defaultLazyRowsetCells = 4096
+        const val defaultLazyRowsetBytes = 262_144
 
         /**
          * Creates a SQLiteCloudConfig object parsing a connection string in the form
          * ```kotlin
          * "sqlitecloud://$username:$password@$hostname:$port/${dbname ?: ""}"
          * ```
+         * where `$hostname:$port` can also be a comma-separated list of cluster nodes
+         * (`host1:port1,host2`): the connection goes to the one that answers first.
          *
          * @param connectionString The connection string to parse.
          * @return A SQLiteCloudConfig object.
@@ -52,7 +110,13 @@ data class SQLiteCloudConfig(
 
             val port = if (connectionUri.port != -1) connectionUri.port else defaultPort
 
-            val userInfo = connectionUri.userInfo?.split(":")
+            // a list of nodes ("host1:port1,host2") is not a server authority, so URI leaves the host
+            // and the user info null and both are taken from the raw authority
+            val authority = connectionUri.rawAuthority ?: ""
+            val nodes = authority.substringAfterLast('@').takeIf { connectionUri.host == null && it.contains(',') }
+            val rawUserInfo = authority.substringBeforeLast('@', "").takeIf { nodes != null && it.isNotEmpty() }
+            val userInfo = (rawUserInfo?.let { URI("sqlitecloud://$it@localhost").userInfo } ?: connectionUri.userInfo)
+                ?.split(":")
 
             val path: String? = connectionUri.path
             val dbname = if (!path.isNullOrEmpty()) path.removePrefix("/") else null
@@ -73,22 +137,73 @@ data class SQLiteCloudConfig(
             val dbCreate = queryItems["create"]
             val insecure = queryItems["insecure"]
             val noblob = queryItems["noblob"]
+            val binaryRowset = queryItems["binary"]
+            val compactIndex = queryItems["compactindex"]
+            val deferConfig = queryItems["deferconfig"]
+            val keepAliveIdle = queryItems["keepidle"]
+            val keepAliveInterval = queryItems["keepintvl"]
+            val keepAliveCount = queryItems["keepcnt"]
+            val userTimeoutMs = queryItems["usertimeout"]
+            val pingTimeoutMs = queryItems["pingtimeout"]
+            val lazyConnect = queryItems["lazyconnect"]
+            val standbyRefreshMs = queryItems["standby"]
+            val networkAware = queryItems["networkaware"]
             val maxData = queryItems["maxdata"]
             val maxRows = queryItems["maxrows"]
             val maxRowset = queryItems["maxrowset"]
             val rootCertificate = queryItems["root_certificate"]
             val clientCertificate = queryItems["client_certificate"]
             val clientCertificateKey = queryItems["client_certificate_key"]
+            val tlsCiphers = queryItems["ciphers"]
+            val statementCacheSize = queryItems["statementcache"]
+            val autoParameterizeSize = queryItems["autoparameterize"]
+            val resultPoolSize = queryItems["resultpool"]
+            val chunkWindow = queryItems["chunkwindow"]
+            val adaptiveChunkMinRows = queryItems["chunkminrows"]
+            val adaptiveChunkMaxRows = queryItems["chunkmaxrows"]
+            val adaptiveChunkMs = queryItems["chunkms"]
+            val compressionMinSize = queryItems["compressionmin"]
+            val networkClass = queryItems["network"]
+            val compressionCalibration = queryItems["compressioncalibration"]
+            val chunkWorkers = queryItems["chunkworkers"]
+            val parallelParseMinBytes = queryItems["parallelparse"]
+            val uploadCompressionMinSize = queryItems["uploadcompressionmin"]
+            val downloadWindow = queryItems["downloadwindow"]
+            val downloadCompression = queryItems["downloadcompression"]
+            val compressionDictionarySize = queryItems["dictionarysize"]
+            val headerCacheSize = queryItems["headercache"]
+            val resultCacheSize = queryItems["resultcache"]
+            val arrayPoolSize = queryItems["arraypool"]
+            val blobCacheSize = queryItems["blobcache"]
+            val spillThreshold = queryItems["spillthreshold"]
+            val lazyRowsetCells = queryItems["lazycells"]
+            val lazyRowsetBytes = queryItems["lazybytes"]
+            val memorySoftLimit = queryItems["memorysoft"]
+            val memoryHardLimit = queryItems["memoryhard"]
+            val pubSubQueueSize = queryItems["pubsubqueue"]
+            val pubSubOverflow = queryItems["pubsuboverflow"]
+            val pubSubFilter = queryItems["pubsubfilter"]
+            val notifyWindowMs = queryItems["notifywindow"]
+            val writeBatchWindowMs = queryItems["writebatch"]
+            val writeBatchMaxStatements = queryItems["writebatchmax"]
+            val writeBatchFailure = queryItems["writebatchfailure"]
+            val offlineQueue = queryItems["offlinequeue"]
+            val dedupReads = queryItems["dedupreads"]
+            val pubSubLatency = queryItems["pubsublatency"]
+            val latencyHistograms = queryItems["latencyhistograms"]
+            val allocationCounters = queryItems["allocationcounters"]
+            val wireRecordPath = queryItems["wirerecord"]
+            val wireReplayPath = queryItems["wirereplay"]
 
             return SQLiteCloudConfig(
-                hostname = connectionUri.host ?: "",
+                hostname = nodes ?: connectionUri.host ?: "",
                 username = userInfo?.get(0) ?: "",
                 password = userInfo?.get(1) ?: "",
                 port = port,
                 dbname = dbname,
                 family = family?.toIntOrNull()
                     ?.let { familyValue -> Family.values().firstOrNull { it.value == familyValue } }
-                    ?: Family.IPv4,
+                    ?: Family.IPvAny,
                 passwordHashed = passwordHashed?.toBoolean() ?: false,
                 nonlinearizable = nonlinearizable?.toBoolean() ?: false,
                 timeout = timeout?.toIntOrNull() ?: 0,
@@ -99,12 +214,69 @@ data class SQLiteCloudConfig(
                 dbCreate = dbCreate?.toBoolean() ?: false,
                 insecure = insecure?.toBoolean() ?: false,
                 noblob = noblob?.toBoolean() ?: false,
+                binaryRowset = binaryRowset?.toBoolean() ?: false,
+                compactIndex = compactIndex?.toBoolean() ?: false,
+                deferConfig = deferConfig?.toBoolean() ?: false,
+                keepAliveIdle = keepAliveIdle?.toIntOrNull() ?: 0,
+                keepAliveInterval = keepAliveInterval?.toIntOrNull() ?: 0,
+                keepAliveCount = keepAliveCount?.toIntOrNull() ?: 0,
+                userTimeoutMs = userTimeoutMs?.toIntOrNull() ?: 0,
+                pingTimeoutMs = pingTimeoutMs?.toIntOrNull() ?: 0,
+                lazyConnect = lazyConnect?.toBoolean() ?: false,
+                standbyRefreshMs = standbyRefreshMs?.toIntOrNull() ?: 0,
+                networkAware = networkAware?.toBoolean() ?: false,
                 maxData = maxData?.toIntOrNull() ?: 0,
                 maxRows = maxRows?.toIntOrNull() ?: 0,
                 maxRowset = maxRowset?.toIntOrNull() ?: 0,
                 rootCertificate = rootCertificate,
                 clientCertificate = clientCertificate,
                 clientCertificateKey = clientCertificateKey,
+                tlsCiphers = tlsCiphers,
+                statementCacheSize = statementCacheSize?.toIntOrNull() ?: defaultStatementCacheSize,
+                autoParameterizeSize = autoParameterizeSize?.toIntOrNull() ?: 0,
+                resultPoolSize = resultPoolSize?.toIntOrNull() ?: 0,
+                chunkWindow = chunkWindow?.toIntOrNull() ?: 0,
+                adaptiveChunkMinRows = adaptiveChunkMinRows?.toIntOrNull() ?: 0,
+                adaptiveChunkMaxRows = adaptiveChunkMaxRows?.toIntOrNull() ?: 0,
+                adaptiveChunkMs = adaptiveChunkMs?.toIntOrNull() ?: defaultAdaptiveChunkMs,
+                compressionMinSize = compressionMinSize?.toIntOrNull() ?: 0,
+                networkClass = networkClass?.toIntOrNull()
+                    ?.let { networkValue -> NetworkClass.values().firstOrNull { it.value == networkValue } }
+                    ?: NetworkClass.Unknown,
+                compressionCalibration = compressionCalibration?.toBoolean() ?: false,
+                chunkWorkers = chunkWorkers?.toIntOrNull() ?: 0,
+                parallelParseMinBytes = parallelParseMinBytes?.toIntOrNull() ?: 0,
+                uploadCompressionMinSize = uploadCompressionMinSize?.toIntOrNull() ?: 0,
+                downloadWindow = downloadWindow?.toIntOrNull() ?: 0,
+                downloadCompression = downloadCompression?.toBoolean() ?: false,
+                compressionDictionarySize = compressionDictionarySize?.toIntOrNull() ?: 0,
+                headerCacheSize = headerCacheSize?.toIntOrNull() ?: 0,
+                resultCacheSize = resultCacheSize?.toIntOrNull() ?: 0,
+                arrayPoolSize = arrayPoolSize?.toLongOrNull() ?: 0,
+                blobCacheSize = blobCacheSize?.toLongOrNull() ?: 0,
+                spillThreshold = spillThreshold?.toIntOrNull() ?: 0,
+                lazyRowsetCells = lazyRowsetCells?.toIntOrNull() ?: defaultLazyRowsetCells,
+                lazyRowsetBytes = lazyRowsetBytes?.toIntOrNull() ?: defaultLazyRowsetBytes,
+                memorySoftLimit = memorySoftLimit?.toLongOrNull() ?: 0,
+                memoryHardLimit = memoryHardLimit?.toLongOrNull() ?: 0,
+                pubSubQueueSize = pubSubQueueSize?.toIntOrNull() ?: 0,
+                pubSubOverflow = pubSubOverflow?.toIntOrNull()
+                    ?.let { overflowValue -> PubSubOverflow.values().firstOrNull { it.value == overflowValue } }
+                    ?: PubSubOverflow.DropOldest,
+                pubSubFilter = pubSubFilter?.toBoolean() ?: false,
+                notifyWindowMs = notifyWindowMs?.toIntOrNull() ?: 0,
+                writeBatchWindowMs = writeBatchWindowMs?.toIntOrNull() ?: 0,
+                writeBatchMaxStatements = writeBatchMaxStatements?.toIntOrNull() ?: defaultWriteBatchMaxStatements,
+                writeBatchFailure = writeBatchFailure?.toIntOrNull()
+                    ?.let { failureValue -> WriteBatchFailure.values().firstOrNull { it.value == failureValue } }
+                    ?: WriteBatchFailure.Isolated,
+                offlineQueue = offlineQueue?.toBoolean() ?: false,
+                dedupReads = dedupReads?.toBoolean() ?: false,
+                pubSubLatency = pubSubLatency?.toBoolean() ?: false,
+                latencyHistograms = latencyHistograms?.toBoolean() ?: false,
+                allocationCounters = allocationCounters?.toBoolean() ?: false,
+                wireRecordPath = wireRecordPath,
+                wireReplayPath = wireReplayPath,
             )
         }
     }
@@ -115,4 +287,26 @@ data class SQLiteCloudConfig(
         IPv6(1),
         IPvAny(2),
     }
+
+    /// Constants that describe the network of the connection, used by the compression policy.
+    enum class NetworkClass(val value: Int) {
+        Unknown(0),
+        WiFi(1),
+        Cellular(2),
+        Metered(3),
+    }
+
+    /// Constants that describe what a full notification queue does with a new notification.
+    enum class PubSubOverflow(val value: Int) {
+        DropOldest(0),
+        CoalesceChannel(1),
+        Suspend(2),
+    }
+
+    /// Constants that describe what a failed statement of a write batch does to the other statements
+    /// of the batch: nothing, or rolls them back too.
+    enum class WriteBatchFailure(val value: Int) {
+        Isolated(0),
+        Atomic(1),
+    }
 }
@@ -0,0 +1,79 @@
+package io.sqlitecloud
+
+/**
+ * The counters of the main socket of a connection since it was opened, reconnects included, see
+ * [SQLiteCloud.connectionStats]. With TLS the bytes are the plaintext ones and the calls are
+ * calls to the TLS library.
+ *
+ * The ratio of [commands] to [roundTrips] shows how much pipelining and the deferred commands
+ * batch the traffic; the ratio of [bytesIn] to [readCalls] shows how much the buffered reads
+ * coalesce the replies.
+ *
+ * @property commands The commands sent, each command of a pipeline or of a deferred batch counts.
+ * @property replies The replies received, a chunked rowset counts once and the error replies are
+ *           in [serverErrors].
+ * @property roundTrips The reads that followed a write, each one waited for the server.
+ * @property bytesOut The bytes written.
+ * @property bytesOutRaw The bytes that would have been written without upload compression.
+ * @property bytesIn The bytes read.
+ * @property bytesInRaw The bytes that would have been read without reply compression.
+ * @property readCalls The read calls.
+ * @property writeCalls The write, writev and sendfile calls.
+ * @property tlsRecordsOut The TLS records written, computed from the size of each write.
+ * @property chunkedRowsets The rowsets received in chunks.
+ * @property chunks The chunks of those rowsets.
+ * @property reconnects The times the connection was reopened in place with its session.
+ * @property serverErrors The error replies.
+ * @property linkRate The smoothed bytes per second of the replies of at least 64 KiB, the time
+ *           spent decompressing them excluded, or of the last database transfer without such
+ *           replies; `0` before either.
+ * @property allocations The allocations of the commands run with
+ *           [SQLiteCloudConfig.allocationCounters], all 0 without it.
+ * @property clientErrors The errors raised by the client, by error code (100000 and above).
+ */
+data class SQLiteCloudConnectionStats(
+    val commands: Long,
+    val replies: Long,
+    val roundTrips: Long,
+    val bytesOut: Long,
+    val bytesOutRaw: Long,
+    val bytesIn: Long,
+    val bytesInRaw: Long,
+    val readCalls: Long,
+    val writeCalls: Long,
+    val tlsRecordsOut: Long,
+    val chunkedRowsets: Long,
+    val chunks: Long,
+    val reconnects: Long,
+    val serverErrors: Long,
+    val linkRate: Long,
+    val allocations: SQLiteCloudAllocations,
+    val clientErrors: Map<Int, Long>,
+) {
+    internal companion object {
+        private const val clientErrorBase = 100000
+        private const val counterCount = 25
+
+        fun fromNative(values: LongArray) = SQLiteCloudConnectionStats(
+            commands = values[0],
+            replies = values[1],
+            roundTrips = values[2],
+            bytesOut = values[3],
+            bytesOutRaw = values[4],
+            bytesIn = values[5],
+            bytesInRaw = values[6],
+            readCalls = values[7],
+            writeCalls = values[8],
+            tlsRecordsOut = values[9],
+            chunkedRowsets = values[10],
+            chunks = values[11],
+            reconnects = values[12],
+            serverErrors = values[13],
+            linkRate = values[14],
+            allocations = SQLiteCloudAllocations.fromNative(values.copyOfRange(15, counterCount)),
+            clientErrors = (counterCount..<values.size)
+                .filter { values[it] > 0 }
+                .associate { clientErrorBase + it - counterCount to values[it] },
+        )
+    }
+}
@@ -0,0 +1,81 @@
+package io.sqlitecloud
+
+import android.database.AbstractWindowedCursor
+import android.database.CursorWindow
+import android.database.sqlite.SQLiteException
+
+/**
+ * An [android.database.Cursor] over a [SQLiteCloudNativeRowset], for the adapters and libraries
+ * that expect one.
+ *
+ * The rows are copied from the native result into the [CursorWindow] of the cursor only when the
+ * cursor moves outside of it, a whole window at a time with a single native call: no
+ * [SQLiteCloudValue] nor any other intermediate object is created for the cells.
+ *
+ * Create an instance with [SQLiteCloudNativeRowset.toCursor]. The cursor owns the rowset and
+ * closes it in [close].
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * val cursor = sqliteCloud.executeRowset(SQLiteCloudCommand("SELECT _id, name FROM users")).toCursor()
+ * adapter.swapCursor(cursor)
+ * ```
+ */
+class SQLiteCloudCursor internal constructor(
+    private val rowset: SQLiteCloudNativeRowset,
+) : AbstractWindowedCursor() {
+    private val columnNames = rowset.columns.toTypedArray()
+
+    // The most rows a window held so far, see [fillWindow].
+    private var windowRows = 0
+
+    override fun getCount(): Int = rowset.rowCount
+
+    override fun getColumnNames(): Array<String> = columnNames
+
+    override fun onMove(oldPosition: Int, newPosition: Int): Boolean {
+        val window = mWindow
+        if (window == null || newPosition < window.startPosition ||
+            newPosition >= window.startPosition + window.numRows
+        ) {
+            fillWindow(newPosition)
+        }
+        return true
+    }
+
+    /**
+     * Closes the cursor and the rowset it reads from.
+     */
+    override fun close() {
+        super.close()
+        rowset.close()
+    }
+
+    private fun fillWindow(position: Int) {
+        clearOrCreateWindow(WINDOW_NAME)
+
+        // As SQLiteCursor, start a third of a window before the position so that scrolling back a
+        // little does not refill, and fill again from the position if the rows before it took too
+        // much room.
+        var start = maxOf(position - windowRows / 3, 0)
+        var rows = fill(start)
+        if (start + rows <= position && start < position) {
+            start = position
+            rows = fill(start)
+        }
+        if (rows == 0) throw SQLiteException("Row $position is too big to fit into a CursorWindow.")
+        windowRows = maxOf(windowRows, rows)
+    }
+
+    private fun fill(start: Int): Int {
+        val window = window
+        window.clear()
+        window.startPosition = start
+        return rowset.fillWindow(window, start)
+    }
+
+    private companion object {
+        const val WINDOW_NAME = "sqlitecloud"
+    }
+}
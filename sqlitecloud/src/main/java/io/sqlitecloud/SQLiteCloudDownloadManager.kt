@@ -0,0 +1,139 @@
+package io.sqlitecloud
+
+import kotlinx.coroutines.async
+import kotlinx.coroutines.awaitAll
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.coroutineScope
+import java.nio.file.Path
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * SQLiteCloudDownloadManager downloads several databases concurrently, each one over its own
+ * connection of [pool], instead of one after the other on a single connection.
+ *
+ * The databases are downloaded in order of [Request.priority], at most [maxConcurrentDownloads]
+ * at a time, and together they do not exceed [maxBytesPerSecond]. Each database is downloaded
+ * with [SQLiteCloud.download] into its destination, so a download that fails can be resumed by
+ * requesting it again.
+ *
+ * Example usage:
+ * ```kotlin
+ * val manager = SQLiteCloudDownloadManager(pool, maxConcurrentDownloads = 4)
+ *
+ * val results = manager.downloadAll(
+ *     tenants.map { SQLiteCloudDownloadManager.Request(it.database, it.path, it.priority) }
+ * ) { progress ->
+ *     print("Progress: ${progress * 100}%")
+ * }
+ * ```
+ *
+ * @param pool The pool that lends the connections.
+ * @param maxConcurrentDownloads The maximum number of databases downloaded at the same time,
+ *            bounded by the size of [pool].
+ * @param maxBytesPerSecond The bandwidth shared by all the downloads, `0` means unlimited.
+ */
+class SQLiteCloudDownloadManager(
+    private val pool: SQLiteCloudPool,
+    maxConcurrentDownloads: Int = pool.size,
+    val maxBytesPerSecond: Long = 0,
+) {
+    val maxConcurrentDownloads = maxConcurrentDownloads.coerceIn(1, pool.size)
+
+    /// A database to download into [destination], databases with a higher [priority] start first.
+    data class Request(
+        val databaseName: String,
+        val destination: Path,
+        val priority: Int = 0,
+    )
+
+    /// The outcome of a [Request], [error] is null if the database has been downloaded.
+    data class Result(
+        val request: Request,
+        val error: Throwable?,
+    )
+
+    private class Transfer {
+        @Volatile var total = 0L
+        @Volatile var received = 0L
+    }
+
+    /**
+     * Downloads the databases of [requests] and returns the outcome of each one, in the same
+     * order. A failed download does not stop the others.
+     *
+     * @param progressHandler Receives the progress of all the downloads together, as the fraction
+     *            of the bytes received. The size of a database that has not started yet is
+     *            estimated from the ones already known.
+     */
+    suspend fun downloadAll(
+        requests: List<Request>,
+        progressHandler: ProgressHandler? = null,
+    ): List<Result> = coroutineScope {
+        val transfers = ConcurrentHashMap<Request, Transfer>()
+        val results = ConcurrentHashMap<Request, Result>()
+        val throttle = Throttle(maxBytesPerSecond)
+
+        val queue = Channel<Request>(Channel.UNLIMITED)
+        requests.sortedByDescending { it.priority }.forEach { queue.trySend(it) }
+        queue.close()
+
+        fun reportProgress() {
+            if (progressHandler == null) return
+            val started = transfers.values.filter { it.total > 0 }
+            val known = started.sumOf { it.total }
+            val estimated = if (started.isEmpty()) 0 else known / started.size * (requests.size - started.size)
+            val total = known + estimated
+            if (total > 0) {
+                progressHandler(started.sumOf { it.received }.toDouble() / total.toDouble())
+            }
+        }
+
+        val workers = (0 until minOf(maxConcurrentDownloads, requests.size)).map {
+            async {
+                for (request in queue) {
+                    val transfer = Transfer()
+                    transfers[request] = transfer
+                    val error = try {
+                        pool.use { sqliteCloud ->
+                            val callback = SQLiteCloudProgressCallback { total, received ->
+                                // The callback runs on the connection thread, so waiting here
+                                // slows down the reads of this download only.
+                                // The first report of a resumed download includes the bytes
+                                // already on disk, which do not count against the bandwidth.
+                                if (transfer.total > 0) throttle.consume(received - transfer.received)
+                                transfer.total = total
+                                transfer.received = received
+                                reportProgress()
+                            }
+                            sqliteCloud.download(request.databaseName, request.destination, callback)
+                        }
+                        null
+                    } catch (e: Throwable) {
+                        e
+                    }
+                    results[request] = Result(request, error)
+                }
+            }
+        }
+        workers.awaitAll()
+
+        requests.map { results.getValue(it) }
+    }
+
+    // A token bucket shared by the downloads, holding at most one second of bandwidth. The bytes
+    // received over the budget are paid back by sleeping.
+    private class Throttle(private val bytesPerSecond: Long) {
+        private val start = System.nanoTime()
+        private var consumed = 0L
+
+        fun consume(bytes: Long) {
+            if (bytesPerSecond <= 0 || bytes <= 0) return
+            val wait = synchronized(this) {
+                val allowed = (System.nanoTime() - start) / 1_000_000 * bytesPerSecond / 1000
+                consumed = maxOf(consumed, allowed - bytesPerSecond) + bytes
+                (consumed - allowed) * 1000 / bytesPerSecond
+            }
+            if (wait > 0) Thread.sleep(wait)
+        }
+    }
+}
@@ -22,6 +22,18 @@ sealed class SQLiteCloudError : Throwable() {
                 code = -2,
                 message = "Invalid UUID",
             )
+            val poolTimeout = Connection(
+                code = -11,
+                message = "No pooled connection available",
+            )
+
+            /// Native code of a command that overran its [SQLiteCloudCommand.deadlineMs], the
+            /// connection is still usable.
+            const val deadlineExceededCode = 100010
+
+            /// Native code of a command that overran its deadline while its reply was being
+            /// received, the connection is opened again by the next command.
+            const val deadlineResetCode = 100011
         }
     }
 
@@ -38,6 +50,28 @@ sealed class SQLiteCloudError : Throwable() {
                 code = -4,
                 message = "Unsupported value type",
             )
+            val closedRowset = Execution(
+                code = -13,
+                message = "The rowset has been closed",
+            )
+            val pipelineCommandFailed = Execution(
+                code = -16,
+                message = "Command failed after another command of the same pipeline",
+            )
+            val aggregateFailed = Execution(
+                code = -17,
+                message = "The rowset aggregate could not be computed",
+            )
+            val writeBatchRolledBack = Execution(
+                code = -18,
+                message = "Write rolled back together with the other writes of its batch",
+            )
+            fun invalidBatchRow(index: Int) =
+                Execution(code = -12, message = "Row [$index] has a different number of values.")
+            fun missingColumn(name: String) =
+                Execution(code = -14, message = "Column [$name] is not in the rowset.")
+            fun nullColumnValue(name: String) =
+                Execution(code = -15, message = "Column [$name] is NULL but the property is not nullable.")
         }
     }
 
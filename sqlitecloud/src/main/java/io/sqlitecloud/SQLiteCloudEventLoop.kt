@@ -0,0 +1,96 @@
+package io.sqlitecloud
+
+import kotlinx.coroutines.suspendCancellableCoroutine
+import java.util.concurrent.Executors
+import kotlin.coroutines.resume
+import kotlin.coroutines.resumeWithException
+
+/**
+ * Drives the non-blocking commands of every [SQLiteCloud] instance from a single daemon thread.
+ *
+ * Commands are queued on their native connection and the replies are parsed as soon as the socket
+ * becomes readable, so any number of requests can be in flight without parking one thread per
+ * connection. The sockets are watched by a native readiness set (epoll on Linux and Android), so a
+ * wait only returns the connections that are ready and the others cost nothing. All the native
+ * async state is only touched from the loop thread.
+ */
+internal object SQLiteCloudEventLoop {
+    // Upper bound of a single wait, new submissions are picked up at most this late.
+    private const val POLL_SLICE_MS = 10
+
+    // Connections processed after a single wait, the others are reported by the next one.
+    private const val READY_MAX = 256
+
+    private const val EVENT_READ = 1
+
+    private const val EVENT_WRITE = 2
+
+    private val executor = Executors.newSingleThreadExecutor { runnable ->
+        Thread(runnable, "SQLiteCloudEventLoop").apply { isDaemon = true }
+    }
+
+    // Loop thread only. The connections waiting for a reply or a write, by socket.
+    private val active = HashMap<Int, SQLiteCloudBridge>()
+
+    // Loop thread only. The connections that queued a command since the last wait.
+    private val submitted = LinkedHashSet<SQLiteCloudBridge>()
+    private val ready = IntArray(READY_MAX)
+    private var scheduled = false
+
+    private val events: Long by lazy { newEvents() }
+
+    suspend fun execute(bridge: SQLiteCloudBridge, command: SQLiteCloudCommand): SQLiteCloudResult =
+        suspendCancellableCoroutine { continuation ->
+            executor.execute {
+                // A cancelled request is still sent, its reply is dropped when it arrives.
+                val queued = bridge.executeAsync(command) { result ->
+                    result.fold(continuation::resume, continuation::resumeWithException)
+                }
+                if (!queued) {
+                    continuation.resumeWithException(bridge.error())
+                    return@execute
+                }
+                submitted.add(bridge)
+                schedule()
+            }
+        }
+
+    private fun schedule() {
+        if (scheduled) return
+        scheduled = true
+        executor.execute(::run)
+    }
+
+    private fun run() {
+        scheduled = false
+
+        // The commands just queued are written right away, without waiting for the socket.
+        submitted.forEach(::process)
+        submitted.clear()
+        if (active.isEmpty()) return
+
+        // Re-scheduling after the wait lets the submissions queued meanwhile run first.
+        val count = waitReady(events, ready, POLL_SLICE_MS)
+        for (index in 0 until count) {
+            active[ready[index]]?.let(::process)
+        }
+        if (active.isNotEmpty()) schedule()
+    }
+
+    private fun process(bridge: SQLiteCloudBridge) {
+        val fd = bridge.connectionFD()
+        // Every callback (successful or not) has been invoked once the mask is 0 or -1.
+        val mask = bridge.processEvents()
+        if (mask > 0) {
+            bridge.watchEvents(events, mask and (EVENT_READ or EVENT_WRITE))
+            active[fd] = bridge
+        } else {
+            bridge.watchEvents(events, 0)
+            active.remove(fd)
+        }
+    }
+
+    private external fun newEvents(): Long
+
+    private external fun waitReady(events: Long, fds: IntArray, timeout: Int): Int
+}
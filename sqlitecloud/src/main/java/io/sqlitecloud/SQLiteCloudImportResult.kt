@@ -0,0 +1,11 @@
+package io.sqlitecloud
+
+/// Outcome of a [SQLiteCloud.import].
+///
+/// - Parameters:
+///   - rows: The number of records of the file that were executed.
+///   - changes: The total number of rows inserted, updated or deleted by them.
+data class SQLiteCloudImportResult(
+    val rows: Long,
+    val changes: Long,
+)
@@ -0,0 +1,115 @@
+package io.sqlitecloud
+
+import kotlinx.coroutines.Deferred
+import kotlinx.coroutines.async
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.flow
+
+/**
+ * Pages through a query by keyset instead of `LIMIT/OFFSET`: every page after the first one asks
+ * for the rows whose [key] follows the last one of the previous page, so the server seeks its
+ * index instead of scanning the rows skipped. The last key is bound as a parameter, through the
+ * array exec path.
+ *
+ * The next page is requested as soon as a page is returned by [next], so it travels while the
+ * caller renders the current one. Each page is received as a [SQLiteCloudColumnarRowset] and
+ * decoded with [mapper]; set [SQLiteCloudConfig.resultPoolSize] so that the receive buffer of a
+ * page is recycled for the next one.
+ *
+ * The query is wrapped as `SELECT * FROM (query) WHERE key > ? ORDER BY key LIMIT pageSize`: it
+ * must return the [key] column, whose values must be unique and not null, and must not have its
+ * own `ORDER BY` or `LIMIT`.
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * val pager = SQLiteCloudKeysetPager(
+ *     sqliteCloud, SQLiteCloudCommand("SELECT id, name FROM users WHERE active = 1"), key = "id", pageSize = 200, UserRowMapper,
+ * )
+ * pager.pages.collect { users -> render(users) }
+ * ```
+ *
+ * @param sqliteCloud The connected [SQLiteCloud] instance used to run the query.
+ * @param command The query to page through, with its parameters.
+ * @param key The column that orders the pages.
+ * @param pageSize The number of rows of a page.
+ * @param mapper The mapper decoding each page into items, usually generated for a
+ *            [SQLiteCloudRow] class.
+ * @param descending Whether the pages go from the highest [key] to the lowest.
+ */
+class SQLiteCloudKeysetPager<T>(
+    private val sqliteCloud: SQLiteCloud,
+    private val command: SQLiteCloudCommand,
+    val key: String,
+    val pageSize: Int,
+    private val mapper: SQLiteCloudRowMapper<T>,
+    val descending: Boolean = false,
+) {
+    private val order = if (descending) "DESC" else "ASC"
+    private val firstQuery = "SELECT * FROM (${command.query}) ORDER BY \"$key\" $order LIMIT $pageSize"
+    private val nextQuery =
+        "SELECT * FROM (${command.query}) WHERE \"$key\" ${if (descending) "<" else ">"} ? ORDER BY \"$key\" $order LIMIT $pageSize"
+
+    // The key of the last row returned, null before the first page.
+    private var lastKey: SQLiteCloudValue? = null
+    private var prefetch: Deferred<Result<SQLiteCloudColumnarRowset>>? = null
+    private var isExhausted = false
+
+    /**
+     * The pages, until the last one. The page after the one being collected is already requested.
+     */
+    val pages: Flow<List<T>> = flow {
+        while (true) emit(next() ?: break)
+    }
+
+    /**
+     * Returns the next page and requests the one after it, or null once the rows are over.
+     *
+     * @throws SQLiteCloudError if the page cannot be read, the next call asks for it again.
+     */
+    suspend fun next(): List<T>? {
+        if (isExhausted) return null
+
+        val page = prefetch ?: fetch(lastKey)
+        prefetch = null
+        val rowset = page.await().getOrThrow()
+        if (rowset.rowCount == 0) {
+            isExhausted = true
+            return null
+        }
+
+        val items = mapper.decode(rowset)
+        if (rowset.rowCount < pageSize) {
+            isExhausted = true
+        } else {
+            val last = rowset.value(rowset.rowCount - 1, rowset.columnIndex(key))
+            lastKey = last
+            prefetch = fetch(last)
+        }
+        return items
+    }
+
+    /**
+     * Starts again from the first page, dropping the page already requested.
+     */
+    fun reset() {
+        prefetch?.cancel()
+        prefetch = null
+        lastKey = null
+        isExhausted = false
+    }
+
+    // The error is kept in the result, so that a failed page does not cancel the scope.
+    private fun fetch(after: SQLiteCloudValue?): Deferred<Result<SQLiteCloudColumnarRowset>> =
+        sqliteCloud.scope.async {
+            runCatching {
+                sqliteCloud.executeColumnar(
+                    if (after == null) {
+                        SQLiteCloudCommand(firstQuery, command.parameters)
+                    } else {
+                        SQLiteCloudCommand(nextQuery, command.parameters + after)
+                    }
+                )
+            }
+        }
+}
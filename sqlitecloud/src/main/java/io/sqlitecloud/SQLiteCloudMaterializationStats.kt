@@ -0,0 +1,22 @@
+package io.sqlitecloud
+
+/**
+ * How the rowsets returned by [SQLiteCloud.execute] and the other parsed results were
+ * materialized since the client was created, see [SQLiteCloud.materializationStats].
+ *
+ * The strategy of each rowset is chosen from its header alone, before any cell is read: a rowset
+ * that the server sent in chunks, or with more than [lazyRowsetCells] cells or more than
+ * [lazyRowsetBytes] bytes, is [SQLiteCloudResult.Materialization.Lazy]; any other rowset is
+ * [SQLiteCloudResult.Materialization.Eager]. Both thresholds at `0` make every rowset eager.
+ *
+ * @property eagerRowsets The rowsets whose cells were all boxed when they were parsed.
+ * @property lazyRowsets The rowsets kept in columnar arrays and boxed row by row when read.
+ * @property lazyRowsetCells The cell threshold, from [SQLiteCloudConfig.lazyRowsetCells].
+ * @property lazyRowsetBytes The byte threshold, from [SQLiteCloudConfig.lazyRowsetBytes].
+ */
+data class SQLiteCloudMaterializationStats(
+    val eagerRowsets: Long,
+    val lazyRowsets: Long,
+    val lazyRowsetCells: Int,
+    val lazyRowsetBytes: Int,
+)
@@ -0,0 +1,321 @@
+package io.sqlitecloud
+
+import android.database.CursorWindow
+import android.os.ParcelFileDescriptor
+
+/**
+ * A result set that is kept in native memory and read on demand.
+ *
+ * Unlike [SQLiteCloudRowset], which copies every cell into Kotlin objects when the command
+ * completes, [SQLiteCloudNativeRowset] keeps the native result alive and only converts the cells
+ * that are actually read. Blob values are returned as direct buffers over the native memory, with
+ * no copy, and stay valid until [close] is called.
+ *
+ * Create an instance with [SQLiteCloud].[executeRowset] and always close it, preferably with
+ * [use]. Call [toRowset] to get an owned copy that outlives the native result, or [toCursor]
+ * to read it through an [android.database.Cursor].
+ *
+ * - Note: Instances are not thread safe, reading and closing from different threads must be
+ *         synchronized by the caller.
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * sqliteCloud.executeRowset(SQLiteCloudCommand("SELECT id, picture FROM users")).use { rowset ->
+ *     for (row in 0..<rowset.rowCount) {
+ *         val picture = rowset.value(row, 1)
+ *         // Process the picture before the rowset is closed
+ *     }
+ * }
+ * ```
+ */
+class SQLiteCloudNativeRowset internal constructor(
+    private val bridge: SQLiteCloudBridge,
+    private var rowset: OpaquePointer<SQLiteCloudResult>,
+) : AutoCloseable {
+    /** The number of rows in the result set. */
+    val rowCount: Int = bridge.rowsetRowCount(rowset)
+
+    /** The column names of the result set. */
+    val columns: List<String> = bridge.rowsetColumns(rowset)
+
+    // Hash indexes built by [find], by column, released by [close].
+    private val indexes = HashMap<Int, OpaquePointer<SQLiteCloudRowsetIndex>>()
+
+    /** Whether [close] has been called and the native result released. */
+    val isClosed: Boolean
+        get() = rowset == nullOpaquePointer
+
+    /**
+     * Reads a single cell from the native result.
+     *
+     * @param row The zero-based row index.
+     * @param column The zero-based column index.
+     *
+     * @return The value of the cell. A [SQLiteCloudValue.Blob] wraps the native memory and must
+     *         not be used after [close].
+     *
+     * @throws IndexOutOfBoundsException if [row] or [column] is out of range.
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun value(row: Int, column: Int): SQLiteCloudValue {
+        val rowset = openRowset()
+        if (row !in 0..<rowCount || column !in columns.indices) {
+            throw IndexOutOfBoundsException("Cell [$row, $column] is out of range.")
+        }
+        return bridge.rowsetValue(rowset, row, column)
+    }
+
+    /**
+     * Reads a whole row from the native result, with the same lifetime rules of [value].
+     */
+    fun row(row: Int): List<SQLiteCloudValue> = columns.indices.map { column -> value(row, column) }
+
+    /**
+     * Copies the whole result set into a [SQLiteCloudRowset] that remains valid after [close].
+     *
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun toRowset(): SQLiteCloudRowset = bridge.copyRowset(openRowset())
+
+    /**
+     * Copies the whole result set into a [SQLiteCloudColumnarRowset] that remains valid after
+     * [close].
+     *
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun toColumnarRowset(): SQLiteCloudColumnarRowset = bridge.parseColumnarRowset(openRowset())
+
+    /**
+     * Copies the given columns into a [SQLiteCloudColumnarRowset] that remains valid after
+     * [close]. The cells of the other columns are not read.
+     *
+     * @param columns The zero-based column indexes, in the order they are wanted.
+     *
+     * @throws IndexOutOfBoundsException if an index is out of range.
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun toColumnarRowset(columns: IntArray): SQLiteCloudColumnarRowset =
+        bridge.parseColumnarRowset(openRowset(), columns)
+
+    /**
+     * Copies the columns called [columnNames] into a [SQLiteCloudColumnarRowset] that remains
+     * valid after [close]. The cells of the other columns are not read.
+     *
+     * @throws SQLiteCloudError.Execution if a column is missing or if the rowset has been closed.
+     */
+    fun toColumnarRowset(columnNames: List<String>): SQLiteCloudColumnarRowset {
+        val rowset = openRowset()
+        return bridge.parseColumnarRowset(rowset, bridge.projection(rowset, columnNames))
+    }
+
+    /**
+     * Wraps the result set into an [android.database.Cursor], for the APIs that expect one. The
+     * cursor reads the native result one [android.database.CursorWindow] at a time as it moves,
+     * and takes over this rowset: closing the cursor closes the rowset.
+     *
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun toCursor(): SQLiteCloudCursor {
+        openRowset()
+        return SQLiteCloudCursor(this)
+    }
+
+    // Fills [window], empty and starting at [first], see SQLiteCloudCursor.
+    internal fun fillWindow(window: CursorWindow, first: Int): Int = bridge.fillWindow(openRowset(), window, first)
+
+    /**
+     * Computes count, sum, min and max of the INTEGER/FLOAT cells of a column in native code,
+     * without converting any cell to a Kotlin object. NULL, TEXT and BLOB cells are skipped.
+     *
+     * @param column The zero-based column index.
+     * @param selection The rows to aggregate, as returned by [filter], or null for every row.
+     *
+     * @throws IndexOutOfBoundsException if [column] or a selected row is out of range.
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun aggregate(column: Int, selection: IntArray? = null): Aggregate {
+        val rowset = openRowset()
+        checkAggregate(column, selection)
+        return bridge.aggregateRowset(rowset, column, selection)
+    }
+
+    /**
+     * Selects the rows whose cell in [column] is an INTEGER/FLOAT that satisfies [comparison]
+     * against [value].
+     *
+     * Filters can be chained by passing the result of a previous filter as [selection], the
+     * returned selection can also be passed to [aggregate] and [groupBy].
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val adults = rowset.filter(AGE, SQLiteCloudNativeRowset.Comparison.GreaterOrEqual, 18.0)
+     * val total = rowset.aggregate(SALARY, adults).sum
+     * ```
+     *
+     * @return The selected row indexes, in ascending order unless [selection] is not sorted.
+     *
+     * @throws IndexOutOfBoundsException if [column] or a selected row is out of range.
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun filter(
+        column: Int,
+        comparison: Comparison,
+        value: Double,
+        selection: IntArray? = null,
+    ): IntArray {
+        val rowset = openRowset()
+        checkAggregate(column, selection)
+        return bridge.filterRowset(rowset, column, comparison, value, selection)
+    }
+
+    /**
+     * Groups the rows by the value of [keyColumn] and aggregates the INTEGER/FLOAT cells of
+     * [column] in each group. Integer and float keys with the same value belong to the same
+     * group, NULL keys form a group of their own.
+     *
+     * @return The groups in order of first appearance. A [SQLiteCloudValue.Blob] key wraps the
+     *         native memory and must not be used after [close].
+     *
+     * @throws IndexOutOfBoundsException if a column or a selected row is out of range.
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun groupBy(keyColumn: Int, column: Int, selection: IntArray? = null): List<Group> {
+        val rowset = openRowset()
+        checkAggregate(keyColumn, selection)
+        checkAggregate(column, null)
+        return bridge.groupRowset(rowset, keyColumn, column, selection)
+    }
+
+    /**
+     * Finds the rows whose cell in [column] equals [key], without converting any cell.
+     *
+     * The first lookup on a column builds a native hash index over it, kept until [close], so
+     * that each following lookup costs the same whatever the number of rows. Integer and float
+     * keys with the same value match, a NULL key matches no row. Text is compared byte by byte.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val rows = rowset.find(ID, SQLiteCloudValue.Integer(userId))
+     * val name = rows.firstOrNull()?.let { rowset.value(it, NAME) }
+     * ```
+     *
+     * @return The matching row indexes, in ascending order.
+     *
+     * @throws IndexOutOfBoundsException if [column] is out of range.
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun find(column: Int, key: SQLiteCloudValue): IntArray {
+        val rowset = openRowset()
+        checkAggregate(column, null)
+        val index = indexes.getOrPut(column) { bridge.buildRowsetIndex(rowset, column) }
+        return bridge.findIndexRows(index, key)
+    }
+
+    /**
+     * Sorts the rows by the values of [columns] in native code, without moving or converting any
+     * cell. Values are ordered as SQLite does: NULL first, then numbers, then text and BLOBs by
+     * their bytes. Rows with equal values keep their order.
+     *
+     * @param columns The zero-based columns to sort by, the first one has precedence.
+     * @param descending Whether each column of [columns] is sorted in descending order, or null
+     *                   to sort every column in ascending order.
+     *
+     * @return The row indexes in sorted order, read the cells with [value].
+     *
+     * @throws IndexOutOfBoundsException if a column is out of range.
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun sortedRows(columns: IntArray, descending: BooleanArray? = null): IntArray {
+        val rowset = openRowset()
+        columns.forEach { column -> checkAggregate(column, null) }
+        return bridge.sortRowset(rowset, columns, descending)
+    }
+
+    /**
+     * Saves the result set to [path], so that a later run can reload it with
+     * [SQLiteCloud.loadRowset] without a connection and without parsing it again.
+     *
+     * The file stores the received bytes and the index of the cells in the byte order of this
+     * device, it is meant as a local cache and not as a portable format. The file is written
+     * next to [path] and then renamed, so readers never see a partial file.
+     *
+     * @return `false` if the file could not be written.
+     *
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun save(path: String): Boolean = bridge.saveRowset(openRowset(), path)
+
+    /**
+     * Copies the result set into an anonymous shared memory region, to hand it to another process
+     * of the app, such as a sync service or a widget, without serializing its cells.
+     *
+     * Send the returned descriptor through Binder, in a `Bundle` or an AIDL call, and load it in
+     * the other process with [SQLiteCloud.loadSharedRowset]: the rowset there reads the region in
+     * place, with no parsing. As with [save], the region is laid out in the byte order of this
+     * device. It is freed once the descriptors and the rowsets loaded from it are closed.
+     *
+     * @return The descriptor of the region, to be closed by the caller, or null if the region
+     *         could not be created.
+     *
+     * @throws SQLiteCloudError.Execution if the rowset has been closed.
+     */
+    fun share(): ParcelFileDescriptor? = bridge.shareRowset(openRowset())
+
+    /**
+     * Releases the native result. Values read with [value] must not be used afterwards, calling
+     * this method more than once has no effect.
+     */
+    override fun close() {
+        if (rowset == nullOpaquePointer) return
+        indexes.values.forEach { bridge.releaseRowsetIndex(it) }
+        indexes.clear()
+        bridge.releaseResult(rowset)
+        rowset = nullOpaquePointer
+    }
+
+    private fun openRowset(): OpaquePointer<SQLiteCloudResult> {
+        if (rowset == nullOpaquePointer) throw SQLiteCloudError.Execution.closedRowset
+        return rowset
+    }
+
+    private fun checkAggregate(column: Int, selection: IntArray?) {
+        if (column !in columns.indices) {
+            throw IndexOutOfBoundsException("Column [$column] is out of range.")
+        }
+        selection?.firstOrNull { row -> row !in 0..<rowCount }?.let { row ->
+            throw IndexOutOfBoundsException("Row [$row] is out of range.")
+        }
+    }
+
+    /** Comparison applied by [filter], the raw values match the native SQCLOUD_COMPARE_OP. */
+    enum class Comparison(val rawValue: Int) {
+        Equal(1),
+        NotEqual(2),
+        Less(3),
+        LessOrEqual(4),
+        Greater(5),
+        GreaterOrEqual(6),
+    }
+
+    /**
+     * Aggregates of the INTEGER/FLOAT cells of a column.
+     *
+     * @property count The number of INTEGER/FLOAT cells.
+     * @property sum Their sum, 0.0 if [count] is 0.
+     * @property min Their minimum, null if [count] is 0.
+     * @property max Their maximum, null if [count] is 0.
+     */
+    data class Aggregate(val count: Int, val sum: Double, val min: Double?, val max: Double?)
+
+    /**
+     * A group built by [groupBy].
+     *
+     * @property key The value of the key column shared by the rows of the group.
+     * @property count The number of rows in the group.
+     * @property aggregate The aggregates of the grouped column over those rows.
+     */
+    data class Group(val key: SQLiteCloudValue, val count: Int, val aggregate: Aggregate)
+}
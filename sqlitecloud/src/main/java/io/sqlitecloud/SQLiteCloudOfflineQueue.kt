@@ -0,0 +1,290 @@
+package io.sqlitecloud
+
+import java.io.ByteArrayOutputStream
+import java.io.DataOutputStream
+import java.io.File
+import java.io.RandomAccessFile
+import java.nio.ByteBuffer
+import java.util.UUID
+import java.util.zip.CRC32
+
+/**
+ * A write of [SQLiteCloud.enqueueWrite] that the server refused when it was replayed. It has been
+ * dropped from the offline queue, the writes after it are replayed anyway.
+ */
+data class SQLiteCloudOfflineFailure(
+    val key: String,
+    val command: SQLiteCloudCommand,
+    val error: Throwable,
+)
+
+/**
+ * The writes of [SQLiteCloud.enqueueWrite], kept in an append-only file until they are replayed.
+ *
+ * Every record is a frame of its length, its CRC32 and its payload: the idempotency key, then the
+ * query and the typed parameters, as they are passed to SQCloudExecArray. A record is synced to
+ * the disk before [append] returns, so it survives the app being killed. The offset of the first
+ * record still to replay is kept in a sidecar `.head` file, and the file is truncated once every
+ * record has been replayed. A record torn by a crash during [append] fails its CRC and is cut off
+ * when the file is opened.
+ *
+ * [replay] sends the records in file order, in batches of up to [replayBatchSize] writes. A batch
+ * is one pipeline inside a savepoint, which also inserts the keys of its writes in
+ * `sqlitecloud_offline_log`, so a batch and its keys are committed together or not at all. When
+ * the outcome of the last batch is unknown, because the connection dropped before its reply or the
+ * app was restarted, the keys of the next batch are first looked up in that table and the writes
+ * already applied are skipped.
+ *
+ * - Note: Records are appended from any thread and replayed on the connection thread, the file
+ *         methods are synchronized.
+ */
+internal class SQLiteCloudOfflineQueue(private val file: File) {
+    class Record(val key: String, val command: SQLiteCloudCommand, val end: Long)
+
+    private val data = RandomAccessFile(file, "rw")
+    private val headFile = RandomAccessFile(File(file.path + ".head"), "rwd")
+
+    // The offset of the first record to replay, and the end of the last valid record.
+    private var head = 0L
+    private var size = 0L
+
+    // Whether the writes at the head may have been applied by a batch whose reply was lost. A
+    // queue just opened does not know how the replay of the previous process ended.
+    private var inDoubt = true
+
+    init {
+        size = scan()
+        if (data.length() > size) data.setLength(size)
+        head = if (headFile.length() >= Long.SIZE_BYTES) headFile.readLong().coerceIn(0, size) else 0
+    }
+
+    @get:Synchronized
+    val isEmpty: Boolean
+        get() = head >= size
+
+    /**
+     * Appends [command] and syncs it to the disk.
+     *
+     * @return The idempotency key of the write.
+     */
+    @Synchronized
+    fun append(command: SQLiteCloudCommand): String {
+        val key = UUID.randomUUID().toString()
+        val payload = ByteArrayOutputStream()
+        DataOutputStream(payload).use { out ->
+            writeString(out, key)
+            writeString(out, command.query)
+            out.writeInt(command.parameters.size)
+            command.parameters.forEach { writeValue(out, it) }
+        }
+        val bytes = payload.toByteArray()
+        val crc = CRC32().apply { update(bytes) }
+
+        val frame = ByteBuffer.allocate(frameHeaderSize + bytes.size)
+            .putInt(bytes.size)
+            .putInt(crc.value.toInt())
+            .put(bytes)
+        data.seek(size)
+        data.write(frame.array())
+        data.fd.sync()
+        size += frame.capacity()
+        return key
+    }
+
+    /**
+     * Replays the records with [send], a batch after the other, until the queue is empty.
+     * [failed] is called with every write that the server refused.
+     *
+     * @return The number of writes applied.
+     *
+     * @throws SQLiteCloudError.Connection if the connection fails, the records not yet applied are
+     *           replayed by the next call.
+     */
+    suspend fun replay(
+        send: suspend (List<SQLiteCloudCommand>) -> List<Result<SQLiteCloudResult>>,
+        failed: (SQLiteCloudOfflineFailure) -> Unit,
+    ): Int {
+        var applied = 0
+        while (true) {
+            val records = peek(replayBatchSize)
+            if (records.isEmpty()) return applied
+
+            var batch = records
+            try {
+                while (batch.isNotEmpty()) {
+                    if (inDoubt) {
+                        val done = appliedKeys(send, batch)
+                        batch = batch.filter { it.key !in done }
+                        inDoubt = false
+                        continue
+                    }
+                    val refused = sendBatch(send, batch) ?: break
+                    failed(refused)
+                    batch = batch.filter { it.key != refused.key }
+                }
+            } catch (error: Throwable) {
+                inDoubt = true
+                throw error
+            }
+            advance(records.last().end)
+            applied += batch.size
+        }
+    }
+
+    // The keys of [batch] that are already in the log table, which is created by the first lookup.
+    private suspend fun appliedKeys(
+        send: suspend (List<SQLiteCloudCommand>) -> List<Result<SQLiteCloudResult>>,
+        batch: List<Record>,
+    ): Set<String> {
+        val results = send(
+            listOf(
+                SQLiteCloudCommand("CREATE TABLE IF NOT EXISTS $logTable (key TEXT PRIMARY KEY, applied INTEGER)"),
+                SQLiteCloudCommand(
+                    "DELETE FROM $logTable WHERE applied < strftime('%s', 'now') - ?",
+                    listOf(SQLiteCloudValue.Integer(logRetentionSeconds)),
+                ),
+                SQLiteCloudCommand(
+                    "SELECT key FROM $logTable WHERE key IN (${batch.joinToString { "?" }})",
+                    batch.map { SQLiteCloudValue.String(it.key) },
+                ),
+            )
+        )
+        val rowset = results.last().getOrThrow() as? SQLiteCloudResult.Rowset ?: return emptySet()
+        return rowset.value.rows.mapNotNull { (it.firstOrNull() as? SQLiteCloudValue.String)?.value }.toSet()
+    }
+
+    // Sends [batch] inside a savepoint. Returns null once it has been committed, or the first write
+    // that failed, the batch being rolled back.
+    private suspend fun sendBatch(
+        send: suspend (List<SQLiteCloudCommand>) -> List<Result<SQLiteCloudResult>>,
+        batch: List<Record>,
+    ): SQLiteCloudOfflineFailure? {
+        val keys = SQLiteCloudCommand(
+            "INSERT INTO $logTable (key, applied) VALUES ${batch.joinToString { "(?, strftime('%s', 'now'))" }}",
+            batch.map { SQLiteCloudValue.String(it.key) },
+        )
+        val results = send(listOf(savepointCommand) + batch.map { it.command } + keys)
+        results[0].getOrThrow()
+
+        val writes = results.subList(1, batch.size + 1)
+        val index = writes.indexOfFirst { it.isFailure }
+        val failure = when {
+            index >= 0 -> writes[index].exceptionOrNull()
+            else -> results.last().exceptionOrNull() ?: send(listOf(releaseCommand)).single().exceptionOrNull()
+        } ?: return null
+
+        runCatching { send(listOf(rollbackCommand, releaseCommand)) }
+        return when {
+            // The connection is gone, or the batch could not be committed: it is replayed later.
+            failure is SQLiteCloudError.Connection || index < 0 -> throw failure
+            // Only the first failed write is known to be refused, the next ones are sent again.
+            else -> SQLiteCloudOfflineFailure(batch[index].key, batch[index].command, failure)
+        }
+    }
+
+    @Synchronized
+    private fun peek(max: Int): List<Record> {
+        val records = mutableListOf<Record>()
+        var offset = head
+        while (records.size < max && offset < size) {
+            val record = read(offset) ?: break
+            records.add(record)
+            offset = record.end
+        }
+        return records
+    }
+
+    // Moves the head past the records replayed, and empties the file once they all are. The file is
+    // truncated before the head is reset, a crash in between leaves a head past the end which is
+    // then clamped to the empty file.
+    @Synchronized
+    private fun advance(end: Long) {
+        head = end
+        if (head >= size) {
+            data.setLength(0)
+            size = 0
+            head = 0
+        }
+        headFile.seek(0)
+        headFile.writeLong(head)
+    }
+
+    // The end of the last record that can be read from the start of the file.
+    private fun scan(): Long {
+        var offset = 0L
+        while (true) {
+            offset = read(offset)?.end ?: return offset
+        }
+    }
+
+    private fun read(offset: Long): Record? {
+        if (offset + frameHeaderSize > data.length()) return null
+        data.seek(offset)
+        val length = data.readInt()
+        val crc = data.readInt()
+        if (length < 0 || offset + frameHeaderSize + length > data.length()) return null
+
+        val bytes = ByteArray(length)
+        data.readFully(bytes)
+        if (CRC32().apply { update(bytes) }.value.toInt() != crc) return null
+
+        val buffer = ByteBuffer.wrap(bytes)
+        val key = readString(buffer)
+        val query = readString(buffer)
+        val parameters = List(buffer.getInt()) { readValue(buffer) }
+        return Record(key, SQLiteCloudCommand(query, parameters), offset + frameHeaderSize + length)
+    }
+
+    private fun writeString(out: DataOutputStream, value: String) {
+        val bytes = value.toByteArray()
+        out.writeInt(bytes.size)
+        out.write(bytes)
+    }
+
+    private fun writeValue(out: DataOutputStream, value: SQLiteCloudValue) {
+        out.writeByte(value.typeValue)
+        when (value) {
+            is SQLiteCloudValue.Integer -> out.writeLong(value.value)
+            is SQLiteCloudValue.Double -> out.writeDouble(value.value)
+            is SQLiteCloudValue.String -> writeString(out, value.value)
+            is SQLiteCloudValue.Blob -> value.value.duplicate().let { blob ->
+                val bytes = ByteArray(blob.remaining()).also { blob.get(it) }
+                out.writeInt(bytes.size)
+                out.write(bytes)
+            }
+            // Stored as a plain blob: the file could be gone by the time the command is replayed.
+            is SQLiteCloudValue.BlobFile -> value.value.readBytes().let { bytes ->
+                out.writeInt(bytes.size)
+                out.write(bytes)
+            }
+            is SQLiteCloudValue.Null -> Unit
+        }
+    }
+
+    private fun readString(buffer: ByteBuffer): String {
+        val bytes = ByteArray(buffer.getInt()).also { buffer.get(it) }
+        return String(bytes)
+    }
+
+    private fun readValue(buffer: ByteBuffer): SQLiteCloudValue =
+        when (SQLiteCloudValue.Type.fromRawValue(buffer.get().toInt())) {
+            SQLiteCloudValue.Type.Integer -> SQLiteCloudValue.Integer(buffer.getLong())
+            SQLiteCloudValue.Type.Double -> SQLiteCloudValue.Double(buffer.getDouble())
+            SQLiteCloudValue.Type.String -> SQLiteCloudValue.String(readString(buffer))
+            SQLiteCloudValue.Type.Blob ->
+                SQLiteCloudValue.Blob(ByteBuffer.wrap(ByteArray(buffer.getInt()).also { buffer.get(it) }))
+            else -> SQLiteCloudValue.Null
+        }
+
+    companion object {
+        const val replayBatchSize = 256
+
+        private const val frameHeaderSize = 8
+        private const val logTable = "sqlitecloud_offline_log"
+        private const val logRetentionSeconds = 30L * 24 * 60 * 60
+
+        private val savepointCommand = SQLiteCloudCommand("SAVEPOINT sqlitecloud_offline_replay")
+        private val releaseCommand = SQLiteCloudCommand("RELEASE sqlitecloud_offline_replay")
+        private val rollbackCommand = SQLiteCloudCommand("ROLLBACK TO sqlitecloud_offline_replay")
+    }
+}
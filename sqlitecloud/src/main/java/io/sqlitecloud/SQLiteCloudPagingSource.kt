@@ -0,0 +1,112 @@
+package io.sqlitecloud
+
+import androidx.paging.PagingConfig
+import androidx.paging.PagingSource
+import androidx.paging.PagingState
+import kotlinx.coroutines.channels.ReceiveChannel
+import kotlinx.coroutines.flow.produceIn
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
+
+/**
+ * A Paging 3 [PagingSource] that reads a query through the chunked rowset stream of
+ * [SQLiteCloud.streamColumnar].
+ *
+ * Pages are cut from the chunks sent by the server, so a page never waits for the whole result:
+ * configure [SQLiteCloudConfig.maxRows] to bound the chunk size and use [pagingConfig] so that
+ * every page, and the prefetch distance, match one chunk. Set [SQLiteCloudConfig.chunkWindow] to
+ * bound the chunks received ahead of the pages. The stream is forward-only, pages can only be
+ * appended and a refresh restarts the query from the first row.
+ *
+ * - Important: The connection cannot be used for other commands while the stream is open, that
+ *              is until the last page has been loaded or the source has been invalidated.
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * val command = SQLiteCloudCommand("SELECT * FROM users")
+ * val pager = Pager(SQLiteCloudPagingSource.pagingConfig(chunkRows = 500)) {
+ *     SQLiteCloudPagingSource(sqliteCloud, command, UserRowMapper)
+ * }
+ * ```
+ *
+ * @param sqliteCloud The connected [SQLiteCloud] instance used to run the query.
+ * @param command The query to page through.
+ * @param mapper The mapper decoding each chunk into items, usually generated for a
+ *            [SQLiteCloudRow] class.
+ */
+class SQLiteCloudPagingSource<T : Any>(
+    private val sqliteCloud: SQLiteCloud,
+    private val command: SQLiteCloudCommand,
+    private val mapper: SQLiteCloudRowMapper<T>,
+) : PagingSource<Int, T>() {
+    private val mutex = Mutex()
+    private var chunks: ReceiveChannel<SQLiteCloudColumnarRowset>? = null
+    private val buffer = ArrayDeque<T>()
+
+    // The index of the first row in the buffer, that is the key of the next page.
+    private var position = 0
+    private var isExhausted = false
+
+    init {
+        registerInvalidatedCallback { chunks?.cancel() }
+    }
+
+    override suspend fun load(params: LoadParams<Int>): LoadResult<Int, T> = mutex.withLock {
+        val key = params.key ?: 0
+        try {
+            if (chunks == null || key < position) restart()
+            while (!fill(key + params.loadSize)) Unit
+            while (position < key && buffer.isNotEmpty()) {
+                buffer.removeFirst()
+                position++
+            }
+
+            val page = List(minOf(params.loadSize, buffer.size)) { buffer.removeFirst() }
+            position += page.size
+            val nextKey = if (isExhausted && buffer.isEmpty()) null else position
+            LoadResult.Page(data = page, prevKey = null, nextKey = nextKey)
+        } catch (error: SQLiteCloudError) {
+            restart(open = false)
+            LoadResult.Error(error)
+        }
+    }
+
+    // The stream cannot seek: refresh from the beginning.
+    override fun getRefreshKey(state: PagingState<Int, T>): Int? = null
+
+    private fun restart(open: Boolean = true) {
+        chunks?.cancel()
+        chunks = if (open) sqliteCloud.streamColumnar(command).produceIn(sqliteCloud.scope) else null
+        buffer.clear()
+        position = 0
+        isExhausted = false
+    }
+
+    // Receives one more chunk unless the buffer already reaches row [end], returns true when done.
+    private suspend fun fill(end: Int): Boolean {
+        if (isExhausted || position + buffer.size >= end) return true
+        val chunk = chunks?.receiveCatching() ?: return true
+        chunk.exceptionOrNull()?.let { throw it }
+        val rowset = chunk.getOrNull()
+        if (rowset == null) {
+            isExhausted = true
+        } else {
+            buffer.addAll(mapper.decode(rowset))
+        }
+        return false
+    }
+
+    companion object {
+        /**
+         * Returns a [PagingConfig] that loads one chunk of [chunkRows] rows per page and starts
+         * prefetching the next chunk when the last one is reached.
+         */
+        fun pagingConfig(chunkRows: Int) = PagingConfig(
+            pageSize = chunkRows,
+            prefetchDistance = chunkRows,
+            initialLoadSize = chunkRows,
+            enablePlaceholders = false,
+        )
+    }
+}
@@ -0,0 +1,203 @@
+package io.sqlitecloud
+
+import android.content.Context
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.NonCancellable
+import kotlinx.coroutines.withContext
+import kotlinx.coroutines.withTimeoutOrNull
+
+/**
+ * SQLiteCloudPool keeps up to [size] authenticated connections to the same SQLite Cloud node
+ * and lends them to callers, so that short-lived operations do not pay the TCP/TLS handshake
+ * and the authentication round trip each time.
+ *
+ * Connections are opened lazily and kept open after use. Each one is checked cheaply for
+ * liveness before it is handed out (a connection closed by the server while idle is replaced),
+ * and its error state is reset when it is returned. Session state set with commands such as
+ * `USE DATABASE` persists across checkouts.
+ *
+ * Every [use] has a [SQLiteCloudCommand.Priority]. A free connection goes to the most urgent
+ * caller waiting, and [interactiveConnections] connections are kept for interactive work: normal
+ * and bulk work never hold all of them, so a lookup does not queue behind a long export. Bulk
+ * work is further limited to [bulkConnections] connections.
+ *
+ * Example usage:
+ * ```kotlin
+ * val pool = SQLiteCloudPool(context, config, size = 4)
+ *
+ * val rows = pool.use { sqliteCloud ->
+ *     sqliteCloud.execute(SQLiteCloudCommand("SELECT * FROM albums;"))
+ * }
+ *
+ * pool.close()
+ * ```
+ *
+ * @constructor Creates a new pool. No connection is opened until the first [use].
+ * @param appContext The Android application context.
+ * @param config The configuration shared by all pooled connections.
+ * @param size The maximum number of connections open at the same time.
+ * @property logger The optional logger passed to the pooled [SQLiteCloud] instances.
+ * @property scope The coroutine scope to use for executing the suspending methods. It defaults to
+ * [CoroutineScope(Dispatchers.IO)].
+ * @param interactiveConnections The connections kept for [SQLiteCloudCommand.Priority.Interactive]
+ *            work, at most `size - 1`.
+ * @param bulkConnections The maximum number of connections used by
+ *            [SQLiteCloudCommand.Priority.Bulk] work at the same time.
+ */
+class SQLiteCloudPool(
+    private val appContext: Context,
+    config: SQLiteCloudConfig,
+    val size: Int = 4,
+    val logger: SQLiteCloudLogger? = DefaultSQLiteCloudLogger(isEnabled = true),
+    val scope: CoroutineScope = CoroutineScope(Dispatchers.IO),
+    interactiveConnections: Int = if (size > 1) 1 else 0,
+    bulkConnections: Int = size,
+) {
+    val config: SQLiteCloudConfig = SQLiteCloud.withDefaultRootCertificate(appContext, config)
+
+    val interactiveConnections = interactiveConnections.coerceIn(0, maxOf(size - 1, 0))
+
+    val bulkConnections = bulkConnections.coerceIn(1, maxOf(size - this.interactiveConnections, 1))
+
+    private val scheduler = Scheduler()
+
+    private val bridge = SQLiteCloudBridge(logger)
+
+    private var pool: OpaquePointer<SQLiteCloudNativePool>? = bridge.createPool(this.config, size)
+
+    /**
+     * Checks out a connection, runs [block] with it and returns it to the pool, even if [block]
+     * throws.
+     *
+     * @param priority The class of work of [block], which decides its turn when all the
+     *            connections it may use are busy.
+     * @param timeout The maximum number of seconds to wait for a connection when all of them are
+     *            in use. `0` waits indefinitely.
+     * @param block The operations to perform with the pooled connection. The [SQLiteCloud]
+     *            instance must not be disconnected, nor used after [block] returns.
+     * @return The value returned by [block].
+     * @throws SQLiteCloudError If the pool has been closed, no connection became available within
+     *            [timeout] or a new connection could not be established.
+     */
+    suspend fun <T> use(
+        timeout: Int = 0,
+        priority: SQLiteCloudCommand.Priority = SQLiteCloudCommand.Priority.Normal,
+        block: suspend (SQLiteCloud) -> T,
+    ): T = withContext(scope.coroutineContext) {
+        val pool = pool ?: throw SQLiteCloudError.Connection.invalidConnection
+
+        scheduler.acquire(priority, timeout)
+        try {
+            val sqliteCloud = SQLiteCloud(appContext, config, logger, scope)
+            sqliteCloud.checkout(pool, timeout)
+            try {
+                block(sqliteCloud)
+            } finally {
+                sqliteCloud.checkin(pool)
+            }
+        } finally {
+            scheduler.release(priority)
+        }
+    }
+
+    /**
+     * Executes [command] on a pooled connection, with the priority of the command.
+     *
+     * @throws SQLiteCloudError If the command fails or no connection could be checked out.
+     */
+    suspend fun execute(command: SQLiteCloudCommand): SQLiteCloudResult =
+        use(priority = command.priority) { it.execute(command) }
+
+    /**
+     * Closes all the idle connections and releases the pool. Connections still in use by a
+     * [use] block must be returned before calling this method.
+     */
+    suspend fun close(): Unit = withContext(scope.coroutineContext) {
+        pool?.let { bridge.destroyPool(it) }
+        pool = null
+    }
+
+    // Hands out the right to check out a connection, so that the native pool is never asked for
+    // more than [size] of them. A caller runs when the connections it may use are not all busy:
+    // all of them for interactive work, all but [interactiveConnections] for normal work, and
+    // [bulkConnections] for bulk work. Waiters are served by priority, then in arrival order.
+    private inner class Scheduler {
+        private class Waiter(val priority: SQLiteCloudCommand.Priority) {
+            val granted = CompletableDeferred<Unit>()
+        }
+
+        private val waiters = mutableListOf<Waiter>()
+        private var busy = 0
+        private var busyBulk = 0
+        private var busyBackground = 0
+
+        suspend fun acquire(priority: SQLiteCloudCommand.Priority, timeout: Int) {
+            val waiter = synchronized(this) {
+                if (waiters.none { it.priority <= priority } && canRun(priority)) {
+                    grant(priority)
+                    return
+                }
+                Waiter(priority).also { waiter ->
+                    waiters.add(waiters.indexOfFirst { it.priority > priority }.takeIf { it >= 0 } ?: waiters.size, waiter)
+                }
+            }
+
+            val granted = try {
+                if (timeout > 0) {
+                    withTimeoutOrNull(timeout * 1000L) { waiter.granted.await() } != null
+                } else {
+                    waiter.granted.await()
+                    true
+                }
+            } catch (error: Throwable) {
+                withContext(NonCancellable) { abandon(waiter) }
+                throw error
+            }
+            if (!granted) {
+                abandon(waiter)
+                throw SQLiteCloudError.Connection.poolTimeout
+            }
+        }
+
+        @Synchronized
+        fun release(priority: SQLiteCloudCommand.Priority) {
+            busy--
+            if (priority != SQLiteCloudCommand.Priority.Interactive) busyBackground--
+            if (priority == SQLiteCloudCommand.Priority.Bulk) busyBulk--
+            dispatch()
+        }
+
+        // A waiter that gives up after it was granted passes its turn on.
+        @Synchronized
+        private fun abandon(waiter: Waiter) {
+            if (!waiters.remove(waiter)) release(waiter.priority)
+        }
+
+        private fun canRun(priority: SQLiteCloudCommand.Priority) = when (priority) {
+            SQLiteCloudCommand.Priority.Interactive -> busy < size
+            SQLiteCloudCommand.Priority.Normal -> busy < size && busyBackground < size - interactiveConnections
+            SQLiteCloudCommand.Priority.Bulk ->
+                busy < size && busyBackground < size - interactiveConnections && busyBulk < bulkConnections
+        }
+
+        private fun grant(priority: SQLiteCloudCommand.Priority) {
+            busy++
+            if (priority != SQLiteCloudCommand.Priority.Interactive) busyBackground++
+            if (priority == SQLiteCloudCommand.Priority.Bulk) busyBulk++
+        }
+
+        private fun dispatch() {
+            val iterator = waiters.iterator()
+            while (iterator.hasNext() && busy < size) {
+                val waiter = iterator.next()
+                if (canRun(waiter.priority)) {
+                    iterator.remove()
+                    grant(waiter.priority)
+                    waiter.granted.complete(Unit)
+                }
+            }
+        }
+    }
+}
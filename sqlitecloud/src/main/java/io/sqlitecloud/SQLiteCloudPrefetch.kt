@@ -0,0 +1,55 @@
+package io.sqlitecloud
+
+/**
+ * A follow-up query run ahead of time for the first rows of a parent result, see
+ * [SQLiteCloud.registerPrefetch].
+ *
+ * For each of the first [rows] rows of the parent, [query] is run with the value of [keyColumn]
+ * bound to its single `?` parameter, and the result is stored in the result cache, so that the
+ * screen that runs the same command next is served from memory. Rows whose key is NULL or a BLOB
+ * are skipped.
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * sqliteCloud.registerPrefetch(
+ *     "SELECT id, customer FROM orders ORDER BY created DESC LIMIT 50",
+ *     SQLiteCloudPrefetch(
+ *         query = "SELECT * FROM order_items WHERE order_id = ?",
+ *         keyColumn = "id",
+ *         cacheTables = listOf("order_items"),
+ *     ),
+ * )
+ * ```
+ */
+data class SQLiteCloudPrefetch(
+    /** The follow-up query, with a single `?` parameter. */
+    val query: String,
+    /** The column of the parent result bound to the parameter of [query]. */
+    val keyColumn: String,
+    /**
+     * The tables read by [query], as [SQLiteCloudCommand.cacheTables]. The follow-up command
+     * must declare the same ones to be served from the cache.
+     */
+    val cacheTables: List<String>,
+    /** How many rows of the parent result, from the first one, are prefetched. */
+    val rows: Int = 10,
+) {
+    /**
+     * The follow-up commands for [rowset], in the order of its rows.
+     */
+    internal fun commands(rowset: SQLiteCloudRowset): List<SQLiteCloudCommand> {
+        val column = rowset.columns.indexOf(keyColumn)
+        if (column < 0) return emptyList()
+
+        return rowset.rows.asSequence()
+            .take(rows)
+            .map { it[column] }
+            .filterNot { it is SQLiteCloudValue.Null || it is SQLiteCloudValue.Blob || it is SQLiteCloudValue.BlobFile }
+            .distinct()
+            .map {
+                SQLiteCloudCommand(query, listOf(it), cacheTables = cacheTables, priority = SQLiteCloudCommand.Priority.Bulk)
+            }
+            .toList()
+    }
+}
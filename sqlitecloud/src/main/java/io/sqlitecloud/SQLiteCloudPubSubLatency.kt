@@ -0,0 +1,44 @@
+package io.sqlitecloud
+
+import kotlin.math.ceil
+
+/// Latency histograms of the notifications of a channel, see [SQLiteCloud.pubSubLatency].
+///
+/// Counter n of a histogram counts the latencies from 2^(n-1) to 2^n microseconds, counter 0 the
+/// ones below a microsecond and the last counter every longer latency.
+///
+/// - Parameters:
+///   - channel: The channel, empty for the notifications without one and for the channels past
+///     the first 64.
+///   - network: From the publish time of the notification, when it has a numeric `timestamp`
+///     member, to the pub/sub socket being readable. It includes the skew between the clocks.
+///   - parse: From the socket being readable to the notification being parsed.
+///   - dispatch: From the notification being parsed to the callback or, with
+///     [SQLiteCloudConfig.pubSubQueueSize], to the notification being drained from the queue.
+///   - callback: The time spent in the callback, which decodes the notification and passes it to
+///     the handlers. It is not measured with a queue.
+data class SQLiteCloudPubSubLatency(
+    val channel: String,
+    val network: List<Int>,
+    val parse: List<Int>,
+    val dispatch: List<Int>,
+    val callback: List<Int>,
+) {
+    companion object {
+        const val bucketCount = 32
+
+        /// The upper bound in microseconds of the [fraction] percentile of [histogram], 0 if empty.
+        fun percentileMicros(histogram: List<Int>, fraction: Double): Long {
+            val total = histogram.sumOf { it.toLong() }
+            if (total == 0L) return 0
+
+            val target = maxOf(1L, ceil(total * fraction).toLong())
+            var count = 0L
+            histogram.forEachIndexed { index, counter ->
+                count += counter
+                if (count >= target) return 1L shl index
+            }
+            return 1L shl (histogram.size - 1)
+        }
+    }
+}
@@ -0,0 +1,308 @@
+package io.sqlitecloud
+
+import android.database.Cursor
+import android.database.sqlite.SQLiteCursor
+import android.database.sqlite.SQLiteDatabase
+import android.database.sqlite.SQLiteException
+import android.database.sqlite.SQLiteQuery
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.cancelAndJoin
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
+import kotlinx.coroutines.withTimeoutOrNull
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.file.Path
+import java.util.concurrent.atomic.AtomicLong
+
+/**
+ * SQLiteCloudReplica serves the reads of a database from a local copy, opened with the SQLite of
+ * the platform, so that a read costs no round trip. Writes and the reads that need the latest
+ * data still go to SQLite Cloud through [sqliteCloud].
+ *
+ * The copy is kept up to date with [SQLiteCloud.sync], which writes only the blocks that changed
+ * since the raft index of the copy. A refresh is triggered by the table change notifications of
+ * the database (`LISTEN TABLE *`), by the writes sent through [execute], and every
+ * [refreshIntervalMs] in case a notification was missed. There are two copies: one is open for
+ * the reads while the other one is synced, then they are swapped, so reads never wait for a
+ * refresh.
+ *
+ * A change is pending from its notification until a refresh that started after it completes.
+ * [Consistency.Local] reads are served by the copy unless a change has been pending for more than
+ * [maxStalenessMs], and by [sqliteCloud] otherwise. A read that the platform SQLite cannot run,
+ * for example one that uses a function of the server, is sent to [sqliteCloud] too.
+ *
+ * - Important: [sqliteCloud] should be a client of its own, with [databaseName] selected: a sync
+ *              holds its connection while the changed blocks are downloaded.
+ *
+ * Example usage:
+ * ```kotlin
+ * val replica = SQLiteCloudReplica(sqliteCloud, "chinook.sqlite", context.filesDir.toPath().resolve("chinook.sqlite"))
+ * replica.open()
+ *
+ * val albums = replica.execute(SQLiteCloudCommand("SELECT * FROM albums WHERE ArtistId = ?", SQLiteCloudValue.Integer(1)))
+ * replica.execute(SQLiteCloudCommand("INSERT INTO albums (Title, ArtistId) VALUES (?, ?)", SQLiteCloudValue.String("Blue"), SQLiteCloudValue.Integer(1)))
+ *
+ * replica.close()
+ * ```
+ *
+ * @param sqliteCloud The client of the database, used by the syncs, the writes and the reads that
+ *            the copy cannot serve.
+ * @param databaseName The name of the database to replicate.
+ * @param localPath The path of the copy, the second copy and the raft indexes are stored next to it.
+ * @property maxStalenessMs How long a change may be pending while the reads are still served by
+ *            the copy, `0` sends them to [sqliteCloud] as soon as a change is notified.
+ * @property refreshIntervalMs The time between two refreshes when no change is notified.
+ * @property logger The optional logger.
+ * @property scope The coroutine scope of the refreshes.
+ */
+class SQLiteCloudReplica(
+    private val sqliteCloud: SQLiteCloud,
+    val databaseName: String,
+    localPath: Path,
+    val maxStalenessMs: Long = 0,
+    val refreshIntervalMs: Long = 60_000,
+    val logger: SQLiteCloudLogger? = sqliteCloud.logger,
+    val scope: CoroutineScope = sqliteCloud.scope,
+) {
+    /// Where a read is served from.
+    enum class Consistency {
+        /// The copy, unless it is staler than [maxStalenessMs].
+        Local,
+
+        /// SQLite Cloud, which also sees the writes not yet replicated.
+        Strong,
+    }
+
+    // A copy of the database and the raft index it was last synced to.
+    private class Slot(val file: File) {
+        private val raftFile = File(file.path + ".raft")
+
+        // A copy deleted meanwhile is downloaded again in full.
+        var raftIndex: Long = raftFile.takeIf { file.exists() && it.exists() }?.readText()?.trim()?.toLongOrNull() ?: 0
+            set(value) {
+                field = value
+                raftFile.writeText(value.toString())
+            }
+    }
+
+    private val slots = listOf(Slot(localPath.toFile()), Slot(File(localPath.toString() + "-b")))
+
+    // The copy open for the reads, and its slot.
+    @Volatile
+    private var database: SQLiteDatabase? = null
+
+    @Volatile
+    private var current = slots[0]
+
+    // The copy swapped out by the last refresh, synced again once the reads still using it are done.
+    private var previous: SQLiteDatabase? = null
+
+    // The time of the oldest change not yet applied to the copy, 0 if there is none.
+    private val pendingSinceNanos = AtomicLong()
+
+    // Incremented by every change, so that a refresh knows whether one arrived while it was syncing.
+    private val changes = AtomicLong()
+
+    private val refreshWanted = Channel<Unit>(Channel.CONFLATED)
+
+    private val refreshLock = Mutex()
+
+    private var jobs = emptyList<Job>()
+
+    /**
+     * The raft index of the copy that serves the reads, `0` before [open].
+     */
+    val raftIndex: Long
+        get() = if (database != null) current.raftIndex else 0
+
+    /**
+     * How long the oldest change not yet applied to the copy has been pending, `0` if the copy is
+     * up to date as far as the notifications tell.
+     */
+    val stalenessMs: Long
+        get() = pendingSinceNanos.get().let { if (it == 0L) 0 else (System.nanoTime() - it) / 1_000_000 }
+
+    private val isFreshEnough: Boolean
+        get() = pendingSinceNanos.get().let { it == 0L || System.nanoTime() - it < maxStalenessMs * 1_000_000 }
+
+    /**
+     * Syncs the copy, opens it and starts listening to the changes of the database. The copy left
+     * by a previous run is reused, so only the blocks changed meanwhile are downloaded.
+     *
+     * @throws SQLiteCloudError if the first sync fails.
+     */
+    suspend fun open() {
+        current = slots.maxBy { if (it.file.exists()) it.raftIndex else -1 }
+
+        // Listening before the first sync, so that no change made meanwhile is missed.
+        val notifications = scope.launch {
+            sqliteCloud.notifications.collect { payloads ->
+                if (payloads.any { it.messageType != SQLiteCloudPayload.MessageType.Message }) changed()
+            }
+        }
+        try {
+            sqliteCloud.listen(SQLiteCloudChannel.AllTables) {}
+            refresh()
+        } catch (error: Throwable) {
+            notifications.cancel()
+            throw error
+        }
+
+        jobs = listOf(
+            notifications,
+            scope.launch {
+                while (isActive) {
+                    withTimeoutOrNull(refreshIntervalMs) { refreshWanted.receive() }
+                    try {
+                        refresh()
+                    } catch (error: SQLiteCloudError) {
+                        logger?.logError(category = "REPLICA", message = "🚨 Replica refresh failed: $error")
+                        delay(refreshRetryMs)
+                    }
+                }
+            },
+        )
+    }
+
+    /**
+     * Executes [command], from the copy when it is a read and [consistency] allows it, on
+     * [sqliteCloud] otherwise. A write makes the reads go to [sqliteCloud] until it has been
+     * replicated, unless [maxStalenessMs] allows otherwise.
+     *
+     * @throws SQLiteCloudError If the command fails on [sqliteCloud].
+     */
+    suspend fun execute(
+        command: SQLiteCloudCommand,
+        consistency: Consistency = Consistency.Local,
+    ): SQLiteCloudResult {
+        if (!command.isReadOnly) {
+            try {
+                return sqliteCloud.execute(command)
+            } finally {
+                changed()
+            }
+        }
+        if (consistency == Consistency.Local && isFreshEnough) {
+            queryLocal(command)?.let { return it }
+        }
+        return sqliteCloud.execute(command)
+    }
+
+    /**
+     * Stops the refreshes and closes the copy, the files are kept for the next [open].
+     */
+    suspend fun close() {
+        jobs.forEach { it.cancelAndJoin() }
+        jobs = emptyList()
+        database?.close()
+        database = null
+    }
+
+    private fun changed() {
+        changes.incrementAndGet()
+        pendingSinceNanos.compareAndSet(0, System.nanoTime())
+        refreshWanted.trySend(Unit)
+    }
+
+    // Syncs the slot not open for the reads, then makes it the one open. The swapped out copy is
+    // closed once its last read is done.
+    private suspend fun refresh() = refreshLock.withLock {
+        val open = database
+        val target = if (open == null) current else slots.first { it !== current }
+        val seen = changes.get()
+
+        // The copy swapped out by the previous refresh may still be read.
+        while (previous?.isOpen == true) delay(closeWaitMs)
+        previous = null
+        val raftIndex = sqliteCloud.sync(databaseName, target.file.toPath(), target.raftIndex)
+        if (open != null && raftIndex == current.raftIndex) {
+            // Nothing changed, the copy open is as fresh as the one just synced.
+            target.raftIndex = raftIndex
+        } else {
+            val fresh = SQLiteDatabase.openDatabase(
+                target.file.path,
+                null,
+                SQLiteDatabase.OPEN_READONLY or SQLiteDatabase.NO_LOCALIZED_COLLATORS,
+            )
+            target.raftIndex = raftIndex
+            current = target
+            database = fresh
+            previous = open
+            open?.close()
+            logger?.logDebug(category = "REPLICA", message = "🔄 Replica of $databaseName at raft index $raftIndex")
+        }
+        if (changes.get() == seen) pendingSinceNanos.set(0)
+    }
+
+    // Runs [command] on the copy, or returns null if the copy is not open or cannot run it.
+    private fun queryLocal(command: SQLiteCloudCommand): SQLiteCloudResult? {
+        while (true) {
+            val db = database ?: return null
+            try {
+                db.acquireReference()
+            } catch (e: IllegalStateException) {
+                // Closed by a refresh between the read of [database] and here.
+                continue
+            }
+            try {
+                val cursor = db.rawQueryWithFactory(
+                    { _, driver, editTable, query -> bind(query, command.parameters); SQLiteCursor(driver, editTable, query) },
+                    command.query,
+                    null,
+                    null,
+                )
+                return cursor.use { SQLiteCloudResult.Rowset(rowset(it)) }
+            } catch (e: SQLiteException) {
+                logger?.logDebug(category = "REPLICA", message = "🔄 Read sent to SQLite Cloud: $e")
+                return null
+            } finally {
+                db.releaseReference()
+            }
+        }
+    }
+
+    private fun bind(query: SQLiteQuery, parameters: List<SQLiteCloudValue>) {
+        parameters.forEachIndexed { index, value ->
+            when (value) {
+                is SQLiteCloudValue.Integer -> query.bindLong(index + 1, value.value)
+                is SQLiteCloudValue.Double -> query.bindDouble(index + 1, value.value)
+                is SQLiteCloudValue.String -> query.bindString(index + 1, value.value)
+                is SQLiteCloudValue.Blob -> value.value.duplicate().let { blob ->
+                    query.bindBlob(index + 1, ByteArray(blob.remaining()).also { blob.get(it) })
+                }
+                is SQLiteCloudValue.BlobFile -> query.bindBlob(index + 1, value.value.readBytes())
+                is SQLiteCloudValue.Null -> query.bindNull(index + 1)
+            }
+        }
+    }
+
+    private fun rowset(cursor: Cursor): SQLiteCloudRowset {
+        val columns = cursor.columnNames.toList()
+        val rows = ArrayList<List<SQLiteCloudValue>>(cursor.count)
+        while (cursor.moveToNext()) {
+            rows.add(
+                List(columns.size) { column ->
+                    when (cursor.getType(column)) {
+                        Cursor.FIELD_TYPE_INTEGER -> SQLiteCloudValue.Integer(cursor.getLong(column))
+                        Cursor.FIELD_TYPE_FLOAT -> SQLiteCloudValue.Double(cursor.getDouble(column))
+                        Cursor.FIELD_TYPE_STRING -> SQLiteCloudValue.String(cursor.getString(column))
+                        Cursor.FIELD_TYPE_BLOB -> SQLiteCloudValue.Blob(ByteBuffer.wrap(cursor.getBlob(column)))
+                        else -> SQLiteCloudValue.Null
+                    }
+                }
+            )
+        }
+        return SQLiteCloudRowset(columns, rows)
+    }
+
+    private companion object {
+        const val closeWaitMs = 5L
+        const val refreshRetryMs = 1000L
+    }
+}
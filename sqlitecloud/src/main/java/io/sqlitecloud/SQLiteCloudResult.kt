@@ -11,6 +11,28 @@ sealed class SQLiteCloudResult(open val value: Any?) {
 
     data class Rowset(override val value: SQLiteCloudRowset) : SQLiteCloudResult(value)
 
+    /**
+     * The latency breakdown of the command that returned this result, `null` for [Success] and for
+     * the results that were not read as the reply to a command. A result served by the result
+     * cache keeps the timings of the command that filled the cache.
+     */
+    var timings: SQLiteCloudTimings? = null
+        internal set
+
+    /**
+     * The allocations made by the command that returned this result for its reply, `null` without
+     * [SQLiteCloudConfig.allocationCounters] and for the results that have no [timings].
+     */
+    var allocations: SQLiteCloudAllocations? = null
+        internal set
+
+    /**
+     * How the rows of a [Rowset] were materialized, `null` for the other results. See
+     * [SQLiteCloudConfig.lazyRowsetCells].
+     */
+    var materialization: Materialization? = null
+        internal set
+
     val stringValue: String?
         get() = when (this) {
             is Value -> value.stringValue
@@ -20,6 +42,15 @@ sealed class SQLiteCloudResult(open val value: Any?) {
             is Success -> "success"
         }
 
+    /// Constants that describe how the rows of a rowset were materialized.
+    enum class Materialization {
+        /// Every cell boxed into a [SQLiteCloudValue] when the result was parsed.
+        Eager,
+
+        /// Cells kept in the arrays of a columnar rowset and boxed when their row is read.
+        Lazy,
+    }
+
     enum class Type(val rawValue: Int) {
         OK(0),
         ERROR(1),
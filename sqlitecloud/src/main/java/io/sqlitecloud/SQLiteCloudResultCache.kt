@@ -0,0 +1,153 @@
+package io.sqlitecloud
+
+/**
+ * Results of read commands kept in native memory, keyed by query text, parameters and options.
+ *
+ * Entries hold the native result itself, whose buffers are the self-contained bytes received
+ * from the server, so every hit is parsed again into new Kotlin objects without touching the
+ * network. The least recently used entries are released once [capacity] bytes are exceeded, and
+ * a change notification on a table releases every entry that reads it.
+ *
+ * - Note: Change notifications arrive on the pub/sub thread, every method is synchronized.
+ */
+internal class SQLiteCloudResultCache(
+    private val capacity: Long,
+    private val release: (OpaquePointer<SQLiteCloudResult>) -> Unit,
+) {
+    private data class Key(
+        val query: String,
+        val parameters: List<SQLiteCloudValue>,
+        val options: SQLiteCloudCommand.Options?,
+    )
+
+    private class Entry(
+        val result: OpaquePointer<SQLiteCloudResult>,
+        val size: Long,
+        val tables: Set<String>,
+    )
+
+    private val entries = LinkedHashMap<Key, Entry>(16, 0.75f, true)
+
+    // Tables the connection is already listening to, see [unlistenedTables].
+    private val listening = mutableSetOf<String>()
+
+    // Incremented by every invalidation, so that a result received while a table was changing is
+    // not stored (see [put]).
+    private var generation = 0L
+
+    private var size = 0L
+
+    val currentGeneration: Long
+        @Synchronized get() = generation
+
+    /** The bytes of the cached entries. */
+    val currentSize: Long
+        @Synchronized get() = size
+
+    /**
+     * Whether [command] can be cached: it must declare the tables it reads and bind no blob,
+     * whose buffer or file could change after the command has been stored as a key.
+     */
+    fun isCacheable(command: SQLiteCloudCommand) = command.cacheTables.isNotEmpty() &&
+        command.parameters.none { it is SQLiteCloudValue.Blob || it is SQLiteCloudValue.BlobFile }
+
+    /**
+     * Parses the cached result of [command] with [parse], or returns null on a miss.
+     */
+    @Synchronized
+    fun <T> get(command: SQLiteCloudCommand, parse: (OpaquePointer<SQLiteCloudResult>) -> T): T? {
+        val entry = entries[key(command)] ?: return null
+        return parse(entry.result)
+    }
+
+    /**
+     * Whether the result of [command] is cached, without parsing it.
+     */
+    @Synchronized
+    fun contains(command: SQLiteCloudCommand) = entries.containsKey(key(command))
+
+    /**
+     * Stores [result] for [command] unless a table was invalidated since [generation] was read,
+     * before the command was sent.
+     *
+     * @return `false` if the result was not stored and must be released by the caller.
+     */
+    @Synchronized
+    fun put(
+        command: SQLiteCloudCommand,
+        result: OpaquePointer<SQLiteCloudResult>,
+        resultSize: Long,
+        generation: Long,
+    ): Boolean {
+        val entrySize = resultSize + command.query.length
+        if (generation != this.generation || entrySize > capacity) return false
+
+        entries.put(key(command), Entry(result, entrySize, tableNames(command)))?.let { previous ->
+            size -= previous.size
+            release(previous.result)
+        }
+        size += entrySize
+        trim(capacity)
+        return true
+    }
+
+    /**
+     * The tables of [command] that still need a `LISTEN TABLE` on this connection.
+     */
+    @Synchronized
+    fun unlistenedTables(command: SQLiteCloudCommand): List<String> =
+        tableNames(command).filter { it !in listening }
+
+    @Synchronized
+    fun setListening(table: String) {
+        listening.add(table.lowercase())
+    }
+
+    /**
+     * Releases the entries that read [table], or every entry if [table] is null or `*`.
+     */
+    @Synchronized
+    fun invalidate(table: String?) {
+        generation++
+        val name = table?.lowercase()
+        val iterator = entries.values.iterator()
+        while (iterator.hasNext()) {
+            val entry = iterator.next()
+            if (name == null || name == SQLiteCloudChannel.AllTables.name || name in entry.tables) {
+                iterator.remove()
+                size -= entry.size
+                release(entry.result)
+            }
+        }
+    }
+
+    /**
+     * Releases the least recently used entries until at most [bytes] are cached.
+     */
+    @Synchronized
+    fun trim(bytes: Long) {
+        val iterator = entries.values.iterator()
+        while (size > bytes && iterator.hasNext()) {
+            val eldest = iterator.next()
+            iterator.remove()
+            size -= eldest.size
+            release(eldest.result)
+        }
+    }
+
+    /**
+     * Releases every entry and forgets the tables listened to, for a connection that is closed
+     * or replaced.
+     */
+    @Synchronized
+    fun clear() {
+        invalidate(null)
+        listening.clear()
+    }
+
+    private fun key(command: SQLiteCloudCommand) = Key(command.query, command.parameters, command.options)
+
+    // SQL identifiers are case insensitive.
+    private fun tableNames(command: SQLiteCloudCommand) =
+        command.cacheTables.map { it.lowercase() }.toSet()
+}
@@ -0,0 +1,112 @@
+package io.sqlitecloud
+
+import android.content.Context
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+
+/**
+ * SQLiteCloudRouter splits the commands of an app between two [SQLiteCloudPool]s, so that
+ * read-heavy screens and bulk writes do not contend on the same socket and the same node:
+ * writes go to the node of [SQLiteCloudConfig.hostname] (the leader), reads go to the node that
+ * answers first among the leader and [readNodes], with [SQLiteCloudConfig.nonlinearizable] set
+ * so that the node replies without asking the leader.
+ *
+ * A command is routed as a read when [SQLiteCloudCommand.isReadOnly] says so, unless the caller
+ * knows better (for example from [SQLiteCloudVM.isReadOnly]). After a write, the reads of the
+ * next [readYourWritesMs] milliseconds go to the leader too, because a replica may not have
+ * applied the write yet.
+ *
+ * Session state must be part of [config] (for example [SQLiteCloudConfig.dbname]): a `USE
+ * DATABASE` run through the router only changes one of the pooled connections.
+ *
+ * Example usage:
+ * ```kotlin
+ * val router = SQLiteCloudRouter(context, config, readNodes = listOf("eu.node.sqlite.cloud", "us.node.sqlite.cloud"))
+ *
+ * router.execute(SQLiteCloudCommand("INSERT INTO albums (title) VALUES (?)", SQLiteCloudValue.String("Blue")))
+ * val albums = router.execute(SQLiteCloudCommand("SELECT * FROM albums"))
+ *
+ * router.close()
+ * ```
+ *
+ * @constructor Creates the two pools. No connection is opened until the first command.
+ * @param appContext The Android application context.
+ * @param config The configuration of the leader, shared by all the connections.
+ * @param readNodes The other nodes of the cluster (`host` or `host:port`, [SQLiteCloudConfig.port]
+ *            when omitted) that can serve reads.
+ * @param writeSize The maximum number of connections open to the leader for writes.
+ * @param readSize The maximum number of connections open for reads.
+ * @property readYourWritesMs How long the reads follow a write to the leader.
+ * @property logger The optional logger passed to the pooled [SQLiteCloud] instances.
+ * @property scope The coroutine scope to use for executing the suspending methods. It defaults to
+ * [CoroutineScope(Dispatchers.IO)].
+ */
+class SQLiteCloudRouter(
+    appContext: Context,
+    config: SQLiteCloudConfig,
+    readNodes: List<String> = emptyList(),
+    writeSize: Int = 2,
+    readSize: Int = 4,
+    val readYourWritesMs: Long = 1000,
+    val logger: SQLiteCloudLogger? = DefaultSQLiteCloudLogger(isEnabled = true),
+    val scope: CoroutineScope = CoroutineScope(Dispatchers.IO),
+) {
+    private val writer = SQLiteCloudPool(appContext, config, writeSize, logger, scope)
+
+    private val reader = SQLiteCloudPool(
+        appContext,
+        config.copy(
+            hostname = (listOf(config.hostname) + readNodes).joinToString(","),
+            nonlinearizable = true,
+        ),
+        readSize,
+        logger,
+        scope,
+    )
+
+    @Volatile
+    private var lastWriteNanos: Long? = null
+
+    private val isFenced: Boolean
+        get() = lastWriteNanos?.let { System.nanoTime() - it < readYourWritesMs * 1_000_000 } ?: false
+
+    /**
+     * Executes [command] on a reader connection when [readOnly] is `true`, on a writer connection
+     * otherwise.
+     *
+     * @throws SQLiteCloudError If the command fails or no connection could be checked out.
+     */
+    suspend fun execute(
+        command: SQLiteCloudCommand,
+        readOnly: Boolean = command.isReadOnly,
+    ): SQLiteCloudResult = use(readOnly, priority = command.priority) { it.execute(command) }
+
+    /**
+     * Checks out a connection from the pool selected by [readOnly], runs [block] with it and
+     * returns it, as [SQLiteCloudPool.use] does. A block that is not [readOnly] is a write even if
+     * it fails, since the leader may have applied it.
+     */
+    suspend fun <T> use(
+        readOnly: Boolean,
+        timeout: Int = 0,
+        priority: SQLiteCloudCommand.Priority = SQLiteCloudCommand.Priority.Normal,
+        block: suspend (SQLiteCloud) -> T,
+    ): T {
+        if (readOnly && !isFenced) return reader.use(timeout, priority, block)
+
+        try {
+            return writer.use(timeout, priority, block)
+        } finally {
+            if (!readOnly) lastWriteNanos = System.nanoTime()
+        }
+    }
+
+    /**
+     * Closes both pools. Connections still in use by a [use] block must be returned before calling
+     * this method.
+     */
+    suspend fun close() {
+        reader.close()
+        writer.close()
+    }
+}
@@ -0,0 +1,42 @@
+package io.sqlitecloud
+
+/**
+ * Marks a class whose primary constructor can be filled from the rows of a
+ * [SQLiteCloudColumnarRowset].
+ *
+ * The `sqlitecloud-ksp` processor generates a `<ClassName>RowMapper` object for each annotated
+ * class. Every constructor parameter is read from the column with the same name, or the one given
+ * with [SQLiteCloudColumn], and must be one of `Long`, `Int`, `Short`, `Byte`, `Boolean`, `Double`,
+ * `Float`, `String`, `ByteArray` or `ByteBuffer`. Nullable parameters receive null for NULL cells.
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * @SQLiteCloudRow
+ * data class User(val id: Long, @SQLiteCloudColumn("user_name") val name: String, val age: Int?)
+ *
+ * val users = sqliteCloud.executeColumnar(SQLiteCloudCommand("SELECT * FROM users")).map(UserRowMapper)
+ * ```
+ */
+@Target(AnnotationTarget.CLASS)
+@Retention(AnnotationRetention.SOURCE)
+annotation class SQLiteCloudRow
+
+/**
+ * Overrides the column read for a constructor parameter of a [SQLiteCloudRow] class.
+ *
+ * @property name The name of the column in the rowset.
+ */
+@Target(AnnotationTarget.VALUE_PARAMETER)
+@Retention(AnnotationRetention.SOURCE)
+annotation class SQLiteCloudColumn(val name: String)
+
+/**
+ * Decodes the rows of a [SQLiteCloudColumnarRowset] into objects of type [T].
+ *
+ * Implementations are expected to resolve the column indices once per rowset, with
+ * [SQLiteCloudColumnarRowset.columnIndex], and then read every row through the typed getters.
+ */
+fun interface SQLiteCloudRowMapper<T> {
+    fun decode(rowset: SQLiteCloudColumnarRowset): List<T>
+}
@@ -0,0 +1,70 @@
+package io.sqlitecloud
+
+/**
+ * A change to the result of a live query, emitted by [SQLiteCloud.liveQuery].
+ *
+ * Rows are identified by the text of their [keyColumn] cell, which is how table change
+ * notifications carry the primary key of the rows they touch. A diff either lists the rows
+ * inserted, updated and deleted since the previous one, or, when [isReset] is true, replaces the
+ * whole result with [inserted].
+ *
+ * Keep the result up to date with [applyTo]:
+ *
+ * ```kotlin
+ * var rowset: SQLiteCloudColumnarRowset? = null
+ * sqliteCloud.liveQuery(command, keyColumn = "id").collect { diff ->
+ *     rowset = diff.applyTo(rowset)
+ * }
+ * ```
+ */
+class SQLiteCloudRowsetDiff internal constructor(
+    /** The column of the result that identifies its rows. */
+    val keyColumn: String,
+    /** Whether the diff replaces every row: the first one of a live query, or after a refresh. */
+    val isReset: Boolean,
+    /** The rows added to the result, or the whole result when [isReset] is true. */
+    val inserted: SQLiteCloudColumnarRowset,
+    /** The new version of rows already in the result. */
+    val updated: SQLiteCloudColumnarRowset,
+    /** The keys of the rows removed from the result. */
+    val deleted: Set<String>,
+) {
+    /**
+     * Applies the diff to [rowset], the result obtained by applying the previous diffs. Updated
+     * rows keep their position, inserted rows are appended. Only the cells are copied, no query
+     * is sent.
+     *
+     * @param rowset The current result, or null before the first diff.
+     * @return The new result.
+     */
+    fun applyTo(rowset: SQLiteCloudColumnarRowset?): SQLiteCloudColumnarRowset {
+        if (isReset || rowset == null) return inserted
+
+        val key = rowset.columnIndex(keyColumn)
+        val updates = HashMap<String, Int>(updated.rowCount)
+        val updatedKey = updated.columnIndex(keyColumn)
+        for (row in 0..<updated.rowCount) {
+            updates[updated.getString(row, updatedKey) ?: continue] = row
+        }
+
+        val rows = ArrayList<Pair<SQLiteCloudColumnarRowset, Int>>(rowset.rowCount + inserted.rowCount)
+        for (row in 0..<rowset.rowCount) {
+            val rowKey = rowset.getString(row, key)
+            when {
+                rowKey in deleted -> Unit
+                rowKey != null && rowKey in updates -> rows.add(updated to updates.getValue(rowKey))
+                else -> rows.add(rowset to row)
+            }
+        }
+        for (row in 0..<inserted.rowCount) {
+            rows.add(inserted to row)
+        }
+        return SQLiteCloudColumnarRowset.copyOf(rowset.columns, rows)
+    }
+
+    internal companion object {
+        /** A diff that replaces the whole result with [rowset]. */
+        fun reset(keyColumn: String, rowset: SQLiteCloudColumnarRowset) =
+            SQLiteCloudRowsetDiff(keyColumn, true, rowset, rowset.copyRows(emptyList()), emptySet())
+    }
+}
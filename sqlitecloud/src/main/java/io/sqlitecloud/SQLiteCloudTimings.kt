@@ -0,0 +1,48 @@
+package io.sqlitecloud
+
+/**
+ * Where the time of the command that returned a [SQLiteCloudResult] went, see
+ * [SQLiteCloudResult.timings].
+ *
+ * The timestamps are microseconds of a monotonic clock, comparable only with each other. A
+ * timestamp is 0 if its stage did not happen.
+ *
+ * @property writeStartMicros The command is about to be written.
+ * @property writeEndMicros The command has been fully written.
+ * @property firstByteMicros The first byte of the reply has been received.
+ * @property lastByteMicros The last byte of the reply has been received (of its last chunk for a
+ *           chunked rowset).
+ * @property decompressMicros The time spent decompressing the reply.
+ * @property parseMicros The time spent parsing the reply.
+ */
+data class SQLiteCloudTimings(
+    val writeStartMicros: Long,
+    val writeEndMicros: Long,
+    val firstByteMicros: Long,
+    val lastByteMicros: Long,
+    val decompressMicros: Long,
+    val parseMicros: Long,
+) {
+    /** From the command written to the first byte of the reply: the server time plus a round trip. */
+    val serverMicros: Long
+        get() = firstByteMicros - writeEndMicros
+
+    /** From the first to the last byte of the reply: the network time of a large reply. */
+    val transferMicros: Long
+        get() = lastByteMicros - firstByteMicros
+
+    /** The client CPU time spent on the reply. */
+    val clientMicros: Long
+        get() = decompressMicros + parseMicros
+
+    internal companion object {
+        fun fromNative(values: LongArray) = SQLiteCloudTimings(
+            writeStartMicros = values[0],
+            writeEndMicros = values[1],
+            firstByteMicros = values[2],
+            lastByteMicros = values[3],
+            decompressMicros = values[4],
+            parseMicros = values[5],
+        )
+    }
+}
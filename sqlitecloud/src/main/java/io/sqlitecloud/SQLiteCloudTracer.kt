@@ -0,0 +1,92 @@
+package io.sqlitecloud
+
+/**
+ * Receives the spans of the native work of a connection, see [SQLiteCloud.tracer], so that they
+ * can be turned into the spans of a tracing library such as OpenTelemetry.
+ *
+ * The methods are called on the thread doing the work: the connection thread, which runs within
+ * the coroutine context of the caller of the [SQLiteCloud] method (so a context element such as
+ * the OpenTelemetry one is current), or the pub/sub thread for [SQLiteCloudSpan.Kind.PubSub].
+ * The spans of a thread are nested: a [SQLiteCloudSpan.Kind.Chunk] ends before the
+ * [SQLiteCloudSpan.Kind.Exec] that received it. The methods must be quick and must not use the
+ * connection; an exception they throw is ignored.
+ *
+ * Example usage:
+ * ```kotlin
+ * sqliteCloud.tracer = object : SQLiteCloudTracer {
+ *     override fun beginSpan(span: SQLiteCloudSpan) =
+ *         otelTracer.spanBuilder(span.kind.name).startSpan()
+ *
+ *     override fun endSpan(handle: Any?, span: SQLiteCloudSpan) {
+ *         (handle as Span).setAttribute("db.bytes_in", span.bytesIn).end()
+ *     }
+ * }
+ * ```
+ */
+interface SQLiteCloudTracer {
+    /** Whether the spans carry the text of the commands, or only [SQLiteCloudSpan.commandHash]. */
+    val includesCommandText: Boolean
+        get() = true
+
+    /** Called when [span] begins, the returned value is passed to the [endSpan] of the same span. */
+    fun beginSpan(span: SQLiteCloudSpan): Any?
+
+    /** Called when [span] ends, with its byte counts, result type and error code. */
+    fun endSpan(handle: Any?, span: SQLiteCloudSpan)
+}
+
+/**
+ * A begin or end event of a span, see [SQLiteCloudTracer].
+ *
+ * @property kind The work traced by the span.
+ * @property command The command of an [Kind.Exec], the host of a [Kind.Connect], [Kind.Resolve]
+ *           or [Kind.TcpConnect], or the channel of a [Kind.PubSub]; `null` without one or without
+ *           [SQLiteCloudTracer.includesCommandText].
+ * @property commandHash The FNV-1a hash of [command], 0 without one.
+ * @property bytesOut The bytes written by the span, 0 at its begin.
+ * @property bytesIn The bytes read by the span (the length of the chunk or notification), 0 at its
+ *           begin.
+ * @property resultType The type of the reply, [SQLiteCloudResult.Type.OK] for a connection or
+ *           handshake that succeeded; `null` at the begin of the span.
+ * @property errorCode The error code of the connection, 0 on success.
+ * @property timestampMicros Microseconds of the monotonic clock of [SQLiteCloudTimings].
+ */
+data class SQLiteCloudSpan(
+    val kind: Kind,
+    val command: String?,
+    val commandHash: Long,
+    val bytesOut: Long,
+    val bytesIn: Long,
+    val resultType: SQLiteCloudResult.Type?,
+    val errorCode: Int,
+    val timestampMicros: Long,
+) {
+    enum class Kind {
+        /** The connection, its TLS handshakes and its configuration commands included. */
+        Connect,
+
+        /** A TLS handshake of the connection or of its pub/sub socket. */
+        TlsHandshake,
+
+        /** A command, from its write to its reply. */
+        Exec,
+
+        /** The parse of a chunk of a rowset reply, or its read with [SQLiteCloudConfig.chunkWorkers]. */
+        Chunk,
+
+        /** The delivery of a notification to the handlers. */
+        PubSub,
+
+        /** The TLS configuration of a connection, with its root certificates when not yet cached. */
+        TlsSetup,
+
+        /** The addresses of the host of a socket, from the DNS cache or from the resolver. */
+        Resolve,
+
+        /** The TCP connection of a socket, racing the addresses of the host. */
+        TcpConnect,
+
+        /** The configuration commands sent once connected, with their round trip. */
+        ConnectConfig,
+    }
+}
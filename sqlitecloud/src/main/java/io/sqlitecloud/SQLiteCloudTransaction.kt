@@ -0,0 +1,108 @@
+package io.sqlitecloud
+
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.Deferred
+
+/**
+ * The statements of a [SQLiteCloud.transaction] block.
+ *
+ * Statements are sent in flights, each one a single round trip. The first flight also carries
+ * `BEGIN`. Statements whose result the block does not need right away are queued with [enqueue]
+ * and travel with the next flight. A flight is sent by [execute] or at the end of the block, and
+ * `COMMIT` follows in a flight of its own. So a block that only enqueues writes costs two round
+ * trips, whatever the number of writes.
+ *
+ * `COMMIT` cannot share a flight with the last statements. The server would run it even after one
+ * of them failed, and commit the others.
+ *
+ * Example usage:
+ *
+ * ```kotlin
+ * sqliteCloud.transaction {
+ *     val id = (execute(SQLiteCloudCommand("INSERT INTO orders (total) VALUES (?) RETURNING id", listOf(total)))
+ *         as SQLiteCloudResult.Rowset).value.rows[0][0]
+ *     items.forEach { enqueue(SQLiteCloudCommand("INSERT INTO items (order_id, sku) VALUES (?, ?)", listOf(id, it))) }
+ * }
+ * ```
+ */
+class SQLiteCloudTransaction internal constructor(
+    private val send: suspend (List<SQLiteCloudCommand>) -> List<Result<SQLiteCloudResult>>,
+) {
+    private class Statement(val command: SQLiteCloudCommand) {
+        val result = CompletableDeferred<SQLiteCloudResult>()
+    }
+
+    private val queued = mutableListOf<Statement>()
+
+    // Set once BEGIN succeeded, the transaction then ends with COMMIT or ROLLBACK.
+    private var begun = false
+
+    /**
+     * Queues [command] to be sent with the next flight, without waiting for it.
+     *
+     * @return The result of [command], completed once its flight is back. If [command] fails, the
+     *         whole transaction fails with its error and is rolled back.
+     */
+    fun enqueue(command: SQLiteCloudCommand): Deferred<SQLiteCloudResult> =
+        Statement(command).also { queued.add(it) }.result
+
+    /**
+     * Sends the queued statements and [command] in one flight and waits for their replies.
+     *
+     * @return The result of [command].
+     *
+     * @throws SQLiteCloudError if any statement of the flight fails, the transaction is then
+     *           rolled back when the block exits with the error.
+     */
+    suspend fun execute(command: SQLiteCloudCommand): SQLiteCloudResult {
+        val result = enqueue(command)
+        flush()
+        return result.await()
+    }
+
+    internal suspend fun flush() {
+        if (queued.isEmpty()) return
+
+        val statements = queued.toList()
+        queued.clear()
+        val commands = statements.map { it.command }
+        val results = try {
+            send(if (begun) commands else listOf(beginCommand) + commands)
+        } catch (error: Throwable) {
+            statements.forEach { it.result.completeExceptionally(error) }
+            throw error
+        }
+
+        val replies = if (begun) results else results.drop(1)
+        statements.forEachIndexed { index, statement -> statement.result.completeWith(replies[index]) }
+        if (!begun) {
+            // A failed BEGIN is not rolled back: it usually means that a transaction is already
+            // open, and that transaction is not ours to end.
+            results[0].getOrThrow()
+            begun = true
+        }
+        replies.firstOrNull { it.isFailure }?.getOrThrow()
+    }
+
+    internal suspend fun commit() {
+        flush()
+        if (!begun) return
+        send(listOf(commitCommand)).single().getOrThrow()
+        begun = false
+    }
+
+    // Ends the transaction after a failure, the error of the rollback itself is not reported.
+    internal suspend fun rollback() {
+        queued.forEach { it.result.cancel() }
+        queued.clear()
+        if (!begun) return
+        begun = false
+        runCatching { send(listOf(rollbackCommand)) }
+    }
+
+    private companion object {
+        val beginCommand = SQLiteCloudCommand("BEGIN")
+        val commitCommand = SQLiteCloudCommand("COMMIT")
+        val rollbackCommand = SQLiteCloudCommand("ROLLBACK")
+    }
+}
@@ -34,6 +34,10 @@ class SQLiteCloudVM internal constructor(
      * nulls, to parameters in a compiled SQL query. The query is executed when you call
      * the [step] method on the virtual machine.
      *
+     * Bindings are not sent right away: they are queued and sent together with the next [step],
+     * so that any number of bindings costs a single round trip. The parameter index is validated
+     * immediately, while any other error reported by the server is thrown by [step].
+     *
      * @param value The value to bind to the parameter.
      * @param index The index of the parameter in the SQL query.
      *
@@ -111,6 +115,92 @@ class SQLiteCloudVM internal constructor(
         }
     }
 
+    /**
+     * Steps through up to [rows] rows of the result set and returns them all at once.
+     *
+     * This is equivalent to calling [step] [rows] times and reading every row, but the rows are
+     * copied with one native call per column instead of one per cell. The last row returned stays
+     * the current row. Fewer rows are returned at the end of the result set, and an empty rowset
+     * means that there are no more rows.
+     *
+     * @param rows The maximum number of rows to return.
+     * @return The rows, in a columnar rowset that can be closed once it has been read.
+     * @throws SQLiteCloudError if an issue occurs during the execution
+     *           of the query.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val vm = sqliteCloud.compileQuery("SELECT * FROM tracks")
+     * vm.setFetchRows(500)
+     * while (true) {
+     *     val rows = vm.fetch(500)
+     *     if (rows.rowCount == 0) break
+     *     rows.use { process(it) }
+     * }
+     * ```
+     */
+    suspend fun fetch(rows: Int): SQLiteCloudColumnarRowset = withContext(scope.coroutineContext) {
+        bridge.vmFetch(vm, rows)
+    }
+
+    /**
+     * Sets how many rows of the result set are received from the server at a time.
+     *
+     * By default the first [step] of a query receives its whole result set. With a fetch size,
+     * the server sends the result set in chunks of [rows] rows and [step] moves to the next
+     * chunk only when the current one has been consumed, so the first row is available sooner
+     * and only one chunk is kept in memory. The following chunks are sent by the server without
+     * waiting, so they are usually already received when they are needed. The connection cannot
+     * execute other commands until the last row has been stepped or the VM has been closed.
+     *
+     * @param rows The number of rows per chunk, `0` to receive the whole result set at once.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val vm = sqliteCloud.compileQuery("SELECT * FROM tracks")
+     * vm.setFetchRows(100)
+     * vm.step()
+     * ```
+     */
+    suspend fun setFetchRows(rows: Int) = withContext(scope.coroutineContext) {
+        bridge.vmSetFetchRows(vm, rows)
+    }
+
+    /**
+     * Resets the virtual machine so that the compiled statement can be executed again with
+     * [step], without compiling it again.
+     *
+     * Like bindings, the reset is sent to the server together with the next [step], so it does
+     * not cost a round trip of its own; an error reported by the server is thrown by [step].
+     * Bound values are kept unless [clearBindings] is `true`, in which case every parameter is
+     * set to `NULL`. A VM that returned a rowset has already been finalized by the server and
+     * cannot be reset.
+     *
+     * @param clearBindings Whether to set every parameter back to `NULL`.
+     *
+     * @throws SQLiteCloudError if the VM cannot be reset.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val vm = sqliteCloud.compileQuery("INSERT INTO employees (name) VALUES (?1)")
+     * for (name in names) {
+     *     vm.bindValue(SQLiteCloudVMValue.String(name), rowIndex = 1)
+     *     vm.step()
+     *     vm.reset()
+     * }
+     * vm.close()
+     * ```
+     */
+    suspend fun reset(clearBindings: Boolean = false) = withContext(scope.coroutineContext) {
+        val success = bridge.vmReset(vm) && (!clearBindings || bridge.vmClearBindings(vm))
+        if (!success) {
+            throw bridge.vmError(vm)
+        }
+    }
+
     /**
      * Retrieves all values from the current row of a virtual machine (VM) that
      * represents the result of an SQLite query.
@@ -124,10 +214,29 @@ class SQLiteCloudVM internal constructor(
      * @return An array of [SQLiteCloudVMValue] objects, each representing a value
      *            in the current row of the SQLite query result.
      */
-    suspend fun getValues(): List<SQLiteCloudVMValue> = withContext(scope.coroutineContext) {
-        (0..<columnCount()).map { index ->
-            getValue(index)
-        }
+    suspend fun getValues(): List<SQLiteCloudVMValue> = currentRow()
+
+    /**
+     * Retrieves all values from the current row of the virtual machine with a single call into
+     * the native library.
+     *
+     * The row is decoded once by the native VM, so this is cheaper than reading each column
+     * with [getValue], which costs several calls per column.
+     *
+     * @throws SQLiteCloudError if a value has an unsupported type.
+     *
+     * @return The values of the current row, one [SQLiteCloudVMValue] for each column.
+     *
+     * Example usage:
+     *
+     * ```kotlin
+     * val vm = sqliteCloud.compileQuery("SELECT id, name FROM employees")
+     * vm.step()
+     * val (id, name) = vm.currentRow()
+     * ```
+     */
+    suspend fun currentRow(): List<SQLiteCloudVMValue> = withContext(scope.coroutineContext) {
+        bridge.vmCurrentRow(vm, SQLiteCloudAccessors.vmColumnCount(vm))
     }
 
     /**
@@ -166,6 +275,15 @@ class SQLiteCloudVM internal constructor(
      * prepared for executing an SQLite query. Closing the VM releases any resources
      * associated with it and finalizes the prepared statement.
      *
+     * If the statement cache of the connection is enabled (see
+     * [SQLiteCloudConfig.statementCacheSize]), the VM is reset and kept for the next
+     * [SQLiteCloud.compileQuery] of the same SQL instead, and it is finalized only when it is
+     * evicted from the cache or the connection is closed.
+     *
+     * The finalize command does not cost a round trip of its own: it is sent to the server
+     * together with the next command executed on the same connection, so closing a VM never
+     * blocks on the network.
+     *
      * - Note: Closing the VM is important to free up resources and maintain the
      *         integrity of the SQLite database.
      *
@@ -188,7 +306,7 @@ class SQLiteCloudVM internal constructor(
      * @return An [Int] value representing the number of columns in the result set.
      */
     suspend fun columnCount(): Int = withContext(scope.coroutineContext) {
-        bridge.vmColumnCount(vm)
+        SQLiteCloudAccessors.vmColumnCount(vm)
     }
 
 
@@ -202,7 +320,7 @@ class SQLiteCloudVM internal constructor(
      * @return A [Long] value representing the identifier (row ID) of the last inserted row.
      */
     suspend fun lastRowID(): Long = withContext(scope.coroutineContext) {
-        bridge.vmLastRowID(vm)
+        SQLiteCloudAccessors.vmLastRowID(vm)
     }
 
     /**
@@ -224,7 +342,7 @@ class SQLiteCloudVM internal constructor(
      *            inserted, or deleted.
      */
     suspend fun changes(): Long = withContext(scope.coroutineContext) {
-        bridge.vmChanges(vm)
+        SQLiteCloudAccessors.vmChanges(vm)
     }
 
     /**
@@ -239,7 +357,7 @@ class SQLiteCloudVM internal constructor(
      *            modified, inserted, or deleted since the database connection was opened.
      */
     suspend fun totalChanges(): Long = withContext(scope.coroutineContext) {
-        bridge.vmTotalChanges(vm)
+        SQLiteCloudAccessors.vmTotalChanges(vm)
     }
 
     /**
@@ -343,7 +461,7 @@ class SQLiteCloudVM internal constructor(
      */
     suspend fun columnType(index: Int): SQLiteCloudValue.Type = withContext(scope.coroutineContext) {
         try {
-            SQLiteCloudValue.Type.fromRawValue(bridge.vmColumnType(vm, index))
+            SQLiteCloudValue.Type.fromRawValue(SQLiteCloudAccessors.vmColumnType(vm, index))
         } catch (e: Error) {
             SQLiteCloudValue.Type.Unknown
         }
@@ -375,7 +493,7 @@ class SQLiteCloudVM internal constructor(
      *            the specified column index.
      */
     suspend fun intergerValue(index: Int): SQLiteCloudVMValue = withContext(scope.coroutineContext) {
-        SQLiteCloudVMValue.Integer64(bridge.vmColumnInt64(vm, index))
+        SQLiteCloudVMValue.Integer64(SQLiteCloudAccessors.vmColumnInt64(vm, index))
     }
 
     /**
@@ -390,7 +508,7 @@ class SQLiteCloudVM internal constructor(
      *            specified column index.
      */
     suspend fun doubleValue(index: Int): SQLiteCloudVMValue = withContext(scope.coroutineContext) {
-        SQLiteCloudVMValue.Double(bridge.vmColumnDouble(vm, index))
+        SQLiteCloudVMValue.Double(SQLiteCloudAccessors.vmColumnDouble(vm, index))
     }
 
     /**
@@ -1,6 +1,8 @@
 package io.sqlitecloud
 
+import java.io.File
 import java.nio.ByteBuffer
+import java.nio.channels.FileChannel
 import java.nio.charset.Charset
 import java.nio.charset.CodingErrorAction
 
@@ -17,6 +19,19 @@ sealed class SQLiteCloudValue(open val value: Any?, internal val typeValue: Int)
     data class Blob(override val value: ByteBuffer) :
         SQLiteCloudValue(value, typeValue = Type.Blob.rawValue)
 
+    /**
+     * A BLOB parameter read from [value] while the command is sent, so that a large file is
+     * never loaded into memory. The file must not change until the command has been executed.
+     * Commands sent together with [SQLiteCloud.executeAll] or queued offline read it whole.
+     */
+    data class BlobFile(override val value: File) :
+        SQLiteCloudValue(value, typeValue = Type.Blob.rawValue) {
+        // The content as a read-only buffer, for the paths that cannot stream it.
+        internal fun mapped(): ByteBuffer = FileChannel.open(value.toPath()).use { channel ->
+            channel.map(FileChannel.MapMode.READ_ONLY, 0, channel.size())
+        }
+    }
+
     data object Null : SQLiteCloudValue(null, typeValue = Type.Null.rawValue)
 
     val stringValue: kotlin.String?
@@ -25,6 +40,7 @@ sealed class SQLiteCloudValue(open val value: Any?, internal val typeValue: Int)
             is Double -> "$value"
             is String -> value
             is Blob -> byteBufferToString(value)
+            is BlobFile -> byteBufferToString(mapped())
             is Null -> null
         }
 
@@ -41,6 +57,10 @@ sealed class SQLiteCloudValue(open val value: Any?, internal val typeValue: Int)
                     position(limit())
                     this
                 }
+                is BlobFile -> mapped().run {
+                    position(limit())
+                    this
+                }
                 is Null -> null
             }
             buffer?.flip()
@@ -48,6 +68,9 @@ sealed class SQLiteCloudValue(open val value: Any?, internal val typeValue: Int)
         }
 
     companion object {
+        // VALUE_BLOB_FILE, the native type of a [BlobFile] parameter (never the type of a cell).
+        internal const val blobFileTypeValue = 6
+
         private fun byteBufferToString(byteBuffer: ByteBuffer): kotlin.String {
             val charset = Charset.defaultCharset()
             val decoder = charset.newDecoder()
@@ -67,7 +90,14 @@ sealed class SQLiteCloudValue(open val value: Any?, internal val typeValue: Int)
         Unknown(-1);
 
         companion object {
-            fun fromRawValue(rawValue: Int): Type = values().first { it.rawValue == rawValue }
+            fun fromRawValue(rawValue: Int): Type = when (rawValue) {
+                1 -> Type.Integer
+                2 -> Type.Double
+                3 -> Type.String
+                4 -> Type.Blob
+                5 -> Type.Null
+                else -> Type.Unknown
+            }
         }
     }
 }
@@ -0,0 +1,99 @@
+package io.sqlitecloud
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotSame
+import org.junit.Assert.assertSame
+import org.junit.Test
+
+class SQLiteCloudArrayPoolTest {
+    @Test
+    fun arraysAreAllocatedByPowerOfTwoSizeClass() {
+        val pool = SQLiteCloudArrayPool(1 shl 20)
+
+        assertEquals(16, pool.bytes(1).size)
+        assertEquals(16, pool.ints(16).size)
+        assertEquals(128, pool.longs(100).size)
+        assertEquals(1024, pool.doubles(513).size)
+    }
+
+    @Test
+    fun releasedArrayIsBorrowedAgainInItsSizeClass() {
+        val pool = SQLiteCloudArrayPool(1 shl 20)
+        val first = pool.ints(100)
+        val second = pool.ints(120)
+        pool.release(first, second)
+
+        // the last released comes back first, for any length of the same class
+        assertSame(second, pool.ints(65))
+        assertSame(first, pool.ints(128))
+        assertNotSame(first, pool.ints(100))
+
+        // another class or another kind does not get it
+        val longs = pool.longs(100)
+        pool.release(longs)
+        assertNotSame(longs, pool.longs(200))
+        assertEquals(128, pool.doubles(100).size)
+        assertSame(longs, pool.longs(100))
+    }
+
+    @Test
+    fun arraysNotAllocatedByThePoolAreIgnored() {
+        val pool = SQLiteCloudArrayPool(1 shl 20)
+        val small = ByteArray(8)
+        val odd = ByteArray(100)
+        pool.release(small, odd, "not an array")
+
+        assertNotSame(small, pool.bytes(8))
+        assertNotSame(odd, pool.bytes(100))
+        assertEquals(128, pool.bytes(100).size)
+    }
+
+    @Test
+    fun arraysBeyondTheCapacityAreNotKept() {
+        // room for two arrays of 128 longs
+        val pool = SQLiteCloudArrayPool(2 * 128 * 8)
+        val arrays = List(3) { pool.longs(128) }
+        pool.release(*arrays.toTypedArray())
+
+        assertSame(arrays[1], pool.longs(128))
+        assertSame(arrays[0], pool.longs(128))
+        assertNotSame(arrays[2], pool.longs(128))
+
+        // borrowing gives the room back
+        pool.release(arrays[2])
+        assertSame(arrays[2], pool.longs(128))
+    }
+
+    @Test
+    fun clearDropsEveryFreeArray() {
+        val pool = SQLiteCloudArrayPool(1 shl 20)
+        val bytes = pool.bytes(64)
+        pool.release(bytes)
+        pool.clear()
+
+        assertNotSame(bytes, pool.bytes(64))
+    }
+
+    @Test
+    fun closedRowsetGivesItsArraysBack() {
+        val pool = SQLiteCloudArrayPool(1 shl 20)
+        val column = SQLiteCloudColumnarRowset.Column(
+            types = pool.bytes(2).apply { fill(SQLiteCloudValue.Type.Integer.rawValue.toByte(), 0, 2) },
+            longs = pool.longs(2).apply { this[0] = 1; this[1] = 2 },
+            doubles = pool.doubles(2),
+            offsets = pool.ints(3),
+            bytes = pool.bytes(0),
+            rows = 2,
+        )
+        val rowset = SQLiteCloudColumnarRowset(listOf("id"), 2, listOf(column), pool)
+        assertEquals(2L, rowset.getLong(1, 0))
+
+        rowset.close()
+        rowset.close()
+        assertSame(column.longs, pool.longs(2))
+        assertSame(column.doubles, pool.doubles(2))
+        assertSame(column.offsets, pool.ints(3))
+        val error = runCatching { rowset.getLong(0, 0) }.exceptionOrNull()
+        assertEquals(SQLiteCloudError.Execution.closedRowset, error)
+    }
+}
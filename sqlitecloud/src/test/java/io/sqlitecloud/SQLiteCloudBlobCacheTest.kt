@@ -0,0 +1,116 @@
+package io.sqlitecloud
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertNull
+import org.junit.Rule
+import org.junit.Test
+import org.junit.rules.TemporaryFolder
+import java.io.File
+import java.nio.ByteBuffer
+
+class SQLiteCloudBlobCacheTest {
+    @get:Rule
+    val folder = TemporaryFolder()
+
+    private val photos = SQLiteCloudBlobInfo(table = "Photos", column = "data")
+    private val documents = SQLiteCloudBlobInfo(table = "documents", column = "data")
+
+    // the directory of the last cache created
+    private lateinit var directory: File
+
+    private fun cache(capacity: Long): SQLiteCloudBlobCache {
+        directory = folder.newFolder()
+        return SQLiteCloudBlobCache(directory, capacity)
+    }
+
+    // the files of the entries still in the cache
+    private fun files(): Int = directory.listFiles()?.size ?: 0
+
+    private fun blob(size: Int, fill: Int) = BlobIO.Write.Buffer(ByteBuffer.wrap(ByteArray(size) { fill.toByte() }))
+
+    private fun SQLiteCloudBlobCache.store(info: SQLiteCloudBlobInfo, rowId: Long, size: Int, fill: Int) =
+        put(info, rowId, currentGeneration, blob(size, fill))
+
+    @Test
+    fun hitIsMappedFromTheStoredContent() {
+        val cache = cache(1000)
+        val written = blob(100, 7)
+        cache.put(photos, 1, cache.currentGeneration, written)
+
+        // the identifiers are case insensitive, the buffer written is not moved
+        val hit = cache.get(SQLiteCloudBlobInfo(table = "PHOTOS", column = "DATA"), 1)
+        assertNotNull(hit)
+        assertEquals(written.buffer, hit)
+        assertEquals(0, written.buffer.position())
+        assertNull(cache.get(photos, 2))
+        assertNull(cache.get(SQLiteCloudBlobInfo(schema = "other", table = "Photos", column = "data"), 1))
+    }
+
+    @Test
+    fun leastRecentlyUsedFilesAreDeletedOverCapacity() {
+        val cache = cache(250)
+        cache.store(photos, 1, 100, 1)
+        cache.store(photos, 2, 100, 2)
+        cache.get(photos, 1)
+        cache.store(photos, 3, 100, 3)
+
+        // the second one was used least recently
+        assertNull(cache.get(photos, 2))
+        assertNotNull(cache.get(photos, 1))
+        assertNotNull(cache.get(photos, 3))
+        assertEquals(2, files())
+
+        // a BLOB larger than the cache is never stored
+        cache.store(photos, 4, 1000, 4)
+        assertNull(cache.get(photos, 4))
+        assertEquals(2, files())
+    }
+
+    @Test
+    fun changeNotificationsDeleteTheFilesOfTheirTable() {
+        val cache = cache(1000)
+        cache.store(photos, 1, 10, 1)
+        cache.store(documents, 1, 10, 2)
+
+        cache.invalidate("PHOTOS")
+        assertNull(cache.get(photos, 1))
+        assertNotNull(cache.get(documents, 1))
+
+        cache.store(photos, 1, 10, 1)
+        cache.invalidate(SQLiteCloudChannel.AllTables.name)
+        assertNull(cache.get(photos, 1))
+        assertNull(cache.get(documents, 1))
+        assertEquals(0, files())
+    }
+
+    @Test
+    fun writtenRowsAreDeletedAndStaleReadsAreNotStored() {
+        val cache = cache(1000)
+        cache.store(photos, 1, 10, 1)
+        cache.store(photos, 2, 10, 2)
+
+        cache.invalidate(photos, listOf(1L))
+        assertNull(cache.get(photos, 1))
+        assertNotNull(cache.get(photos, 2))
+
+        // read before the BLOB is opened, the notification arrives while it is being read
+        val generation = cache.currentGeneration
+        cache.invalidate("photos")
+        cache.put(photos, 3, generation, blob(10, 3))
+        assertNull(cache.get(photos, 3))
+    }
+
+    @Test
+    fun tablesAreListenedToOnceUntilCleared() {
+        val cache = cache(1000)
+        assertEquals("Photos", cache.unlistenedTable(photos))
+        cache.setListening("photos")
+        assertNull(cache.unlistenedTable(photos))
+
+        cache.store(photos, 1, 10, 1)
+        cache.clear()
+        assertNull(cache.get(photos, 1))
+        assertEquals("Photos", cache.unlistenedTable(photos))
+    }
+}
@@ -0,0 +1,59 @@
+package io.sqlitecloud
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+
+class SQLiteCloudCommandLatencyTest {
+    private val bucketCount = SQLiteCloudCommandLatency.bucketCount
+
+    // a histogram with count latencies in each bucket
+    private fun histogram(vararg counts: Pair<Int, Int>): List<Int> {
+        val counters = MutableList(bucketCount) { 0 }
+        counts.forEach { (bucket, count) -> counters[bucket] += count }
+        return counters
+    }
+
+    @Test
+    fun bucketLimitsMatchTheNativeLayout() {
+        // one microsecond per bucket below 16, then 8 buckets per power of two
+        assertEquals(1L, SQLiteCloudCommandLatency.bucketLimitMicros(0))
+        assertEquals(16L, SQLiteCloudCommandLatency.bucketLimitMicros(15))
+        assertEquals(18L, SQLiteCloudCommandLatency.bucketLimitMicros(16))
+        assertEquals(32L, SQLiteCloudCommandLatency.bucketLimitMicros(23))
+        assertEquals(36L, SQLiteCloudCommandLatency.bucketLimitMicros(24))
+
+        for (index in 17 until bucketCount) {
+            val lower = SQLiteCloudCommandLatency.bucketLimitMicros(index - 1)
+            val limit = SQLiteCloudCommandLatency.bucketLimitMicros(index)
+            assertTrue(limit > lower && (limit - lower) * 8 <= lower)
+        }
+    }
+
+    @Test
+    fun percentilesAreTheLimitsOfTheirBuckets() {
+        val counters = histogram(10 to 90, 100 to 9, 200 to 1)
+        val latency = SQLiteCloudCommandLatency(mapOf(SQLiteCloudCommandLatency.Kind.Query to counters))
+
+        assertEquals(SQLiteCloudCommandLatency.bucketLimitMicros(10), latency.percentileMicros(SQLiteCloudCommandLatency.Kind.Query, 0.5))
+        assertEquals(SQLiteCloudCommandLatency.bucketLimitMicros(10), latency.percentileMicros(SQLiteCloudCommandLatency.Kind.Query, 0.8))
+        assertEquals(SQLiteCloudCommandLatency.bucketLimitMicros(100), latency.percentileMicros(SQLiteCloudCommandLatency.Kind.Query, 0.95))
+        assertEquals(SQLiteCloudCommandLatency.bucketLimitMicros(200), latency.percentileMicros(SQLiteCloudCommandLatency.Kind.Query, 1.0))
+        assertEquals(0L, latency.percentileMicros(SQLiteCloudCommandLatency.Kind.Blob, 0.99))
+    }
+
+    @Test
+    fun plusAddsTheCountersOfEachKind() {
+        val first = SQLiteCloudCommandLatency(mapOf(SQLiteCloudCommandLatency.Kind.Query to histogram(10 to 1)))
+        val second = SQLiteCloudCommandLatency(mapOf(
+            SQLiteCloudCommandLatency.Kind.Query to histogram(10 to 2, 50 to 1),
+            SQLiteCloudCommandLatency.Kind.PubSub to histogram(30 to 4),
+        ))
+        val merged = first + second
+
+        assertEquals(histogram(10 to 3, 50 to 1), merged.histograms[SQLiteCloudCommandLatency.Kind.Query])
+        assertEquals(histogram(30 to 4), merged.histograms[SQLiteCloudCommandLatency.Kind.PubSub])
+        assertEquals(histogram(), merged.histograms[SQLiteCloudCommandLatency.Kind.Blob])
+        assertEquals(SQLiteCloudCommandLatency.bucketLimitMicros(50), merged.percentileMicros(SQLiteCloudCommandLatency.Kind.Query, 1.0))
+    }
+}
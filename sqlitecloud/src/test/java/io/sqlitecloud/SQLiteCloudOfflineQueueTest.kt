@@ -0,0 +1,145 @@
+package io.sqlitecloud
+
+import kotlinx.coroutines.runBlocking
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertTrue
+import org.junit.Rule
+import org.junit.Test
+import org.junit.rules.TemporaryFolder
+import java.nio.ByteBuffer
+
+class SQLiteCloudOfflineQueueTest {
+    @get:Rule
+    val folder = TemporaryFolder()
+
+    // A server that runs the pipelines of the replay: the writes of a savepoint are only applied
+    // once it is released, and the log table is a set of keys.
+    private class FakeServer {
+        val applied = mutableListOf<SQLiteCloudCommand>()
+        val logKeys = mutableSetOf<String>()
+        var refused: (SQLiteCloudCommand) -> Boolean = { false }
+        var loseNextRelease = false
+
+        private val pendingWrites = mutableListOf<SQLiteCloudCommand>()
+        private val pendingKeys = mutableListOf<String>()
+
+        suspend fun send(commands: List<SQLiteCloudCommand>): List<Result<SQLiteCloudResult>> {
+            val results = commands.map { execute(it) }
+            if (loseNextRelease && commands.any { it.query.startsWith("RELEASE") }) {
+                loseNextRelease = false
+                throw SQLiteCloudError.Connection(code = -1, message = "Connection lost")
+            }
+            return results
+        }
+
+        private fun execute(command: SQLiteCloudCommand): Result<SQLiteCloudResult> {
+            val query = command.query
+            when {
+                query.startsWith("SELECT key") -> {
+                    val rows = command.parameters.map { (it as SQLiteCloudValue.String).value }
+                        .filter { it in logKeys }
+                        .map { listOf(SQLiteCloudValue.String(it)) }
+                    return Result.success(SQLiteCloudResult.Rowset(SQLiteCloudRowset(listOf("key"), rows)))
+                }
+                query.startsWith("SAVEPOINT") || query.startsWith("ROLLBACK") -> {
+                    pendingWrites.clear()
+                    pendingKeys.clear()
+                }
+                query.startsWith("RELEASE") -> {
+                    applied.addAll(pendingWrites)
+                    logKeys.addAll(pendingKeys)
+                    pendingWrites.clear()
+                    pendingKeys.clear()
+                }
+                query.startsWith("INSERT INTO sqlitecloud_offline_log") ->
+                    pendingKeys.addAll(command.parameters.map { (it as SQLiteCloudValue.String).value })
+                query.startsWith("CREATE") || query.startsWith("DELETE") -> Unit
+                refused(command) -> return Result.failure(SQLiteCloudError.Execution(code = 19, message = "constraint failed"))
+                else -> pendingWrites.add(command)
+            }
+            return Result.success(SQLiteCloudResult.Success)
+        }
+    }
+
+    private fun write(id: Long) = SQLiteCloudCommand(
+        "INSERT INTO events (id, name, payload, score) VALUES (?, ?, ?, ?)",
+        SQLiteCloudValue.Integer(id),
+        SQLiteCloudValue.String("event $id"),
+        SQLiteCloudValue.Blob(ByteBuffer.wrap(byteArrayOf(1, 2, id.toByte()))),
+        if (id % 2 == 0L) SQLiteCloudValue.Null else SQLiteCloudValue.Double(id / 2.0),
+    )
+
+    @Test
+    fun writesSurviveReopeningAndReplayInOrder() = runBlocking {
+        val file = folder.newFile("queue")
+        val writes = (1..3L).map { write(it) }
+        val queue = SQLiteCloudOfflineQueue(file)
+        writes.forEach { queue.append(it) }
+
+        // a new process opens the same file
+        val reopened = SQLiteCloudOfflineQueue(file)
+        val server = FakeServer()
+        assertFalse(reopened.isEmpty)
+        assertEquals(3, reopened.replay(server::send) { throw it.error })
+
+        assertEquals(writes, server.applied)
+        assertEquals(3, server.logKeys.size)
+        assertTrue(reopened.isEmpty)
+        assertEquals(0L, file.length())
+    }
+
+    @Test
+    fun tornRecordIsCutOffWhenTheQueueIsOpened() = runBlocking {
+        val file = folder.newFile("queue")
+        val queue = SQLiteCloudOfflineQueue(file)
+        queue.append(write(1))
+        val valid = file.length()
+        // the length and the CRC of a record whose payload was never written
+        file.appendBytes(byteArrayOf(0, 0, 0, 100, 1, 2, 3, 4, 5))
+
+        val reopened = SQLiteCloudOfflineQueue(file)
+        assertEquals(valid, file.length())
+        reopened.append(write(2))
+        val server = FakeServer()
+        reopened.replay(server::send) { throw it.error }
+
+        assertEquals(listOf(write(1), write(2)), server.applied)
+    }
+
+    @Test
+    fun refusedWriteIsReportedAndTheOthersAreApplied() = runBlocking {
+        val queue = SQLiteCloudOfflineQueue(folder.newFile("queue"))
+        queue.append(write(1))
+        val refusedKey = queue.append(write(2))
+        queue.append(write(3))
+
+        val server = FakeServer().apply { refused = { it == write(2) } }
+        val failures = mutableListOf<SQLiteCloudOfflineFailure>()
+        val applied = queue.replay(server::send) { failures.add(it) }
+
+        assertEquals(2, applied)
+        assertEquals(listOf(write(1), write(3)), server.applied)
+        assertEquals(listOf(refusedKey), failures.map { it.key })
+        assertEquals(write(2), failures.single().command)
+        assertTrue(queue.isEmpty)
+    }
+
+    @Test
+    fun batchWhoseReplyWasLostIsNotAppliedTwice() = runBlocking {
+        val queue = SQLiteCloudOfflineQueue(folder.newFile("queue"))
+        queue.append(write(1))
+        queue.append(write(2))
+
+        // the batch is committed but its reply never arrives
+        val server = FakeServer().apply { loseNextRelease = true }
+        val lost = runCatching { queue.replay(server::send) { throw it.error } }
+        assertTrue(lost.exceptionOrNull() is SQLiteCloudError.Connection)
+        assertFalse(queue.isEmpty)
+
+        // the keys found in the log table skip the writes at the next replay
+        assertEquals(0, queue.replay(server::send) { throw it.error })
+        assertEquals(listOf(write(1), write(2)), server.applied)
+        assertTrue(queue.isEmpty)
+    }
+}
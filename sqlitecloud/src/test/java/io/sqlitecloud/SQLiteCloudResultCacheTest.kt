@@ -0,0 +1,103 @@
+package io.sqlitecloud
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import java.nio.ByteBuffer
+
+class SQLiteCloudResultCacheTest {
+    // the fake native results released by the cache, in order
+    private val released = mutableListOf<OpaquePointer<SQLiteCloudResult>>()
+
+    private fun cache(capacity: Long) = SQLiteCloudResultCache(capacity) { released.add(it) }
+
+    private fun read(query: String, vararg tables: String) =
+        SQLiteCloudCommand(query, cacheTables = tables.toList())
+
+    @Test
+    fun hitParsesTheStoredResultUntilItsTableChanges() {
+        val cache = cache(1000)
+        val command = read("SELECT * FROM albums WHERE id = ?1", "Albums")
+            .copy(parameters = listOf(SQLiteCloudValue.Integer(1)))
+
+        assertTrue(cache.put(command, 1L, 100, cache.currentGeneration))
+        assertEquals(1L, cache.get(command) { it })
+        assertNull(cache.get(command.copy(parameters = listOf(SQLiteCloudValue.Integer(2)))) { it })
+
+        // table names are case insensitive, other tables keep their entries
+        cache.invalidate("artists")
+        assertTrue(cache.contains(command))
+        cache.invalidate("ALBUMS")
+        assertFalse(cache.contains(command))
+        assertEquals(listOf(1L), released)
+        assertEquals(0L, cache.currentSize)
+    }
+
+    @Test
+    fun allTablesAndMissingChannelReleaseEverything() {
+        val cache = cache(1000)
+        val albums = read("SELECT * FROM albums", "albums")
+        val artists = read("SELECT * FROM artists", "artists")
+
+        cache.put(albums, 1L, 10, cache.currentGeneration)
+        cache.put(artists, 2L, 10, cache.currentGeneration)
+        cache.invalidate(SQLiteCloudChannel.AllTables.name)
+        assertEquals(setOf(1L, 2L), released.toSet())
+
+        cache.put(albums, 3L, 10, cache.currentGeneration)
+        cache.invalidate(null)
+        assertFalse(cache.contains(albums))
+        assertEquals(3L, released.last())
+    }
+
+    @Test
+    fun leastRecentlyUsedEntriesAreReleasedOverCapacity() {
+        val cache = cache(250)
+        val first = read("SELECT 1", "t")
+        val second = read("SELECT 2", "t")
+        val third = read("SELECT 3", "t")
+
+        cache.put(first, 1L, 100, cache.currentGeneration)
+        cache.put(second, 2L, 100, cache.currentGeneration)
+        cache.get(first) { it }
+        cache.put(third, 3L, 100, cache.currentGeneration)
+
+        // the second one was used least recently
+        assertEquals(listOf(2L), released)
+        assertTrue(cache.contains(first) && cache.contains(third))
+        assertTrue(cache.currentSize <= 250)
+
+        // a result larger than the cache is never stored
+        assertFalse(cache.put(read("SELECT 4", "t"), 4L, 1000, cache.currentGeneration))
+    }
+
+    @Test
+    fun resultReceivedWhileItsTableChangedIsNotStored() {
+        val cache = cache(1000)
+        val command = read("SELECT * FROM albums", "albums")
+
+        // read before the command is sent, the notification arrives while the reply is in flight
+        val generation = cache.currentGeneration
+        cache.invalidate("albums")
+        assertFalse(cache.put(command, 1L, 10, generation))
+        assertFalse(cache.contains(command))
+    }
+
+    @Test
+    fun tablesAreListenedToOnceAndBlobCommandsAreNotCached() {
+        val cache = cache(1000)
+        val command = read("SELECT * FROM albums JOIN artists", "Albums", "artists")
+
+        assertEquals(listOf("albums", "artists"), cache.unlistenedTables(command))
+        cache.setListening("ALBUMS")
+        assertEquals(listOf("artists"), cache.unlistenedTables(command))
+        cache.clear()
+        assertEquals(listOf("albums", "artists"), cache.unlistenedTables(command))
+
+        assertTrue(cache.isCacheable(command))
+        assertFalse(cache.isCacheable(read("SELECT 1")))
+        assertFalse(cache.isCacheable(command.copy(parameters = listOf(SQLiteCloudValue.Blob(ByteBuffer.allocate(4))))))
+    }
+}